@@ -0,0 +1,108 @@
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+
+void run_aggregate_bench(size_t rows) {
+    size_t failures = 0;
+    const int32_t customers = 10000;
+
+    Database db;
+    db.execute("CREATE TABLE sales (id: int32, customer: int32, region: string[16], amount: int32, returned: bool)");
+    shared_ptr<Table> sales = db.get_table("sales");
+    for (size_t start = 0; start < rows; start += 65536) {
+        vector<ColumnStorage> batch;
+        for (const auto& column : sales->get_columns()) {
+            batch.emplace_back(column.get_type());
+        }
+        for (size_t i = start; i < min(rows, start + 65536); ++i) {
+            batch[0].append_int32(static_cast<int32_t>(i));
+            batch[1].append_int32(static_cast<int32_t>((i * 7919) % customers));
+            batch[2].append_string("region_" + to_string(i % 24));
+            batch[3].append_int32(static_cast<int32_t>(i % 1000));
+            batch[4].append_bool(i % 3 == 0);
+        }
+        sales->append_columns(batch);
+    }
+
+    // What applications did before: copy every row out and group them by hand.
+    int64_t expected_total = 0;
+    size_t expected_groups = 0;
+    string expected_min_region;
+    string expected_max_region;
+    int64_t expected_returned = 0;
+    {
+        BenchTimer timer;
+        unordered_map<int32_t, int64_t> totals;
+        for (const Row& row : sales->get_rows()) {
+            totals[row.get_int32(1)] += row.get_int32(3);
+        }
+        for (const auto& [customer, total] : totals) {
+            expected_total += total;
+        }
+        expected_groups = totals.size();
+        report("aggregate", "get_rows_group_by_customer", timer.elapsed_ms(), "ms");
+    }
+    for (const Row& row : sales->get_rows()) {
+        string region(row.get_string(2));
+        if (expected_min_region.empty() || region < expected_min_region) {
+            expected_min_region = region;
+        }
+        expected_max_region = max(expected_max_region, region);
+        expected_returned += row.get_bool(4);
+    }
+
+    vector<size_t> thread_counts = {1};
+    if (thread::hardware_concurrency() > 1) {
+        thread_counts.push_back(thread::hardware_concurrency());
+    }
+    for (size_t threads : thread_counts) {
+        db.set_scan_threads(threads);
+        string suffix = '_' + to_string(threads) + "_threads";
+        {
+            BenchTimer timer;
+            auto [groups, total] = drain(db.query_batches("SELECT customer, SUM(amount) FROM sales GROUP BY customer"), 1);
+            report("aggregate", "group_by_int32" + suffix, timer.elapsed_ms(), "ms");
+            if (total != expected_total || groups != expected_groups) {
+                cerr << "aggregate: GROUP BY customer disagrees with the rows" << endl;
+                ++failures;
+            }
+        }
+        {
+            BenchTimer timer;
+            auto [groups, total] = drain(db.query_batches("SELECT region, customer, SUM(amount) FROM sales GROUP BY region, customer"), 2);
+            report("aggregate", "group_by_string_int32" + suffix, timer.elapsed_ms(), "ms");
+            if (total != expected_total) {
+                cerr << "aggregate: GROUP BY region, customer disagrees with the rows" << endl;
+                ++failures;
+            }
+            report("aggregate", "string_int32_groups", static_cast<double>(groups), "groups");
+        }
+        {
+            BenchTimer timer;
+            auto [groups, total] = drain(db.query_batches("SELECT SUM(amount), COUNT(*), MIN(amount), MAX(amount) FROM sales"), 0);
+            report("aggregate", "ungrouped" + suffix, timer.elapsed_ms(), "ms");
+            if (total != expected_total || groups != 1) {
+                cerr << "aggregate: ungrouped SUM disagrees with the rows" << endl;
+                ++failures;
+            }
+        }
+        {
+            // MIN and MAX of a string column, SUM of a bool column.
+            BenchTimer timer;
+            ExecutionPlan plan = db.query_batches("SELECT MIN(region), MAX(region), SUM(returned) FROM sales");
+            Batch batch;
+            bool matched = plan.root->next(batch) && batch.size() == 1 && batch.columns[0].string_values[0] == expected_min_region
+                        && batch.columns[1].string_values[0] == expected_max_region && batch.columns[2].int64_values[0] == expected_returned;
+            report("aggregate", "ungrouped_string_bool" + suffix, timer.elapsed_ms(), "ms");
+            if (!matched) {
+                cerr << "aggregate: MIN/MAX of a string or SUM of a bool disagrees with the rows" << endl;
+                ++failures;
+            }
+        }
+    }
+    report("aggregate", "check_failures", static_cast<double>(failures), "");
+}
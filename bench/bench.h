@@ -0,0 +1,199 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+class Column;
+class ColumnStorage;
+struct ExecutionPlan;
+class Table;
+
+class BenchTimer {
+public:
+    BenchTimer() : start(chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    chrono::steady_clock::time_point start;
+};
+
+// Bytes currently allocated on the heap, or 0 where the allocator cannot tell us.
+inline size_t heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// How generated keys are spread over their domain. ZIPFIAN makes key 0 the
+// most frequent, then key 1, and so on.
+enum class KeyDistribution { SEQUENTIAL, UNIFORM, ZIPFIAN };
+
+// Settings shared by every bench, taken from the command line.
+struct BenchOptions {
+    size_t rows = 1000000;
+    uint64_t seed = 42;
+    KeyDistribution distribution = KeyDistribution::UNIFORM;
+    // Zipfian exponent, in (0, 1).
+    double skew = 0.99;
+    // Length generated strings are padded to; 0 leaves them as they are. At
+    // most MAX_STRING_LENGTH, the narrowest column they are stored in.
+    size_t string_length = 0;
+
+    static constexpr size_t MAX_STRING_LENGTH = 32;
+};
+
+const char* distribution_name(KeyDistribution distribution);
+
+const BenchOptions& bench_options();
+
+void set_bench_options(const BenchOptions& options);
+
+// Keys in [0, domain), drawn as bench_options() says. Generators with the
+// same seed and stream produce the same keys, so runs can be compared.
+class KeyGenerator {
+public:
+    explicit KeyGenerator(size_t domain, uint64_t stream = 0);
+
+    size_t next();
+
+private:
+    size_t domain;
+    KeyDistribution distribution;
+    size_t position = 0;
+    mt19937_64 engine;
+    uniform_real_distribution<double> unit{0.0, 1.0};
+    // Zipfian constants, after Gray et al., "Quickly Generating
+    // Billion-Record Synthetic Databases".
+    double theta = 0;
+    double zeta_n = 0;
+    double alpha = 0;
+    double eta = 0;
+};
+
+// `prefix` followed by `key`, padded with 'x' to bench_options().string_length.
+string make_text(string_view prefix, size_t key);
+
+struct BenchResult {
+    string bench;
+    string metric;
+    double value;
+    string unit;
+};
+
+// Prints a measurement and records it for the JSON report.
+void report(const string& bench, const string& metric, double value, const string& unit);
+
+const vector<BenchResult>& bench_results();
+
+struct BenchReport {
+    // The options as a JSON object; runs are only comparable when these match.
+    string options;
+    vector<BenchResult> results;
+};
+
+// Writes the options and every result reported so far as JSON.
+void write_json_report(ostream& out);
+
+// A report written by write_json_report.
+BenchReport read_json_report(istream& in);
+
+// bench_options() as written to the report.
+string options_json();
+
+// Compares the results with `baseline`, printing every metric that got worse
+// by more than `threshold_percent`, and every failed correctness check.
+// Timings, sizes and memory should go down, rates ("/s") and speedups ("x")
+// up; other units are counts and are not compared. Returns the number of
+// regressions and failed checks.
+size_t check_regressions(const vector<BenchResult>& baseline, double threshold_percent);
+
+// Appends `rows` rows to `table` in batches laid out like its columns;
+// `append_row(batch, i)` appends the values of row i to every column.
+void fill_table(Table& table, size_t rows, const function<void(vector<ColumnStorage>&, size_t)>& append_row);
+
+// A table `name` with `columns`, filled by fill_table.
+shared_ptr<Table> make_table(const string& name, const vector<Column>& columns, size_t rows,
+                             const function<void(vector<ColumnStorage>&, size_t)>& append_row);
+
+// Whether `actual` holds the same values as `expected`, and unless
+// `values_only` the same column definitions, counters and indexes.
+bool same_table(const Table& expected, const Table& actual, bool values_only = false);
+
+// Runs `plan` to the end. Returns the rows it produced and the sum of the
+// int32 and int64 values in `column`, or in every column by default.
+pair<size_t, int64_t> drain(ExecutionPlan& plan, size_t column = numeric_limits<size_t>::max());
+
+pair<size_t, int64_t> drain(ExecutionPlan&& plan, size_t column = numeric_limits<size_t>::max());
+
+// Keeps the optimizer from discarding benchmark results.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+void run_storage_bench(size_t rows);
+
+void run_parser_bench(size_t statements);
+
+void run_prepared_bench(size_t rows);
+
+void run_ingest_bench(size_t rows);
+
+void run_scan_bench(size_t rows);
+
+void run_lookup_bench(size_t rows);
+
+void run_range_bench(size_t rows);
+
+void run_cursor_bench(size_t rows);
+
+void run_snapshot_bench(size_t rows);
+
+void run_mapped_bench(size_t rows);
+
+void run_wal_bench(size_t rows);
+
+void run_checkpoint_bench(size_t rows);
+
+void run_concurrency_bench(size_t rows);
+
+void run_mvcc_bench(size_t rows);
+
+void run_parallel_bench(size_t rows);
+
+void run_vectorized_bench(size_t rows);
+
+void run_aggregate_bench(size_t rows);
+
+void run_join_bench(size_t rows);
+
+void run_dictionary_bench(size_t rows);
+
+void run_inline_bench(size_t rows);
+
+void run_explain_bench(size_t rows);
+
+void run_metrics_bench(size_t rows);
+
+#endif // BENCH_H
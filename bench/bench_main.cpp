@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+struct Bench {
+    string name;
+    function<void(size_t rows)> run;
+};
+
+static const vector<Bench> BENCHES = {
+    {"storage", run_storage_bench},
+    {"parser", [](size_t rows) { run_parser_bench(rows / 10); }},
+    {"prepared", [](size_t rows) { run_prepared_bench(rows / 10); }},
+    {"ingest", run_ingest_bench},
+    {"scan", run_scan_bench},
+    {"lookup", run_lookup_bench},
+    {"range", run_range_bench},
+    {"cursor", run_cursor_bench},
+    {"snapshot", run_snapshot_bench},
+    {"mapped", run_mapped_bench},
+    {"wal", run_wal_bench},
+    {"checkpoint", run_checkpoint_bench},
+    {"concurrency", run_concurrency_bench},
+    {"mvcc", run_mvcc_bench},
+    {"parallel", run_parallel_bench},
+    {"vectorized", run_vectorized_bench},
+    {"aggregate", run_aggregate_bench},
+    {"join", run_join_bench},
+    {"dictionary", run_dictionary_bench},
+    {"inline", run_inline_bench},
+    {"explain", run_explain_bench},
+    {"metrics", run_metrics_bench},
+};
+
+static void usage(ostream& out) {
+    out << "usage: bench [rows] [options]\n"
+        << "  --rows N               rows per table (default 1000000)\n"
+        << "  --only a,b,...         run only the named benches\n"
+        << "  --list                 list the benches and exit\n"
+        << "  --seed N               seed of the key generators (default 42)\n"
+        << "  --distribution D       sequential, uniform or zipfian keys (default uniform)\n"
+        << "  --skew S               zipfian exponent in (0, 1) (default 0.99)\n"
+        << "  --string-length N      pad generated strings to N <= 32 bytes\n"
+        << "  --json FILE            write the results as JSON\n"
+        << "  --baseline FILE        compare with the JSON of an earlier run\n"
+        << "  --threshold PERCENT    regression allowed against the baseline (default 10)\n";
+}
+
+static vector<string> split(const string& list) {
+    vector<string> names;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            names.push_back(list.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return names;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    vector<string> only;
+    string json_path;
+    string baseline_path;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) {
+                cerr << argument << " needs a value" << endl;
+                exit(2);
+            }
+            return argv[++i];
+        };
+        if (argument == "--rows") {
+            options.rows = strtoull(value().c_str(), nullptr, 10);
+        } else if (argument == "--only") {
+            only = split(value());
+        } else if (argument == "--list") {
+            for (const Bench& bench : BENCHES) {
+                cout << bench.name << endl;
+            }
+            return 0;
+        } else if (argument == "--seed") {
+            options.seed = strtoull(value().c_str(), nullptr, 10);
+        } else if (argument == "--distribution") {
+            string name = value();
+            bool known = false;
+            for (KeyDistribution distribution : {KeyDistribution::SEQUENTIAL, KeyDistribution::UNIFORM, KeyDistribution::ZIPFIAN}) {
+                if (name == distribution_name(distribution)) {
+                    options.distribution = distribution;
+                    known = true;
+                }
+            }
+            if (!known) {
+                cerr << "Unknown distribution '" << name << "'" << endl;
+                return 2;
+            }
+        } else if (argument == "--skew") {
+            options.skew = strtod(value().c_str(), nullptr);
+            if (!(options.skew > 0.0 && options.skew < 1.0)) {
+                cerr << "--skew must be between 0 and 1" << endl;
+                return 2;
+            }
+        } else if (argument == "--string-length") {
+            options.string_length = strtoull(value().c_str(), nullptr, 10);
+            if (options.string_length > BenchOptions::MAX_STRING_LENGTH) {
+                cerr << "--string-length is at most " << BenchOptions::MAX_STRING_LENGTH << endl;
+                return 2;
+            }
+        } else if (argument == "--json") {
+            json_path = value();
+        } else if (argument == "--baseline") {
+            baseline_path = value();
+        } else if (argument == "--threshold") {
+            threshold = strtod(value().c_str(), nullptr);
+        } else if (argument == "--help" || argument == "-h") {
+            usage(cout);
+            return 0;
+        } else if (!argument.empty() && argument[0] != '-') {
+            options.rows = strtoull(argument.c_str(), nullptr, 10);
+        } else {
+            cerr << "Unknown option " << argument << endl;
+            usage(cerr);
+            return 2;
+        }
+    }
+    if (options.rows == 0) {
+        cerr << "rows must be positive" << endl;
+        return 2;
+    }
+    for (const string& name : only) {
+        if (none_of(BENCHES.begin(), BENCHES.end(), [&name](const Bench& bench) { return bench.name == name; })) {
+            cerr << "Unknown bench '" << name << "'; see --list" << endl;
+            return 2;
+        }
+    }
+    set_bench_options(options);
+
+    // Read first, so a missing baseline fails before the benches run.
+    BenchReport baseline;
+    if (!baseline_path.empty()) {
+        ifstream in(baseline_path);
+        if (!in) {
+            cerr << "Cannot open baseline " << baseline_path << endl;
+            return 2;
+        }
+        baseline = read_json_report(in);
+        if (baseline.options != options_json()) {
+            cerr << "Warning: the baseline ran with " << baseline.options << ", this run with " << options_json() << endl;
+        }
+    }
+
+    cout << "Running benchmarks with " << options.rows << " rows, " << distribution_name(options.distribution)
+         << " keys, seed " << options.seed << endl;
+    for (const Bench& bench : BENCHES) {
+        if (only.empty() || find(only.begin(), only.end(), bench.name) != only.end()) {
+            bench.run(options.rows);
+        }
+    }
+
+    if (!json_path.empty()) {
+        ofstream out(json_path);
+        write_json_report(out);
+        if (!out) {
+            cerr << "Cannot write " << json_path << endl;
+            return 2;
+        }
+    }
+    size_t regressions = check_regressions(baseline.results, threshold);
+    if (regressions > 0) {
+        cerr << regressions << " regression(s) or failed check(s)" << endl;
+        return 1;
+    }
+    return 0;
+}
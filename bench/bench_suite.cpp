@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+
+#include "bench.h"
+#include "operators.h"
+#include "table.h"
+
+static BenchOptions options;
+static vector<BenchResult> results;
+
+const BenchOptions& bench_options() {
+    return options;
+}
+
+void set_bench_options(const BenchOptions& new_options) {
+    options = new_options;
+}
+
+const char* distribution_name(KeyDistribution distribution) {
+    switch (distribution) {
+        case KeyDistribution::SEQUENTIAL: return "sequential";
+        case KeyDistribution::UNIFORM: return "uniform";
+        case KeyDistribution::ZIPFIAN: return "zipfian";
+    }
+    return "unknown";
+}
+
+KeyGenerator::KeyGenerator(size_t domain, uint64_t stream)
+    : domain(max<size_t>(domain, 1)), distribution(options.distribution), engine(options.seed * 0x9e3779b97f4a7c15ull + stream) {
+    if (distribution == KeyDistribution::ZIPFIAN) {
+        theta = options.skew;
+        for (size_t i = 1; i <= this->domain; ++i) {
+            zeta_n += 1.0 / pow(static_cast<double>(i), theta);
+        }
+        double zeta_2 = 1.0 + pow(0.5, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - pow(2.0 / static_cast<double>(this->domain), 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+    }
+}
+
+size_t KeyGenerator::next() {
+    switch (distribution) {
+        case KeyDistribution::SEQUENTIAL:
+            return position++ % domain;
+        case KeyDistribution::UNIFORM:
+            return engine() % domain;
+        case KeyDistribution::ZIPFIAN: {
+            double u = unit(engine);
+            double uz = u * zeta_n;
+            if (uz < 1.0) {
+                return 0;
+            }
+            if (uz < 1.0 + pow(0.5, theta)) {
+                return min<size_t>(1, domain - 1);
+            }
+            auto key = static_cast<size_t>(static_cast<double>(domain) * pow(eta * u - eta + 1.0, alpha));
+            return min(key, domain - 1);
+        }
+    }
+    return 0;
+}
+
+string make_text(string_view prefix, size_t key) {
+    string text(prefix);
+    text += to_string(key);
+    if (text.size() < options.string_length) {
+        text.resize(options.string_length, 'x');
+    }
+    return text;
+}
+
+void report(const string& bench, const string& metric, double value, const string& unit) {
+    cout << bench << "\t" << metric << "\t" << value << " " << unit << endl;
+    results.push_back({bench, metric, value, unit});
+}
+
+const vector<BenchResult>& bench_results() {
+    return results;
+}
+
+void fill_table(Table& table, size_t rows, const function<void(vector<ColumnStorage>&, size_t)>& append_row) {
+    for (size_t start = 0; start < rows; start += 65536) {
+        // Inline columns get inline batches, so appending them copies slots wholesale.
+        vector<ColumnStorage> batch;
+        for (size_t i = 0; i < table.get_columns().size(); ++i) {
+            const ColumnStorage& storage = table.get_column_storage(i);
+            batch.emplace_back(storage.get_type(), false, storage.get_inline_width());
+        }
+        for (size_t i = start; i < min(rows, start + 65536); ++i) {
+            append_row(batch, i);
+        }
+        table.append_columns(batch);
+    }
+}
+
+shared_ptr<Table> make_table(const string& name, const vector<Column>& columns, size_t rows,
+                             const function<void(vector<ColumnStorage>&, size_t)>& append_row) {
+    auto table = make_shared<Table>(name);
+    for (const Column& column : columns) {
+        table->add_column(column);
+    }
+    fill_table(*table, rows, append_row);
+    return table;
+}
+
+bool same_table(const Table& expected, const Table& actual, bool values_only) {
+    auto expected_columns = expected.get_columns();
+    auto actual_columns = actual.get_columns();
+    if (expected_columns.size() != actual_columns.size() || expected.get_row_count() != actual.get_row_count()) {
+        return false;
+    }
+    for (size_t i = 0; i < expected_columns.size(); ++i) {
+        const Column& a = expected_columns[i];
+        const Column& b = actual_columns[i];
+        if (!values_only
+            && (a.get_name() != b.get_name() || a.get_type() != b.get_type() || a.get_length() != b.get_length()
+                || a.is_autoincrement() != b.is_autoincrement() || a.is_unique() != b.is_unique() || a.is_key() != b.is_key()
+                || a.has_default() != b.has_default() || (a.has_default() && a.get_default_value() != b.get_default_value())
+                || a.get_autoincrement_value() != b.get_autoincrement_value()
+                || expected.has_hash_index(i) != actual.has_hash_index(i) || expected.has_ordered_index(i) != actual.has_ordered_index(i))) {
+            return false;
+        }
+        for (size_t row = 0; row < expected.get_row_count(); ++row) {
+            if (expected.get_column_storage(i).get_value(row) != actual.get_column_storage(i).get_value(row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+pair<size_t, int64_t> drain(ExecutionPlan& plan, size_t column) {
+    size_t rows = 0;
+    int64_t total = 0;
+    Batch batch;
+    while (plan.root->next(batch)) {
+        for (size_t c = 0; c < batch.columns.size(); ++c) {
+            if (column != numeric_limits<size_t>::max() && c != column) {
+                continue;
+            }
+            for (int32_t value : batch.columns[c].int32_values) {
+                total += value;
+            }
+            for (int64_t value : batch.columns[c].int64_values) {
+                total += value;
+            }
+        }
+        rows += batch.size();
+    }
+    return {rows, total};
+}
+
+pair<size_t, int64_t> drain(ExecutionPlan&& plan, size_t column) {
+    return drain(plan, column);
+}
+
+static string quote(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+string options_json() {
+    ostringstream out;
+    out << "{\"rows\": " << options.rows << ", \"seed\": " << options.seed
+        << ", \"distribution\": " << quote(distribution_name(options.distribution))
+        << ", \"skew\": " << options.skew << ", \"string_length\": " << options.string_length << "}";
+    return out.str();
+}
+
+void write_json_report(ostream& out) {
+    out << "{\n";
+    out << "  \"options\": " << options_json() << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        // JSON has no infinities; a rate over a zero-length interval is written as null.
+        ostringstream value;
+        if (isfinite(result.value)) {
+            value << setprecision(12) << result.value;
+        } else {
+            value << "null";
+        }
+        out << (i == 0 ? "\n" : ",\n") << "    {\"bench\": " << quote(result.bench) << ", \"metric\": " << quote(result.metric)
+            << ", \"value\": " << value.str() << ", \"unit\": " << quote(result.unit) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// The string after `"key": ` in `line`, or nullopt.
+static optional<string> string_field(const string& line, const string& key) {
+    size_t start = line.find("\"" + key + "\": \"");
+    if (start == string::npos) {
+        return nullopt;
+    }
+    string value;
+    for (size_t i = start + key.size() + 5; i < line.size(); ++i) {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+            value += line[++i];
+        } else if (line[i] == '"') {
+            return value;
+        } else {
+            value += line[i];
+        }
+    }
+    return nullopt;
+}
+
+BenchReport read_json_report(istream& in) {
+    BenchReport report;
+    string line;
+    // write_json_report puts the options and each result on a line of its own.
+    while (getline(in, line)) {
+        size_t options_start = line.find("\"options\": ");
+        if (options_start != string::npos) {
+            report.options = line.substr(options_start + 11, line.rfind('}') + 1 - (options_start + 11));
+            continue;
+        }
+        optional<string> bench = string_field(line, "bench");
+        optional<string> metric = string_field(line, "metric");
+        optional<string> unit = string_field(line, "unit");
+        size_t value = line.find("\"value\": ");
+        if (!bench || !metric || !unit || value == string::npos) {
+            continue;
+        }
+        const char* start = line.c_str() + value + 9;
+        char* end = nullptr;
+        double number = strtod(start, &end);
+        if (end != start) {
+            report.results.push_back({*bench, *metric, number, *unit});
+        }
+    }
+    return report;
+}
+
+// +1 when larger values are better, -1 when smaller ones are, 0 for counts.
+static int direction(const string& unit) {
+    if (unit == "ms" || unit == "us" || unit == "us/query" || unit == "bytes" || unit == "B" || unit == "MiB") {
+        return -1;
+    }
+    if (unit == "x" || (unit.size() > 2 && unit.ends_with("/s"))) {
+        return 1;
+    }
+    return 0;
+}
+
+static bool is_failure_count(const BenchResult& result) {
+    return result.metric.ends_with("_failures");
+}
+
+size_t check_regressions(const vector<BenchResult>& baseline, double threshold_percent) {
+    size_t regressions = 0;
+    for (const BenchResult& result : results) {
+        if (is_failure_count(result) && result.value != 0) {
+            cerr << "FAILED " << result.bench << "." << result.metric << ": " << result.value << endl;
+            ++regressions;
+        }
+    }
+    for (const BenchResult& result : results) {
+        int better = direction(result.unit);
+        auto previous = find_if(baseline.begin(), baseline.end(), [&result](const BenchResult& candidate) {
+            return candidate.bench == result.bench && candidate.metric == result.metric && candidate.unit == result.unit;
+        });
+        if (better == 0 || previous == baseline.end() || previous->value <= 0 || !isfinite(result.value)) {
+            continue;
+        }
+        double change = (result.value - previous->value) / previous->value * 100.0;
+        if (change * -better > threshold_percent) {
+            ostringstream percent;
+            percent << showpos << fixed << setprecision(1) << change << "%";
+            cerr << "REGRESSION " << result.bench << "." << result.metric << ": " << previous->value << " -> " << result.value
+                 << " " << result.unit << " (" << percent.str() << ")" << endl;
+            ++regressions;
+        }
+    }
+    return regressions;
+}
@@ -0,0 +1,220 @@
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "database.h"
+
+static double insert_rate(PreparedStatement& insert, double duration_ms) {
+    size_t inserts = 0;
+    BenchTimer timer;
+    while (timer.elapsed_ms() < duration_ms) {
+        insert.bind(1, static_cast<int32_t>(inserts % 1000)).execute();
+        ++inserts;
+    }
+    return static_cast<double>(inserts) / (timer.elapsed_ms() / 1000);
+}
+
+static double query_rate(Database& db, double duration_ms) {
+    size_t queries = 0;
+    BenchTimer timer;
+    while (timer.elapsed_ms() < duration_ms) {
+        size_t rows = 0;
+        for (RowView view : db.query("SELECT id FROM history WHERE amount = " + to_string(queries % 1000) + " LIMIT 100")) {
+            do_not_optimize(view);
+            ++rows;
+        }
+        do_not_optimize(rows);
+        ++queries;
+    }
+    return static_cast<double>(queries) / (timer.elapsed_ms() / 1000);
+}
+
+// Database::checkpoint while writers keep inserting: every insert that
+// returned must come back from the snapshot plus the log.
+static size_t concurrent_checkpoint_failures(const string& log_path, const string& snapshot_path) {
+    filesystem::remove(log_path);
+    filesystem::remove(log_path + ".old");
+    filesystem::remove(snapshot_path);
+    const size_t writers = 4;
+    atomic<size_t> committed = 0;
+    {
+        Database db;
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.execute("CREATE TABLE ledger ({key, autoincrement} id: int32, amount: int32)");
+        atomic<bool> stopping = false;
+        vector<thread> threads;
+        for (size_t w = 0; w < writers; ++w) {
+            threads.emplace_back([&, w] {
+                while (!stopping) {
+                    db.execute("INSERT INTO ledger (amount) VALUES (" + to_string(w) + ")");
+                    ++committed;
+                }
+            });
+        }
+        for (int i = 0; i < 20; ++i) {
+            db.checkpoint(snapshot_path);
+        }
+        stopping = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    Database recovered;
+    recovered.load_from_file(snapshot_path);
+    recovered.open_log(log_path, SyncPolicy::NONE);
+    size_t failures = 0;
+    shared_ptr<Table> ledger = recovered.get_table("ledger");
+    if (!ledger || ledger->get_row_count() != committed) {
+        cerr << "checkpoint: recovered " << (ledger ? ledger->get_row_count() : 0) << " of " << committed
+             << " rows inserted during checkpoint()" << endl;
+        ++failures;
+    }
+    filesystem::remove(log_path);
+    filesystem::remove(log_path + ".old");
+    filesystem::remove(snapshot_path);
+    return failures;
+}
+
+// A checkpoint that stopped between retiring the log and writing the tables
+// leaves the retired file behind; the next process's checkpointer must take it
+// over rather than keep the log whole forever, without losing a row.
+static size_t leftover_retired_failures(const string& directory, const string& log_path) {
+    filesystem::remove_all(directory);
+    filesystem::remove(log_path);
+    filesystem::remove(log_path + ".old");
+    const CheckpointOptions options{chrono::hours(1), 256u << 20};
+    auto insert_rows = [](Database& db, int count) {
+        for (int i = 0; i < count; ++i) {
+            db.execute("INSERT INTO ledger (amount) VALUES (" + to_string(i) + ")");
+        }
+    };
+    {
+        Database db;
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.execute("CREATE TABLE ledger ({key, autoincrement} id: int32, amount: int32)");
+        insert_rows(db, 100);
+        db.start_checkpointer(directory, options);
+        db.get_checkpointer()->run_once();
+        insert_rows(db, 100);
+        db.get_log()->rotate();
+        insert_rows(db, 100);
+    }
+    size_t failures = 0;
+    if (!filesystem::exists(log_path + ".old")) {
+        cerr << "checkpoint: no retired file left to take over" << endl;
+        ++failures;
+    }
+    {
+        Database db;
+        db.load_from_directory(directory);
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.start_checkpointer(directory, options);
+        db.get_checkpointer()->run_once();
+        if (filesystem::exists(log_path + ".old")) {
+            cerr << "checkpoint: retired file from an earlier process was never discarded" << endl;
+            ++failures;
+        }
+        insert_rows(db, 100);
+        db.get_checkpointer()->run_once();
+        insert_rows(db, 100);
+    }
+    Database recovered;
+    recovered.load_from_directory(directory);
+    recovered.open_log(log_path, SyncPolicy::NONE);
+    shared_ptr<Table> ledger = recovered.get_table("ledger");
+    if (!ledger || ledger->get_row_count() != 500) {
+        cerr << "checkpoint: recovered " << (ledger ? ledger->get_row_count() : 0)
+             << " of 500 rows after taking over a retired file" << endl;
+        ++failures;
+    }
+    filesystem::remove_all(directory);
+    filesystem::remove(log_path);
+    filesystem::remove(log_path + ".old");
+    return failures;
+}
+
+void run_checkpoint_bench(size_t rows) {
+    filesystem::path directory = filesystem::temp_directory_path() / "checkpoint_bench";
+    string log_path = (filesystem::temp_directory_path() / "checkpoint_bench.log").string();
+    filesystem::remove_all(directory);
+    filesystem::remove(log_path);
+    filesystem::remove(log_path + ".old");
+    size_t failures = 0;
+    const double duration_ms = 500;
+
+    {
+        Database db;
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.execute("CREATE TABLE history ({key, autoincrement} id: int32, amount: int32, note: string[32])");
+        db.execute("CREATE TABLE orders ({key, autoincrement} id: int32, amount: int32)");
+        shared_ptr<Table> history = db.get_tables()["history"];
+        vector<Row> batch;
+        for (size_t i = 0; i < rows; ++i) {
+            Row& row = batch.emplace_back(history->get_schema());
+            row.set(1, static_cast<int32_t>(i % 1000));
+            row.set(2, "entry " + to_string(i));
+            if (batch.size() == 10000 || i + 1 == rows) {
+                history->insert_rows(batch);
+                batch.clear();
+            }
+        }
+        auto insert = db.prepare("INSERT INTO orders (amount) VALUES (?)");
+
+        double idle_inserts = insert_rate(insert, duration_ms);
+        double idle_queries = query_rate(db, duration_ms);
+        report("checkpoint", "inserts_idle", idle_inserts, "inserts/s");
+        report("checkpoint", "queries_idle", idle_queries, "queries/s");
+
+        // The first pass writes every table; later ones only what changed.
+        db.start_checkpointer(directory.string(), CheckpointOptions{chrono::milliseconds(100), 256u << 20});
+        CheckpointStats first = db.get_checkpointer()->run_once();
+        report("checkpoint", "full_ms", first.elapsed_ms, "ms");
+        report("checkpoint", "full_bytes", static_cast<double>(first.bytes_written) / (1024.0 * 1024.0), "MiB");
+
+        // Incremental passes keep running while writers and readers do.
+        double busy_inserts = insert_rate(insert, duration_ms);
+        double busy_queries = query_rate(db, duration_ms);
+        db.stop_checkpointer();
+        report("checkpoint", "inserts_during_checkpoints", busy_inserts, "inserts/s");
+        report("checkpoint", "queries_during_checkpoints", busy_queries, "queries/s");
+
+        insert.bind(1, int32_t(3)).execute();
+        CheckpointStats last = db.get_checkpointer()->run_once();
+        report("checkpoint", "incremental_ms", last.elapsed_ms, "ms");
+        report("checkpoint", "incremental_bytes", static_cast<double>(last.bytes_written) / (1024.0 * 1024.0), "MiB");
+        if (!db.get_checkpointer()->get_last_error().empty()) {
+            cerr << "checkpoint: background checkpoint failed: " << db.get_checkpointer()->get_last_error() << endl;
+            ++failures;
+        }
+        // Only the table taking inserts changed; the big one must not be rewritten.
+        if (last.tables_written != 1 || last.tables_skipped != 1) {
+            cerr << "checkpoint: incremental pass wrote " << last.tables_written << " tables" << endl;
+            ++failures;
+        }
+
+        // Rows inserted after the last checkpoint exist only in the log.
+        insert.bind(1, int32_t(7)).execute();
+        size_t expected_orders = db.get_tables()["orders"]->get_row_count();
+
+        Database recovered;
+        recovered.load_from_directory(directory.string());
+        recovered.open_log(log_path, SyncPolicy::NONE);
+        auto tables = recovered.get_tables();
+        if (!tables.count("orders") || !tables.count("history") || tables["orders"]->get_row_count() != expected_orders
+            || tables["history"]->get_row_count() != rows) {
+            cerr << "checkpoint: recovery from checkpoint plus log lost rows" << endl;
+            ++failures;
+        }
+    }
+    report("checkpoint", "check_failures", static_cast<double>(failures), "");
+    string snapshot_path = (filesystem::temp_directory_path() / "checkpoint_bench.dat").string();
+    report("checkpoint", "concurrent_checkpoint_failures", static_cast<double>(concurrent_checkpoint_failures(log_path, snapshot_path)), "");
+    report("checkpoint", "leftover_retired_failures", static_cast<double>(leftover_retired_failures(directory.string(), log_path)), "");
+
+    filesystem::remove_all(directory);
+    filesystem::remove(log_path);
+    filesystem::remove(log_path + ".old");
+}
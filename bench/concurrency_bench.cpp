@@ -0,0 +1,212 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+
+static size_t drain(Cursor cursor) {
+    size_t rows = 0;
+    for (RowView view : cursor) {
+        do_not_optimize(view);
+        ++rows;
+    }
+    return rows;
+}
+
+// `total` full-scan SELECTs split evenly over `threads` threads, each with its own prepared statement.
+static double select_rate(Database& db, size_t threads, size_t total) {
+    vector<PreparedStatement> statements;
+    for (size_t t = 0; t < threads; ++t) {
+        statements.push_back(db.prepare("SELECT id FROM items WHERE category = ?"));
+    }
+    BenchTimer timer;
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t q = t; q < total; q += threads) {
+                do_not_optimize(drain(statements[t].bind(1, static_cast<int32_t>(q % 64)).query()));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return static_cast<double>(total) / (timer.elapsed_ms() / 1000);
+}
+
+void run_concurrency_bench(size_t rows) {
+    size_t failures = 0;
+    report("concurrency", "hardware_threads", thread::hardware_concurrency(), "");
+
+    // Readers of one table: SELECTs share its lock, so throughput should grow with cores.
+    {
+        Database db;
+        db.execute("CREATE TABLE items ({key, autoincrement} id: int32, category: int32, name: string[32])");
+        shared_ptr<Table> items = db.get_table("items");
+        vector<Row> batch;
+        for (size_t i = 0; i < rows; ++i) {
+            Row& row = batch.emplace_back(items->get_schema());
+            row.set(1, static_cast<int32_t>(i % 64));
+            row.set(2, "item " + to_string(i));
+            if (batch.size() == 10000 || i + 1 == rows) {
+                items->insert_rows(batch);
+                batch.clear();
+            }
+        }
+        size_t total = max<size_t>(64, 64000000 / max<size_t>(rows, 1));
+        double single = 0;
+        for (size_t threads : {1, 2, 4, 8}) {
+            double rate = select_rate(db, threads, total);
+            if (threads == 1) {
+                single = rate;
+            }
+            report("concurrency", "select_" + to_string(threads) + "_threads", rate, "queries/s");
+            report("concurrency", "select_speedup_" + to_string(threads) + "_threads", rate / single, "x");
+        }
+    }
+
+    // Writers of their own tables next to readers of another: neither side waits on the other's table lock.
+    {
+        Database db;
+        db.execute("CREATE TABLE items ({key, autoincrement} id: int32, category: int32, name: string[32])");
+        for (size_t w = 0; w < 2; ++w) {
+            db.execute("CREATE TABLE events_" + to_string(w) + " ({key, autoincrement} id: int32, kind: int32)");
+        }
+        auto fill = db.prepare("INSERT INTO items (category, name) VALUES (?, ?)");
+        for (size_t i = 0; i < max<size_t>(rows / 10, 1000); ++i) {
+            fill.bind(1, static_cast<int32_t>(i % 64)).bind(2, "item " + to_string(i)).execute();
+        }
+
+        const double duration_ms = 500;
+        atomic<size_t> inserts = 0;
+        atomic<size_t> queries = 0;
+        vector<thread> workers;
+        BenchTimer timer;
+        for (size_t w = 0; w < 2; ++w) {
+            workers.emplace_back([&, w] {
+                auto insert = db.prepare("INSERT INTO events_" + to_string(w) + " (kind) VALUES (?)");
+                size_t done = 0;
+                while (timer.elapsed_ms() < duration_ms) {
+                    insert.bind(1, static_cast<int32_t>(done % 16)).execute();
+                    ++done;
+                }
+                inserts += done;
+            });
+            workers.emplace_back([&] {
+                auto select = db.prepare("SELECT id, name FROM items WHERE category = ? LIMIT 100");
+                size_t done = 0;
+                while (timer.elapsed_ms() < duration_ms) {
+                    do_not_optimize(drain(select.bind(1, static_cast<int32_t>(done % 64)).query()));
+                    ++done;
+                }
+                queries += done;
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        double seconds = timer.elapsed_ms() / 1000;
+        report("concurrency", "mixed_inserts", inserts / seconds, "inserts/s");
+        report("concurrency", "mixed_queries", queries / seconds, "queries/s");
+    }
+
+    // Stress: writers append batches to a shared table and to their own, readers
+    // scan the shared one and CREATE TABLE runs alongside. Every reader must see
+    // whole batches in the order their autoincrement ids were handed out.
+    {
+        const size_t writers = 4;
+        const size_t readers = 2;
+        const size_t batch_rows = 16;
+        size_t batches = max<size_t>(rows / (writers * batch_rows * 100), 50);
+
+        Database db;
+        db.execute("CREATE TABLE ledger ({key, autoincrement} id: int32, writer: int32, batch: int32)");
+        for (size_t w = 0; w < writers; ++w) {
+            db.execute("CREATE TABLE own_" + to_string(w) + " ({key, autoincrement} id: int32, batch: int32)");
+        }
+        shared_ptr<Table> ledger = db.get_table("ledger");
+
+        atomic<size_t> writers_done = 0;
+        atomic<size_t> reader_failures = 0;
+        atomic<size_t> scans = 0;
+        vector<thread> workers;
+        BenchTimer timer;
+        for (size_t w = 0; w < writers; ++w) {
+            workers.emplace_back([&, w] {
+                auto own = db.prepare("INSERT INTO own_" + to_string(w) + " (batch) VALUES (?)");
+                vector<Row> batch;
+                for (size_t b = 0; b < batches; ++b) {
+                    batch.clear();
+                    for (size_t r = 0; r < batch_rows; ++r) {
+                        Row& row = batch.emplace_back(ledger->get_schema());
+                        row.set(1, static_cast<int32_t>(w));
+                        row.set(2, static_cast<int32_t>(b));
+                    }
+                    ledger->insert_rows(batch);
+                    own.bind(1, static_cast<int32_t>(b)).execute();
+                }
+                ++writers_done;
+            });
+        }
+        for (size_t r = 0; r < readers; ++r) {
+            workers.emplace_back([&] {
+                while (writers_done < writers) {
+                    size_t position = 0;
+                    int32_t writer = 0;
+                    int32_t batch = 0;
+                    for (RowView view : db.query("SELECT id, writer, batch FROM ledger")) {
+                        if (position % batch_rows == 0) {
+                            writer = view.get_int32(1);
+                            batch = view.get_int32(2);
+                        }
+                        if (view.get_int32(0) != static_cast<int32_t>(position) || view.get_int32(1) != writer || view.get_int32(2) != batch) {
+                            ++reader_failures;
+                            break;
+                        }
+                        ++position;
+                    }
+                    if (position % batch_rows != 0) {
+                        ++reader_failures;
+                    }
+                    ++scans;
+                }
+            });
+        }
+        workers.emplace_back([&] {
+            for (size_t t = 0; t < 8; ++t) {
+                db.execute("CREATE TABLE side_" + to_string(t) + " (id: int32)");
+                db.execute("INSERT INTO side_" + to_string(t) + " VALUES (" + to_string(t) + ")");
+            }
+        });
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        report("concurrency", "stress_ms", timer.elapsed_ms(), "ms");
+        report("concurrency", "stress_scans", static_cast<double>(scans), "scans");
+
+        if (reader_failures != 0) {
+            cerr << "concurrency: " << reader_failures << " scans saw a partial or reordered batch" << endl;
+            ++failures;
+        }
+        if (drain(db.query("SELECT id FROM ledger")) != writers * batches * batch_rows) {
+            cerr << "concurrency: ledger lost rows" << endl;
+            ++failures;
+        }
+        for (size_t w = 0; w < writers; ++w) {
+            if (db.get_table("own_" + to_string(w))->get_row_count() != batches) {
+                cerr << "concurrency: own_" << w << " lost rows" << endl;
+                ++failures;
+            }
+        }
+        for (size_t t = 0; t < 8; ++t) {
+            auto side = db.get_table("side_" + to_string(t));
+            if (!side || side->get_row_count() != 1) {
+                cerr << "concurrency: side_" << t << " is missing" << endl;
+                ++failures;
+            }
+        }
+    }
+    report("concurrency", "check_failures", static_cast<double>(failures), "");
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "cursor.h"
+#include "parser.h"
+#include "table.h"
+
+static shared_ptr<Table> make_cursor_table(size_t rows) {
+    return make_table("messages", {Column("id", DataType::INT32), Column("body", DataType::STRING, 64), Column("read", DataType::BOOL)}, rows,
+                      [](vector<ColumnStorage>& batch, size_t i) {
+                          batch[0].append_int32(static_cast<int32_t>(i));
+                          batch[1].append_string("message body number " + to_string(i));
+                          batch[2].append_bool(i % 2 == 0);
+                      });
+}
+
+static vector<int32_t> ids(const string& query, const shared_ptr<Table>& table) {
+    vector<int32_t> result;
+    for (RowView row : Cursor::open(get<SelectStatement>(Parser::parse(query)), table)) {
+        result.push_back(row.get_int32(0));
+    }
+    return result;
+}
+
+// LIMIT must return the first rows of the unlimited result, after sorting when
+// there is an ORDER BY, and a cursor closed early must not hold up writers.
+// Returns the number of checks that failed.
+static size_t limit_failures(const shared_ptr<Table>& table, size_t rows) {
+    size_t failures = 0;
+    vector<int32_t> all = ids("SELECT id FROM messages WHERE read", table);
+    vector<int32_t> first = ids("SELECT id FROM messages WHERE read LIMIT 10", table);
+    if (first.size() != min<size_t>(all.size(), 10) || !equal(first.begin(), first.end(), all.begin())) {
+        cerr << "cursor: LIMIT 10 did not return the first 10 matches" << endl;
+        ++failures;
+    }
+    vector<int32_t> highest;
+    for (size_t i = 0; i < min<size_t>(rows, 5); ++i) {
+        highest.push_back(static_cast<int32_t>(rows - 1 - i));
+    }
+    if (ids("SELECT id FROM messages ORDER BY id DESC LIMIT 5", table) != highest) {
+        cerr << "cursor: ORDER BY id DESC LIMIT 5 did not return the 5 highest ids" << endl;
+        ++failures;
+    }
+
+    size_t read = 0;
+    for (RowView row : Cursor::open(get<SelectStatement>(Parser::parse("SELECT id FROM messages")), table)) {
+        do_not_optimize(row);
+        if (++read == 3) {
+            break;
+        }
+    }
+    Row late(table->get_schema());
+    late.set(0, static_cast<int32_t>(rows));
+    late.set(1, string("late"));
+    late.set(2, true);
+    table->insert_row(late);
+    if (ids("SELECT id FROM messages WHERE read", table).size() != all.size() + 1) {
+        cerr << "cursor: a write after closing a cursor early was lost" << endl;
+        ++failures;
+    }
+    return failures;
+}
+
+void run_cursor_bench(size_t rows) {
+    auto table = make_cursor_table(rows);
+    auto select = get<SelectStatement>(Parser::parse("SELECT id, body FROM messages WHERE read"));
+
+    {
+        size_t before = heap_in_use();
+        BenchTimer timer;
+        auto result = table->select(Expression::compile(*select.where, *table));
+        size_t bytes = 0;
+        for (const Row& row : result) {
+            bytes += row.get_string(1).size();
+        }
+        do_not_optimize(bytes);
+        report("cursor", "materialized_ms", timer.elapsed_ms(), "ms");
+        report("cursor", "materialized_heap_growth", static_cast<double>(heap_in_use() - before) / (1024.0 * 1024.0), "MiB");
+    }
+    {
+        size_t before = heap_in_use();
+        BenchTimer timer;
+        size_t bytes = 0;
+        for (RowView row : Cursor::open(select, table)) {
+            bytes += row.get_string(1).size();
+        }
+        do_not_optimize(bytes);
+        report("cursor", "streamed_ms", timer.elapsed_ms(), "ms");
+        report("cursor", "streamed_heap_growth", static_cast<double>(heap_in_use() - before) / (1024.0 * 1024.0), "MiB");
+    }
+
+    for (const char* query : {"SELECT id FROM messages WHERE read", "SELECT id FROM messages WHERE read LIMIT 10"}) {
+        auto limited = get<SelectStatement>(Parser::parse(query));
+        BenchTimer timer;
+        size_t count = 0;
+        for (RowView row : Cursor::open(limited, table)) {
+            count += row.get_int32(0) >= 0;
+        }
+        do_not_optimize(count);
+        report("cursor", limited.limit ? "limit_10" : "no_limit", timer.elapsed_ms(), "ms");
+    }
+    report("cursor", "limit_failures", static_cast<double>(limit_failures(table, rows)), "");
+}
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+#include "serializer.h"
+
+static const char* const STATUSES[] = {"active", "suspended", "pending_verification", "closed"};
+
+static size_t string_column_bytes(const Table& table) {
+    return table.get_column_storage(1).memory_usage() + table.get_column_storage(2).memory_usage();
+}
+
+static size_t snapshot_bytes(const string& name, shared_ptr<Table> table, bool compress) {
+    ostringstream out;
+    Serializer serializer;
+    serializer.set_compress_payloads(compress);
+    serializer.save({{name, std::move(table)}}, out);
+    return out.str().size();
+}
+
+static void append_account(vector<ColumnStorage>& batch, size_t i) {
+    batch[0].append_int32(static_cast<int32_t>(i));
+    batch[1].append_string("login_" + to_string((i * 7919) % 20000));
+    batch[2].append_string(STATUSES[i % 97 == 0 ? 1 + i % 3 : 0]);
+    batch[3].append_bool(i % 97 != 0);
+}
+
+void run_dictionary_bench(size_t rows) {
+    size_t failures = 0;
+
+    // The same accounts, once with plain string columns and once with
+    // dictionary encoded ones: 20000 distinct logins and four statuses.
+    Database db;
+    db.execute("CREATE TABLE plain (id: int32, login: string[32], status: string[32], verified: bool)");
+    db.execute("CREATE TABLE encoded (id: int32, {dictionary} login: string[32], {dictionary} status: string[32], verified: bool)");
+    shared_ptr<Table> plain = db.get_table("plain");
+    shared_ptr<Table> encoded = db.get_table("encoded");
+    {
+        BenchTimer timer;
+        fill_table(*plain, rows, append_account);
+        report("dictionary", "ingest_plain", timer.elapsed_ms(), "ms");
+    }
+    {
+        BenchTimer timer;
+        fill_table(*encoded, rows, append_account);
+        report("dictionary", "ingest_dictionary", timer.elapsed_ms(), "ms");
+    }
+    report("dictionary", "plain_string_bytes", static_cast<double>(string_column_bytes(*plain)), "bytes");
+    report("dictionary", "dictionary_string_bytes", static_cast<double>(string_column_bytes(*encoded)), "bytes");
+
+    // Equality filters: string comparison against code comparison.
+    for (const string& filter : vector<string>{"status = 'suspended'", "login = 'login_42'", "status <> 'active'"}) {
+        string metric = filter.substr(0, filter.find(' '));
+        metric += filter.find("<>") == string::npos ? "_equal" : "_not_equal";
+        pair<size_t, int64_t> expected;
+        {
+            BenchTimer timer;
+            expected = drain(db.query_batches("SELECT id FROM plain WHERE " + filter));
+            report("dictionary", "scan_" + metric + "_plain", timer.elapsed_ms(), "ms");
+        }
+        {
+            BenchTimer timer;
+            auto actual = drain(db.query_batches("SELECT id FROM encoded WHERE " + filter));
+            report("dictionary", "scan_" + metric + "_dictionary", timer.elapsed_ms(), "ms");
+            if (actual != expected) {
+                cerr << "dictionary: " << filter << " disagrees with the plain column" << endl;
+                ++failures;
+            }
+        }
+    }
+
+    // Projecting the strings decodes them.
+    {
+        BenchTimer timer;
+        size_t matched = 0;
+        ExecutionPlan plan = db.query_batches("SELECT status, login FROM encoded WHERE verified = false");
+        Batch batch;
+        while (plan.root->next(batch)) {
+            for (string_view status : batch.columns[0].string_values) {
+                matched += status != "active";
+            }
+        }
+        report("dictionary", "project_dictionary", timer.elapsed_ms(), "ms");
+        size_t expected = (rows + 96) / 97;
+        if (matched != expected) {
+            cerr << "dictionary: projected " << matched << " statuses, expected " << expected << endl;
+            ++failures;
+        }
+    }
+
+    // Compressed snapshots bit-pack the dictionary codes and the bools.
+    report("dictionary", "snapshot_bytes_plain", static_cast<double>(snapshot_bytes("plain", plain, false)), "bytes");
+    report("dictionary", "snapshot_bytes_dictionary", static_cast<double>(snapshot_bytes("encoded", encoded, false)), "bytes");
+    report("dictionary", "snapshot_bytes_dictionary_compressed", static_cast<double>(snapshot_bytes("encoded", encoded, true)), "bytes");
+
+    string path = (filesystem::temp_directory_path() / "imdb_dictionary_bench.snap").string();
+    for (bool compress : {false, true}) {
+        for (bool mapped : {false, true}) {
+            {
+                ofstream out(path, ios::binary);
+                Serializer serializer;
+                serializer.set_compress_payloads(compress);
+                serializer.save({{"encoded", encoded}}, out);
+            }
+            Serializer serializer;
+            unordered_map<string, shared_ptr<Table>> tables;
+            BenchTimer timer;
+            if (mapped) {
+                tables = serializer.map(path);
+            } else {
+                ifstream in(path, ios::binary);
+                tables = serializer.load(in);
+            }
+            report("dictionary", string(mapped ? "map_dictionary" : "load_dictionary") + (compress ? "_compressed" : ""), timer.elapsed_ms(), "ms");
+            const Table& loaded = *tables.at("encoded");
+            bool same = loaded.get_row_count() == encoded->get_row_count() && loaded.get_column("login").is_dictionary();
+            for (size_t i = 0; same && i < loaded.get_columns().size(); ++i) {
+                for (size_t row = 0; same && row < loaded.get_row_count(); ++row) {
+                    same = loaded.get_column_storage(i).get_value(row) == encoded->get_column_storage(i).get_value(row);
+                }
+            }
+            if (!same) {
+                cerr << "dictionary: " << (mapped ? "mapped" : "loaded") << " snapshot differs from the table" << endl;
+                ++failures;
+            }
+        }
+    }
+    remove(path.c_str());
+
+    report("dictionary", "check_failures", static_cast<double>(failures), "");
+}
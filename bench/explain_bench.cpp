@@ -0,0 +1,78 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+#include "parser.h"
+
+static ExecutionPlan build(const string& query, shared_ptr<const Table> table, bool profile) {
+    SelectStatement select = get<SelectStatement>(Parser::parse(query));
+    return ExecutionPlan::build_select(select, std::move(table), {}, nullptr, profile);
+}
+
+void run_explain_bench(size_t rows) {
+    size_t failures = 0;
+
+    Database db;
+    db.execute("CREATE TABLE events (id: int32, kind: int32, amount: int32)");
+    shared_ptr<Table> events = db.get_table("events");
+    for (size_t start = 0; start < rows; start += 65536) {
+        vector<ColumnStorage> batch;
+        for (const auto& column : events->get_columns()) {
+            batch.emplace_back(column.get_type());
+        }
+        for (size_t i = start; i < min(rows, start + 65536); ++i) {
+            batch[0].append_int32(static_cast<int32_t>(i));
+            batch[1].append_int32(static_cast<int32_t>(i % 10));
+            batch[2].append_int32(static_cast<int32_t>((i * 7919) % 1000));
+        }
+        events->append_columns(batch);
+    }
+
+    // The same plans with and without ProfiledOperator wrappers; the
+    // difference is what EXPLAIN ANALYZE adds per batch.
+    struct Case {
+        const char* name;
+        string query;
+    };
+    vector<Case> cases = {
+        {"scan", "SELECT id FROM events"},
+        {"filter", "SELECT id FROM events WHERE kind = 3 AND amount < 500"},
+        {"sort_limit", "SELECT id, amount FROM events ORDER BY amount DESC LIMIT 100"},
+        {"aggregate", "SELECT kind, SUM(amount) FROM events GROUP BY kind"},
+    };
+    for (const Case& test : cases) {
+        pair<size_t, int64_t> expected;
+        {
+            ExecutionPlan plan = build(test.query, events, false);
+            BenchTimer timer;
+            expected = drain(plan);
+            report("explain", string(test.name) + "_plain", timer.elapsed_ms(), "ms");
+        }
+        ExecutionPlan plan = build(test.query, events, true);
+        BenchTimer timer;
+        pair<size_t, int64_t> actual = drain(plan);
+        report("explain", string(test.name) + "_analyzed", timer.elapsed_ms(), "ms");
+        if (actual != expected) {
+            cerr << "explain: profiled " << test.name << " returned different rows" << endl;
+            ++failures;
+        }
+
+        // The root's output is the result, and the scan at the bottom read the table.
+        vector<PlanStage> stages = plan.explain();
+        if (stages.empty() || stages.front().rows_out != expected.first) {
+            cerr << "explain: " << test.name << " root reports " << (stages.empty() ? 0 : stages.front().rows_out)
+                 << " rows, expected " << expected.first << endl;
+            ++failures;
+        } else if (stages.back().rows_in != rows || stages.back().description.find("Scan events") != 0) {
+            cerr << "explain: " << test.name << " scan reports " << stages.back().rows_in << " rows read, expected " << rows << endl;
+            ++failures;
+        }
+        if (build(test.query, events, false).explain().size() != stages.size()) {
+            cerr << "explain: " << test.name << " plans differ with profiling" << endl;
+            ++failures;
+        }
+    }
+
+    report("explain", "check_failures", static_cast<double>(failures), "");
+}
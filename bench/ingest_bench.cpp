@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+
+static shared_ptr<Table> make_users_table() {
+    auto table = make_shared<Table>("users");
+    table->add_column(Column("id", DataType::INT32, 0, true));
+    table->add_column(Column("login", DataType::STRING, 32));
+    table->add_column(Column("password_hash", DataType::BYTES, 8));
+    table->add_column(Column("is_admin", DataType::BOOL, 0, false, false, false));
+    return table;
+}
+
+static void fill_row(Row& row, size_t i) {
+    row.set(1, make_text("user_", i));
+    row.set(2, vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8});
+    row.set(3, i % 100 == 0);
+}
+
+// A batch that fails its checks must leave the table, the caller's rows and
+// the autoincrement counter as they were. Returns the number of checks that did not.
+static size_t rollback_failures() {
+    auto table = make_shared<Table>("accounts");
+    table->add_column(Column("id", DataType::INT32, 0, true, false, nullopt, true));
+    table->add_column(Column("login", DataType::STRING, 32, false, true));
+    auto insert = [&](const vector<ValueType>& logins) {
+        vector<Row> batch;
+        for (const ValueType& login : logins) {
+            batch.emplace_back(table->get_schema()).set(1, login);
+        }
+        try {
+            table->insert_rows(batch);
+        } catch (const exception&) {
+            return none_of(batch.begin(), batch.end(), [](const Row& row) { return row.has(0); });
+        }
+        return false;
+    };
+
+    size_t failures = 0;
+    insert({string("first")});
+    for (const vector<ValueType>& rejected : {vector<ValueType>{string("second"), string("third"), string("second")},
+                                              vector<ValueType>{string("second"), string("first")},
+                                              vector<ValueType>{string("second"), int32_t(3)}}) {
+        if (!insert(rejected) || table->get_row_count() != 1) {
+            cerr << "ingest: a rejected batch changed the table or its rows" << endl;
+            ++failures;
+        }
+    }
+    insert({string("second")});
+    if (table->get_row_count() != 2 || table->get_column_storage(0).get_int32(1) != table->get_column_storage(0).get_int32(0) + 1) {
+        cerr << "ingest: a rejected batch advanced the autoincrement counter" << endl;
+        ++failures;
+    }
+    return failures;
+}
+
+// Values given explicitly for an autoincrement key must move its counter past
+// them, on insert as well as after a snapshot load and a log replay, or every
+// later generated value collides. Returns the number of checks that failed.
+static size_t explicit_autoincrement_failures() {
+    string snapshot_path = (filesystem::temp_directory_path() / "ingest_bench.dat").string();
+    string log_path = (filesystem::temp_directory_path() / "ingest_bench.log").string();
+    remove(snapshot_path.c_str());
+    remove(log_path.c_str());
+    auto last_id = [](Database& db) {
+        shared_ptr<Table> table = db.get_table("k");
+        return table->get_column_storage(0).get_int32(table->get_row_count() - 1);
+    };
+
+    size_t failures = 0;
+    try {
+        {
+            Database db;
+            db.execute("CREATE TABLE k ({autoincrement, key} id: int32, v: int32)");
+            db.execute("INSERT INTO k VALUES (0, 1)");
+            db.execute("INSERT INTO k (v) VALUES (2)");
+            db.execute("INSERT INTO k VALUES (10, 3), (4, 4)");
+            db.execute("INSERT INTO k (v) VALUES (5)");
+            if (last_id(db) != 11) {
+                cerr << "ingest: explicit autoincrement values did not advance the counter" << endl;
+                ++failures;
+            }
+            // As a snapshot written before the counter moved would hold it.
+            db.get_table("k")->set_autoincrement_value(0, 0);
+            db.save_to_file(snapshot_path);
+        }
+        {
+            Database db;
+            db.load_from_file(snapshot_path);
+            db.open_log(log_path, SyncPolicy::NONE);
+            db.execute("INSERT INTO k (v) VALUES (6)");
+            if (last_id(db) != 12) {
+                cerr << "ingest: a loaded table reused an autoincrement value" << endl;
+                ++failures;
+            }
+            db.execute("INSERT INTO k VALUES (20, 7)");
+        }
+        Database db;
+        db.load_from_file(snapshot_path);
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.execute("INSERT INTO k (v) VALUES (8)");
+        if (last_id(db) != 21) {
+            cerr << "ingest: a replayed table reused an autoincrement value" << endl;
+            ++failures;
+        }
+    } catch (const exception& e) {
+        cerr << "ingest: explicit autoincrement values jammed the table: " << e.what() << endl;
+        ++failures;
+    }
+    remove(snapshot_path.c_str());
+    remove(log_path.c_str());
+    return failures;
+}
+
+void run_ingest_bench(size_t rows) {
+    const size_t batch_size = 1024;
+
+    {
+        auto table = make_users_table();
+        BenchTimer timer;
+        for (size_t i = 0; i < rows; ++i) {
+            Row row(table->get_schema());
+            fill_row(row, i);
+            table->insert_row(row);
+        }
+        report("ingest", "insert_row_rows_per_sec", rows / (timer.elapsed_ms() / 1000.0), "rows/s");
+    }
+    {
+        auto table = make_users_table();
+        vector<Row> batch;
+        BenchTimer timer;
+        for (size_t start = 0; start < rows; start += batch_size) {
+            batch.clear();
+            for (size_t i = start; i < min(rows, start + batch_size); ++i) {
+                fill_row(batch.emplace_back(table->get_schema()), i);
+            }
+            table->insert_rows(batch);
+        }
+        report("ingest", "insert_rows_rows_per_sec", rows / (timer.elapsed_ms() / 1000.0), "rows/s");
+    }
+    {
+        auto table = make_users_table();
+        const uint8_t hash[] = {1, 2, 3, 4, 5, 6, 7, 8};
+        BenchTimer timer;
+        for (size_t start = 0; start < rows; start += batch_size) {
+            vector<ColumnStorage> batch;
+            for (const auto& column : table->get_columns()) {
+                batch.emplace_back(column.get_type());
+            }
+            for (size_t i = start; i < min(rows, start + batch_size); ++i) {
+                batch[0].append_int32(static_cast<int32_t>(i));
+                batch[1].append_string(make_text("user_", i));
+                batch[2].append_bytes(hash);
+                batch[3].append_bool(i % 100 == 0);
+            }
+            table->append_columns(batch);
+        }
+        report("ingest", "append_columns_rows_per_sec", rows / (timer.elapsed_ms() / 1000.0), "rows/s");
+    }
+    {
+        Database db;
+        ostringstream sink;
+        streambuf* original = cout.rdbuf(sink.rdbuf());
+        db.execute("CREATE TABLE users ({autoincrement} id: int32, login: string[32], password_hash: bytes[8], is_admin: bool = false)");
+        BenchTimer timer;
+        for (size_t start = 0; start < rows; start += batch_size) {
+            string query = "INSERT INTO users (login, password_hash, is_admin) VALUES ";
+            for (size_t i = start; i < min(rows, start + batch_size); ++i) {
+                query += (i == start ? "('" : ", ('") + make_text("user_", i) + "', 0x0102030405060708, " + (i % 100 == 0 ? "true)" : "false)");
+            }
+            db.execute(query);
+        }
+        double elapsed = timer.elapsed_ms();
+        cout.rdbuf(original);
+        report("ingest", "multi_row_values_rows_per_sec", rows / (elapsed / 1000.0), "rows/s");
+    }
+    report("ingest", "rollback_failures", static_cast<double>(rollback_failures()), "");
+    report("ingest", "explicit_autoincrement_failures", static_cast<double>(explicit_autoincrement_failures()), "");
+}
@@ -0,0 +1,110 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+#include "exceptions.h"
+#include "serializer.h"
+
+static string make_sku(size_t i) {
+    return "SKU-" + to_string((i * 2654435761u) % 1000000);
+}
+
+static void append_item(vector<ColumnStorage>& batch, size_t i) {
+    uint8_t digest[8];
+    for (size_t byte = 0; byte < sizeof(digest); ++byte) {
+        digest[byte] = static_cast<uint8_t>(i >> (byte % 4 * 8));
+    }
+    batch[0].append_int32(static_cast<int32_t>(i));
+    batch[1].append_string(make_sku(i));
+    batch[2].append_bytes(digest);
+}
+
+void run_inline_bench(size_t rows) {
+    size_t failures = 0;
+
+    // The same items, once in unbounded columns (offsets into a blob) and
+    // once in declared-length ones that are stored inline.
+    Database db;
+    db.execute("CREATE TABLE offsets (id: int32, sku: string, digest: bytes)");
+    db.execute("CREATE TABLE slots (id: int32, sku: string[16], digest: bytes[8])");
+    shared_ptr<Table> offsets = db.get_table("offsets");
+    shared_ptr<Table> slots = db.get_table("slots");
+    if (offsets->get_column_storage(1).is_inline() || !slots->get_column_storage(1).is_inline()) {
+        cerr << "inline: columns are not laid out as expected" << endl;
+        ++failures;
+    }
+    for (const auto& [layout, table] : {pair<string, shared_ptr<Table>>{"offsets", offsets}, {"inline", slots}}) {
+        BenchTimer timer;
+        fill_table(*table, rows, append_item);
+        report("inline", "ingest_" + layout, timer.elapsed_ms(), "ms");
+        report("inline", "column_bytes_" + layout, static_cast<double>(table->get_column_storage(1).memory_usage() + table->get_column_storage(2).memory_usage()), "bytes");
+    }
+
+    // Random point reads of single values.
+    for (const auto& [layout, table] : {pair<string, shared_ptr<Table>>{"offsets", offsets}, {"inline", slots}}) {
+        const ColumnStorage& skus = table->get_column_storage(1);
+        size_t total = 0;
+        uint64_t state = 88172645463325252ull;
+        BenchTimer timer;
+        for (size_t i = 0; i < rows; ++i) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            string_view sku = skus.get_string(state % rows);
+            total += sku.size() + static_cast<uint8_t>(sku.back());
+        }
+        report("inline", "point_read_" + layout, timer.elapsed_ms(), "ms");
+        do_not_optimize(total);
+    }
+
+    // Filters and projections that touch every string.
+    for (const string& query : {string("SELECT id FROM %s WHERE sku = 'SKU-42'"), string("SELECT sku, digest FROM %s WHERE id >= 0")}) {
+        size_t expected = 0;
+        for (const auto& [layout, table] : {pair<string, shared_ptr<Table>>{"offsets", offsets}, {"inline", slots}}) {
+            string sql = query;
+            sql.replace(sql.find("%s"), 2, table == offsets ? "offsets" : "slots");
+            BenchTimer timer;
+            size_t matched = drain(db.query_batches(sql)).first;
+            report("inline", string(query.find("WHERE sku") != string::npos ? "scan_" : "project_") + layout, timer.elapsed_ms(), "ms");
+            if (table == offsets) {
+                expected = matched;
+            } else if (matched != expected) {
+                cerr << "inline: " << sql << " returned " << matched << " rows, expected " << expected << endl;
+                ++failures;
+            }
+        }
+    }
+
+    // Values are identical in both layouts and after a snapshot round trip.
+    ostringstream out;
+    {
+        BenchTimer timer;
+        Serializer().save({{"slots", slots}}, out);
+        report("inline", "save_inline", timer.elapsed_ms(), "ms");
+    }
+    istringstream in(out.str());
+    shared_ptr<Table> loaded = Serializer().load(in).at("slots");
+    bool same = loaded->get_row_count() == rows && slots->get_row_count() == rows && loaded->get_column_storage(1).is_inline();
+    for (size_t row = 0; same && row < rows; ++row) {
+        for (size_t column = 1; same && column < 3; ++column) {
+            ValueType value = offsets->get_column_storage(column).get_value(row);
+            same = slots->get_column_storage(column).get_value(row) == value && loaded->get_column_storage(column).get_value(row) == value;
+        }
+    }
+    if (!same) {
+        cerr << "inline: inline values differ from the offset layout" << endl;
+        ++failures;
+    }
+
+    // Declared lengths are enforced on insert.
+    try {
+        db.execute("INSERT INTO slots VALUES (-1, 'SKU-0123456789ABCDEF', 0x00)");
+        cerr << "inline: an over-length value was accepted" << endl;
+        ++failures;
+    } catch (const ConstraintViolationException&) {
+    }
+
+    report("inline", "check_failures", static_cast<double>(failures), "");
+}
@@ -0,0 +1,111 @@
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+
+void run_join_bench(size_t rows) {
+    size_t failures = 0;
+
+    // A fact table of `rows` orders against customer tables 1, 10, 100 and
+    // 1000 times smaller; every order has a customer.
+    for (size_t ratio : {1, 10, 100, 1000}) {
+        size_t customer_rows = max<size_t>(rows / ratio, 1);
+        Database db;
+        db.execute("CREATE TABLE customers (cid: int32, segment: int32)");
+        db.execute("CREATE TABLE orders (oid: int32, customer: int32, amount: int32)");
+        fill_table(*db.get_table("customers"), customer_rows, [](vector<ColumnStorage>& batch, size_t i) {
+            batch[0].append_int32(static_cast<int32_t>(i));
+            batch[1].append_int32(static_cast<int32_t>(i % 16));
+        });
+        fill_table(*db.get_table("orders"), rows, [customer_rows](vector<ColumnStorage>& batch, size_t i) {
+            batch[0].append_int32(static_cast<int32_t>(i));
+            batch[1].append_int32(static_cast<int32_t>((i * 7919) % customer_rows));
+            batch[2].append_int32(static_cast<int32_t>(i % 100));
+        });
+        string suffix = "_1_to_" + to_string(ratio);
+
+        // What applications did before: both tables out through get_rows, joined by hand.
+        size_t expected_pairs = 0;
+        int64_t expected_total = 0;
+        int64_t expected_amount = 0;
+        unordered_set<int32_t> expected_segments;
+        {
+            BenchTimer timer;
+            unordered_map<int32_t, int32_t> segments;
+            for (const Row& row : db.get_table("customers")->get_rows()) {
+                segments.emplace(row.get_int32(0), row.get_int32(1));
+            }
+            for (const Row& row : db.get_table("orders")->get_rows()) {
+                auto it = segments.find(row.get_int32(1));
+                if (it != segments.end()) {
+                    ++expected_pairs;
+                    expected_total += row.get_int32(2) + it->second;
+                    expected_amount += row.get_int32(2);
+                    expected_segments.insert(it->second);
+                }
+            }
+            report("join", "get_rows_join" + suffix, timer.elapsed_ms(), "ms");
+        }
+        {
+            BenchTimer timer;
+            auto [pairs, total] = drain(db.query_batches("SELECT amount, segment FROM orders JOIN customers ON customer = cid"));
+            report("join", "hash_join" + suffix, timer.elapsed_ms(), "ms");
+            if (pairs != expected_pairs || total != expected_total) {
+                cerr << "join: hash join of 1 to " << ratio << " disagrees with get_rows" << endl;
+                ++failures;
+            }
+        }
+        {
+            // Only the groups leave the engine.
+            BenchTimer timer;
+            auto [groups, total] = drain(db.query_batches("SELECT segment, SUM(amount) FROM orders JOIN customers ON customer = cid GROUP BY segment"), 1);
+            report("join", "hash_join_group_by" + suffix, timer.elapsed_ms(), "ms");
+            if (groups != expected_segments.size() || total != expected_amount) {
+                cerr << "join: GROUP BY over the join of 1 to " << ratio << " disagrees with get_rows" << endl;
+                ++failures;
+            }
+        }
+    }
+
+    // A few hundred ids looked up in a large keyed table: the planner probes
+    // its hash index instead of hashing the whole table.
+    {
+        size_t lookups = max<size_t>(rows / 1000, 1);
+        Database db;
+        db.execute("CREATE TABLE accounts ({key} id: int32, balance: int32)");
+        db.execute("CREATE TABLE wanted (account: int32)");
+        fill_table(*db.get_table("accounts"), rows, [](vector<ColumnStorage>& batch, size_t i) {
+            batch[0].append_int32(static_cast<int32_t>(i));
+            batch[1].append_int32(static_cast<int32_t>(i % 1000));
+        });
+        fill_table(*db.get_table("wanted"), lookups, [rows](vector<ColumnStorage>& batch, size_t i) {
+            batch[0].append_int32(static_cast<int32_t>((i * 104729) % rows));
+        });
+
+        int64_t expected_total = 0;
+        {
+            BenchTimer timer;
+            unordered_map<int32_t, int32_t> balances;
+            for (const Row& row : db.get_table("accounts")->get_rows()) {
+                balances.emplace(row.get_int32(0), row.get_int32(1));
+            }
+            for (const Row& row : db.get_table("wanted")->get_rows()) {
+                expected_total += row.get_int32(0) + balances.at(row.get_int32(0));
+            }
+            report("join", "get_rows_lookup_join", timer.elapsed_ms(), "ms");
+        }
+        {
+            BenchTimer timer;
+            auto [pairs, total] = drain(db.query_batches("SELECT account, balance FROM wanted JOIN accounts ON account = id"));
+            report("join", "index_join", timer.elapsed_ms(), "ms");
+            if (pairs != lookups || total != expected_total) {
+                cerr << "join: index join disagrees with get_rows" << endl;
+                ++failures;
+            }
+        }
+    }
+    report("join", "check_failures", static_cast<double>(failures), "");
+}
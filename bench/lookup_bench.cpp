@@ -0,0 +1,65 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "expression.h"
+#include "parser.h"
+#include "query_planner.h"
+#include "table.h"
+
+static shared_ptr<Table> make_lookup_table(size_t rows) {
+    vector<Column> columns = {
+        Column("id", DataType::INT32, 0, false, false, nullopt, true),
+        Column("login", DataType::STRING, 32, false, true),
+        Column("active", DataType::BOOL),
+    };
+    return make_table("accounts", columns, rows, [](vector<ColumnStorage>& batch, size_t i) {
+        batch[0].append_int32(static_cast<int32_t>(i));
+        batch[1].append_string(make_text("user_", i));
+        batch[2].append_bool(i % 3 == 0);
+    });
+}
+
+void run_lookup_bench(size_t rows) {
+    const size_t lookups = 1000;
+    {
+        size_t before = heap_in_use();
+        auto table = make_lookup_table(rows);
+        size_t after = heap_in_use();
+        report("lookup", "table_bytes_per_row", static_cast<double>(after - before) / rows, "bytes");
+    }
+
+    auto table = make_lookup_table(rows);
+    size_t failures = 0;
+    for (const char* column : {"id", "login"}) {
+        string query = string("SELECT * FROM accounts WHERE ") + column + " = ?";
+        auto select = get<SelectStatement>(Parser::parse(query));
+
+        for (bool use_index : {false, true}) {
+            // The full scan is orders of magnitude slower; a handful of probes is enough to time it.
+            size_t count = use_index ? lookups : 10;
+            size_t found = 0;
+            KeyGenerator generator(rows);
+            vector<size_t> targets(count);
+            for (size_t& target : targets) {
+                target = generator.next();
+            }
+            BenchTimer timer;
+            for (size_t target : targets) {
+                ValueType key = string(column) == "id" ? ValueType(static_cast<int32_t>(target)) : ValueType(make_text("user_", target));
+                span<const ValueType> parameters(&key, 1);
+                Expression predicate = Expression::compile(*select.where, *table, parameters);
+                AccessPath path = use_index ? QueryPlanner::choose_access_path(select, *table, parameters) : AccessPath();
+                auto result = table->select(predicate, path);
+                found += result.size();
+                do_not_optimize(result);
+            }
+            if (found != count) {
+                cerr << "lookup: expected " << count << " matches, found " << found << endl;
+                ++failures;
+            }
+            report("lookup", string(use_index ? "hash_index_" : "full_scan_") + column, timer.elapsed_ms() * 1000 / count, "us/query");
+        }
+    }
+    report("lookup", "check_failures", static_cast<double>(failures), "");
+}
@@ -0,0 +1,195 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "bench.h"
+#include "checksum.h"
+#include "parser.h"
+#include "serializer.h"
+
+static shared_ptr<Table> make_mapped_table(size_t rows) {
+    vector<Column> columns = {
+        Column("id", DataType::INT32, 0, true, false, nullopt, true),
+        Column("source", DataType::STRING, 32),
+        Column("severity", DataType::INT32, 0, false, false, nullopt, false, true),
+        Column("acknowledged", DataType::BOOL),
+    };
+    auto table = make_table("events", columns, rows, [](vector<ColumnStorage>& batch, size_t i) {
+        batch[0].append_int32(static_cast<int32_t>(i));
+        batch[1].append_string("host-" + to_string(i % 997));
+        batch[2].append_int32(static_cast<int32_t>(i * 7 % 10));
+        batch[3].append_bool(i % 5 == 0);
+    });
+    table->set_autoincrement_value(0, static_cast<int32_t>(rows));
+    return table;
+}
+
+// Bytes of column payload a snapshot of `table` holds, as its storage lays them out.
+static size_t payload_bytes(const Table& table) {
+    size_t rows = table.get_row_count();
+    size_t bytes = 0;
+    for (size_t i = 0; i < table.get_columns().size(); ++i) {
+        const ColumnStorage& storage = table.get_column_storage(i);
+        switch (storage.get_type()) {
+            case DataType::INT32: bytes += rows * sizeof(int32_t); break;
+            case DataType::BOOL: bytes += rows; break;
+            case DataType::STRING:
+            case DataType::BYTES:
+                bytes += storage.is_inline() ? rows * (storage.get_inline_width() + 1) : (rows + 1) * sizeof(uint64_t) + storage.get_blob().size();
+                break;
+        }
+    }
+    return bytes;
+}
+
+// Whether mapping a snapshot whose middle blob offset is out of order fails
+// under verification instead of handing out values past the end of the file.
+// The block's checksum is recomputed, so it is the order check that fails.
+static bool rejects_corrupt_offsets(Serializer& serializer, const string& path) {
+    auto table = make_shared<Table>("blobs");
+    table->add_column(Column("payload", DataType::BYTES));
+    vector<Row> batch;
+    for (size_t i = 0; i < 1000; ++i) {
+        batch.emplace_back(table->get_schema()).set(0, vector<uint8_t>(7, static_cast<uint8_t>(i)));
+    }
+    table->insert_rows(batch);
+
+    ostringstream out;
+    serializer.save({{"blobs", table}}, out);
+    string bytes = out.str();
+    // The offsets block: its payload starts with 0, 7, 14, and its one chunk
+    // checksum sits 8 bytes before it, after the 16-byte header.
+    uint64_t first_offsets[] = {0, 7, 14};
+    size_t start = bytes.find(string(reinterpret_cast<const char*>(first_offsets), sizeof(first_offsets)));
+    if (start == string::npos || start < 8) {
+        return false;
+    }
+    uint64_t corrupt = uint64_t(1) << 40;
+    bytes.replace(start + 500 * sizeof(uint64_t), sizeof(corrupt), reinterpret_cast<const char*>(&corrupt), sizeof(corrupt));
+    uint32_t crc = Checksum::crc32c(bytes.data() + start, 1001 * sizeof(uint64_t));
+    bytes.replace(start - 8, sizeof(crc), reinterpret_cast<const char*>(&crc), sizeof(crc));
+    {
+        ofstream file(path, ios::binary);
+        file << bytes;
+    }
+    try {
+        serializer.map(path, true);
+        return false;
+    } catch (const SerializationException& e) {
+        return string(e.what()).find("Corrupt offsets") != string::npos;
+    }
+}
+
+void run_mapped_bench(size_t rows) {
+    string path = (filesystem::temp_directory_path() / "mapped_bench.dat").string();
+    Serializer serializer;
+    size_t failures = 0;
+
+    // Startup cost at two data sizes: a stream load grows with the file, a mapped one should not.
+    vector<double> map_ms;
+    for (size_t size : {rows / 10, rows}) {
+        string suffix = '_' + to_string(size) + "_rows";
+        {
+            ofstream out(path, ios::binary);
+            serializer.save({{"events", make_mapped_table(size)}}, out);
+        }
+
+        unordered_map<string, shared_ptr<Table>> streamed;
+        {
+            BenchTimer timer;
+            ifstream in(path, ios::binary);
+            streamed = serializer.load(in);
+            report("mapped", "stream_load" + suffix, timer.elapsed_ms(), "ms");
+        }
+
+        // The fastest of a few maps, so that one slow run does not look like growth.
+        unordered_map<string, shared_ptr<Table>> mapped;
+        double fastest = numeric_limits<double>::max();
+        for (int run = 0; run < 5; ++run) {
+            mapped.clear();
+            BenchTimer timer;
+            mapped = serializer.map(path);
+            fastest = min(fastest, timer.elapsed_ms());
+        }
+        report("mapped", "map_load" + suffix, fastest, "ms");
+        map_ms.push_back(fastest);
+
+        // Snapshots are saved without payload compression unless asked, so no
+        // column has to be expanded into owned memory.
+        size_t borrowed = 0;
+        for (size_t i = 0; i < mapped["events"]->get_columns().size(); ++i) {
+            if (!mapped["events"]->get_column_storage(i).is_borrowed()) {
+                cerr << "mapped: column " << mapped["events"]->get_columns()[i].get_name() << " was copied on load" << endl;
+                ++failures;
+            }
+            borrowed += mapped["events"]->get_column_storage(i).borrowed_bytes();
+        }
+        if (borrowed != payload_bytes(*streamed["events"])) {
+            cerr << "mapped: " << borrowed << " bytes read in place, the file holds " << payload_bytes(*streamed["events"]) << endl;
+            ++failures;
+        }
+
+        // The first query pays for faulting pages in and building the key index.
+        {
+            BenchTimer timer;
+            auto row = mapped["events"]->find_row(0, int32_t(size / 2));
+            do_not_optimize(row);
+            report("mapped", "first_lookup" + suffix, timer.elapsed_ms(), "ms");
+            if (size > 0 && (!row || *row != size / 2)) {
+                cerr << "mapped: key lookup on a mapped table returned the wrong row" << endl;
+                ++failures;
+            }
+        }
+        {
+            BenchTimer timer;
+            auto select = get<SelectStatement>(Parser::parse("SELECT * FROM events WHERE severity = 3"));
+            Expression predicate = Expression::compile(*select.where, *mapped["events"]);
+            auto matches = mapped["events"]->select_row_ids(predicate);
+            do_not_optimize(matches);
+            report("mapped", "first_scan" + suffix, timer.elapsed_ms(), "ms");
+        }
+
+        if (!same_table(*streamed["events"], *mapped["events"], true)) {
+            cerr << "mapped: mapped table differs from the stream-loaded one" << endl;
+            ++failures;
+        }
+    }
+
+    // With ten times the rows, anything that reads every row on load shows up
+    // as growth here. Timings this short are too noisy to fail the bench on.
+    report("mapped", "map_load_growth", map_ms[1] / max(map_ms[0], 1e-6), "ratio");
+
+    // Modifying a mapped table copies its columns; neither the file nor other
+    // tables mapped from it may observe the change.
+    auto first = serializer.map(path);
+    auto second = serializer.map(path);
+    size_t before = heap_in_use();
+    Row row;
+    row.set_value("source", string("late"));
+    row.set_value("severity", int32_t(9));
+    row.set_value("acknowledged", true);
+    try {
+        first["events"]->insert_row(row);
+    } catch (const exception& e) {
+        cerr << "mapped: insert into a mapped table failed: " << e.what() << endl;
+        ++failures;
+    }
+    report("mapped", "copy_on_write_heap", static_cast<double>(heap_in_use() - before) / (1024.0 * 1024.0), "MiB");
+    if (first["events"]->get_row_count() != rows + 1 || second["events"]->get_row_count() != rows
+        || !first["events"]->find_row(0, int32_t(rows)) || !second["events"]->get_column_storage(1).is_borrowed()) {
+        cerr << "mapped: copy-on-write leaked between tables mapped from one file" << endl;
+        ++failures;
+    }
+    first.clear();
+    second.clear();
+
+    if (!rejects_corrupt_offsets(serializer, path)) {
+        cerr << "mapped: snapshot with out-of-order offsets passed the offset check" << endl;
+        ++failures;
+    }
+    report("mapped", "check_failures", static_cast<double>(failures), "");
+
+    remove(path.c_str());
+}
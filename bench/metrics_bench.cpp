@@ -0,0 +1,161 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+
+// Value of the first line of `text` that starts with `series`, or -1.
+static double sample(const string& text, const string& series) {
+    size_t start = text.find("\n" + series + " ");
+    if (start == string::npos) {
+        return -1;
+    }
+    return stod(text.substr(start + series.size() + 2));
+}
+
+void run_metrics_bench(size_t rows) {
+    size_t failures = 0;
+
+    // Every bucket holds the values it is asked for, and its neighbour below does not.
+    for (uint64_t value = 0; value < LatencyHistogram::HIGHEST_VALUE; value = value * 3 / 2 + 1) {
+        size_t bucket = LatencyHistogram::bucket_of(value);
+        if (bucket >= LatencyHistogram::BUCKETS || LatencyHistogram::bucket_limit(bucket) < value
+            || (bucket > 0 && LatencyHistogram::bucket_limit(bucket - 1) >= value)) {
+            cerr << "metrics: " << value << " ns falls in the wrong bucket" << endl;
+            ++failures;
+            break;
+        }
+    }
+
+    // Percentiles of 1 .. rows ns stay within one bucket's width of the truth.
+    {
+        LatencyHistogram histogram;
+        BenchTimer timer;
+        for (size_t i = 1; i <= rows; ++i) {
+            histogram.record(static_cast<uint64_t>(i));
+        }
+        report("metrics", "record_ns", timer.elapsed_ms() * 1e6 / static_cast<double>(rows), "ns");
+        for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+            double expected = quantile * static_cast<double>(rows);
+            auto actual = static_cast<double>(histogram.percentile(quantile));
+            if (actual < expected - 1 || actual > expected * (1.0 + 1.0 / LatencyHistogram::SUB_BUCKETS) + 1) {
+                cerr << "metrics: percentile " << quantile << " is " << actual << " ns, expected about " << expected << endl;
+                ++failures;
+            }
+        }
+        if (histogram.get_count() != rows || histogram.get_max() != rows || histogram.percentile(1.0) != rows) {
+            cerr << "metrics: histogram counted " << histogram.get_count() << " values up to " << histogram.get_max() << endl;
+            ++failures;
+        }
+    }
+
+    // Threads recording into one histogram lose nothing.
+    {
+        LatencyHistogram histogram;
+        size_t threads = 4;
+        BenchTimer timer;
+        vector<thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&histogram, rows, t] {
+                for (size_t i = 0; i < rows; ++i) {
+                    histogram.record(static_cast<uint64_t>(i * 7 + t));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        report("metrics", "record_contended_ns", timer.elapsed_ms() * 1e6 / static_cast<double>(rows * threads), "ns");
+        if (histogram.get_count() != rows * threads) {
+            cerr << "metrics: " << threads << " threads recorded " << histogram.get_count() << " of " << rows * threads << " values" << endl;
+            ++failures;
+        }
+    }
+
+    // Statements through Database::execute, with the log and snapshots counted.
+    filesystem::path directory = filesystem::temp_directory_path();
+    string log_path = (directory / "imdb_metrics_bench.wal").string();
+    string snapshot_path = (directory / "imdb_metrics_bench.snap").string();
+    remove(log_path.c_str());
+    size_t inserts = max<size_t>(rows / 100, 1);
+    {
+        Database db;
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.execute("CREATE TABLE events ({key} id: int32, kind: string[16], payload: bytes)");
+        {
+            BenchTimer timer;
+            for (size_t i = 0; i < inserts; ++i) {
+                db.execute("INSERT INTO events VALUES (" + to_string(i) + ", 'kind_" + to_string(i % 8) + "', 0x0102030405060708)");
+            }
+            report("metrics", "execute_insert_us", timer.elapsed_ms() * 1000 / static_cast<double>(inserts), "us/query");
+        }
+        try {
+            db.execute("INSERT INTO events VALUES (0, 'duplicate', 0x00)");
+        } catch (const exception&) {
+        }
+        try {
+            db.execute("SELEKT id FROM events");
+        } catch (const exception&) {
+        }
+        db.save_to_file(snapshot_path);
+
+        string text;
+        {
+            BenchTimer timer;
+            text = db.export_metrics();
+            report("metrics", "export_us", timer.elapsed_ms() * 1000, "us");
+        }
+        TableMemory memory = db.get_table("events")->memory_breakdown();
+        struct Expectation {
+            const char* series;
+            double value;
+        };
+        vector<Expectation> expectations = {
+            {"imdb_statement_latency_us_count{type=\"insert\"}", static_cast<double>(inserts)},
+            {"imdb_statement_latency_us_count{type=\"create_table\"}", 1},
+            {"imdb_statement_failures_total{type=\"insert\"}", 1},
+            {"imdb_parse_failures_total", 1},
+            {"imdb_table_rows{table=\"events\"}", static_cast<double>(inserts)},
+            {"imdb_table_bytes{table=\"events\",part=\"strings\"}", static_cast<double>(memory.string_bytes)},
+            {"imdb_snapshot_writes_total", 1},
+            {"imdb_log_records_total", static_cast<double>(inserts + 1)},
+        };
+        for (const Expectation& expectation : expectations) {
+            double actual = sample(text, expectation.series);
+            if (actual != expectation.value) {
+                cerr << "metrics: " << expectation.series << " is " << actual << ", expected " << expectation.value << endl;
+                ++failures;
+            }
+        }
+        if (memory.string_bytes == 0 || memory.column_bytes == 0 || memory.index_bytes == 0 || memory.mapped_bytes != 0) {
+            cerr << "metrics: events holds " << memory.column_bytes << " column, " << memory.string_bytes << " string, "
+                 << memory.index_bytes << " index and " << memory.mapped_bytes << " mapped bytes" << endl;
+            ++failures;
+        }
+        if (sample(text, "imdb_statement_latency_us{type=\"insert\",quantile=\"0.99\"}") <= 0) {
+            cerr << "metrics: no insert latency exported" << endl;
+            ++failures;
+        }
+    }
+    remove(log_path.c_str());
+
+    // A mapped snapshot is read in place, not copied to the heap.
+    {
+        Database db;
+        db.load_from_file(snapshot_path);
+        TableMemory memory = db.get_table("events")->memory_breakdown();
+        report("metrics", "mapped_table_bytes", static_cast<double>(memory.mapped_bytes), "bytes");
+        string text = db.export_metrics();
+        if (memory.mapped_bytes == 0 || sample(text, "imdb_snapshot_reads_total") != 1
+            || sample(text, "imdb_snapshot_bytes_read_total") != static_cast<double>(filesystem::file_size(snapshot_path))) {
+            cerr << "metrics: mapped snapshot reports " << memory.mapped_bytes << " bytes" << endl;
+            ++failures;
+        }
+    }
+    remove(snapshot_path.c_str());
+
+    report("metrics", "check_failures", static_cast<double>(failures), "");
+}
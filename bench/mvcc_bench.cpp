@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+#include "epoch.h"
+
+static const int32_t SENSORS = 100;
+
+static double percentile(vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// A full scan must return exactly the rows below its snapshot, in row order.
+static bool check_full_scan(Cursor cursor) {
+    int32_t expected = 0;
+    for (RowView view : cursor) {
+        if (view.get_int32(0) != expected || view.get_int32(1) != expected % SENSORS) {
+            return false;
+        }
+        ++expected;
+    }
+    return true;
+}
+
+// An index range scan over sensors [10, 20) must return, for every sensor, the
+// ids sensor, sensor + 100, ... up to one snapshot: in (key, row) order, no id
+// twice, none skipped, and every sensor's last id within one round of the others.
+static bool check_range_scan(Cursor cursor) {
+    int32_t previous_sensor = -1;
+    int32_t previous_id = -1;
+    int32_t lowest_last = numeric_limits<int32_t>::max();
+    int32_t highest_last = -1;
+    for (RowView view : cursor) {
+        int32_t id = view.get_int32(0);
+        int32_t sensor = view.get_int32(1);
+        if (sensor != previous_sensor) {
+            if (sensor <= previous_sensor || id != sensor) {
+                return false;
+            }
+            if (previous_sensor >= 0) {
+                lowest_last = min(lowest_last, previous_id);
+                highest_last = max(highest_last, previous_id);
+            }
+            previous_sensor = sensor;
+        } else if (id != previous_id + SENSORS) {
+            return false;
+        }
+        previous_id = id;
+    }
+    lowest_last = min(lowest_last, previous_id);
+    highest_last = max(highest_last, previous_id);
+    return previous_sensor == 19 && highest_last - lowest_last < SENSORS;
+}
+
+struct LatencyRun {
+    vector<double> insert_us;
+    size_t scans = 0;
+    double elapsed_ms = 0;
+};
+
+// One writer inserts rows one at a time while one reader scans the whole
+// table over and over. With `hold_lock` the reader holds the table's read lock
+// for each scan, the way a cursor did before reads were versioned. The
+// maximum also catches the writer's own index and array growth.
+static LatencyRun run_inserts_beside_scans(Database& db, double duration_ms, bool hold_lock) {
+    LatencyRun run;
+    shared_ptr<Table> table = db.get_table("readings");
+    atomic<bool> stop = false;
+    thread reader([&] {
+        while (!stop) {
+            shared_lock<shared_mutex> lock;
+            if (hold_lock) {
+                lock = table->lock_shared();
+            }
+            int64_t sum = 0;
+            for (RowView view : db.query("SELECT value FROM readings")) {
+                sum += view.get_int32(0);
+            }
+            do_not_optimize(sum);
+            ++run.scans;
+        }
+    });
+
+    auto insert = db.prepare("INSERT INTO readings (sensor, value) VALUES (?, ?)");
+    BenchTimer timer;
+    size_t next_id = table->get_row_count();
+    while (timer.elapsed_ms() < duration_ms) {
+        BenchTimer latency;
+        insert.bind(1, static_cast<int32_t>(next_id % SENSORS)).bind(2, static_cast<int32_t>(next_id)).execute();
+        run.insert_us.push_back(latency.elapsed_ms() * 1000);
+        ++next_id;
+    }
+    run.elapsed_ms = timer.elapsed_ms();
+    stop = true;
+    reader.join();
+    return run;
+}
+
+void run_mvcc_bench(size_t rows) {
+    size_t failures = 0;
+    const double duration_ms = 1000;
+
+    Database db;
+    db.execute("CREATE TABLE readings ({key, autoincrement} id: int32, sensor: int32, value: int32)");
+    db.execute("CREATE INDEX ON readings (sensor)");
+    shared_ptr<Table> readings = db.get_table("readings");
+    vector<Row> batch;
+    for (size_t i = 0; i < rows; ++i) {
+        Row& row = batch.emplace_back(readings->get_schema());
+        row.set(1, static_cast<int32_t>(i % SENSORS));
+        row.set(2, static_cast<int32_t>(i));
+        if (batch.size() == 10000 || i + 1 == rows) {
+            readings->insert_rows(batch);
+            batch.clear();
+        }
+    }
+
+    for (bool hold_lock : {true, false}) {
+        LatencyRun run = run_inserts_beside_scans(db, duration_ms, hold_lock);
+        string mode = hold_lock ? "locked_scans" : "snapshot_scans";
+        report("mvcc", mode + "_inserts", run.insert_us.size() / (run.elapsed_ms / 1000), "inserts/s");
+        report("mvcc", mode + "_scans", run.scans / (run.elapsed_ms / 1000), "scans/s");
+        report("mvcc", mode + "_insert_p50", percentile(run.insert_us, 0.5), "us");
+        report("mvcc", mode + "_insert_p99", percentile(run.insert_us, 0.99), "us");
+        report("mvcc", mode + "_insert_p999", percentile(run.insert_us, 0.999), "us");
+        report("mvcc", mode + "_insert_max", percentile(run.insert_us, 1.0), "us");
+    }
+
+    // Consistency: scans opened while the writer runs see one snapshot each.
+    {
+        atomic<bool> stop = false;
+        thread writer([&] {
+            auto insert = db.prepare("INSERT INTO readings (sensor, value) VALUES (?, ?)");
+            size_t next_id = readings->get_row_count();
+            while (!stop) {
+                insert.bind(1, static_cast<int32_t>(next_id % SENSORS)).bind(2, static_cast<int32_t>(next_id)).execute();
+                ++next_id;
+            }
+        });
+        size_t scans = 0;
+        BenchTimer timer;
+        while (timer.elapsed_ms() < duration_ms) {
+            if (!check_full_scan(db.query("SELECT id, sensor FROM readings"))
+                || !check_range_scan(db.query("SELECT id, sensor FROM readings WHERE sensor >= 10 AND sensor < 20 ORDER BY sensor"))) {
+                ++failures;
+            }
+            ++scans;
+        }
+        stop = true;
+        writer.join();
+        report("mvcc", "consistency_scans", static_cast<double>(scans), "scans");
+    }
+
+    // More cursors than one block of guard slots holds stay open together.
+    {
+        vector<Cursor> cursors;
+        try {
+            for (size_t i = 0; i < Epoch::SLOTS_PER_BLOCK * 2 + 1; ++i) {
+                cursors.push_back(db.query("SELECT id FROM readings LIMIT 1"));
+            }
+        } catch (const exception& e) {
+            cerr << "mvcc: opening cursor " << cursors.size() + 1 << " failed: " << e.what() << endl;
+            ++failures;
+        }
+        if (Epoch::capacity() < cursors.size()) {
+            cerr << "mvcc: " << cursors.size() << " cursors open in " << Epoch::capacity() << " guard slots" << endl;
+            ++failures;
+        }
+    }
+
+    // Readers on several threads release guards while another retires
+    // memory, so releases often find a collect already running.
+    {
+        atomic<bool> stop = false;
+        vector<thread> readers;
+        for (size_t r = 0; r < 4; ++r) {
+            readers.emplace_back([&stop] {
+                while (!stop) {
+                    Epoch::Guard guard;
+                    this_thread::yield();
+                }
+            });
+        }
+        for (size_t i = 0; i < 20000; ++i) {
+            Epoch::retire(make_shared<int64_t>(static_cast<int64_t>(i)));
+        }
+        stop = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+    }
+
+    // Every retired array is freed once no cursor or guard is left, without
+    // waiting for another write.
+    if (Epoch::pending() != 0) {
+        cerr << "mvcc: " << Epoch::pending() << " retired arrays were never freed" << endl;
+        ++failures;
+    }
+    report("mvcc", "check_failures", static_cast<double>(failures), "");
+}
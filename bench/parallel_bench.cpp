@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+
+static vector<size_t> row_ids(Cursor cursor) {
+    vector<size_t> rows;
+    for (RowView view : cursor) {
+        rows.push_back(view.get_row_id());
+    }
+    return rows;
+}
+
+void run_parallel_bench(size_t rows) {
+    size_t failures = 0;
+    report("parallel", "hardware_threads", thread::hardware_concurrency(), "");
+
+    Database db;
+    db.execute("CREATE TABLE measurements (id: int32, station: int32, reading: int32, note: string[16])");
+    shared_ptr<Table> measurements = db.get_table("measurements");
+    for (size_t start = 0; start < rows; start += 65536) {
+        vector<ColumnStorage> batch;
+        for (const auto& column : measurements->get_columns()) {
+            batch.emplace_back(column.get_type());
+        }
+        for (size_t i = start; i < min(rows, start + 65536); ++i) {
+            batch[0].append_int32(static_cast<int32_t>(i));
+            batch[1].append_int32(static_cast<int32_t>(i % 97));
+            batch[2].append_int32(static_cast<int32_t>((i * 7919) % 1000));
+            batch[3].append_string(i % 3 == 0 ? "calibrated" : "raw");
+        }
+        measurements->append_columns(batch);
+    }
+
+    const vector<pair<string, string>> queries = {
+        {"selective", "SELECT id FROM measurements WHERE station = 7 AND reading > 500"},
+        {"half", "SELECT id FROM measurements WHERE reading < 500"},
+        {"string", "SELECT id FROM measurements WHERE note = 'calibrated' AND station < 10"},
+        {"sorted", "SELECT id FROM measurements WHERE station = 3 ORDER BY reading DESC"},
+    };
+    vector<size_t> thread_counts = {1, 2, 4, 8};
+    for (size_t threads = 16; threads <= thread::hardware_concurrency(); threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    size_t repetitions = max<size_t>(3, 20000000 / max<size_t>(rows, 1));
+
+    for (const auto& [label, query] : queries) {
+        db.set_scan_threads(1);
+        vector<size_t> expected = row_ids(db.query(query));
+        double single = 0;
+        for (size_t threads : thread_counts) {
+            db.set_scan_threads(threads);
+            if (row_ids(db.query(query)) != expected) {
+                cerr << "parallel: " << label << " with " << threads << " threads returned different rows" << endl;
+                ++failures;
+            }
+            BenchTimer timer;
+            for (size_t r = 0; r < repetitions; ++r) {
+                size_t matched = 0;
+                for (RowView view : db.query(query)) {
+                    do_not_optimize(view);
+                    ++matched;
+                }
+                do_not_optimize(matched);
+            }
+            double rate = repetitions / (timer.elapsed_ms() / 1000);
+            if (threads == 1) {
+                single = rate;
+            }
+            report("parallel", label + "_" + to_string(threads) + "_threads", rate, "queries/s");
+            report("parallel", label + "_speedup_" + to_string(threads) + "_threads", rate / single, "x");
+        }
+    }
+
+    // Several queries sharing one pool at once still get their own rows back.
+    {
+        const string& query = queries.front().second;
+        db.set_scan_threads(1);
+        vector<size_t> expected = row_ids(db.query(query));
+        db.set_scan_threads(4);
+        vector<thread> clients;
+        atomic<size_t> mismatches = 0;
+        for (size_t c = 0; c < 4; ++c) {
+            clients.emplace_back([&] {
+                for (size_t r = 0; r < 5; ++r) {
+                    if (row_ids(db.query(query)) != expected) {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        for (auto& client : clients) {
+            client.join();
+        }
+        if (mismatches != 0) {
+            cerr << "parallel: " << mismatches << " concurrent queries returned different rows" << endl;
+            ++failures;
+        }
+    }
+    report("parallel", "check_failures", static_cast<double>(failures), "");
+}
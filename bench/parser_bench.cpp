@@ -0,0 +1,103 @@
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "exceptions.h"
+#include "parser.h"
+#include "statement_cache.h"
+
+// The regex matching QueryExecutor::execute performed per INSERT before the
+// hand-written parser, kept here as the baseline.
+static size_t legacy_regex_parse(const string& query) {
+    regex create_table_regex(R"(CREATE\s+TABLE\s+(\w+)\s*\((.*)\))", regex::icase);
+    smatch match;
+    if (regex_match(query, match, create_table_regex)) {
+        return 0;
+    }
+    regex insert_regex(R"(INSERT\s+INTO\s+(\w+)\s+VALUES\s*\((.*)\))", regex::icase);
+    if (!regex_match(query, match, insert_regex)) {
+        return 0;
+    }
+    string values_str = match[2];
+    regex value_regex(R"(\s*(\S+)\s*)");
+    size_t values = 0;
+    for (auto it = sregex_iterator(values_str.begin(), values_str.end(), value_regex); it != sregex_iterator(); ++it) {
+        ++values;
+    }
+    return values;
+}
+
+// Statements the grammar must accept, with the number of values in each row,
+// and statements it must reject. Returns the number that it got wrong.
+static size_t grammar_failures() {
+    size_t failures = 0;
+    struct Accepted {
+        const char* query;
+        size_t rows;
+    };
+    for (Accepted accepted : {Accepted{"INSERT INTO users VALUES (1, 'a', 0x01, true)", 1}, Accepted{"INSERT INTO users VALUES (1 'a' 0x01 true)", 1},
+                              Accepted{"INSERT INTO users VALUES (1, 'a', 0x01, true), (2 'b' 0x02 false)", 2}}) {
+        try {
+            auto insert = get<InsertStatement>(Parser::parse(accepted.query));
+            if (insert.rows.size() != accepted.rows || insert.rows.back().size() != 4) {
+                cerr << "parser: wrong values for: " << accepted.query << endl;
+                ++failures;
+            }
+        } catch (const exception& e) {
+            cerr << "parser: rejected " << accepted.query << ": " << e.what() << endl;
+            ++failures;
+        }
+    }
+    for (const char* rejected : {"SELECT id FROM users WHERE id = 1 extra", "INSERT INTO users VALUES (1, 'a') (2, 'b')",
+                                 "INSERT INTO users VALUES (1, 'a'), (2)", "INSERT INTO users (id, login) VALUES (1, 'a', true)",
+                                 "INSERT INTO users (login, login) VALUES ('a', 'b')", "INSERT (login = 'a', login = 'b') TO users",
+                                 "CREATE TABLE t (name: string[99999999999999999999999])", "SELECT id FROM users LIMIT 99999999999999999999999"}) {
+        try {
+            Parser::parse(rejected);
+            cerr << "parser: accepted " << rejected << endl;
+            ++failures;
+        } catch (const InvalidQueryException&) {
+        }
+    }
+    return failures;
+}
+
+void run_parser_bench(size_t statements) {
+    vector<string> queries;
+    queries.reserve(statements);
+    for (size_t i = 0; i < statements; ++i) {
+        queries.push_back("INSERT INTO users VALUES (" + to_string(i) + " '" + make_text("user_", i) + "' 0x0102030405060708 false)");
+    }
+
+    {
+        BenchTimer timer;
+        size_t values = 0;
+        for (const auto& query : queries) {
+            values += legacy_regex_parse(query);
+        }
+        do_not_optimize(values);
+        report("parser", "regex_statements_per_sec", statements / (timer.elapsed_ms() / 1000.0), "stmt/s");
+    }
+    {
+        BenchTimer timer;
+        size_t values = 0;
+        for (const auto& query : queries) {
+            values += get<InsertStatement>(Parser::parse(query)).rows.front().size();
+        }
+        do_not_optimize(values);
+        report("parser", "parser_statements_per_sec", statements / (timer.elapsed_ms() / 1000.0), "stmt/s");
+    }
+    {
+        StatementCache cache;
+        const string repeated = "SELECT id, login FROM users WHERE id = 42";
+        BenchTimer timer;
+        size_t found = 0;
+        for (size_t i = 0; i < statements; ++i) {
+            found += cache.get_or_parse(repeated) != nullptr;
+        }
+        do_not_optimize(found);
+        report("parser", "cached_statements_per_sec", statements / (timer.elapsed_ms() / 1000.0), "stmt/s");
+    }
+    report("parser", "grammar_failures", static_cast<double>(grammar_failures()), "");
+}
@@ -0,0 +1,90 @@
+#include <array>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include "bench.h"
+#include "database.h"
+#include "exceptions.h"
+
+static const char* users_table = "CREATE TABLE users ({autoincrement} id: int32, login: string[32], password_hash: bytes[8], is_admin: bool = false)";
+
+// A misused prepared INSERT must throw without inserting anything. Returns the
+// number of misuses that went through, plus one if a correct execute failed.
+static size_t binding_failures(span<const uint8_t> hash) {
+    Database db;
+    db.execute(users_table);
+    const string insert = "INSERT INTO users (login, password_hash, is_admin) VALUES (?, ?, ?)";
+    size_t failures = 0;
+    auto expect_rejected = [&](const char* misuse, const function<void(PreparedStatement&)>& run) {
+        PreparedStatement statement = db.prepare(insert);
+        try {
+            run(statement);
+            cerr << "prepared: " << misuse << " was accepted" << endl;
+            ++failures;
+        } catch (const InvalidQueryException&) {
+        }
+    };
+    expect_rejected("an unbound parameter", [&](PreparedStatement& statement) { statement.bind(1, "user").bind(2, hash).execute(); });
+    expect_rejected("parameter index 0", [](PreparedStatement& statement) { statement.bind(0, "user"); });
+    expect_rejected("a parameter index past the last", [](PreparedStatement& statement) { statement.bind(4, true); });
+    expect_rejected("an int32 bound to a string", [](PreparedStatement& statement) { statement.bind(1, int32_t(7)); });
+    expect_rejected("a string bound to bytes", [](PreparedStatement& statement) { statement.bind(2, "0x01"); });
+
+    // Bindings are cleared by request only; a fully bound statement runs again.
+    PreparedStatement statement = db.prepare(insert);
+    try {
+        statement.bind(1, "user").bind(2, hash).bind(3, true).execute();
+        statement.execute();
+        statement.clear_bindings();
+        statement.execute();
+        cerr << "prepared: execute after clear_bindings was accepted" << endl;
+        ++failures;
+    } catch (const InvalidQueryException&) {
+    }
+    if (db.get_table("users")->get_row_count() != 2) {
+        cerr << "prepared: rejected executions changed the table" << endl;
+        ++failures;
+    }
+    return failures;
+}
+
+void run_prepared_bench(size_t rows) {
+    const array<uint8_t, 8> hash = {1, 2, 3, 4, 5, 6, 7, 8};
+    ostringstream sink;
+    streambuf* original = cout.rdbuf(sink.rdbuf());
+
+    double execute_ms = 0;
+    {
+        Database db;
+        db.execute(users_table);
+        BenchTimer timer;
+        for (size_t i = 0; i < rows; ++i) {
+            db.execute("INSERT INTO users (login, password_hash, is_admin) VALUES ('user_" + to_string(i) + "', 0x0102030405060708, false)");
+            if (sink.tellp() > (1 << 20)) {
+                sink.str("");
+            }
+        }
+        execute_ms = timer.elapsed_ms();
+    }
+
+    double prepared_ms = 0;
+    {
+        Database db;
+        db.execute(users_table);
+        PreparedStatement insert = db.prepare("INSERT INTO users (login, password_hash, is_admin) VALUES (?, ?, ?)");
+        string login;
+        BenchTimer timer;
+        for (size_t i = 0; i < rows; ++i) {
+            login = "user_" + to_string(i);
+            insert.bind(1, login).bind(2, span<const uint8_t>(hash)).bind(3, false).execute();
+        }
+        prepared_ms = timer.elapsed_ms();
+    }
+
+    size_t failures = binding_failures(hash);
+    cout.rdbuf(original);
+    report("prepared", "execute_inserts_per_sec", rows / (execute_ms / 1000.0), "rows/s");
+    report("prepared", "prepared_inserts_per_sec", rows / (prepared_ms / 1000.0), "rows/s");
+    report("prepared", "binding_failures", static_cast<double>(failures), "");
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include "bench.h"
+#include "expression.h"
+#include "parser.h"
+#include "query_planner.h"
+#include "table.h"
+
+static shared_ptr<Table> make_range_table(size_t rows) {
+    mt19937 rng(42);
+    return make_table("readings", {Column("id", DataType::INT32), Column("value", DataType::INT32), Column("valid", DataType::BOOL)}, rows,
+                      [&rng, rows](vector<ColumnStorage>& batch, size_t i) {
+                          batch[0].append_int32(static_cast<int32_t>(i));
+                          batch[1].append_int32(static_cast<int32_t>(rng() % rows));
+                          batch[2].append_bool(i % 2 == 0);
+                      });
+}
+
+// Compares the planned access path against a full scan sorted the same way.
+static bool matches_full_scan(const Table& table, const string& query) {
+    auto select = get<SelectStatement>(Parser::parse(query));
+    Expression predicate = select.where ? Expression::compile(*select.where, table) : Expression();
+    AccessPath path = QueryPlanner::choose_access_path(select, table);
+    AccessPath full_scan;
+    full_scan.order_ordinal = path.order_ordinal;
+    full_scan.descending = path.descending;
+
+    auto planned = table.select_row_ids(predicate, path);
+    auto expected = table.select_row_ids(predicate, full_scan);
+    if (!select.order_by) {
+        sort(planned.begin(), planned.end());
+    }
+    if (planned != expected) {
+        cerr << "range: index and full scan disagree for: " << query << endl;
+        return false;
+    }
+    return true;
+}
+
+void run_range_bench(size_t rows) {
+    size_t checks = 0;
+    size_t failures = 0;
+    auto check = [&](const Table& table, const string& query) {
+        ++checks;
+        failures += matches_full_scan(table, query) ? 0 : 1;
+    };
+
+    auto table = make_range_table(rows);
+    {
+        BenchTimer timer;
+        table->create_ordered_index(table->get_column_ordinal("value"));
+        report("range", "build_index", timer.elapsed_ms(), "ms");
+    }
+    {
+        // Incremental inserts in key order exercise the append-friendly leaf split.
+        auto appended = make_range_table(0);
+        appended->create_ordered_index(appended->get_column_ordinal("id"));
+        vector<Row> batch;
+        for (size_t i = 0; i < rows; ++i) {
+            Row& row = batch.emplace_back(appended->get_schema());
+            row.set(0, static_cast<int32_t>(i));
+            row.set(1, static_cast<int32_t>(i % 1000));
+            row.set(2, false);
+            if (batch.size() == 1000 || i + 1 == rows) {
+                appended->insert_rows(batch);
+                batch.clear();
+            }
+        }
+        size_t before = heap_in_use();
+        appended->create_ordered_index(appended->get_column_ordinal("value"));
+        report("range", "index_bytes_per_row", static_cast<double>(heap_in_use() - before) / max<size_t>(rows, 1), "bytes");
+        check(*appended, "SELECT * FROM readings WHERE id >= 10 AND id < 5000 ORDER BY id DESC");
+        check(*appended, "SELECT * FROM readings WHERE value = 7 ORDER BY value");
+    }
+
+    for (const char* query : {
+             "SELECT * FROM readings WHERE value < 100",
+             "SELECT * FROM readings WHERE value >= 500 AND value <= 900 AND valid",
+             "SELECT * FROM readings WHERE 1000 > value ORDER BY value DESC",
+             "SELECT * FROM readings WHERE value > 2147483647",
+             "SELECT * FROM readings WHERE value < 50 ORDER BY id",
+             "SELECT * FROM readings ORDER BY value",
+             "SELECT * FROM readings WHERE value = 3 OR value = 4"}) {
+        check(*table, query);
+    }
+    report("range", "correctness_failures", static_cast<double>(failures), "of " + to_string(checks));
+
+    for (auto [percent, label] : {pair{0.01, "0.01pct"}, pair{0.1, "0.1pct"}, pair{1.0, "1pct"}, pair{10.0, "10pct"}, pair{50.0, "50pct"}}) {
+        int32_t threshold = static_cast<int32_t>(rows * percent / 100);
+        auto select = get<SelectStatement>(Parser::parse("SELECT * FROM readings WHERE value < " + to_string(threshold)));
+        Expression predicate = Expression::compile(*select.where, *table);
+
+        AccessPath index_path;
+        index_path.method = AccessMethod::INDEX_RANGE;
+        index_path.ordinal = table->get_column_ordinal("value");
+        index_path.range.upper = threshold - 1;
+        for (bool use_index : {false, true}) {
+            BenchTimer timer;
+            auto result = table->select_row_ids(predicate, use_index ? index_path : AccessPath());
+            do_not_optimize(result);
+            report("range", string(use_index ? "index_" : "full_scan_") + label, timer.elapsed_ms(), "ms");
+        }
+        BenchTimer timer;
+        auto result = table->select_row_ids(predicate, QueryPlanner::choose_access_path(select, *table));
+        do_not_optimize(result);
+        report("range", string("planned_") + label, timer.elapsed_ms(), "ms");
+    }
+
+    {
+        auto select = get<SelectStatement>(Parser::parse("SELECT * FROM readings ORDER BY value"));
+        AccessPath sort_path;
+        sort_path.order_ordinal = table->get_column_ordinal("value");
+        for (bool use_index : {false, true}) {
+            BenchTimer timer;
+            auto result = table->select_row_ids(Expression(), use_index ? QueryPlanner::choose_access_path(select, *table) : sort_path);
+            do_not_optimize(result);
+            report("range", use_index ? "order_by_index" : "order_by_sort", timer.elapsed_ms(), "ms");
+        }
+    }
+}
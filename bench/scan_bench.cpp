@@ -0,0 +1,107 @@
+#include <sstream>
+#include <string>
+
+#include "bench.h"
+#include "expression.h"
+#include "parser.h"
+#include "scan_kernels.h"
+#include "table.h"
+
+// Expression::evaluate before conditions were compiled: the condition string
+// is re-tokenized and the literal re-parsed for every row.
+static bool legacy_evaluate(const string& condition, const Row& row) {
+    istringstream iss(condition);
+    string column, op, value;
+    iss >> column >> op >> value;
+    int32_t column_value = get<int32_t>(row.get_value(column));
+    int32_t compare_value = stoi(value);
+    if (op == "<") return column_value < compare_value;
+    if (op == ">") return column_value > compare_value;
+    return column_value == compare_value;
+}
+
+static shared_ptr<Table> make_scan_table(size_t rows) {
+    return make_table("events", {Column("id", DataType::INT32), Column("kind", DataType::STRING, 16), Column("flag", DataType::BOOL)}, rows,
+                      [](vector<ColumnStorage>& batch, size_t i) {
+                          batch[0].append_int32(static_cast<int32_t>(i));
+                          batch[1].append_string(i % 4 == 0 ? "click" : "view");
+                          batch[2].append_bool(i % 2 == 0);
+                      });
+}
+
+void run_scan_bench(size_t rows) {
+    auto table = make_scan_table(rows);
+
+    for (int percent : {1, 10, 50}) {
+        int32_t threshold = static_cast<int32_t>(rows * percent / 100);
+        string condition = "id < " + to_string(threshold);
+        string label = to_string(percent) + "pct";
+
+        {
+            BenchTimer timer;
+            auto result = table->select([&condition](const Row& row) { return legacy_evaluate(condition, row); });
+            do_not_optimize(result);
+            report("scan", "interpreted_" + label, timer.elapsed_ms(), "ms");
+        }
+        {
+            BenchTimer timer;
+            auto select = get<SelectStatement>(Parser::parse("SELECT * FROM events WHERE " + condition));
+            auto result = table->select(Expression::compile(*select.where, *table));
+            do_not_optimize(result);
+            report("scan", "compiled_" + label, timer.elapsed_ms(), "ms");
+        }
+    }
+
+    {
+        auto select = get<SelectStatement>(Parser::parse("SELECT * FROM events WHERE (kind = 'click' AND flag) OR NOT id > 10"));
+        BenchTimer timer;
+        auto result = table->select(Expression::compile(*select.where, *table));
+        do_not_optimize(result);
+        report("scan", "compiled_compound", timer.elapsed_ms(), "ms");
+    }
+
+    // Row-at-a-time evaluation of the compiled tree against the bitmap kernels at each SIMD level.
+    SimdLevel detected = ScanKernels::detected_level();
+    vector<string> conditions = {
+        "id < " + to_string(rows / 100),
+        "id >= " + to_string(rows / 2),
+        "flag",
+        "id < " + to_string(rows / 2) + " AND NOT flag",
+        "id = 7 OR flag = false",
+    };
+    vector<string> labels = {"int32_1pct", "int32_50pct", "bool", "and_not", "or"};
+    size_t failures = 0;
+    for (size_t c = 0; c < conditions.size(); ++c) {
+        auto select = get<SelectStatement>(Parser::parse("SELECT * FROM events WHERE " + conditions[c]));
+        Expression predicate = Expression::compile(*select.where, *table);
+
+        vector<size_t> expected;
+        {
+            BenchTimer timer;
+            for (size_t i = 0; i < rows; ++i) {
+                if (predicate.matches(i)) {
+                    expected.push_back(i);
+                }
+            }
+            do_not_optimize(expected);
+            report("scan", "row_at_a_time_" + labels[c], timer.elapsed_ms(), "ms");
+        }
+
+        for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE42, SimdLevel::AVX2}) {
+            if (static_cast<int>(level) > static_cast<int>(detected)) {
+                continue;
+            }
+            ScanKernels::set_level(level);
+            BenchTimer timer;
+            auto result = table->select_row_ids(predicate);
+            do_not_optimize(result);
+            report("scan", string("bitmap_") + ScanKernels::level_name(level) + "_" + labels[c], timer.elapsed_ms(), "ms");
+            if (result != expected) {
+                cerr << "scan: " << ScanKernels::level_name(level) << " kernels disagree with row-at-a-time evaluation for: " << conditions[c] << endl;
+                ++failures;
+            }
+        }
+        ScanKernels::set_level(detected);
+    }
+    report("scan", "kernel_failures", static_cast<double>(failures), "");
+}
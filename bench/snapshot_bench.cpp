@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "bench.h"
+#include "serializer.h"
+
+static shared_ptr<Table> make_snapshot_table(size_t rows) {
+    vector<Column> columns = {
+        Column("id", DataType::INT32, 0, true, false, nullopt, true),
+        Column("title", DataType::STRING, 64, false, false, string("untitled")),
+        Column("digest", DataType::BYTES, 16),
+        Column("published", DataType::BOOL, 0, false, false, false, false, true),
+        Column("views", DataType::INT32, 0, false, false, int32_t(0), false, true),
+    };
+    auto table = make_table("documents", columns, rows, [](vector<ColumnStorage>& batch, size_t i) {
+        uint8_t digest[] = {static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), 0xff};
+        batch[0].append_int32(static_cast<int32_t>(i));
+        batch[1].append_string(i % 7 == 0 ? string("untitled") : make_text("document title ", i));
+        batch[2].append_bytes(digest);
+        batch[3].append_bool(i % 3 == 0);
+        batch[4].append_int32(static_cast<int32_t>(i * 31 % 1000));
+    });
+    table->set_autoincrement_value(0, static_cast<int32_t>(rows));
+    return table;
+}
+
+void run_snapshot_bench(size_t rows) {
+    unordered_map<string, shared_ptr<Table>> tables = {
+        {"documents", make_snapshot_table(rows)},
+        {"empty", make_snapshot_table(0)},
+    };
+    string path = (filesystem::temp_directory_path() / "snapshot_bench.dat").string();
+    Serializer serializer;
+
+    {
+        BenchTimer timer;
+        ofstream out(path, ios::binary);
+        serializer.save(tables, out);
+        out.close();
+        double seconds = timer.elapsed_ms() / 1000;
+        double megabytes = static_cast<double>(filesystem::file_size(path)) / (1024.0 * 1024.0);
+        report("snapshot", "file_size", megabytes, "MiB");
+        report("snapshot", "save_throughput", megabytes / seconds, "MiB/s");
+    }
+
+    unordered_map<string, shared_ptr<Table>> loaded;
+    {
+        BenchTimer timer;
+        ifstream in(path, ios::binary);
+        loaded = serializer.load(in);
+        double seconds = timer.elapsed_ms() / 1000;
+        report("snapshot", "load_throughput", static_cast<double>(filesystem::file_size(path)) / (1024.0 * 1024.0) / seconds, "MiB/s");
+    }
+
+    size_t failures = 0;
+    for (const auto& [name, table] : tables) {
+        if (!loaded.count(name) || !same_table(*table, *loaded[name])) {
+            cerr << "snapshot: table '" << name << "' did not round-trip" << endl;
+            ++failures;
+        }
+    }
+
+    // A reloaded table keeps handing out fresh autoincrement keys.
+    Row row;
+    row.set_value("digest", vector<uint8_t>{1});
+    try {
+        loaded["documents"]->insert_row(row);
+    } catch (const exception& e) {
+        cerr << "snapshot: insert after reload failed: " << e.what() << endl;
+        ++failures;
+    }
+
+    // Flipping one payload byte must be caught by the chunk checksums.
+    {
+        ostringstream out;
+        serializer.save({{"documents", tables["documents"]}}, out);
+        string bytes = out.str();
+        bytes[bytes.size() / 2] ^= 0x40;
+        istringstream in(bytes);
+        try {
+            serializer.load(in);
+            cerr << "snapshot: corrupted snapshot loaded without error" << endl;
+            ++failures;
+        } catch (const SerializationException&) {
+        }
+    }
+    // A block size far past the end of the file must be rejected before
+    // anything is allocated for it. The first block follows the 24-byte header.
+    {
+        ostringstream out;
+        serializer.save({{"documents", tables["documents"]}}, out);
+        string bytes = out.str();
+        uint64_t size = uint64_t(1) << 46;
+        uint32_t chunk_bytes = uint32_t(1) << 31;
+        uint32_t chunk_count = static_cast<uint32_t>(size / chunk_bytes);
+        bytes.replace(24, sizeof(size), reinterpret_cast<const char*>(&size), sizeof(size));
+        bytes.replace(32, sizeof(chunk_bytes), reinterpret_cast<const char*>(&chunk_bytes), sizeof(chunk_bytes));
+        bytes.replace(36, sizeof(chunk_count), reinterpret_cast<const char*>(&chunk_count), sizeof(chunk_count));
+        istringstream in(bytes);
+        try {
+            serializer.load(in);
+            cerr << "snapshot: snapshot with an oversized block loaded without error" << endl;
+            ++failures;
+        } catch (const SerializationException&) {
+        } catch (const exception& e) {
+            cerr << "snapshot: oversized block failed with " << e.what() << " instead of a SerializationException" << endl;
+            ++failures;
+        }
+    }
+    report("snapshot", "round_trip_failures", static_cast<double>(failures), "");
+
+    remove(path.c_str());
+}
@@ -0,0 +1,121 @@
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "table.h"
+
+// The layout Table used before columnar storage: one hash map per row.
+using LegacyRow = unordered_map<string, ValueType>;
+
+static string make_login(size_t i) {
+    return make_text("user_", i);
+}
+
+void run_storage_bench(size_t rows) {
+    size_t heap_before = heap_in_use();
+    auto legacy = make_unique<vector<LegacyRow>>();
+    {
+        BenchTimer timer;
+        for (size_t i = 0; i < rows; ++i) {
+            LegacyRow row;
+            row["id"] = static_cast<int32_t>(i);
+            row["login"] = make_login(i);
+            row["password_hash"] = vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8};
+            row["is_admin"] = (i % 100 == 0);
+            legacy->push_back(std::move(row));
+        }
+        report("storage", "legacy_ingest", timer.elapsed_ms(), "ms");
+    }
+    size_t legacy_bytes = heap_in_use() - heap_before;
+
+    heap_before = heap_in_use();
+    auto table = make_unique<Table>("users");
+    table->add_column(Column("id", DataType::INT32));
+    table->add_column(Column("login", DataType::STRING, 32));
+    table->add_column(Column("password_hash", DataType::BYTES, 8));
+    table->add_column(Column("is_admin", DataType::BOOL));
+    {
+        BenchTimer timer;
+        for (size_t i = 0; i < rows; ++i) {
+            Row row;
+            row.set_value("id", static_cast<int32_t>(i));
+            row.set_value("login", make_login(i));
+            row.set_value("password_hash", vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8});
+            row.set_value("is_admin", i % 100 == 0);
+            table->insert_row(row);
+        }
+        report("storage", "columnar_ingest", timer.elapsed_ms(), "ms");
+    }
+    size_t columnar_bytes = heap_in_use() - heap_before;
+
+    report("storage", "legacy_bytes_per_row", static_cast<double>(legacy_bytes) / rows, "B");
+    report("storage", "columnar_bytes_per_row", static_cast<double>(columnar_bytes) / rows, "B");
+    report("storage", "columnar_reported_bytes_per_row", static_cast<double>(table->memory_usage()) / rows, "B");
+
+    {
+        Table positional("users_positional");
+        for (const auto& column : table->get_columns()) {
+            positional.add_column(column);
+        }
+        BenchTimer timer;
+        Row row(positional.get_schema());
+        for (size_t i = 0; i < rows; ++i) {
+            row.set(0, static_cast<int32_t>(i));
+            row.set(1, make_login(i));
+            row.set(2, vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8});
+            row.set(3, i % 100 == 0);
+            positional.insert_row(row);
+        }
+        report("storage", "positional_ingest", timer.elapsed_ms(), "ms");
+    }
+
+    {
+        BenchTimer timer;
+        size_t total = 0;
+        table->select([&total](const Row& row) {
+            total += get<string>(row.get_value("login")).size();
+            return false;
+        });
+        do_not_optimize(total);
+        report("storage", "select_by_name", timer.elapsed_ms(), "ms");
+    }
+    {
+        BenchTimer timer;
+        size_t ordinal = table->get_column_ordinal("login");
+        size_t total = 0;
+        table->select([&total, ordinal](const Row& row) {
+            total += row.get_string(ordinal).size();
+            return false;
+        });
+        do_not_optimize(total);
+        report("storage", "select_by_ordinal", timer.elapsed_ms(), "ms");
+    }
+
+    int32_t threshold = static_cast<int32_t>(rows / 2);
+    {
+        BenchTimer timer;
+        size_t matches = 0;
+        for (const auto& row : *legacy) {
+            if (get<int32_t>(row.at("id")) > threshold) {
+                ++matches;
+            }
+        }
+        do_not_optimize(matches);
+        report("storage", "legacy_scan", timer.elapsed_ms(), "ms");
+    }
+    {
+        BenchTimer timer;
+        size_t ordinal = table->get_column_ordinal("id");
+        const ColumnStorage& ids = table->get_column_storage(ordinal);
+        const int32_t* data = ids.int32_data();
+        size_t matches = 0;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (data[i] > threshold) {
+                ++matches;
+            }
+        }
+        do_not_optimize(matches);
+        report("storage", "columnar_scan", timer.elapsed_ms(), "ms");
+    }
+}
@@ -0,0 +1,127 @@
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "database.h"
+#include "operators.h"
+#include "parser.h"
+
+// Discards what is written to it, so printing is timed without a terminal.
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+void run_vectorized_bench(size_t rows) {
+    size_t failures = 0;
+
+    Database db;
+    db.set_scan_threads(1);
+    db.execute("CREATE TABLE orders (id: int32, customer: int32, amount: int32, status: string[12], paid: bool)");
+    shared_ptr<Table> orders = db.get_table("orders");
+    vector<ColumnStorage> batch;
+    for (const auto& column : orders->get_columns()) {
+        batch.emplace_back(column.get_type());
+    }
+    for (size_t i = 0; i < rows; ++i) {
+        batch[0].append_int32(static_cast<int32_t>(i));
+        batch[1].append_int32(static_cast<int32_t>(i % 5000));
+        batch[2].append_int32(static_cast<int32_t>((i * 31) % 1000));
+        batch[3].append_string(i % 4 == 0 ? "shipped" : "pending");
+        batch[4].append_bool(i % 3 != 0);
+    }
+    orders->append_columns(batch);
+
+    const string query = "SELECT id, amount, status FROM orders WHERE amount < 500";
+    auto select = get<SelectStatement>(Parser::parse(query));
+    size_t expected = 0;
+
+    // Row at a time: a std::function call per row, then a variant per column.
+    {
+        BenchTimer timer;
+        size_t amount = orders->get_column_ordinal("amount");
+        vector<size_t> projection = {0, amount, orders->get_column_ordinal("status")};
+        auto matched = orders->select([amount](const Row& row) { return row.get_int32(amount) < 500; });
+        for (const Row& row : matched) {
+            for (size_t ordinal : projection) {
+                ValueType value = row.get(ordinal);
+                do_not_optimize(value);
+            }
+        }
+        expected = matched.size();
+        report("vectorized", "row_at_a_time_select", timer.elapsed_ms(), "ms");
+    }
+    {
+        BenchTimer timer;
+        size_t matched = 0;
+        for (RowView view : Cursor::open(select, orders)) {
+            for (size_t c = 0; c < view.size(); ++c) {
+                ValueType value = view.get_value(c);
+                do_not_optimize(value);
+            }
+            ++matched;
+        }
+        if (matched != expected) {
+            ++failures;
+        }
+        report("vectorized", "cursor_select", timer.elapsed_ms(), "ms");
+    }
+    {
+        BenchTimer timer;
+        size_t matched = 0;
+        ExecutionPlan plan = ExecutionPlan::build_select(select, orders);
+        Batch output;
+        while (plan.root->next(output)) {
+            do_not_optimize(output.columns);
+            matched += output.size();
+        }
+        if (matched != expected) {
+            ++failures;
+        }
+        report("vectorized", "batch_select", timer.elapsed_ms(), "ms");
+    }
+
+    // The whole of handle_select: rows printed, to nowhere.
+    {
+        NullBuffer sink;
+        streambuf* previous = cout.rdbuf(&sink);
+        BenchTimer cursor_timer;
+        Cursor cursor = Cursor::open(select, orders);
+        QueryExecutor::print_rows(cursor);
+        double cursor_ms = cursor_timer.elapsed_ms();
+        BenchTimer batch_timer;
+        ExecutionPlan plan = ExecutionPlan::build_select(select, orders);
+        QueryExecutor::print_rows(plan);
+        double batch_ms = batch_timer.elapsed_ms();
+        cout.rdbuf(previous);
+        report("vectorized", "print_cursor", cursor_ms, "ms");
+        report("vectorized", "print_batches", batch_ms, "ms");
+    }
+
+    // SUM over the matching rows: copied Rows against an Aggregate over the scan.
+    {
+        BenchTimer timer;
+        int64_t sum = 0;
+        size_t amount = orders->get_column_ordinal("amount");
+        for (const Row& row : orders->select([amount](const Row& row) { return row.get_int32(amount) < 500; })) {
+            sum += row.get_int32(amount);
+        }
+        report("vectorized", "row_at_a_time_sum", timer.elapsed_ms(), "ms");
+
+        BenchTimer batch_timer;
+        unique_ptr<Operator> scan = make_unique<ScanOperator>(orders, AccessPath());
+        auto where = Expression::compile(*select.where, *orders);
+        unique_ptr<Operator> filter = make_unique<FilterOperator>(std::move(scan), where);
+        AggregateOperator aggregate(std::move(filter), orders, {}, {{AggregateFunction::SUM, amount}, {AggregateFunction::COUNT, nullopt}});
+        Batch result;
+        aggregate.next(result);
+        report("vectorized", "batch_sum", batch_timer.elapsed_ms(), "ms");
+        if (result.columns[0].int64_values[0] != sum || result.columns[1].int64_values[0] != static_cast<int64_t>(expected)) {
+            ++failures;
+        }
+    }
+    report("vectorized", "check_failures", static_cast<double>(failures), "");
+}
@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "database.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+static const char* policy_name(SyncPolicy policy) {
+    switch (policy) {
+        case SyncPolicy::NONE: return "none";
+        case SyncPolicy::EVERY_COMMIT: return "every_commit";
+        case SyncPolicy::GROUP: return "group";
+    }
+    return "unknown";
+}
+
+// Single-row inserts from `writers` threads, each into its own table, all committing to one log.
+static double inserts_per_second(const string& path, SyncPolicy policy, chrono::microseconds window, size_t writers, size_t inserts) {
+    remove(path.c_str());
+    auto log = make_shared<WriteAheadLog>(path, policy, window);
+    vector<shared_ptr<Table>> tables;
+    for (size_t w = 0; w < writers; ++w) {
+        auto table = make_shared<Table>("log_" + to_string(w));
+        table->add_column(Column("id", DataType::INT32, 0, true, false, nullopt, true));
+        table->add_column(Column("payload", DataType::STRING, 64));
+        table->set_log(log);
+        tables.push_back(table);
+    }
+
+    BenchTimer timer;
+    vector<thread> threads;
+    for (size_t w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w] {
+            Row row(tables[w]->get_schema());
+            for (size_t i = 0; i < inserts / writers; ++i) {
+                row.unset(0);
+                row.set(1, "event payload " + to_string(i));
+                tables[w]->insert_row(row);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return static_cast<double>(inserts / writers * writers) / (timer.elapsed_ms() / 1000);
+}
+
+static size_t count_rows(Database& db, const string& table) {
+    size_t rows = 0;
+    for (RowView view : db.query("SELECT id FROM " + table)) {
+        do_not_optimize(view);
+        ++rows;
+    }
+    return rows;
+}
+
+// An insert whose commit fails must not leave its rows visible, and the table
+// must refuse later writes. The log's writes are failed by capping the size of
+// files this process may write at the log's current size.
+static size_t failed_commit_failures(const string& log_path) {
+    size_t failures = 0;
+#ifndef _WIN32
+    remove(log_path.c_str());
+    Database db;
+    db.open_log(log_path, SyncPolicy::EVERY_COMMIT);
+    db.execute("CREATE TABLE ledger (id: int32)");
+    db.execute("INSERT INTO ledger VALUES (1)");
+
+    rlimit original;
+    getrlimit(RLIMIT_FSIZE, &original);
+    auto ignored = signal(SIGXFSZ, SIG_IGN);
+    rlimit capped = original;
+    capped.rlim_cur = filesystem::file_size(log_path);
+    setrlimit(RLIMIT_FSIZE, &capped);
+    bool threw = false;
+    try {
+        db.execute("INSERT INTO ledger VALUES (2)");
+    } catch (const exception&) {
+        threw = true;
+    }
+    setrlimit(RLIMIT_FSIZE, &original);
+    signal(SIGXFSZ, ignored);
+
+    if (!threw || count_rows(db, "ledger") != 1) {
+        cerr << "wal: rows of an insert whose commit failed became visible" << endl;
+        ++failures;
+    }
+    try {
+        db.execute("INSERT INTO ledger VALUES (3)");
+        cerr << "wal: a table accepted a write after a failed commit" << endl;
+        ++failures;
+    } catch (const exception&) {
+    }
+    if (count_rows(db, "ledger") != 1) {
+        cerr << "wal: rows written after a failed commit became visible" << endl;
+        ++failures;
+    }
+    remove(log_path.c_str());
+#else
+    (void)log_path;
+#endif
+    return failures;
+}
+
+void run_wal_bench(size_t rows) {
+    filesystem::path directory = filesystem::temp_directory_path();
+    string log_path = (directory / "wal_bench.log").string();
+    string snapshot_path = (directory / "wal_bench.dat").string();
+    // Synced commits cost a disk flush each; keep their counts small.
+    size_t inserts = max<size_t>(rows / 500, 100);
+
+    struct Setting {
+        SyncPolicy policy;
+        chrono::microseconds window;
+        const char* suffix;
+    };
+    for (Setting setting : {Setting{SyncPolicy::NONE, chrono::microseconds(0), ""},
+                            Setting{SyncPolicy::EVERY_COMMIT, chrono::microseconds(0), ""},
+                            Setting{SyncPolicy::GROUP, chrono::microseconds(0), ""},
+                            Setting{SyncPolicy::GROUP, chrono::microseconds(200), "_200us"}}) {
+        for (size_t writers : {1, 4}) {
+            double rate = inserts_per_second(log_path, setting.policy, setting.window, writers, inserts);
+            report("wal", string(policy_name(setting.policy)) + setting.suffix + "_" + to_string(writers) + "_writers", rate, "inserts/s");
+        }
+    }
+
+    // Recovery: a database dropped without saving comes back from snapshot plus log.
+    size_t failures = 0;
+    remove(log_path.c_str());
+    remove(snapshot_path.c_str());
+    size_t logged_rows = max<size_t>(rows / 100, 10);
+    {
+        Database db;
+        db.open_log(log_path, SyncPolicy::NONE);
+        db.execute("CREATE TABLE journal ({key, autoincrement} id: int32, note: string[32], flagged: bool = false)");
+        db.execute("CREATE INDEX ON journal (id)");
+        auto insert = db.prepare("INSERT INTO journal (note) VALUES (?)");
+        for (size_t i = 0; i < logged_rows; ++i) {
+            insert.bind(1, "note " + to_string(i)).execute();
+            if (i == logged_rows / 2) {
+                db.checkpoint(snapshot_path);
+                if (filesystem::file_size(log_path) != 16) {
+                    cerr << "wal: checkpoint did not truncate the log" << endl;
+                    ++failures;
+                }
+            }
+        }
+    }
+    // A torn final record, as left by a crash mid-write, is cut off on open.
+    {
+        ofstream torn(log_path, ios::binary | ios::app);
+        torn << "torn";
+    }
+    {
+        BenchTimer timer;
+        Database db;
+        db.load_from_file(snapshot_path);
+        db.open_log(log_path, SyncPolicy::NONE);
+        report("wal", "recovery", timer.elapsed_ms(), "ms");
+        if (count_rows(db, "journal") != logged_rows) {
+            cerr << "wal: recovered " << count_rows(db, "journal") << " of " << logged_rows << " rows" << endl;
+            ++failures;
+        }
+        // Autoincrement keys continue where the lost process stopped.
+        db.prepare("INSERT INTO journal (note) VALUES ('after recovery')").execute();
+        auto last = db.query("SELECT id FROM journal WHERE id = " + to_string(logged_rows));
+        if (last.begin() == last.end() || !db.get_tables()["journal"]->has_ordered_index(0)) {
+            cerr << "wal: recovered table lost its autoincrement counter or index" << endl;
+            ++failures;
+        }
+    }
+    {
+        Database db;
+        db.load_from_file(snapshot_path);
+        db.open_log(log_path, SyncPolicy::NONE);
+        if (count_rows(db, "journal") != logged_rows + 1) {
+            cerr << "wal: insert after recovery was not logged" << endl;
+            ++failures;
+        }
+    }
+    // A snapshot loaded while a log is open keeps logging its tables.
+    string later_log_path = (directory / "wal_bench_later.log").string();
+    remove(later_log_path.c_str());
+    size_t snapshot_rows = 0;
+    {
+        Database db;
+        db.open_log(later_log_path, SyncPolicy::NONE);
+        db.load_from_file(snapshot_path);
+        snapshot_rows = count_rows(db, "journal");
+        db.prepare("INSERT INTO journal (note) VALUES ('after load')").execute();
+    }
+    {
+        Database db;
+        db.load_from_file(snapshot_path);
+        db.open_log(later_log_path, SyncPolicy::NONE);
+        if (count_rows(db, "journal") != snapshot_rows + 1) {
+            cerr << "wal: insert into a table loaded after open_log was not logged" << endl;
+            ++failures;
+        }
+    }
+    remove(later_log_path.c_str());
+    report("wal", "recovery_failures", static_cast<double>(failures), "");
+    report("wal", "failed_commit_failures", static_cast<double>(failed_commit_failures(log_path)), "");
+
+    remove(log_path.c_str());
+    remove(snapshot_path.c_str());
+}
@@ -0,0 +1,84 @@
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+class Database;
+class Table;
+
+struct CheckpointOptions {
+    // Pause between the end of one checkpoint and the start of the next.
+    chrono::milliseconds interval = chrono::milliseconds(1000);
+    // Cap on the write rate in bytes per second; 0 leaves it uncapped.
+    size_t max_bytes_per_second = 0;
+};
+
+struct CheckpointStats {
+    size_t tables_written = 0;
+    size_t tables_skipped = 0;
+    size_t bytes_written = 0;
+    double elapsed_ms = 0;
+};
+
+// Checkpoints a database into a directory holding one snapshot file per table
+// (see table_path), while queries and inserts keep running. A table is only
+// rewritten when it changed since it was last written, from a consistent copy
+// taken with Table::consistent_copy. With a write-ahead log open, each pass
+// first retires the records logged so far and deletes them once every table is
+// on disk; records logged meanwhile stay in the log and replay skips those a
+// table file already reflects.
+class Checkpointer {
+public:
+    Checkpointer(Database& database, const string& directory, CheckpointOptions options = CheckpointOptions());
+
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // Runs a checkpoint every options.interval on a background thread until stop().
+    void start();
+
+    void stop();
+
+    // Runs one checkpoint on the calling thread.
+    CheckpointStats run_once();
+
+    CheckpointStats get_last_stats() const;
+
+    // Message of the last background checkpoint that failed, if any.
+    string get_last_error() const;
+
+    static string table_path(const string& directory, const string& table_name);
+
+private:
+    Database& database;
+    string directory;
+    CheckpointOptions options;
+
+    // Table::get_version of each table as last written.
+    unordered_map<string, uint64_t> written_versions;
+    mutex run_mutex;
+
+    mutable mutex state_mutex;
+    condition_variable wake;
+    bool stopping = false;
+    thread worker;
+    CheckpointStats last_stats;
+    string last_error;
+
+    size_t write_table(const string& table_name, const shared_ptr<Table>& table);
+};
+
+#endif // CHECKPOINTER_H
@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+class Checksum {
+public:
+    // CRC-32C (Castagnoli) of `size` bytes, continuing from `crc` (0 to
+    // start). Uses the SSE4.2 crc32 instruction when the CPU has it.
+    static uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+};
+
+#endif // CHECKSUM_H
@@ -1,6 +1,7 @@
 #ifndef COLUMN_H
 #define COLUMN_H
 
+#include <optional>
 #include <string>
 #include <vector>
 #include <variant>
@@ -12,17 +13,30 @@ class Column {
 public:
     Column() = default;
 
-    Column(const string& name, DataType type, size_t length = 0, bool autoincrement = false, bool unique = false, ValueType default_value = ValueType())
-        : name(name), type(type), length(length), autoincrement(autoincrement), unique(unique), default_value(default_value) {}
+    Column(const string& name, DataType type, size_t length = 0, bool autoincrement = false, bool unique = false, optional<ValueType> default_value = nullopt, bool key = false, bool indexed = false, bool dictionary = false)
+        : name(name), type(type), length(length), autoincrement(autoincrement), unique(unique), default_value(default_value), key(key), indexed(indexed), dictionary(dictionary) {}
 
     string get_name() const { return name; }
     DataType get_type() const { return type; }
     size_t get_length() const { return length; }
     bool is_autoincrement() const { return autoincrement; }
     ValueType get_next_autoincrement_value() { return autoincrement_value++; }
-    bool is_unique() const { return unique; }
-    ValueType get_default_value() const { return default_value; }
-    bool has_default() const { return default_value.index() != variant_npos; }
+    // Next value an autoincrement column hands out; persisted with snapshots.
+    int32_t get_autoincrement_value() const { return autoincrement_value; }
+    void set_autoincrement_value(int32_t value) { autoincrement_value = value; }
+    int32_t reserve_autoincrement_range(size_t count) {
+        int32_t first = autoincrement_value;
+        autoincrement_value += static_cast<int32_t>(count);
+        return first;
+    }
+    bool is_unique() const { return unique || key; }
+    bool is_key() const { return key; }
+    // Declared with the {index} attribute; Table::has_ordered_index also covers CREATE INDEX.
+    bool is_indexed() const { return indexed; }
+    // Declared with the {dictionary} attribute: values are stored once and rows hold codes.
+    bool is_dictionary() const { return dictionary; }
+    const ValueType& get_default_value() const { return *default_value; }
+    bool has_default() const { return default_value.has_value(); }
 
 private:
     string name;
@@ -30,7 +44,10 @@ private:
     size_t length;
     bool autoincrement;
     bool unique;
-    ValueType default_value;
+    optional<ValueType> default_value;
+    bool key = false;
+    bool indexed = false;
+    bool dictionary = false;
     int32_t autoincrement_value = 0;
 };
 
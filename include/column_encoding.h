@@ -0,0 +1,38 @@
+#ifndef COLUMN_ENCODING_H
+#define COLUMN_ENCODING_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace std;
+
+// Compact forms of int32 and bool column payloads (and dictionary codes) in
+// snapshots. RUN_LENGTH stores (int32 value, u32 run length) pairs.
+// BIT_PACKED stores each value minus `base` in `bit_width` bits, packed from
+// the low bits of little-endian 64-bit words. PLAIN is the array itself.
+enum class Encoding : uint32_t { PLAIN = 0, RUN_LENGTH = 1, BIT_PACKED = 2 };
+
+struct EncodingHeader {
+    Encoding encoding = Encoding::PLAIN;
+    uint32_t bit_width = 0;
+    int64_t base = 0;
+};
+
+class ColumnEncoding {
+public:
+    // Picks the encoding of `values`, filling `payload` unless it is PLAIN. A
+    // compact form is only used when it at least halves the payload. Only
+    // called for snapshots saved with Serializer::set_compress_payloads.
+    static EncodingHeader encode(span<const int32_t> values, vector<uint8_t>& payload);
+
+    static EncodingHeader encode(span<const uint8_t> values, vector<uint8_t>& payload);
+
+    // Expands a RUN_LENGTH or BIT_PACKED payload of `rows` values; a payload
+    // that does not decode to exactly that throws SerializationException.
+    static vector<int32_t> decode_int32(const EncodingHeader& header, span<const uint8_t> payload, size_t rows);
+
+    static vector<uint8_t> decode_bool(const EncodingHeader& header, span<const uint8_t> payload, size_t rows);
+};
+
+#endif // COLUMN_ENCODING_H
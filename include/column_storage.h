@@ -0,0 +1,218 @@
+#ifndef COLUMN_STORAGE_H
+#define COLUMN_STORAGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "data_types.h"
+
+using namespace std;
+
+// Contiguous, typed storage for the values of a single table column.
+// int32 and bool values are packed into plain arrays; strings and bytes share
+// an offset+blob layout where value i spans blob[offsets[i], offsets[i + 1]).
+// The arrays may also be borrowed from a memory-mapped snapshot; the first
+// modification then copies them into owned memory.
+//
+// An inline column keeps each string or bytes value in a fixed-width slot
+// of the blob, a length byte followed by up to `inline width` bytes, so a
+// value is found without an offset and stored without one.
+//
+// A dictionary column stores each distinct string or bytes value once, in
+// the offset+blob arrays, and one int32 code per row naming its value. Codes
+// are assigned in order of first appearance and never change while the
+// column lives, so they can be compared instead of the values.
+//
+// One writer may append while readers read the values already there: appends
+// never touch existing values, and arrays that have to move (or borrowed ones
+// being copied) are retired to Epoch instead of freed. Readers hold an
+// Epoch::Guard and only read rows published to them some other way, such as
+// Table::get_row_count.
+class ColumnStorage {
+public:
+    // Declared lengths up to this are stored inline; longer slots would mostly hold padding.
+    static constexpr size_t MAX_INLINE_WIDTH = 64;
+
+    // `inline_width`, when not 0, stores string or bytes values of at most
+    // that many bytes inline; longer values are rejected.
+    explicit ColumnStorage(DataType type, bool dictionary = false, size_t inline_width = 0);
+
+    ColumnStorage(const ColumnStorage& other);
+
+    ColumnStorage(ColumnStorage&& other) noexcept;
+
+    ColumnStorage& operator=(const ColumnStorage& other);
+
+    ColumnStorage& operator=(ColumnStorage&& other) noexcept;
+
+    DataType get_type() const { return type; }
+
+    size_t size() const { return count.load(memory_order_acquire); }
+
+    void reserve(size_t rows);
+
+    // Makes room for `rows` more values (and `blob_bytes` more string/bytes
+    // payload), growing geometrically so repeated small batches stay amortized.
+    void reserve_additional(size_t rows, size_t blob_bytes = 0);
+
+    // Frees the arrays at once; only for columns no reader can see yet.
+    void clear();
+
+    // Drops every value from `rows` onwards.
+    void truncate(size_t rows);
+
+    void append(const ValueType& value);
+
+    void append_int32(int32_t value);
+
+    void append_bool(bool value);
+
+    void append_string(string_view value);
+
+    void append_bytes(span<const uint8_t> value);
+
+    void append_from(const ColumnStorage& other);
+
+    // Appends rows [first, first + rows) of `other`.
+    void append_range_from(const ColumnStorage& other, size_t first, size_t rows);
+
+    void append_int32_values(span<const int32_t> values);
+
+    void append_bool_values(span<const uint8_t> values);
+
+    // `value_offsets` holds n + 1 offsets into `data`, starting at 0.
+    void append_blob_values(span<const uint64_t> value_offsets, span<const uint8_t> data);
+
+    // Replace the contents with arrays already in storage layout, taking them over without copying.
+    void assign_int32_values(vector<int32_t> values);
+
+    void assign_bool_values(vector<uint8_t> values);
+
+    // `value_offsets` must start at 0, never decrease and end at data.size().
+    void assign_blob_values(vector<uint64_t> value_offsets, vector<uint8_t> data);
+
+    // Read the values in place from memory kept alive by `owner`, typically a mapped snapshot.
+    void borrow_int32_values(const int32_t* values, size_t rows, shared_ptr<const void> memory);
+
+    void borrow_bool_values(const uint8_t* values, size_t rows, shared_ptr<const void> memory);
+
+    void borrow_blob_values(const uint64_t* value_offsets, size_t rows, const uint8_t* data, size_t size, shared_ptr<const void> memory);
+
+    // Dictionary columns: `value_offsets` and `data` hold the distinct values,
+    // `codes` one entry per row below the number of values.
+    void assign_dictionary(vector<uint64_t> value_offsets, vector<uint8_t> data, vector<int32_t> codes);
+
+    // Borrowed codes are trusted rather than read; callers check them when they need to.
+    void borrow_dictionary(const uint64_t* value_offsets, size_t values, const uint8_t* data, size_t size,
+                           const int32_t* codes, size_t rows, shared_ptr<const void> memory);
+
+    bool is_borrowed() const { return owner != nullptr; }
+
+    bool is_dictionary() const { return dictionary; }
+
+    bool is_inline() const { return inline_width != 0; }
+
+    size_t get_inline_width() const { return inline_width; }
+
+    // Inline columns: `slots` holds one slot of get_inline_width() + 1 bytes per row.
+    void assign_inline_values(vector<uint8_t> slots);
+
+    void borrow_inline_values(const uint8_t* slots, size_t rows, shared_ptr<const void> memory);
+
+    ValueType get_value(size_t row) const;
+
+    // Copies value `row` into `out`, reusing its buffer when it already holds this type.
+    void read_value(size_t row, ValueType& out) const;
+
+    int32_t get_int32(size_t row) const { return int32_view.load(memory_order_acquire)[row]; }
+
+    bool get_bool(size_t row) const { return bool_view.load(memory_order_acquire)[row] != 0; }
+
+    string_view get_string(size_t row) const;
+
+    span<const uint8_t> get_bytes(size_t row) const;
+
+    const int32_t* int32_data() const { return int32_view.load(memory_order_acquire); }
+
+    const uint8_t* bool_data() const { return bool_view.load(memory_order_acquire); }
+
+    // Per-row codes of a dictionary column.
+    const int32_t* codes_data() const { return int32_view.load(memory_order_acquire); }
+
+    size_t dictionary_size() const { return dictionary_count.load(memory_order_acquire); }
+
+    string_view get_dictionary_value(int32_t code) const;
+
+    // Code of `value` in a dictionary column, if any row holds it. The lookup
+    // table belongs to the writer, so callers hold the table's read lock.
+    optional<int32_t> find_code(string_view value) const;
+
+    // Offsets and blob of a plain column, or the values of a dictionary column.
+    // An inline column has no offsets and its blob is the slots.
+    span<const uint64_t> get_offsets() const;
+
+    span<const uint8_t> get_blob() const;
+
+    // Heap bytes owned by this column; borrowed arrays are not counted.
+    size_t memory_usage() const;
+
+    // The part of memory_usage() holding string or bytes payload.
+    size_t string_memory_usage() const { return blob.capacity(); }
+
+    // Bytes read in place from borrowed memory; 0 once the column owns its arrays.
+    size_t borrowed_bytes() const;
+
+private:
+    DataType type;
+    bool dictionary = false;
+    size_t inline_width = 0;
+    atomic<size_t> count = 0;
+    // Also the codes of a dictionary column.
+    vector<int32_t> int32_values;
+    vector<uint8_t> bool_values;
+    vector<uint64_t> offsets;
+    vector<uint8_t> blob;
+
+    // Where reads go: the vectors above, or borrowed memory while owner is set.
+    atomic<const int32_t*> int32_view = nullptr;
+    atomic<const uint8_t*> bool_view = nullptr;
+    atomic<const uint64_t*> offsets_view = nullptr;
+    atomic<const uint8_t*> blob_view = nullptr;
+    atomic<size_t> blob_size = 0;
+    atomic<size_t> dictionary_count = 0;
+    shared_ptr<const void> owner;
+
+    // Open-addressing table from dictionary value to code + 1; 0 marks a free slot.
+    vector<uint32_t> slots;
+
+    // Copies borrowed arrays into the vectors before a modification.
+    void own();
+
+    void refresh_views();
+
+    // Code of `value`, adding it to the dictionary when it is new.
+    int32_t encode(string_view value);
+
+    void append_code(int32_t code);
+
+    void append_inline(string_view value);
+
+    size_t slot_bytes() const { return inline_width + 1; }
+
+    size_t find_slot(string_view value) const;
+
+    void rebuild_slots();
+
+    // Makes room for `additional` more elements in `values` without moving
+    // it under readers: a larger array is filled and published, then the old
+    // one is retired.
+    template <typename T>
+    void make_room(vector<T>& values, size_t additional);
+};
+
+#endif // COLUMN_STORAGE_H
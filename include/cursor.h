@@ -0,0 +1,185 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "epoch.h"
+#include "expression.h"
+#include "query_planner.h"
+#include "statement.h"
+#include "table.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// One result row read in place from column storage. Columns are numbered by
+// their position in the cursor's projection. A view stays valid while its
+// cursor is open.
+class RowView {
+public:
+    RowView(const Table& table, const vector<size_t>& projection, size_t row)
+        : table(&table), projection(&projection), row(row) {}
+
+    size_t size() const { return projection->size(); }
+
+    size_t get_row_id() const { return row; }
+
+    DataType get_type(size_t column) const { return storage(column).get_type(); }
+
+    int32_t get_int32(size_t column) const { return storage(column).get_int32(row); }
+
+    bool get_bool(size_t column) const { return storage(column).get_bool(row); }
+
+    string_view get_string(size_t column) const { return storage(column).get_string(row); }
+
+    span<const uint8_t> get_bytes(size_t column) const { return storage(column).get_bytes(row); }
+
+    // Copies the value out of storage.
+    ValueType get_value(size_t column) const { return storage(column).get_value(row); }
+
+private:
+    const Table* table;
+    const vector<size_t>* projection;
+    size_t row;
+
+    const ColumnStorage& storage(size_t column) const { return table->get_column_storage((*projection)[column]); }
+};
+
+// The compiled WHERE clause of a single-table SELECT and the access path the
+// planner chose for it.
+struct ScanPlan {
+    Expression predicate;
+    AccessPath path;
+};
+
+// Compiles and plans `select` under the table's read lock, since planning
+// reads the indexes. Shared by cursors and execution plans.
+ScanPlan plan_scan(const SelectStatement& select, const Table& table, span<const ValueType> parameters);
+
+// Streams the ids of the first `rows` rows matching a predicate in the order
+// the access path produces them; the caller holds an Epoch::Guard and took
+// `rows` from Table::get_row_count. ORDER BY sorting and LIMIT are left to the
+// caller. Index walks take the table's read lock one chunk of entries at a
+// time, picking up where they left off if a writer changed the index between
+// chunks. Given a pool of more than one thread, a full scan without LIMIT
+// filters a window of morsels at a time on it and returns their rows in order.
+class RowScanner {
+public:
+    RowScanner(const Table& table, Expression predicate, AccessPath path, size_t rows, ThreadPool* pool = nullptr);
+
+    bool next(size_t& row);
+
+private:
+    static constexpr size_t INDEX_CHUNK_ROWS = 1024;
+    // Rows per morsel, and morsels per pool thread in one window.
+    static constexpr size_t MORSEL_ROWS = 16 * PredicateNode::BATCH_ROWS;
+    static constexpr size_t WINDOW_MORSELS_PER_THREAD = 4;
+
+    const Table* table;
+    Expression predicate;
+    AccessPath path;
+    size_t rows;
+    ThreadPool* pool;
+    bool started = false;
+    bool done = false;
+
+    // FULL_SCAN: selection bitmap of the batch starting at batch_begin.
+    size_t batch_begin = 0;
+    size_t batch_count = 0;
+    size_t word = 0;
+    uint64_t mask = 0;
+    uint64_t bits[PredicateNode::BATCH_ROWS / 64];
+
+    // Parallel FULL_SCAN: matching rows of each morsel in the current window.
+    vector<vector<size_t>> morsels;
+    size_t morsel_index = 0;
+    size_t morsel_position = 0;
+    size_t window_end = 0;
+
+    // INDEX_RANGE: entries read under the lock but not yet returned, the
+    // index version the iterator belongs to, and the last entry it produced.
+    OrderedIndex::RangeIterator range;
+    vector<size_t> chunk;
+    size_t chunk_position = 0;
+    uint64_t range_version = 0;
+    bool range_exhausted = false;
+    optional<pair<int32_t, size_t>> last_entry;
+
+    bool next_batch();
+
+    bool next_window();
+
+    bool next_chunk();
+};
+
+// Pull-based SELECT result. Matching rows are produced one at a time as
+// RowViews, so memory stays constant however many rows match; only an ORDER
+// BY that no index provides collects the matching row ids to sort them.
+// LIMIT stops the scan as soon as enough rows were produced. A cursor reads
+// the rows committed when it was opened (see Table) and holds no lock while it
+// is open, so writers of the table go ahead and never change what it returns.
+class Cursor {
+public:
+    class Iterator {
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type = RowView;
+        using difference_type = ptrdiff_t;
+
+        Iterator() = default;
+
+        explicit Iterator(Cursor* cursor) : cursor(cursor) { ++*this; }
+
+        RowView operator*() const { return cursor->current(); }
+
+        Iterator& operator++() {
+            if (!cursor->next()) {
+                cursor = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return cursor == other.cursor; }
+
+    private:
+        Cursor* cursor = nullptr;
+    };
+
+    // Full scans run on `pool` when one is given; see RowScanner.
+    Cursor(shared_ptr<const Table> table, Expression predicate, AccessPath path, vector<size_t> projection, shared_ptr<ThreadPool> pool = nullptr);
+
+    // Resolves the projection, compiles the WHERE clause and plans the access path of `select`.
+    static Cursor open(const SelectStatement& select, shared_ptr<const Table> table, span<const ValueType> parameters = {}, shared_ptr<ThreadPool> pool = nullptr);
+
+    // Advances to the next row; false once the result is exhausted.
+    bool next();
+
+    RowView current() const { return RowView(*table, projection, row); }
+
+    const vector<size_t>& get_projection() const { return projection; }
+
+    const Table& get_table() const { return *table; }
+
+    Iterator begin() { return Iterator(this); }
+
+    Iterator end() { return Iterator(); }
+
+private:
+    shared_ptr<const Table> table;
+    Epoch::Guard epoch;
+    shared_ptr<ThreadPool> pool;
+    vector<size_t> projection;
+    optional<size_t> limit;
+    RowScanner scanner;
+    bool sorted;
+    vector<size_t> sorted_rows;
+    size_t produced = 0;
+    size_t row = 0;
+};
+
+#endif // CURSOR_H
@@ -17,6 +17,12 @@ public:
     static bool validate(const ValueType& value, DataType type);
 
     static string type_to_string(DataType type);
+
+    // `value` written as a query literal: 42, true, 'it''s', 0x0aff.
+    static string to_literal(const ValueType& value);
+
+    // ValueType alternatives are declared in DataType order.
+    static DataType type_of(const ValueType& value) { return static_cast<DataType>(value.index()); }
 };
 
 #endif // DATA_TYPES_H
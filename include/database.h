@@ -5,27 +5,116 @@
 #include <unordered_map>
 #include <memory>
 #include <fstream>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
 #include "table.h"
+#include "checkpointer.h"
+#include "metrics.h"
 #include "query_executor.h"
+#include "write_ahead_log.h"
 
 using namespace std;
 
+// Safe to share between threads. A catalog lock guards the set of tables:
+// CREATE TABLE takes it exclusively, every other statement shares it while it
+// looks its table up. Tables lock themselves (see Table), so SELECTs run side
+// by side, and INSERTs into different tables only meet at the log. A SELECT
+// that scans the whole table also splits the scan over the database's scan
+// threads, one thread per core unless set_scan_threads says otherwise.
 class Database {
 public:
-    Database() = default;
+    Database();
 
-    void load_from_file(const string& filepath);
+    // Maps the snapshot rather than reading it; see Serializer::map. With a
+    // log open, later writes to the loaded tables are logged to it.
+    void load_from_file(const string& filepath, bool verify_checksums = false);
+
+    // Maps every table file of a checkpoint directory written by a Checkpointer.
+    void load_from_directory(const string& directory, bool verify_checksums = false);
 
     void save_to_file(const string& filepath);
 
-    void execute(const string& query);
+    // Opens the write-ahead log at `filepath`, replays the records newer than
+    // the loaded snapshot and logs every later CREATE and INSERT to it.
+    void open_log(const string& filepath, SyncPolicy policy = SyncPolicy::GROUP, chrono::microseconds group_window = chrono::microseconds(0));
+
+    // Retires the records logged so far (see WriteAheadLog::rotate), saves a
+    // snapshot that covers them and deletes them. Writers may keep running;
+    // what they log meanwhile stays in the log. While a retired file from an
+    // earlier rotation exists, the log is left whole.
+    void checkpoint(const string& filepath);
+
+    // Checkpoints into `directory` in the background until stop_checkpointer; see Checkpointer.
+    void start_checkpointer(const string& directory, CheckpointOptions options = CheckpointOptions());
+
+    void stop_checkpointer();
+
+    Checkpointer* get_checkpointer() { return checkpointer.get(); }
+
+    // Threads, the calling one included, that one SELECT scans with; 1 scans
+    // on the calling thread alone. Statements already running keep the pool they started with.
+    void set_scan_threads(size_t threads);
+
+    size_t get_scan_threads() const;
+
+    shared_ptr<WriteAheadLog> get_log() const;
+
+    // Directory the tables were last loaded from, if they came from one.
+    string get_checkpoint_directory() const;
+
+    vector<pair<string, shared_ptr<Table>>> list_tables() const;
 
+    // Retires the log records written so far and lists the tables, as one step
+    // with respect to CREATE TABLE, open_log and loading. `rotated` is set to
+    // the log whose records were retired, or to nullptr when no log is open or
+    // an earlier rotation's retired file is still waiting for its checkpoint.
+    vector<pair<string, shared_ptr<Table>>> begin_checkpoint(shared_ptr<WriteAheadLog>& rotated);
+
+    // EXPLAIN [ANALYZE] leaves the plan in the result; see QueryResult::get_plan.
+    QueryResult execute(const string& query);
+
+    PreparedStatement prepare(const string& query);
+
+    // Streams the rows of a SELECT; see Cursor.
+    Cursor query(const string& query);
+
+    // Streams the result of a SELECT batch by batch; see ExecutionPlan. Unlike
+    // query(), this also returns aggregates, groups and joins.
+    ExecutionPlan query_batches(const string& query);
+
+    // The table called `name`, or nullptr.
+    shared_ptr<Table> get_table(const string& name) const;
+
+    // The catalog itself, unguarded; only for code that has the database to itself.
     unordered_map<string, shared_ptr<Table>>& get_tables();
 
     void set_tables(unordered_map<string, shared_ptr<Table>> new_tables);
 
+    // Statement latencies and failures, and snapshot I/O; see MetricsRegistry.
+    MetricsRegistry& get_metrics() { return *metrics; }
+
+    // The registry, each table's rows and bytes (see Table::memory_breakdown)
+    // and the log's I/O, in the Prometheus text format. Safe to call while
+    // statements run; tables are locked shared one at a time.
+    string export_metrics() const;
+
 private:
     unordered_map<string, shared_ptr<Table>> tables;
+    QueryExecutor executor;
+    shared_ptr<MetricsRegistry> metrics = make_shared<MetricsRegistry>();
+    shared_ptr<WriteAheadLog> log;
+    string checkpoint_directory;
+    // Guards `tables`: CREATE TABLE holds it exclusively, other statements shared.
+    mutable shared_mutex catalog_mutex;
+    // Declared last so it stops before the tables and log it reads go away.
+    unique_ptr<Checkpointer> checkpointer;
+
+    QueryResult execute_statement(const Statement& statement);
+
+    // Logs later writes of every table to `log`, numbering records after the
+    // ones the tables reflect; called with the catalog lock held exclusively.
+    void attach_log();
 };
 
 #endif // DATABASE_H
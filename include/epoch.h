@@ -0,0 +1,63 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+// Epoch-based reclamation of memory that readers use without taking locks.
+// A reader holds a Guard while it reads; a writer that replaces such memory
+// retires the old allocation instead of freeing it, and it is freed once every
+// guard taken before the retirement is gone.
+class Epoch {
+public:
+    // Where a guard pins its epoch; defined in epoch.cpp.
+    struct Slot;
+
+    // Pins the epoch current when it was taken until destroyed. Not tied to a
+    // thread, so a guard can move along with the cursor that owns it.
+    class Guard {
+    public:
+        Guard();
+
+        ~Guard();
+
+        Guard(Guard&& other) noexcept;
+
+        Guard& operator=(Guard&& other) noexcept;
+
+        Guard(const Guard&) = delete;
+
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        Slot* slot;
+
+        void release();
+    };
+
+    // Guards pin themselves in slots that are added in blocks of this many
+    // whenever every slot is taken, so any number can be held at once.
+    static constexpr size_t SLOTS_PER_BLOCK = 1024;
+
+    // Keeps `memory` alive until no guard taken before this call is left. The
+    // replacement must already be published, so later readers cannot reach it.
+    static void retire(shared_ptr<const void> memory);
+
+    // Frees retired memory no guard can reach any more. Called by retire and
+    // whenever a guard is released while memory is waiting. A call that finds
+    // another thread collecting leaves it to that thread, which passes over
+    // the slots once more before it returns, so memory never waits for the
+    // next write once its last guard is gone.
+    static void collect();
+
+    // Retired allocations not freed yet.
+    static size_t pending();
+
+    // Slots guards can pin, taken or not; grows with the most guards held at once.
+    static size_t capacity();
+};
+
+#endif // EPOCH_H
@@ -1,17 +1,69 @@
 #ifndef EXPRESSION_H
 #define EXPRESSION_H
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
-#include <unordered_map>
-#include <functional>
+#include <vector>
 #include "data_types.h"
 #include "row.h"
+#include "statement.h"
 
 using namespace std;
 
+class Table;
+
+class PredicateNode {
+public:
+    // Most rows passed to one evaluate_batch call, so callers can keep bitmaps on the stack.
+    static constexpr size_t BATCH_ROWS = 4096;
+
+    virtual ~PredicateNode() = default;
+
+    virtual bool evaluate(size_t row) const = 0;
+
+    // Writes the selection bitmap of rows [begin, begin + count) in the
+    // ScanKernels layout. The default evaluates row by row.
+    virtual void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const;
+};
+
+// A WHERE expression compiled against one table's column storage. Column
+// names, parameter values and literal types are resolved at compile time,
+// constant subexpressions are folded, and evaluation reads values in place.
+// A default-constructed Expression matches every row.
 class Expression {
 public:
-    static bool evaluate(const string& condition, const Row& row);
+    Expression() = default;
+
+    static Expression compile(const Expr& expr, const Table& table, span<const ValueType> parameters = {});
+
+    // As above, keeping `expr` so that describe() can show it.
+    static Expression compile(shared_ptr<const Expr> expr, const Table& table, span<const ValueType> parameters = {});
+
+    // The condition as written in a query, "true" when there is none.
+    string describe() const;
+
+    static string describe(const Expr& expr);
+
+    // Types of the '?' placeholders in `expr`, inferred from what they are compared with.
+    static vector<DataType> infer_parameter_types(const Expr& expr, const Schema& schema, size_t parameter_count);
+
+    bool matches(size_t row) const { return constant ? *constant : root->evaluate(row); }
+
+    // Selection bitmap of rows [begin, begin + count); count is at most PredicateNode::BATCH_ROWS.
+    void matches_batch(size_t begin, size_t count, uint64_t* bits) const;
+
+    // Set when the expression folded to a constant.
+    optional<bool> get_constant() const { return constant; }
+
+    static bool compare(const ValueType& lhs, ComparisonOp op, const ValueType& rhs);
+
+private:
+    shared_ptr<const PredicateNode> root;
+    optional<bool> constant = true;
+    shared_ptr<const Expr> source;
 };
 
 #endif // EXPRESSION_H
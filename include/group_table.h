@@ -0,0 +1,64 @@
+#ifndef GROUP_TABLE_H
+#define GROUP_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Open-addressing hash table that numbers GROUP BY keys densely, in the order
+// they were first inserted. A key is the encoded group-by values of a row (see
+// AggregateOperator); its bytes are copied once into an arena of blocks that
+// never move, so the views handed out stay valid for the table's lifetime.
+// Grouping by a single int32 column skips the encoding: such keys live in the
+// slots themselves and are compared as integers.
+class GroupTable {
+public:
+    // Hash of an encoded key, and of an int32 key.
+    static uint64_t hash(string_view key);
+
+    static uint64_t hash(int32_t key);
+
+    // Number of `key`, which becomes the next group if it is new.
+    size_t find_or_insert(string_view key, uint64_t hash_value);
+
+    size_t find_or_insert(int32_t key, uint64_t hash_value);
+
+    size_t size() const { return group_count; }
+
+    // Keys by group number; only the kind that was inserted is filled.
+    string_view get_key(size_t group) const { return keys[group]; }
+
+    int32_t get_int32_key(size_t group) const { return int32_keys[group]; }
+
+    size_t memory_usage() const;
+
+private:
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+
+    struct Slot {
+        uint64_t hash = 0;
+        // Group number plus one; zero marks an empty slot.
+        uint32_t group = 0;
+        int32_t int32_key = 0;
+    };
+
+    vector<Slot> slots;
+    size_t group_count = 0;
+    vector<string_view> keys;
+    vector<int32_t> int32_keys;
+    vector<unique_ptr<char[]>> blocks;
+    size_t block_used = 0;
+    size_t block_capacity = 0;
+    size_t arena_bytes = 0;
+
+    // Doubles the slots once they are more than half full.
+    void grow_if_needed();
+
+    string_view copy_to_arena(string_view key);
+};
+
+#endif // GROUP_TABLE_H
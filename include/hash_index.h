@@ -0,0 +1,52 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "column_storage.h"
+#include "data_types.h"
+
+using namespace std;
+
+// Unique hash index over one column. Keys are not copied: each open-addressing
+// slot packs a 24-bit hash tag with a 40-bit row id, and probes compare
+// against the value in the column storage passed to each call.
+class HashIndex {
+public:
+    HashIndex() = default;
+
+    size_t size() const { return count; }
+
+    optional<size_t> find(const ColumnStorage& storage, const ValueType& key) const;
+
+    // Adds `row` unless an equal value is already indexed; returns false in that case.
+    bool insert(const ColumnStorage& storage, size_t row);
+
+    void rebuild(const ColumnStorage& storage);
+
+    void reserve(const ColumnStorage& storage, size_t rows);
+
+    void clear();
+
+    size_t memory_usage() const { return slots.capacity() * sizeof(uint64_t); }
+
+    static uint64_t hash(const ValueType& key);
+
+    static uint64_t hash(const ColumnStorage& storage, size_t row);
+
+    static bool equals(const ColumnStorage& storage, size_t row, const ValueType& key);
+
+private:
+    static constexpr uint64_t ROW_BITS = 40;
+    static constexpr uint64_t ROW_MASK = (uint64_t(1) << ROW_BITS) - 1;
+
+    vector<uint64_t> slots;
+    size_t count = 0;
+
+    void rehash(const ColumnStorage& storage, size_t capacity);
+
+    void place(uint64_t hash_value, size_t row);
+};
+
+#endif // HASH_INDEX_H
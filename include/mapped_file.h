@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+// A read-only, private mapping of a whole file. Pages are faulted in on first
+// access; the mapping stays valid for as long as any shared_ptr to it lives.
+class MappedFile {
+public:
+    static shared_ptr<const MappedFile> open(const string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return bytes; }
+
+    size_t size() const { return length; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    // Holds the file contents on platforms without mmap.
+    unique_ptr<uint8_t[]> fallback;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,149 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+// A monotonically increasing count. Increments are relaxed atomics, so any
+// thread may bump it without a lock; readers see some recent value.
+class Counter {
+public:
+    void add(uint64_t amount = 1) { value.fetch_add(amount, memory_order_relaxed); }
+
+    uint64_t get() const { return value.load(memory_order_relaxed); }
+
+private:
+    atomic<uint64_t> value = 0;
+};
+
+// Latencies in nanoseconds, bucketed the way HdrHistogram does: values below
+// 2 * SUB_BUCKETS land in a bucket of their own, larger ones in one of
+// SUB_BUCKETS buckets per power of two, so a reported percentile is at most
+// 1 / SUB_BUCKETS (about 3%) above the true one. Recording is a handful of
+// relaxed atomic operations and takes no lock.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    // Values from 2^40 ns (about 18 minutes) up share the last bucket.
+    static constexpr uint64_t HIGHEST_VALUE = (uint64_t(1) << 40) - 1;
+    static constexpr size_t BUCKETS = (40 - SUB_BUCKET_BITS) * SUB_BUCKETS + SUB_BUCKETS;
+
+    void record(uint64_t nanoseconds);
+
+    void record(chrono::nanoseconds elapsed) { record(static_cast<uint64_t>(max<int64_t>(elapsed.count(), 0))); }
+
+    uint64_t get_count() const { return count.load(memory_order_relaxed); }
+
+    uint64_t get_sum() const { return sum.load(memory_order_relaxed); }
+
+    uint64_t get_max() const { return highest.load(memory_order_relaxed); }
+
+    // A value that `quantile` (0 to 1) of the recorded ones are at or below:
+    // the top of its bucket, capped at the largest value recorded. 0 when
+    // nothing was recorded.
+    uint64_t percentile(double quantile) const;
+
+    static size_t bucket_of(uint64_t value);
+
+    // Largest value that falls in `bucket`.
+    static uint64_t bucket_limit(size_t bucket);
+
+private:
+    array<atomic<uint64_t>, BUCKETS> buckets{};
+    atomic<uint64_t> count = 0;
+    atomic<uint64_t> sum = 0;
+    atomic<uint64_t> highest = 0;
+};
+
+// Reads and writes of the snapshot files or of the write-ahead log.
+struct IoMetrics {
+    // Tables written to snapshots, or records appended to the log.
+    Counter records;
+    // Snapshot files, or log write calls, and the bytes they wrote.
+    Counter writes;
+    Counter bytes_written;
+    // Snapshot files mapped, or log files replayed, and their bytes.
+    Counter reads;
+    Counter bytes_read;
+    Counter syncs;
+    // Time to write a whole snapshot, or to fsync the log.
+    LatencyHistogram latency;
+};
+
+enum class StatementKind {
+    CREATE_TABLE,
+    CREATE_INDEX,
+    INSERT,
+    SELECT,
+    EXPLAIN,
+    PREPARED_INSERT,
+    PREPARED_SELECT,
+};
+
+// The metrics of one Database. Every member is updated lock-free, so the
+// registry is always on; see Database::export_metrics for the text form.
+class MetricsRegistry {
+public:
+    static constexpr size_t STATEMENT_KINDS = 7;
+
+    static const char* kind_name(StatementKind kind);
+
+    // A statement of `kind` that ran to completion in `elapsed`.
+    void record_statement(StatementKind kind, chrono::nanoseconds elapsed) { statement(kind).latency.record(elapsed); }
+
+    // A statement of `kind` that threw.
+    void record_failure(StatementKind kind) { statement(kind).failures.add(); }
+
+    // Runs `work`, a statement of `kind`, and records its latency, or its failure if it throws.
+    template <typename Work>
+    auto time_statement(StatementKind kind, Work&& work) -> decltype(work()) {
+        auto start = chrono::steady_clock::now();
+        try {
+            auto result = work();
+            record_statement(kind, chrono::steady_clock::now() - start);
+            return result;
+        } catch (...) {
+            record_failure(kind);
+            throw;
+        }
+    }
+
+    const LatencyHistogram& get_latency(StatementKind kind) const { return statements[static_cast<size_t>(kind)].latency; }
+
+    uint64_t get_failures(StatementKind kind) const { return statements[static_cast<size_t>(kind)].failures.get(); }
+
+    // Queries that did not parse, so have no kind.
+    Counter parse_failures;
+
+    IoMetrics snapshots;
+
+    // Writes the statement and snapshot metrics in the Prometheus text format.
+    void write_text(ostream& out) const;
+
+    // Writes `histogram` as a summary: quantiles, sum and count, in microseconds.
+    static void write_summary(ostream& out, const string& name, const string& labels, const LatencyHistogram& histogram);
+
+    // Writes the counters of `io` as `prefix`_writes_total and so on, its latency as `latency_name`.
+    static void write_io(ostream& out, const string& prefix, const string& latency_name, const IoMetrics& io);
+
+private:
+    struct StatementMetrics {
+        LatencyHistogram latency;
+        Counter failures;
+    };
+
+    array<StatementMetrics, STATEMENT_KINDS> statements;
+
+    StatementMetrics& statement(StatementKind kind) { return statements[static_cast<size_t>(kind)]; }
+};
+
+#endif // METRICS_H
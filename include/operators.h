@@ -0,0 +1,522 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cursor.h"
+#include "epoch.h"
+#include "expression.h"
+#include "group_table.h"
+#include "query_planner.h"
+#include "query_result.h"
+#include "statement.h"
+#include "table.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// Values of one output column for the live rows of a batch, in selection
+// order. Only the vector matching `kind` is used. Strings and bytes point into
+// column storage and stay valid while the plan that produced them is alive.
+struct ColumnVector {
+    enum class Kind { INT32, INT64, DOUBLE, BOOL, STRING, BYTES };
+
+    Kind kind = Kind::INT32;
+    vector<int32_t> int32_values;
+    vector<int64_t> int64_values;
+    vector<double> double_values;
+    vector<uint8_t> bool_values;
+    vector<string_view> string_values;
+    vector<span<const uint8_t>> bytes_values;
+
+    void clear();
+
+    size_t size() const;
+
+    // Appends values[index] of `from`, which has the same kind, for every index.
+    void append_from(const ColumnVector& from, span<const uint32_t> indexes);
+
+    // Orders values a and b.
+    bool less(size_t a, size_t b) const;
+};
+
+// Up to CAPACITY rows passed from one operator to the next. The rows are
+// [first, first + count) of the scanned table while `contiguous`, else
+// row_ids[0, count). `selection` lists the positions still live, ascending,
+// so a filter drops rows without moving any. Project fills `columns`; below
+// it they hold whatever the batch last carried, kept for their capacity.
+// Above a join, row_ids[i] is paired with joined_row_ids[i] of the other table.
+struct Batch {
+    static constexpr size_t CAPACITY = PredicateNode::BATCH_ROWS;
+
+    bool contiguous = true;
+    size_t first = 0;
+    size_t count = 0;
+    vector<size_t> row_ids;
+    vector<size_t> joined_row_ids;
+    vector<uint32_t> selection;
+    vector<ColumnVector> columns;
+
+    size_t row(size_t position) const { return contiguous ? first + position : row_ids[position]; }
+
+    size_t size() const { return selection.size(); }
+
+    // Makes every row of the batch live.
+    void select_all();
+};
+
+class ProfiledOperator;
+
+// A pull-based operator. Each next() call does the work for a whole batch, so
+// virtual calls and type dispatch are paid per batch rather than per value.
+// The other members serve EXPLAIN and are never called while a query runs
+// unexplained.
+class Operator {
+public:
+    virtual ~Operator() = default;
+
+    // Fills `batch` with the next rows; false once the operator is exhausted.
+    // Batches handed out are never empty.
+    virtual bool next(Batch& batch) = 0;
+
+    // What the operator does, in one line, e.g. "Filter (id < 10)".
+    virtual string describe() const = 0;
+
+    virtual vector<const Operator*> inputs() const { return {}; }
+
+    // Bytes held by buffers of the operator's own: hash tables, sort keys,
+    // groups, windows of batches. Batches it hands on are not counted.
+    virtual size_t memory_usage() const { return 0; }
+
+    // Of `rows_in` rows received (for a scan, read) and `rows_out` produced,
+    // the rows the operator passed over: those a filter, sort or limit
+    // dropped, or those of its table a scan never read.
+    virtual size_t rows_skipped(size_t rows_in, size_t rows_out) const;
+
+    // Counters of a ProfiledOperator, null for every other operator.
+    virtual const ProfiledOperator* profile() const { return nullptr; }
+};
+
+// Stands in for another operator under EXPLAIN ANALYZE, timing its next()
+// calls and counting what they produce. Plans built without profiling have
+// none, so they pay nothing for it.
+class ProfiledOperator : public Operator {
+public:
+    explicit ProfiledOperator(unique_ptr<Operator> inner) : inner(std::move(inner)) {}
+
+    bool next(Batch& batch) override;
+
+    string describe() const override { return inner->describe(); }
+
+    vector<const Operator*> inputs() const override { return inner->inputs(); }
+
+    size_t memory_usage() const override { return inner->memory_usage(); }
+
+    size_t rows_skipped(size_t rows_in, size_t rows_out) const override { return inner->rows_skipped(rows_in, rows_out); }
+
+    const ProfiledOperator* profile() const override { return this; }
+
+    size_t get_batches() const { return batches; }
+
+    size_t get_rows() const { return rows; }
+
+    // Sampled after every next() call.
+    size_t get_peak_bytes() const { return peak_bytes; }
+
+    // In next(), the inputs included.
+    chrono::nanoseconds get_time() const { return time; }
+
+private:
+    unique_ptr<Operator> inner;
+    size_t batches = 0;
+    size_t rows = 0;
+    size_t peak_bytes = 0;
+    chrono::nanoseconds time{0};
+};
+
+// Reads the rows committed when it was created through an access path: whole
+// ranges for a full scan, row ids in index order otherwise. It applies no
+// predicate, and holds the Epoch::Guard that keeps its batches readable.
+class ScanOperator : public Operator {
+public:
+    ScanOperator(shared_ptr<const Table> table, AccessPath path);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override;
+
+    size_t rows_skipped(size_t rows_in, size_t rows_out) const override;
+
+private:
+    shared_ptr<const Table> table;
+    Epoch::Guard epoch;
+    AccessPath path;
+    size_t rows;
+    size_t next_row = 0;
+    optional<RowScanner> scanner;
+};
+
+// Drops the rows that do not match a predicate. Contiguous batches are
+// evaluated column at a time into a bitmap. With a pool of more than one
+// thread, a window of batches is pulled and filtered in parallel, one batch
+// per task, and handed on in order.
+class FilterOperator : public Operator {
+public:
+    FilterOperator(unique_ptr<Operator> child, Expression predicate, shared_ptr<ThreadPool> pool = nullptr);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override { return "Filter (" + predicate.describe() + ")"; }
+
+    vector<const Operator*> inputs() const override { return {child.get()}; }
+
+    size_t memory_usage() const override;
+
+    size_t rows_skipped(size_t rows_in, size_t rows_out) const override { return rows_in - rows_out; }
+
+private:
+    static constexpr size_t WINDOW_BATCHES_PER_THREAD = 4;
+
+    unique_ptr<Operator> child;
+    Expression predicate;
+    shared_ptr<ThreadPool> pool;
+    vector<Batch> window;
+    size_t window_size = 0;
+    size_t window_position = 0;
+    bool child_done = false;
+
+    void filter(Batch& batch) const;
+};
+
+// Gathers the projected columns of the live rows into batch.columns. Above a
+// join, ordinals from the table's column count up are columns of `joined`,
+// read at the paired rows.
+class ProjectOperator : public Operator {
+public:
+    ProjectOperator(unique_ptr<Operator> child, shared_ptr<const Table> table, vector<size_t> projection, shared_ptr<const Table> joined = nullptr);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override;
+
+    vector<const Operator*> inputs() const override { return {child.get()}; }
+
+private:
+    unique_ptr<Operator> child;
+    shared_ptr<const Table> table;
+    vector<size_t> projection;
+    shared_ptr<const Table> joined;
+};
+
+// Passes on the first `limit` live rows, then stops pulling.
+class LimitOperator : public Operator {
+public:
+    LimitOperator(unique_ptr<Operator> child, size_t limit);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override { return "Limit " + to_string(limit); }
+
+    vector<const Operator*> inputs() const override { return {child.get()}; }
+
+    size_t rows_skipped(size_t rows_in, size_t rows_out) const override { return rows_in - rows_out; }
+
+private:
+    unique_ptr<Operator> child;
+    size_t limit;
+    size_t produced = 0;
+};
+
+// Collects every live row, orders them by one column and hands them on in
+// batches of row ids. Ties keep row order, and descending order is exactly the
+// reverse of ascending, as with Table::select_row_ids. With a limit only that
+// many rows are sorted out. Above a join, `ordinal` is numbered as in
+// ProjectOperator, pairs are sorted together and ties keep the join's order.
+class SortOperator : public Operator {
+public:
+    SortOperator(unique_ptr<Operator> child, shared_ptr<const Table> table, size_t ordinal, bool descending, optional<size_t> limit = nullopt,
+                 shared_ptr<const Table> joined = nullptr);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override;
+
+    vector<const Operator*> inputs() const override { return {child.get()}; }
+
+    size_t memory_usage() const override;
+
+    size_t rows_skipped(size_t rows_in, size_t rows_out) const override { return rows_in - rows_out; }
+
+private:
+    unique_ptr<Operator> child;
+    shared_ptr<const Table> table;
+    size_t ordinal;
+    bool descending;
+    optional<size_t> limit;
+    shared_ptr<const Table> joined;
+    bool sorted = false;
+    vector<size_t> sorted_rows;
+    vector<size_t> sorted_joined_rows;
+    size_t position = 0;
+
+    void sort_rows();
+};
+
+// Inner equi-join of a probe and a build input on one column of each, both of
+// the same type. The build rows are hashed into a table chained through arrays
+// and every probe row walks its chain, so pairs come out in probe order and,
+// for one probe row, in build order: probe rows in row_ids, build rows in
+// joined_row_ids.
+//
+// A build side of more than PARTITION_ROWS rows is split by hash into
+// partitions whose tables stay in cache, and the probe side is read into the
+// same partitions, so that each partition joins its own rows; pairs then come
+// out partition by partition. Nothing is spilled: both sides' row ids and
+// hashes are kept in memory. With a pool of more than one thread the
+// partitions are built, and joined, in parallel.
+class HashJoinOperator : public Operator {
+public:
+    HashJoinOperator(unique_ptr<Operator> probe, shared_ptr<const Table> probe_table, size_t probe_ordinal,
+                     unique_ptr<Operator> build, shared_ptr<const Table> build_table, size_t build_ordinal, shared_ptr<ThreadPool> pool = nullptr);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override;
+
+    vector<const Operator*> inputs() const override { return {probe.get(), build.get()}; }
+
+    size_t memory_usage() const override;
+
+private:
+    // About 1 MB of row ids, hashes and chains per partition.
+    static constexpr size_t PARTITION_ROWS = 32 * 1024;
+
+    // Build rows, chained by bucket: heads[bucket] and next[entry] hold an
+    // entry number plus one, zero ending a chain. Once partitioned, also the
+    // probe rows that hash here and, after joining, the pairs found.
+    struct Partition {
+        vector<size_t> build_rows;
+        vector<uint64_t> build_hashes;
+        vector<uint32_t> heads;
+        vector<uint32_t> next;
+        vector<size_t> probe_rows;
+        vector<uint64_t> probe_hashes;
+        vector<size_t> matched_probe_rows;
+        vector<size_t> matched_build_rows;
+    };
+
+    unique_ptr<Operator> probe;
+    shared_ptr<const Table> probe_table;
+    size_t probe_ordinal;
+    unique_ptr<Operator> build;
+    shared_ptr<const Table> build_table;
+    size_t build_ordinal;
+    shared_ptr<ThreadPool> pool;
+    const ColumnStorage* probe_keys;
+    const ColumnStorage* build_keys;
+
+    bool built = false;
+    size_t partition_bits = 0;
+    vector<Partition> partitions;
+    // One partition: the probe batch being matched, the live position after
+    // the probe row being matched, its hash and the next entry of its chain.
+    Batch input;
+    bool probe_done = false;
+    size_t input_position = 0;
+    size_t probe_row = 0;
+    uint64_t probe_hash = 0;
+    uint32_t chain = 0;
+    // Partitioned: the first partition not yet joined, and the next pair to hand out.
+    size_t next_partition = 0;
+    size_t output_partition = 0;
+    size_t output_position = 0;
+
+    void build_partitions();
+
+    void partition_probe();
+
+    void chain_partition(Partition& partition) const;
+
+    void join_partition(Partition& partition) const;
+
+    size_t bucket_of(const Partition& partition, uint64_t hash_value) const { return (hash_value >> partition_bits) & (partition.heads.size() - 1); }
+
+    bool keys_equal(size_t probe_row, size_t build_row) const;
+
+    bool next_streamed(Batch& batch);
+
+    bool next_partitioned(Batch& batch);
+};
+
+// Inner equi-join that looks every outer row's key up in an index on the
+// inner table's join column: its hash index, which holds at most one row per
+// key, or its ordered index. Inner rows committed after the operator was
+// created, and those not matching `inner_predicate`, are skipped. Pairs come
+// out in outer order, outer rows in row_ids and inner rows in joined_row_ids.
+// The inner table's read lock is held while one outer batch is looked up.
+class IndexJoinOperator : public Operator {
+public:
+    IndexJoinOperator(unique_ptr<Operator> outer, shared_ptr<const Table> outer_table, size_t outer_ordinal,
+                      shared_ptr<const Table> inner_table, size_t inner_ordinal, Expression inner_predicate);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override;
+
+    vector<const Operator*> inputs() const override { return {outer.get()}; }
+
+    size_t memory_usage() const override;
+
+private:
+    unique_ptr<Operator> outer;
+    shared_ptr<const Table> outer_table;
+    size_t outer_ordinal;
+    shared_ptr<const Table> inner_table;
+    size_t inner_ordinal;
+    Expression inner_predicate;
+    Epoch::Guard epoch;
+    size_t inner_rows;
+    Batch input;
+    // Pairs of the last outer batch not handed out yet.
+    vector<size_t> outer_rows;
+    vector<size_t> matched_rows;
+    size_t position = 0;
+    vector<size_t> scratch;
+
+    void look_up(const Batch& batch);
+};
+
+// One output column of an AggregateOperator: an aggregate or, without a
+// function, the value of a GROUP BY column. COUNT counts rows whatever its
+// column; SUM and AVG read an int32 or bool column, a bool counting as 0 or 1;
+// MIN and MAX read a column of any type.
+struct AggregateSpec {
+    optional<AggregateFunction> function;
+    optional<size_t> ordinal;
+};
+
+// Groups the live rows by the values of the group columns and folds every
+// group into one output row. Without group columns all rows form one group,
+// output even when empty; its MIN, MAX and AVG are then 0, false or empty, the
+// database having no NULL. Groups come out in the order of their first row, or
+// sorted by one output column, and a limit keeps the first groups. Above a
+// join, ordinals are numbered as in ProjectOperator and "first row" means the
+// first pair the join handed on.
+//
+// Each group's key is its group-by values encoded into bytes (see
+// GroupTable); grouping by one int32 column hashes the value itself, and the
+// int32 and bool aggregates run tight loops over the column. MIN and MAX of a
+// string or bytes column keep the row holding the extreme value so far and
+// compare values in column storage. With a pool of more than one thread,
+// every thread folds its share of a window of batches into its own partial
+// groups, and the partials are merged once the input is exhausted.
+class AggregateOperator : public Operator {
+public:
+    AggregateOperator(unique_ptr<Operator> child, shared_ptr<const Table> table, vector<size_t> group_ordinals, vector<AggregateSpec> specs,
+                      optional<pair<size_t, bool>> order = nullopt, optional<size_t> limit = nullopt, shared_ptr<ThreadPool> pool = nullptr,
+                      shared_ptr<const Table> joined = nullptr);
+
+    bool next(Batch& batch) override;
+
+    string describe() const override;
+
+    vector<const Operator*> inputs() const override { return {child.get()}; }
+
+    size_t memory_usage() const override;
+
+private:
+    static constexpr size_t WINDOW_BATCHES_PER_THREAD = 4;
+
+    // The column an output or group column reads, and whether its rows are
+    // the joined table's.
+    struct Source {
+        const ColumnStorage* storage = nullptr;
+        bool joined = false;
+    };
+
+    // Groups one thread has folded so far, with `specs.size()` accumulators
+    // per group. MIN and MAX of a string or bytes column accumulate a row, -1
+    // until there is one.
+    struct Partial {
+        GroupTable groups;
+        vector<int64_t> counts;
+        vector<size_t> first_rows;
+        vector<int64_t> values;
+        vector<uint32_t> row_groups;
+        string key;
+    };
+
+    unique_ptr<Operator> child;
+    shared_ptr<const Table> table;
+    vector<size_t> group_ordinals;
+    vector<AggregateSpec> specs;
+    optional<pair<size_t, bool>> order;
+    optional<size_t> limit;
+    shared_ptr<ThreadPool> pool;
+    shared_ptr<const Table> joined;
+    vector<Source> group_sources;
+    vector<Source> sources;
+    // Position of each group column spec's column among the group columns.
+    vector<size_t> key_positions;
+    bool int32_key = false;
+
+    bool aggregated = false;
+    // Output columns of every group; strings and bytes of group keys point into `arena`.
+    vector<ColumnVector> results;
+    GroupTable arena;
+    vector<uint32_t> output_order;
+    size_t position = 0;
+
+    Source source_of(size_t ordinal) const;
+
+    // Whether spec `s` accumulates rows rather than numbers.
+    bool by_row(size_t s) const;
+
+    void aggregate();
+
+    // `first` numbers the batch's first live row among all rows received,
+    // which orders the groups above a join.
+    void fold(Partial& partial, const Batch& batch, size_t first) const;
+
+    size_t add_group(Partial& partial, size_t group) const;
+
+    void merge(Partial& into, Partial& from) const;
+
+    void encode_key(string& key, size_t row, size_t joined_row) const;
+
+    void decode_results(Partial& merged);
+};
+
+// An operator tree and the names of the columns its batches carry.
+struct ExecutionPlan {
+    unique_ptr<Operator> root;
+    vector<string> column_names;
+
+    // The operators, root first, with counters once a profiled plan has run.
+    vector<PlanStage> explain() const;
+
+    // Scan -> Filter -> [Sort] -> [Limit] -> Project for a single-table
+    // SELECT, or Scan -> Filter -> Aggregate when it has aggregates or GROUP
+    // BY, with the access path chosen by QueryPlanner.
+    // With `profile`, every operator is wrapped in a ProfiledOperator.
+    static ExecutionPlan build_select(const SelectStatement& select, shared_ptr<const Table> table, span<const ValueType> parameters = {}, shared_ptr<ThreadPool> pool = nullptr,
+                                      bool profile = false);
+
+    // A SELECT with a JOIN, `joined` being the JOIN table. Each WHERE
+    // condition of the top-level AND must read one table and is filtered
+    // below the join, on that table's own access path. The join is an
+    // IndexJoinOperator when QueryPlanner::choose_join_method picks one, else
+    // a HashJoinOperator building on the smaller side; then [Sort] -> [Limit]
+    // -> Project, or Aggregate when the query has aggregates or GROUP BY.
+    // `*` selects the FROM table's columns, then the JOIN table's.
+    static ExecutionPlan build_join(const SelectStatement& select, shared_ptr<const Table> table, shared_ptr<const Table> joined,
+                                    span<const ValueType> parameters = {}, shared_ptr<ThreadPool> pool = nullptr, bool profile = false);
+};
+
+#endif // OPERATORS_H
@@ -0,0 +1,115 @@
+#ifndef ORDERED_INDEX_H
+#define ORDERED_INDEX_H
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+#include "column_storage.h"
+#include "data_types.h"
+
+using namespace std;
+
+// Inclusive key bounds of a range scan. Bounds are 64-bit so that strict
+// comparisons against the int32 extremes stay representable.
+struct KeyRange {
+    int64_t lower = numeric_limits<int32_t>::min();
+    int64_t upper = numeric_limits<int32_t>::max();
+
+    bool is_empty() const { return lower > upper; }
+};
+
+// Non-unique B+-tree over an int32 or bool column (bools are keyed as 0/1).
+// Nodes are fixed-size arrays with their keys stored contiguously, and leaves
+// are chained left to right for range scans. Entries are ordered by
+// (key, row), so rows with equal keys come out in insertion order.
+class OrderedIndex {
+private:
+    static constexpr uint32_t NO_NODE = numeric_limits<uint32_t>::max();
+
+public:
+    static constexpr size_t NODE_CAPACITY = 64;
+
+    // Resumable walk over the entries of a key range, in ascending or
+    // descending (key, row) order. Invalidated by changes to the index.
+    class RangeIterator {
+    public:
+        RangeIterator() = default;
+
+        bool next(size_t& row);
+
+        // Also yields the entry's key.
+        bool next(size_t& row, int32_t& key);
+
+    private:
+        friend class OrderedIndex;
+
+        const OrderedIndex* index = nullptr;
+        uint32_t leaf = NO_NODE;
+        // Next slot to read going forward, or one past it going backward.
+        uint32_t position = 0;
+        int32_t lower = 0;
+        int32_t upper = 0;
+        bool descending = false;
+    };
+
+    OrderedIndex();
+
+    static bool supports(DataType type) { return type == DataType::INT32 || type == DataType::BOOL; }
+
+    static int32_t key_of(const ColumnStorage& storage, size_t row);
+
+    size_t size() const { return count; }
+
+    void insert(int32_t key, size_t row);
+
+    // Bulk-loads the index from every row of `storage`, filling leaves completely.
+    void rebuild(const ColumnStorage& storage);
+
+    void clear();
+
+    RangeIterator range(const KeyRange& range, bool descending = false) const;
+
+    // Appends the rows whose keys fall in `range` to `rows`, in key order.
+    void scan(const KeyRange& range, vector<size_t>& rows) const;
+
+    // Fraction of the entries expected to fall in `range`, assuming keys are
+    // spread evenly between the smallest and the largest.
+    double estimate_selectivity(const KeyRange& range) const;
+
+    size_t memory_usage() const;
+
+private:
+    struct Leaf {
+        uint32_t size = 0;
+        uint32_t next = NO_NODE;
+        uint32_t prev = NO_NODE;
+        int32_t keys[NODE_CAPACITY];
+        uint64_t rows[NODE_CAPACITY];
+    };
+
+    // keys[i] is the smallest key reachable through children[i + 1].
+    struct Inner {
+        uint32_t size = 0;
+        int32_t keys[NODE_CAPACITY];
+        uint32_t children[NODE_CAPACITY + 1];
+    };
+
+    struct Split {
+        int32_t separator;
+        uint32_t node;
+    };
+
+    vector<Leaf> leaves;
+    vector<Inner> inners;
+    uint32_t root = 0;
+    size_t height = 0;
+    uint32_t last_leaf = 0;
+    size_t count = 0;
+
+    optional<Split> insert_into(uint32_t node, size_t level, int32_t key, size_t row);
+
+    optional<Split> insert_into_leaf(uint32_t node, int32_t key, size_t row);
+};
+
+#endif // ORDERED_INDEX_H
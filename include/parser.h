@@ -0,0 +1,74 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "statement.h"
+#include "tokenizer.h"
+
+using namespace std;
+
+// Recursive-descent parser for the CREATE TABLE, CREATE INDEX, INSERT, SELECT and EXPLAIN dialect.
+class Parser {
+public:
+    static Statement parse(string_view query);
+
+private:
+    explicit Parser(string_view query) : tokenizer(query) {}
+
+    Tokenizer tokenizer;
+    size_t parameter_count = 0;
+
+    Statement parse_statement();
+
+    CreateTableStatement parse_create();
+
+    CreateIndexStatement parse_create_index();
+
+    ColumnDefinition parse_column_definition();
+
+    InsertStatement parse_insert();
+
+    void parse_insert_value(InsertStatement& statement);
+
+    // Adds a column name to an INSERT, rejecting one it already names.
+    void parse_insert_column(InsertStatement& statement);
+
+    SelectStatement parse_select();
+
+    // A column name, or an aggregate call such as COUNT(*) or SUM(amount).
+    SelectItem parse_select_item();
+
+    shared_ptr<const Expr> parse_or();
+
+    shared_ptr<const Expr> parse_and();
+
+    shared_ptr<const Expr> parse_not();
+
+    shared_ptr<const Expr> parse_comparison();
+
+    shared_ptr<const Expr> parse_operand();
+
+    ValueType parse_literal();
+
+    string parse_identifier();
+
+    // A non-negative integer such as a column length, called `what` in errors.
+    size_t parse_count(const string& what);
+
+    // A column name, optionally qualified by its table as in users.id.
+    string parse_column_name();
+
+    void expect_keyword(string_view keyword);
+
+    void expect_symbol(string_view symbol);
+
+    bool accept_keyword(string_view keyword);
+
+    bool accept_symbol(string_view symbol);
+
+    [[noreturn]] void fail(const string& message, const Token& token);
+};
+
+#endif // PARSER_H
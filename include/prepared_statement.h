@@ -0,0 +1,77 @@
+#ifndef PREPARED_STATEMENT_H
+#define PREPARED_STATEMENT_H
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "cursor.h"
+#include "metrics.h"
+#include "query_result.h"
+#include "row.h"
+#include "statement.h"
+#include "table.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// A parsed INSERT or SELECT whose table, column ordinals and parameter types
+// are resolved once. Parameters are the '?' placeholders in query order and
+// are numbered from 1; bound values persist across execute() calls. A SELECT
+// scans on `pool`, if given. Executions and fetches are recorded in `metrics`, if given.
+class PreparedStatement {
+public:
+    PreparedStatement(shared_ptr<const Statement> statement, shared_ptr<Table> table, shared_ptr<ThreadPool> pool = nullptr,
+                      shared_ptr<MetricsRegistry> metrics = nullptr);
+
+    size_t get_parameter_count() const { return parameter_types.size(); }
+
+    PreparedStatement& bind(size_t index, int32_t value);
+
+    PreparedStatement& bind(size_t index, bool value);
+
+    PreparedStatement& bind(size_t index, string_view value);
+
+    PreparedStatement& bind(size_t index, const char* value) { return bind(index, string_view(value)); }
+
+    PreparedStatement& bind(size_t index, span<const uint8_t> value);
+
+    void clear_bindings();
+
+    // Inserts the statement's rows, or prints the matching rows of a SELECT.
+    QueryResult execute();
+
+    // Runs a prepared SELECT and returns the matching rows.
+    vector<Row> fetch();
+
+    // Runs a prepared SELECT and streams the matching rows. The cursor keeps
+    // the parameter values bound when it was opened.
+    Cursor query();
+
+private:
+    shared_ptr<const Statement> statement;
+    shared_ptr<Table> table;
+    shared_ptr<ThreadPool> pool;
+    shared_ptr<MetricsRegistry> metrics;
+    shared_ptr<const Schema> schema;
+    bool is_insert;
+
+    vector<DataType> parameter_types;
+    vector<bool> bound;
+
+    vector<Row> pending_rows;
+    vector<pair<size_t, size_t>> parameter_slots;
+    vector<bool> provided;
+
+    shared_ptr<const Expr> where;
+    vector<ValueType> parameter_values;
+
+    ValueType& parameter_slot(size_t index, DataType type);
+
+    void check_ready() const;
+
+    QueryResult run();
+};
+
+#endif // PREPARED_STATEMENT_H
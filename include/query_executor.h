@@ -1,40 +1,81 @@
 #ifndef QUERY_EXECUTOR_H
 #define QUERY_EXECUTOR_H
 
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <memory>
 
-#include "database.h"
+#include "cursor.h"
+#include "metrics.h"
+#include "operators.h"
+#include "prepared_statement.h"
+#include "query_result.h"
+#include "statement.h"
+#include "statement_cache.h"
 #include "table.h"
+#include "thread_pool.h"
+#include "write_ahead_log.h"
 
 using namespace std;
 
-class QueryResult {
+class QueryExecutor {
 public:
-    QueryResult(bool success, const string& error = "")
-        : success(success), error_message(error) {}
+    QueryExecutor() = default;
 
-    bool is_ok() const { return success; }
-    string get_error() const { return error_message; }
+    QueryResult execute(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
 
-private:
-    bool success;
-    string error_message;
-};
+    // The parsed form of `query`, from the statement cache when possible.
+    shared_ptr<const Statement> parse(const string& query) { return statement_cache.get_or_parse(query); }
 
-class QueryExecutor {
-public:
-    QueryExecutor() = default;
+    QueryResult execute(const Statement& statement, unordered_map<string, shared_ptr<Table>>& tables);
+
+    PreparedStatement prepare(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
+
+    // Opens a cursor over the rows of a SELECT without materializing them.
+    Cursor query(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
+
+    // Plans a SELECT, aggregates and joins included, whose batches the caller pulls from the plan's root.
+    ExecutionPlan query_batches(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
 
-    void execute(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
+    // Prints every remaining row of `cursor` as "column: value" pairs.
+    static void print_rows(Cursor& cursor);
+
+    // Prints every row `plan` produces the same way, formatting a batch column by column.
+    static void print_rows(ExecutionPlan& plan);
+
+    // Prints an EXPLAINed plan as an indented tree, with its counters when analyzed.
+    static void print_plan(const QueryResult& result);
+
+    const StatementCache& get_statement_cache() const { return statement_cache; }
+
+    // Logs CREATE TABLE and attaches the log to created tables, which log the rest.
+    void set_log(shared_ptr<WriteAheadLog> log) { this->log = std::move(log); }
+
+    // Pool that SELECTs split their full scans over; none runs them on the calling thread.
+    // Swapping it is safe while statements run: each statement loads the pool once when it starts.
+    void set_scan_pool(shared_ptr<ThreadPool> pool) { scan_pool.store(std::move(pool), memory_order_release); }
+
+    shared_ptr<ThreadPool> get_scan_pool() const { return scan_pool.load(memory_order_acquire); }
+
+    // Registry that prepared statements record their executions in.
+    void set_metrics(shared_ptr<MetricsRegistry> metrics) { this->metrics = std::move(metrics); }
 
 private:
-    QueryResult handle_create(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
+    StatementCache statement_cache;
+    shared_ptr<WriteAheadLog> log;
+    atomic<shared_ptr<ThreadPool>> scan_pool;
+    shared_ptr<MetricsRegistry> metrics;
+
+    QueryResult handle_create(const CreateTableStatement& statement, unordered_map<string, shared_ptr<Table>>& tables);
+
+    QueryResult handle_create_index(const CreateIndexStatement& statement, unordered_map<string, shared_ptr<Table>>& tables);
+
+    QueryResult handle_insert(const InsertStatement& statement, unordered_map<string, shared_ptr<Table>>& tables);
 
-    QueryResult handle_insert(const string& query, unordered_map<string, shared_ptr<Table>>& tables);
+    QueryResult handle_select(const SelectStatement& statement, unordered_map<string, shared_ptr<Table>>& tables);
 
-    QueryResult handle_select(const string &query, unordered_map<string, shared_ptr<Table>> &tables);
+    QueryResult handle_explain(const ExplainStatement& statement, unordered_map<string, shared_ptr<Table>>& tables);
 };
 
 #endif // QUERY_EXECUTOR_H
@@ -0,0 +1,73 @@
+#ifndef QUERY_PLANNER_H
+#define QUERY_PLANNER_H
+
+#include <optional>
+#include <span>
+#include "data_types.h"
+#include "ordered_index.h"
+#include "statement.h"
+
+using namespace std;
+
+class Table;
+
+enum class AccessMethod { FULL_SCAN, HASH_LOOKUP, INDEX_RANGE };
+
+// How Table::select reaches candidate rows before the predicate is applied,
+// and how the matches are ordered.
+struct AccessPath {
+    AccessMethod method = AccessMethod::FULL_SCAN;
+    size_t ordinal = 0;
+    ValueType key;
+    KeyRange range;
+    // ORDER BY column, if any; presorted is set when the access method
+    // already yields rows in ascending order of that column.
+    optional<size_t> order_ordinal;
+    bool descending = false;
+    bool presorted = false;
+    optional<size_t> limit;
+};
+
+enum class JoinMethod { HASH, INDEX_NESTED_LOOP };
+
+// What the planner weighs of one input of a join: the rows its access path
+// reads, and whether its join column has a hash or ordered index.
+struct JoinSide {
+    double rows = 0;
+    bool indexed = false;
+};
+
+// How ExecutionPlan::build_join pairs the rows of a join. The outer side is
+// read first: it probes the hash table built over the other side, or looks
+// its keys up in the other side's index.
+struct JoinPath {
+    JoinMethod method = JoinMethod::HASH;
+    bool left_outer = true;
+};
+
+class QueryPlanner {
+public:
+    // Above this estimated fraction of the table, a full scan beats chasing row ids from an ordered index.
+    static constexpr double MAX_RANGE_SELECTIVITY = 0.05;
+
+    // Up to this ratio of outer to inner rows, one index lookup per outer row
+    // beats reading and hashing the whole inner side.
+    static constexpr double MAX_INDEX_JOIN_RATIO = 0.1;
+
+    // Uses a hash index when the condition, or one operand of a top-level AND,
+    // is an equality between an indexed column and a constant. Otherwise uses
+    // an ordered index for a selective range on an indexed column, or to
+    // produce the ORDER BY order without sorting.
+    static AccessPath choose_access_path(const SelectStatement& select, const Table& table, span<const ValueType> parameters = {});
+
+    // Rows `path` reads from `table`, before any predicate is applied. Callers
+    // hold the table's read lock.
+    static double estimate_rows(const Table& table, const AccessPath& path);
+
+    // An index join when one side has an index on its join column and the
+    // other side is small enough next to it; otherwise a hash join that builds
+    // on the side with fewer estimated rows.
+    static JoinPath choose_join_method(const JoinSide& left, const JoinSide& right);
+};
+
+#endif // QUERY_PLANNER_H
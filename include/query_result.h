@@ -0,0 +1,54 @@
+#ifndef QUERY_RESULT_H
+#define QUERY_RESULT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One operator of an EXPLAINed plan. A plan lists its root first and every
+// operator before its inputs, `depth` levels below the root. Only EXPLAIN
+// ANALYZE fills the counters: the batches and rows the operator produced, the
+// rows its inputs handed it (for a scan, the rows it read), the rows it
+// passed over (see Operator::rows_skipped), the most bytes its own buffers
+// held, and the wall time spent in it with and without its inputs.
+struct PlanStage {
+    string description;
+    size_t depth = 0;
+    size_t batches = 0;
+    size_t rows_in = 0;
+    size_t rows_out = 0;
+    size_t rows_skipped = 0;
+    size_t peak_bytes = 0;
+    double time_ms = 0;
+    double self_time_ms = 0;
+};
+
+class QueryResult {
+public:
+    QueryResult(bool success, const string& error = "")
+        : success(success), error_message(error) {}
+
+    bool is_ok() const { return success; }
+    string get_error() const { return error_message; }
+
+    // The plan of an EXPLAIN, empty for other statements.
+    const vector<PlanStage>& get_plan() const { return plan; }
+
+    // Whether the plan was run, as EXPLAIN ANALYZE does, and its counters filled.
+    bool is_analyzed() const { return analyzed; }
+
+    void set_plan(vector<PlanStage> stages, bool analyzed) {
+        plan = std::move(stages);
+        this->analyzed = analyzed;
+    }
+
+private:
+    bool success;
+    string error_message;
+    vector<PlanStage> plan;
+    bool analyzed = false;
+};
+
+#endif // QUERY_RESULT_H
@@ -1,23 +1,65 @@
 #ifndef ROW_H
 #define ROW_H
 
+#include <memory>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <variant>
+#include <vector>
 #include "data_types.h"
+#include "schema.h"
 
 using namespace std;
 
+// A row bound to a table schema holds one value slot per column, indexed by
+// ordinal. A default-constructed row is unbound: values set by name are kept
+// aside until Table::insert_row binds the row to the table's schema.
 class Row {
 public:
+    Row() = default;
+
+    explicit Row(shared_ptr<const Schema> schema);
+
+    bool is_bound() const { return schema != nullptr; }
+
+    const shared_ptr<const Schema>& get_schema() const { return schema; }
+
+    void bind(shared_ptr<const Schema> new_schema);
+
+    size_t size() const { return values.size(); }
+
+    void set(size_t ordinal, ValueType value);
+
+    const ValueType& get(size_t ordinal) const;
+
+    void unset(size_t ordinal) { present[ordinal] = false; }
+
+    bool has(size_t ordinal) const { return ordinal < present.size() && present[ordinal]; }
+
+    int32_t get_int32(size_t ordinal) const { return std::get<int32_t>(get(ordinal)); }
+
+    bool get_bool(size_t ordinal) const { return std::get<bool>(get(ordinal)); }
+
+    string_view get_string(size_t ordinal) const { return std::get<string>(get(ordinal)); }
+
+    span<const uint8_t> get_bytes(size_t ordinal) const { return std::get<vector<uint8_t>>(get(ordinal)); }
+
+    // Mutable slot access for callers that refill a bound row in place.
+    ValueType& slot(size_t ordinal);
+
     void set_value(const string& column_name, const ValueType& value);
 
-    ValueType get_value(const string& column_name) const;
+    const ValueType& get_value(const string& column_name) const;
 
     bool has_value(const string& column_name) const;
 
 private:
-    unordered_map<string, ValueType> values;
+    shared_ptr<const Schema> schema;
+    vector<ValueType> values;
+    vector<bool> present;
+    vector<pair<string, ValueType>> unbound_values;
 };
 
 #endif // ROW_H
@@ -0,0 +1,40 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "statement.h"
+
+using namespace std;
+
+enum class SimdLevel { SCALAR, SSE42, AVX2 };
+
+// Column comparison kernels writing selection bitmaps: bit i of the output
+// (least significant bit of word 0 first) is set when value i matches. Every
+// word covering [0, count) is written and bits past `count` are cleared.
+// Implementations are picked at startup from what the CPU supports.
+class ScanKernels {
+public:
+    static SimdLevel detected_level();
+
+    static SimdLevel active_level();
+
+    // Selects the kernels to use, capped at the detected level; mainly for
+    // benchmarks. Safe while scans run: each kernel call uses one level or
+    // the other.
+    static void set_level(SimdLevel level);
+
+    static const char* level_name(SimdLevel level);
+
+    static void compare_int32(const int32_t* values, size_t count, ComparisonOp op, int32_t constant, uint64_t* bits);
+
+    // Bool columns store one byte per value, 0 or 1.
+    static void equal_bool(const uint8_t* values, size_t count, bool expected, uint64_t* bits);
+
+    static size_t word_count(size_t count) { return (count + 63) / 64; }
+
+    // Mask of the bits in the last word that correspond to values.
+    static uint64_t tail_mask(size_t count) { return count % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (count % 64)) - 1; }
+};
+
+#endif // SCAN_KERNELS_H
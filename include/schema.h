@@ -0,0 +1,36 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "column.h"
+
+using namespace std;
+
+// Ordered column definitions of a table. Column ordinals are positions in
+// declaration order; rows bound to a schema store their values by ordinal.
+class Schema {
+public:
+    Schema() = default;
+
+    void add_column(const Column& column);
+
+    size_t size() const { return columns.size(); }
+
+    const vector<Column>& get_columns() const { return columns; }
+
+    const Column& get_column(size_t ordinal) const { return columns[ordinal]; }
+
+    Column& get_column(size_t ordinal) { return columns[ordinal]; }
+
+    bool has_column(const string& column_name) const;
+
+    size_t get_column_ordinal(const string& column_name) const;
+
+private:
+    vector<Column> columns;
+    unordered_map<string, size_t> column_ordinals;
+};
+
+#endif // SCHEMA_H
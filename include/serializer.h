@@ -1,20 +1,80 @@
 #ifndef SERIALIZER_H
 #define SERIALIZER_H
 
+#include <cstdint>
+#include <span>
 #include <unordered_map>
 #include <memory>
 #include <string>
+#include <vector>
 #include <fstream>
 #include "table.h"
 #include "exceptions.h"
 
 using namespace std;
 
+// Snapshot format, version 1. Integers are little-endian.
+//
+//   header      "IMDBSNAP", u32 version, u32 table count, u64 log sequence
+//               number
+//   per table   a schema block, then per column:
+//                 int32, bool    an encoded payload
+//                 string, bytes  a layout block (u32 layout, u32 inline
+//                                width), then the blocks of that layout:
+//                   offsets      two blocks: u64 offsets, then the blob
+//                   dictionary   the offsets and blob of the distinct values,
+//                                then the int32 codes as an encoded payload
+//                   inline       one block of fixed-width slots
+//   encoded     a 16-byte block (u32 encoding, u32 bit width, i64 base; see
+//               ColumnEncoding), then a block with the values in that
+//               encoding; plain unless saved with set_compress_payloads
+//   block       u64 payload size, u32 chunk size, u32 chunk count, one
+//               CRC-32C per chunk, padding to an 8-byte file offset, the
+//               payload, padding to an 8-byte file offset
+//
+// The schema block holds the table name, the row count and, per column, its
+// name, type, length, attribute flags, default value and next autoincrement
+// value. Plain payloads are the ColumnStorage arrays as they are in memory.
 class Serializer {
 public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    // Payloads are checksummed, written and read in chunks of this size.
+    static constexpr uint32_t CHUNK_BYTES = 1 << 20;
+
     void save(const unordered_map<string, shared_ptr<Table>>& tables, ostream& out);
 
     unordered_map<string, shared_ptr<Table>> load(istream& file);
+
+    // Maps the snapshot at `path` and serves column data from the mapping, so
+    // startup cost does not grow with the data. A column is copied into owned
+    // memory the first time its table is modified. Payload checksums, and the
+    // string offsets, inline slot lengths and dictionary codes that reads rely
+    // on, are only verified when asked, as that reads the whole file; without
+    // verification, a damaged snapshot can make reads go astray.
+    unordered_map<string, shared_ptr<Table>> map(const string& path, bool verify_checksums = false);
+
+    // Last write-ahead log record reflected in a snapshot: written by save,
+    // read back by load and map. Replay skips records up to it.
+    uint64_t get_log_sequence_number() const { return log_sequence_number; }
+
+    void set_log_sequence_number(uint64_t lsn) { log_sequence_number = lsn; }
+
+    // Whether save writes int32 and bool payloads and dictionary codes in a
+    // compact encoding where that at least halves them (see ColumnEncoding).
+    // Off by default: map has to expand encoded payloads into owned memory
+    // rather than read them in place, so it suits snapshots kept for load.
+    void set_compress_payloads(bool compress) { compress_payloads = compress; }
+
+    // The schema block of `table` stored as `table_name`: the name, row count and column definitions.
+    static vector<uint8_t> encode_schema(const string& table_name, const Table& table);
+
+    // An empty table with the columns of a schema block; its row count goes to `row_count`.
+    static shared_ptr<Table> decode_schema(span<const uint8_t> schema_block, uint64_t& row_count);
+
+private:
+    uint64_t log_sequence_number = 0;
+    bool compress_payloads = false;
 };
 
 #endif // SERIALIZER_H
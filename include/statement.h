@@ -0,0 +1,111 @@
+#ifndef STATEMENT_H
+#define STATEMENT_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+#include "data_types.h"
+
+using namespace std;
+
+enum class ComparisonOp { EQ, NE, LT, LE, GT, GE };
+
+struct ColumnDefinition {
+    string name;
+    DataType type = DataType::INT32;
+    size_t length = 0;
+    bool autoincrement = false;
+    bool unique = false;
+    bool key = false;
+    bool indexed = false;
+    bool dictionary = false;
+    optional<ValueType> default_value;
+};
+
+struct CreateTableStatement {
+    string table_name;
+    vector<ColumnDefinition> columns;
+};
+
+// CREATE INDEX [name] ON table (column): an ordered index on one column.
+struct CreateIndexStatement {
+    string index_name;
+    string table_name;
+    string column_name;
+};
+
+// Each entry of `rows` is one VALUES tuple, positional unless column_names is
+// non-empty. `parameters` lists the (row, value) positions written as '?'
+// placeholders, in query order.
+struct InsertStatement {
+    string table_name;
+    vector<string> column_names;
+    vector<vector<ValueType>> rows;
+    vector<pair<size_t, size_t>> parameters;
+};
+
+enum class ExprType { COLUMN, LITERAL, PARAMETER, COMPARISON, AND, OR, NOT };
+
+// Node of a WHERE expression. COMPARISON has two children, AND/OR two or
+// more, NOT one. Parameters are numbered from 0 in query order.
+struct Expr {
+    ExprType type = ExprType::LITERAL;
+    string column_name;
+    ValueType value;
+    size_t parameter_index = 0;
+    ComparisonOp op = ComparisonOp::EQ;
+    vector<shared_ptr<const Expr>> children;
+};
+
+enum class AggregateFunction { COUNT, SUM, MIN, MAX, AVG };
+
+// An entry of a SELECT list: a column, or an aggregate over one. COUNT(*)
+// leaves column_name empty.
+struct SelectItem {
+    optional<AggregateFunction> aggregate;
+    string column_name;
+};
+
+// Of an aggregate query, ORDER BY names one of its SELECT items.
+struct OrderByClause {
+    string column_name;
+    optional<AggregateFunction> aggregate;
+    bool descending = false;
+};
+
+// JOIN table_name ON left_column = right_column, an inner equi-join with the
+// FROM table. Either ON column may name either table.
+struct JoinClause {
+    string table_name;
+    string left_column;
+    string right_column;
+};
+
+// An empty column list selects every column. A list with an aggregate, or a
+// query with GROUP BY, is kept in `items` instead and column_names stays empty.
+// Column names may be qualified as "table.column", which a join needs when
+// both tables have the column.
+struct SelectStatement {
+    vector<string> column_names;
+    vector<SelectItem> items;
+    string table_name;
+    optional<JoinClause> join;
+    shared_ptr<const Expr> where;
+    vector<string> group_by;
+    optional<OrderByClause> order_by;
+    optional<size_t> limit;
+    size_t parameter_count = 0;
+};
+
+// EXPLAIN [ANALYZE] SELECT ...: the SELECT's plan and, with ANALYZE, what
+// running it measured. The rows themselves are not returned.
+struct ExplainStatement {
+    SelectStatement select;
+    bool analyze = false;
+};
+
+using Statement = variant<CreateTableStatement, CreateIndexStatement, InsertStatement, SelectStatement, ExplainStatement>;
+
+#endif // STATEMENT_H
@@ -0,0 +1,44 @@
+#ifndef STATEMENT_CACHE_H
+#define STATEMENT_CACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "statement.h"
+
+using namespace std;
+
+// LRU cache of parsed statements keyed on the query text with whitespace
+// outside string literals collapsed, so reformatted copies share an entry.
+// Safe to use from several threads; parsing happens outside the lock.
+class StatementCache {
+public:
+    explicit StatementCache(size_t capacity = 256) : capacity(capacity) {}
+
+    shared_ptr<const Statement> get_or_parse(string_view query);
+
+    static string normalize(string_view query);
+
+    size_t size() const;
+
+    size_t get_hits() const;
+
+    size_t get_misses() const;
+
+    void clear();
+
+private:
+    using Entry = pair<string, shared_ptr<const Statement>>;
+
+    size_t capacity;
+    list<Entry> entries;
+    unordered_map<string_view, list<Entry>::iterator> index;
+    size_t hits = 0;
+    size_t misses = 0;
+    mutable mutex cache_mutex;
+};
+
+#endif // STATEMENT_CACHE_H
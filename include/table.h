@@ -1,19 +1,61 @@
 #ifndef TABLE_H
 #define TABLE_H
 
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include "row.h"
 #include "column.h"
+#include "column_storage.h"
+#include "expression.h"
+#include "hash_index.h"
+#include "ordered_index.h"
+#include "query_planner.h"
+#include "schema.h"
+#include "thread_pool.h"
+#include "write_ahead_log.h"
 
 using namespace std;
 
+// Where the bytes of a table are; see Table::memory_breakdown.
+struct TableMemory {
+    // Owned int32 and bool values, string offsets, dictionary codes and lookup slots.
+    size_t column_bytes = 0;
+    // Owned string and bytes payload, inline slots and dictionary values included.
+    size_t string_bytes = 0;
+    size_t index_bytes = 0;
+    // Read in place from a mapped snapshot rather than held on the heap.
+    size_t mapped_bytes = 0;
+};
+
+// Concurrency is multi-versioned. Rows are only ever appended, and a write is
+// committed by publishing the new row count once its rows and index entries
+// are in place, so the row count is the commit timestamp: whoever reads
+// get_row_count() once has a snapshot, since rows below it never change.
+// With a log, the lock is released while the log commits, so that other
+// writers can join the flush, and the rows are published only once it has:
+// rows a crash could lose are never visible. After a failed commit the table
+// refuses every later write.
+// Column storage is read without locks under an Epoch::Guard (see
+// ColumnStorage); writers never wait for such readers. Writers serialize on
+// the table's lock. Indexes change in place, so callers of find_row and
+// get_ordered_index hold lock_shared() while they use the result (RowScanner
+// does, one chunk of rows at a time); those are all a writer ever waits for.
+// Cursors and the whole-table reads below take the guard and lock themselves.
 class Table {
 public:
     Table(const string& name);
 
+    const string& get_name() const { return name; }
+
     void add_column(const Column& column);
 
     vector<Column> get_columns() const;
@@ -22,20 +64,155 @@ public:
 
     const Column& get_column(const string& column_name) const;
 
+    size_t get_column_ordinal(const string& column_name) const;
+
+    shared_ptr<const Schema> get_schema() const { return schema; }
+
+    const ColumnStorage& get_column_storage(size_t ordinal) const;
+
     void insert_row(Row& row);
 
+    // Inserts a batch atomically: every row is bound, type-checked and
+    // checked for missing values and uniqueness before any is appended.
+    // Autoincrement values are then assigned to the rows in one contiguous
+    // range per column; a rejected batch gets none.
+    void insert_rows(span<Row> batch);
+
+    // Appends one ColumnStorage per column; all columns must hold the same number of values.
+    void append_columns(const vector<ColumnStorage>& batch);
+
     vector<Row> select(function<bool(const Row&)> condition);
 
+    // Evaluates a compiled predicate against column storage; only matching rows are materialized.
+    vector<Row> select(const Expression& predicate, const AccessPath& path = AccessPath(), ThreadPool* pool = nullptr) const;
+
+    // Ids of the rows matching `predicate`, read through `path` and in the
+    // order it asks for. Full scans are split into morsels on `pool`, if given.
+    vector<size_t> select_row_ids(const Expression& predicate, const AccessPath& path = AccessPath(), ThreadPool* pool = nullptr) const;
+
+    bool has_hash_index(size_t ordinal) const { return hash_indexes.count(ordinal) != 0; }
+
+    // Row id holding `key` in a hash-indexed column, if any.
+    optional<size_t> find_row(size_t ordinal, const ValueType& key) const;
+
+    // Builds a B+-tree over an int32 or bool column from its current values.
+    void create_ordered_index(size_t ordinal);
+
+    bool has_ordered_index(size_t ordinal) const { return ordered_indexes.count(ordinal) != 0; }
+
+    const OrderedIndex& get_ordered_index(size_t ordinal) const;
+
     void print_table() const;
 
-    const std::vector<Row>& get_rows() const;
+    // Rows committed so far; see the concurrency notes above.
+    size_t get_row_count() const { return committed_rows.load(memory_order_acquire); }
+
+    // Holds writers of this table off until released.
+    shared_lock<shared_mutex> lock_shared() const { return shared_lock<shared_mutex>(table_mutex); }
+
+    // As lock_shared(), once every appended row is published too, so that the
+    // rows and get_log_lsn() agree; throws if a log commit failed.
+    shared_lock<shared_mutex> lock_published() const;
+
+    Row get_row(size_t index) const;
+
+    // Refills a row bound to this table's schema with the values of row `index`.
+    void read_row(size_t index, Row& row) const;
+
+    vector<Row> get_rows() const;
 
     vector<Column> get_column_definitions() const;
 
+    // Takes over loaded columns; indexes are rebuilt on first use rather than here.
+    void load_column_storage(vector<ColumnStorage> loaded, size_t loaded_row_count);
+
+    // Heap bytes of the columns and indexes.
+    size_t memory_usage() const;
+
+    TableMemory memory_breakdown() const;
+
+    // Inserts, appends and CREATE INDEX are logged to `log` and committed before they return.
+    void set_log(shared_ptr<WriteAheadLog> log) { this->log = std::move(log); }
+
+    // LSN of the last log record reflected in the table.
+    uint64_t get_log_lsn() const { return log_lsn; }
+
+    void set_log_lsn(uint64_t lsn) { log_lsn = lsn; }
+
+    // Bumped by every insert, append and CREATE INDEX.
+    uint64_t get_version() const { return version; }
+
+    // A private copy of the rows committed so far, with the schema, counters
+    // and index definitions as they were then. Writers are only held off while
+    // those are read, not while the rows are copied; indexes are left to be
+    // built on first use.
+    shared_ptr<Table> consistent_copy() const;
+
+    // Restores the next value of an autoincrement column, e.g. while replaying a log.
+    // Appends already move it past the values they hold.
+    void set_autoincrement_value(size_t ordinal, int32_t value) { schema->get_column(ordinal).set_autoincrement_value(value); }
+
 private:
     string name;
-    unordered_map<string, Column> columns;
-    vector<Row> rows;
+    shared_ptr<Schema> schema;
+    vector<ColumnStorage> storage;
+    // Rows appended by writers, and the part of them readers may see.
+    size_t row_count = 0;
+    atomic<size_t> committed_rows = 0;
+    mutable unordered_map<size_t, HashIndex> hash_indexes;
+    mutable unordered_map<size_t, OrderedIndex> ordered_indexes;
+    mutable atomic<bool> indexes_stale = false;
+    // Set by load_column_storage until a writer has checked the loaded rows
+    // against the autoincrement counters; see ensure_autoincrement.
+    bool autoincrement_stale = false;
+    mutable mutex index_mutex;
+    shared_ptr<WriteAheadLog> log;
+    // Held exclusively by writers and shared by index readers.
+    mutable shared_mutex table_mutex;
+    // Signalled whenever rows are published or a commit fails.
+    mutable condition_variable_any published;
+    bool commit_failed = false;
+    atomic<uint64_t> version = 0;
+    atomic<uint64_t> log_lsn = 0;
+
+    // Appends a validated batch and returns the id of its first row.
+    size_t append_rows(span<Row> batch);
+
+    // Logs rows [first_row, row_count) before they are published; on failure
+    // they are truncated again. Returns the LSN to commit, or 0 without a log.
+    uint64_t log_appended_rows(size_t first_row);
+
+    // Drops the unpublished rows from `first_row` on and rebuilds the indexes.
+    void truncate_rows(size_t first_row);
+
+    // Throws once a commit has failed; called with the lock held exclusively.
+    void check_writable() const;
+
+    // With `lsn` 0 (no log), publishes the rows up to `end_row` under the
+    // lock held by `lock`. Else releases it, commits `lsn` and only then
+    // publishes them, or marks the table failed.
+    void publish_rows(unique_lock<shared_mutex>& lock, size_t end_row, uint64_t lsn);
+
+    // Rejects string and bytes values longer than the column's declared length.
+    static void check_length(const Column& column, size_t size);
+
+    void check_unique(span<Row> batch, size_t ordinal) const;
+
+    // Moves each autoincrement counter past the largest value in rows
+    // [first_row, row_count), so that values given explicitly are never
+    // generated again.
+    void advance_autoincrement(size_t first_row);
+
+    // Advances the counters over loaded rows before the first write, so that
+    // loading a snapshot does not have to read them.
+    void ensure_autoincrement();
+
+    void index_rows(size_t first_row);
+
+    void rebuild_indexes() const;
+
+    // Rebuilds indexes left stale by load_column_storage.
+    void ensure_indexes() const;
 };
 
 #endif // TABLE_H
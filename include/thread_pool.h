@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Threads that run the morsels of parallel scans. Every worker owns a deque:
+// it takes tasks from the back of its own and, once that is empty, steals from
+// the front of the others'. The thread calling run() works through tasks too,
+// so a pool of one thread has no workers and runs everything inline.
+class ThreadPool {
+public:
+    // `threads` counts the calling thread; at least one is used.
+    explicit ThreadPool(size_t threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Calls task(i) for every i in [0, count) across the pool and returns once
+    // all of them have finished. Rethrows the first exception a task threw.
+    // Safe to call from several threads at once.
+    void run(size_t count, const function<void(size_t)>& task);
+
+private:
+    struct Job {
+        const function<void(size_t)>* task;
+        atomic<size_t> remaining;
+        mutex done_mutex;
+        condition_variable done;
+        exception_ptr error;
+    };
+
+    using Task = pair<shared_ptr<Job>, size_t>;
+
+    struct Queue {
+        mutex queue_mutex;
+        deque<Task> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+    // Tasks pushed but not taken yet; idle workers sleep while it is zero.
+    atomic<size_t> queued = 0;
+    mutex sleep_mutex;
+    condition_variable wake;
+    bool stopping = false;
+
+    void work(size_t index);
+
+    // Takes a task from queue `first` (its back) or, failing that, steals from another's front.
+    bool take(size_t first, Task& task);
+
+    static void execute(Task& task);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,38 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+enum class TokenType { IDENTIFIER, INTEGER, STRING, HEX, SYMBOL, END };
+
+struct Token {
+    TokenType type;
+    string_view text;
+    size_t position;
+};
+
+// Splits a query into tokens without copying it. String tokens keep their
+// surrounding quotes; doubled quotes inside them are unescaped by the parser.
+class Tokenizer {
+public:
+    explicit Tokenizer(string_view input) : input(input) {}
+
+    Token next();
+
+    Token peek();
+
+private:
+    string_view input;
+    size_t position = 0;
+    optional<Token> lookahead;
+
+    Token scan();
+
+    void skip_whitespace();
+};
+
+#endif // TOKENIZER_H
@@ -0,0 +1,137 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "metrics.h"
+
+using namespace std;
+
+class Table;
+
+// When a committed record has to be on stable storage.
+enum class SyncPolicy {
+    // Written to the OS on commit, never fsynced: survives a process crash but not a power loss.
+    NONE,
+    // Every commit does its own write and fsync of the records up to its own.
+    EVERY_COMMIT,
+    // Commits that wait at the same time share one write and fsync.
+    GROUP,
+};
+
+enum class LogRecordType : uint8_t {
+    CREATE_TABLE = 1,
+    CREATE_INDEX = 2,
+    INSERT = 3,
+};
+
+struct LogRecord {
+    uint64_t lsn;
+    LogRecordType type;
+    span<const uint8_t> payload;
+};
+
+// Append-only redo log of CREATE TABLE, CREATE INDEX and INSERT. Integers are
+// little-endian.
+//
+//   header   "IMDBWAL" and a NUL, u32 version, u32 reserved
+//   record   u32 payload size, u32 CRC-32C of the remaining fields, u64 log
+//            sequence number (LSN), u8 record type, payload
+//
+// CREATE TABLE payloads are snapshot schema blocks; INSERT payloads hold the
+// appended rows column by column with their final values, plus the table's
+// autoincrement counters. Opening a log replays it up to the first torn or
+// corrupt record and cuts it there. A checkpoint retires the records logged so
+// far to a second file (see rotate) so the log never has to be rewritten.
+class WriteAheadLog {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    // Opens or creates the log at `path`, handing every intact record to `replay` first.
+    WriteAheadLog(const string& path, SyncPolicy policy = SyncPolicy::GROUP, chrono::microseconds group_window = chrono::microseconds(0),
+                  const function<void(const LogRecord&)>& replay = nullptr);
+
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    uint64_t append_create_table(const Table& table);
+
+    uint64_t append_create_index(const Table& table, size_t ordinal);
+
+    // Logs `rows` rows of `table` from `first_row` on; they need not be published yet.
+    // Throws without logging anything when the record would exceed 4 GiB.
+    uint64_t append_insert(const Table& table, size_t first_row, size_t rows);
+
+    // Returns once record `lsn` and every record before it are durable under the sync policy.
+    void commit(uint64_t lsn);
+
+    // Moves the records logged so far to retired_path() and continues in an
+    // empty log. A retired file that was already there when the log was opened
+    // is taken over: the records are appended to it. Returns false, leaving
+    // the log as it is, while a retired file from an earlier rotation of this
+    // log still exists.
+    bool rotate();
+
+    // Deletes the retired records once a checkpoint covers them.
+    void discard_retired();
+
+    string retired_path() const { return path + ".old"; }
+
+    uint64_t get_last_lsn() const;
+
+    // Numbers later records after `lsn`, e.g. the one a snapshot was taken at.
+    void advance_lsn(uint64_t lsn);
+
+    SyncPolicy get_policy() const { return policy; }
+
+    // Records appended, writes and fsyncs of this log, and the bytes replayed when it was opened.
+    const IoMetrics& get_io_metrics() const { return io; }
+
+    // Re-applies a logged mutation to `tables`, unless the table already
+    // reflects it according to Table::get_log_lsn.
+    static void apply(const LogRecord& record, unordered_map<string, shared_ptr<Table>>& tables);
+
+private:
+    string path;
+    SyncPolicy policy;
+    chrono::microseconds group_window;
+    int fd = -1;
+
+    mutable mutex log_mutex;
+    condition_variable flushed;
+    // Records appended but not yet written, and the LSNs around them.
+    vector<uint8_t> pending;
+    // LSN of each pending record and the offset in `pending` where it ends.
+    vector<pair<uint64_t, size_t>> pending_ends;
+    uint64_t next_lsn = 1;
+    uint64_t durable_lsn = 0;
+    bool flushing = false;
+    // The retired file was left by a checkpoint before this log was opened.
+    bool retired_on_open = false;
+    string failure;
+    IoMetrics io;
+
+    uint64_t append(LogRecordType type, span<const uint8_t> payload);
+
+    void write_header();
+
+    // Appends the records of the log file to the retired file and syncs it.
+    void append_to_retired();
+
+    void write_all(span<const uint8_t> data);
+
+    void sync();
+};
+
+#endif // WRITE_AHEAD_LOG_H
@@ -15,11 +15,20 @@ void test_database() {
         cout << "Running: CREATE TABLE users ({autoincrement} id : int32, {unique} login: string[32], password_hash: bytes[8], is_admin: bool = false)" << endl;
         executor.execute("CREATE TABLE users ({autoincrement} id : int32, {unique} login: string[32], password_hash: bytes[8], is_admin: bool = false)", db.get_tables());
 
-        cout << "Running: INSERT INTO users VALUES (true 0x123abc 'Alice' 1)" << endl;
-        executor.execute("INSERT INTO users VALUES (true 0x123abc 'Alice' 1)", db.get_tables());
+        cout << "Running: INSERT INTO users VALUES (1 'Alice' 0x123abc true)" << endl;
+        executor.execute("INSERT INTO users VALUES (1 'Alice' 0x123abc true)", db.get_tables());
 
-        cout << "Running: INSERT INTO users VALUES (false 0x789xyz 'Bob' 2)" << endl;
-        executor.execute("INSERT INTO users VALUES (false 0x789xyz 'Bob' 2)", db.get_tables());
+        cout << "Running: INSERT INTO users VALUES (2 'Bob' 0x789abc false)" << endl;
+        executor.execute("INSERT INTO users VALUES (2 'Bob' 0x789abc false)", db.get_tables());
+
+        cout << "Running: SELECT id, login FROM users WHERE id > 1" << endl;
+        executor.execute("SELECT id, login FROM users WHERE id > 1", db.get_tables());
+
+        cout << "Running: CREATE INDEX ON users (id)" << endl;
+        executor.execute("CREATE INDEX ON users (id)", db.get_tables());
+
+        cout << "Running: SELECT id, login FROM users WHERE id >= 1 ORDER BY id DESC" << endl;
+        executor.execute("SELECT id, login FROM users WHERE id >= 1 ORDER BY id DESC", db.get_tables());
 
         cout << "Printing table 'users' after inserts:" << endl;
         auto tables = db.get_tables();
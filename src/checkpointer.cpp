@@ -0,0 +1,208 @@
+#include "checkpointer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <streambuf>
+
+#include "database.h"
+#include "serializer.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static constexpr const char* SNAPSHOT_EXTENSION = ".snap";
+
+// Passes writes through to another buffer, sleeping as needed to stay under a byte rate.
+class ThrottledBuffer : public streambuf {
+public:
+    ThrottledBuffer(streambuf* target, size_t bytes_per_second)
+        : target(target), bytes_per_second(bytes_per_second), start(chrono::steady_clock::now()) {}
+
+    size_t get_bytes_written() const { return bytes_written; }
+
+protected:
+    streamsize xsputn(const char* data, streamsize size) override {
+        streamsize done = 0;
+        while (done < size) {
+            streamsize slice = min<streamsize>(size - done, SLICE_BYTES);
+            if (target->sputn(data + done, slice) != slice) {
+                return done;
+            }
+            done += slice;
+            bytes_written += static_cast<size_t>(slice);
+            if (bytes_per_second != 0) {
+                this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(
+                    chrono::duration<double>(static_cast<double>(bytes_written) / bytes_per_second)));
+            }
+        }
+        return done;
+    }
+
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+
+    int sync() override { return target->pubsync(); }
+
+private:
+    static constexpr streamsize SLICE_BYTES = 64 * 1024;
+
+    streambuf* target;
+    size_t bytes_per_second;
+    chrono::steady_clock::time_point start;
+    size_t bytes_written = 0;
+};
+
+// Flushes a file, or a directory entry after a rename, to stable storage.
+static void sync_path(const filesystem::path& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Failed to open for sync: " + path.string());
+    }
+    int result = fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        throw runtime_error("Failed to sync: " + path.string());
+    }
+#endif
+}
+
+Checkpointer::Checkpointer(Database& database, const string& directory, CheckpointOptions options)
+    : database(database), directory(directory), options(options) {
+    // Tables loaded from this directory and not modified since are already on disk.
+    if (database.get_checkpoint_directory() == directory) {
+        for (const auto& [name, table] : database.list_tables()) {
+            if (table->get_version() == 0) {
+                written_versions[name] = 0;
+            }
+        }
+    }
+}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::start() {
+    lock_guard<mutex> lock(state_mutex);
+    if (worker.joinable()) {
+        return;
+    }
+    stopping = false;
+    worker = thread([this] {
+        unique_lock<mutex> lock(state_mutex);
+        while (!wake.wait_for(lock, options.interval, [this] { return stopping; })) {
+            lock.unlock();
+            string error;
+            try {
+                run_once();
+            } catch (const exception& e) {
+                error = e.what();
+            }
+            lock.lock();
+            if (!error.empty()) {
+                last_error = error;
+            }
+        }
+    });
+}
+
+void Checkpointer::stop() {
+    {
+        lock_guard<mutex> lock(state_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+CheckpointStats Checkpointer::run_once() {
+    lock_guard<mutex> run(run_mutex);
+    auto start = chrono::steady_clock::now();
+    filesystem::create_directories(directory);
+
+    CheckpointStats stats;
+    // The log and tables are copied under the catalog lock, so open_log or a
+    // load replacing them cannot pull them from under the checkpoint.
+    shared_ptr<WriteAheadLog> log;
+    vector<pair<string, shared_ptr<Table>>> listed = database.begin_checkpoint(log);
+    for (const auto& [name, table] : listed) {
+        auto written = written_versions.find(name);
+        if (written != written_versions.end() && written->second == table->get_version()) {
+            ++stats.tables_skipped;
+            continue;
+        }
+        shared_ptr<Table> copy = table->consistent_copy();
+        stats.bytes_written += write_table(name, copy);
+        written_versions[name] = copy->get_version();
+        ++stats.tables_written;
+    }
+    if (stats.tables_written > 0) {
+        sync_path(directory);
+    }
+    // Every record this pass retired is now reflected in a table file. A
+    // retired file this pass did not rotate may still wait for another
+    // checkpoint, so it is left alone.
+    if (log) {
+        log->discard_retired();
+    }
+
+    stats.elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    lock_guard<mutex> lock(state_mutex);
+    last_stats = stats;
+    return stats;
+}
+
+size_t Checkpointer::write_table(const string& table_name, const shared_ptr<Table>& table) {
+    string path = table_path(directory, table_name);
+    string temporary = path + ".tmp";
+    ofstream file(temporary, ios::binary);
+    if (!file.is_open()) {
+        throw runtime_error("Failed to open file: " + temporary);
+    }
+    auto start = chrono::steady_clock::now();
+    ThrottledBuffer throttled(file.rdbuf(), options.max_bytes_per_second);
+    ostream out(&throttled);
+
+    Serializer serializer;
+    serializer.set_log_sequence_number(table->get_log_lsn());
+    serializer.save({{table_name, table}}, out);
+    out.flush();
+    file.close();
+    if (!out || !file) {
+        throw runtime_error("Failed to write file: " + temporary);
+    }
+    sync_path(temporary);
+    filesystem::rename(temporary, path);
+
+    IoMetrics& io = database.get_metrics().snapshots;
+    io.records.add();
+    io.writes.add();
+    io.bytes_written.add(throttled.get_bytes_written());
+    io.syncs.add();
+    io.latency.record(chrono::steady_clock::now() - start);
+    return throttled.get_bytes_written();
+}
+
+CheckpointStats Checkpointer::get_last_stats() const {
+    lock_guard<mutex> lock(state_mutex);
+    return last_stats;
+}
+
+string Checkpointer::get_last_error() const {
+    lock_guard<mutex> lock(state_mutex);
+    return last_error;
+}
+
+string Checkpointer::table_path(const string& directory, const string& table_name) {
+    return (filesystem::path(directory) / (table_name + SNAPSHOT_EXTENSION)).string();
+}
@@ -0,0 +1,72 @@
+#include "checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CHECKSUM_X86_64 1
+#endif
+
+namespace {
+
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82f63b78;
+
+constexpr array<uint32_t, 256> make_table() {
+    array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLYNOMIAL : 0);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr array<uint32_t, 256> CRC_TABLE = make_table();
+
+uint32_t crc32c_software(const uint8_t* bytes, size_t size, uint32_t crc) {
+    for (size_t i = 0; i < size; ++i) {
+        crc = CRC_TABLE[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_X86_64
+__attribute__((target("sse4.2")))
+uint32_t crc32c_hardware(const uint8_t* bytes, size_t size, uint32_t crc) {
+    uint64_t wide = crc;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<uint32_t>(wide);
+    for (; i < size; ++i) {
+        crc = _mm_crc32_u8(crc, bytes[i]);
+    }
+    return crc;
+}
+#endif
+
+using Crc32cFunction = uint32_t (*)(const uint8_t*, size_t, uint32_t);
+
+Crc32cFunction select_crc32c() {
+#ifdef CHECKSUM_X86_64
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return crc32c_hardware;
+    }
+#endif
+    return crc32c_software;
+}
+
+const Crc32cFunction crc32c_implementation = select_crc32c();
+
+}
+
+uint32_t Checksum::crc32c(const void* data, size_t size, uint32_t crc) {
+    return ~crc32c_implementation(static_cast<const uint8_t*>(data), size, ~crc);
+}
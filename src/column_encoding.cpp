@@ -0,0 +1,144 @@
+#include "column_encoding.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+template <typename T>
+static EncodingHeader encode_values(span<const T> values, vector<uint8_t>& payload) {
+    payload.clear();
+    EncodingHeader header;
+    if (values.empty()) {
+        return header;
+    }
+    size_t runs = 1;
+    int64_t low = values[0];
+    int64_t high = values[0];
+    for (size_t i = 1; i < values.size(); ++i) {
+        runs += values[i] != values[i - 1];
+        low = min<int64_t>(low, values[i]);
+        high = max<int64_t>(high, values[i]);
+    }
+    uint32_t width = static_cast<uint32_t>(bit_width(static_cast<uint64_t>(high - low)));
+    size_t plain_bytes = values.size() * sizeof(T);
+    size_t run_length_bytes = runs * (sizeof(int32_t) + sizeof(uint32_t));
+    size_t word_count = (values.size() * width + 63) / 64;
+    size_t packed_bytes = word_count * sizeof(uint64_t);
+    if (min(run_length_bytes, packed_bytes) * 2 > plain_bytes) {
+        return header;
+    }
+
+    if (run_length_bytes <= packed_bytes) {
+        header.encoding = Encoding::RUN_LENGTH;
+        payload.reserve(run_length_bytes);
+        size_t start = 0;
+        for (size_t i = 1; i <= values.size(); ++i) {
+            if (i == values.size() || values[i] != values[start] || i - start == numeric_limits<uint32_t>::max()) {
+                int32_t value = values[start];
+                uint32_t length = static_cast<uint32_t>(i - start);
+                const auto* value_bytes = reinterpret_cast<const uint8_t*>(&value);
+                const auto* length_bytes = reinterpret_cast<const uint8_t*>(&length);
+                payload.insert(payload.end(), value_bytes, value_bytes + sizeof(value));
+                payload.insert(payload.end(), length_bytes, length_bytes + sizeof(length));
+                start = i;
+            }
+        }
+        return header;
+    }
+
+    header.encoding = Encoding::BIT_PACKED;
+    header.bit_width = width;
+    header.base = low;
+    vector<uint64_t> words(word_count, 0);
+    if (width > 0) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            uint64_t delta = static_cast<uint64_t>(values[i] - low);
+            size_t bit = i * width;
+            words[bit / 64] |= delta << (bit % 64);
+            if (bit % 64 + width > 64) {
+                words[bit / 64 + 1] |= delta >> (64 - bit % 64);
+            }
+        }
+    }
+    payload.resize(packed_bytes);
+    if (packed_bytes > 0) {
+        memcpy(payload.data(), words.data(), packed_bytes);
+    }
+    return header;
+}
+
+// Values outside [low, high] can only come from a corrupt payload.
+template <typename T>
+static vector<T> decode_values(const EncodingHeader& header, span<const uint8_t> payload, size_t rows, int64_t low, int64_t high) {
+    vector<T> values;
+    values.reserve(rows);
+    switch (header.encoding) {
+        case Encoding::RUN_LENGTH:
+            if (payload.size() % (sizeof(int32_t) + sizeof(uint32_t)) != 0) {
+                throw SerializationException("Corrupt run-length payload");
+            }
+            for (size_t offset = 0; offset < payload.size(); offset += sizeof(int32_t) + sizeof(uint32_t)) {
+                int32_t value;
+                uint32_t length;
+                memcpy(&value, payload.data() + offset, sizeof(value));
+                memcpy(&length, payload.data() + offset + sizeof(value), sizeof(length));
+                if (value < low || value > high || length > rows - values.size()) {
+                    throw SerializationException("Corrupt run-length payload");
+                }
+                values.insert(values.end(), length, static_cast<T>(value));
+            }
+            break;
+        case Encoding::BIT_PACKED: {
+            uint32_t width = header.bit_width;
+            if (width > 32 || header.base < low || header.base > high
+                || payload.size() != (rows * width + 63) / 64 * sizeof(uint64_t)) {
+                throw SerializationException("Corrupt bit-packed payload");
+            }
+            uint64_t mask = width == 0 ? 0 : ~uint64_t(0) >> (64 - width);
+            for (size_t row = 0; row < rows; ++row) {
+                uint64_t delta = 0;
+                if (width > 0) {
+                    size_t bit = row * width;
+                    uint64_t word;
+                    memcpy(&word, payload.data() + bit / 64 * sizeof(uint64_t), sizeof(word));
+                    delta = word >> (bit % 64);
+                    if (bit % 64 + width > 64) {
+                        memcpy(&word, payload.data() + (bit / 64 + 1) * sizeof(uint64_t), sizeof(word));
+                        delta |= word << (64 - bit % 64);
+                    }
+                    delta &= mask;
+                }
+                int64_t value = header.base + static_cast<int64_t>(delta);
+                if (value > high) {
+                    throw SerializationException("Corrupt bit-packed payload");
+                }
+                values.push_back(static_cast<T>(value));
+            }
+            break;
+        }
+        default:
+            throw SerializationException("Unknown column encoding " + to_string(static_cast<uint32_t>(header.encoding)));
+    }
+    if (values.size() != rows) {
+        throw SerializationException("Encoded payload holds " + to_string(values.size()) + " values, expected " + to_string(rows));
+    }
+    return values;
+}
+
+EncodingHeader ColumnEncoding::encode(span<const int32_t> values, vector<uint8_t>& payload) {
+    return encode_values(values, payload);
+}
+
+EncodingHeader ColumnEncoding::encode(span<const uint8_t> values, vector<uint8_t>& payload) {
+    return encode_values(values, payload);
+}
+
+vector<int32_t> ColumnEncoding::decode_int32(const EncodingHeader& header, span<const uint8_t> payload, size_t rows) {
+    return decode_values<int32_t>(header, payload, rows, numeric_limits<int32_t>::min(), numeric_limits<int32_t>::max());
+}
+
+vector<uint8_t> ColumnEncoding::decode_bool(const EncodingHeader& header, span<const uint8_t> payload, size_t rows) {
+    return decode_values<uint8_t>(header, payload, rows, 0, 1);
+}
@@ -0,0 +1,669 @@
+#include "column_storage.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "epoch.h"
+
+ColumnStorage::ColumnStorage(DataType type, bool dictionary, size_t inline_width)
+    : type(type), dictionary(dictionary), inline_width(inline_width) {
+    bool blob_type = type == DataType::STRING || type == DataType::BYTES;
+    if (dictionary && !blob_type) {
+        throw runtime_error("Only string and bytes columns can be dictionary encoded");
+    }
+    if (inline_width != 0 && (!blob_type || dictionary || inline_width > MAX_INLINE_WIDTH)) {
+        throw runtime_error("Only string and bytes columns of at most " + to_string(MAX_INLINE_WIDTH) + " bytes can be stored inline");
+    }
+    if (blob_type && inline_width == 0) {
+        offsets.push_back(0);
+    }
+    refresh_views();
+}
+
+ColumnStorage::ColumnStorage(const ColumnStorage& other)
+    : type(other.type), dictionary(other.dictionary), inline_width(other.inline_width), count(other.count.load()), int32_values(other.int32_values), bool_values(other.bool_values),
+      offsets(other.offsets), blob(other.blob), dictionary_count(other.dictionary_count.load()), owner(other.owner), slots(other.slots) {
+    if (owner) {
+        int32_view = other.int32_view.load();
+        bool_view = other.bool_view.load();
+        offsets_view = other.offsets_view.load();
+        blob_view = other.blob_view.load();
+        blob_size = other.blob_size.load();
+    } else {
+        refresh_views();
+    }
+}
+
+ColumnStorage::ColumnStorage(ColumnStorage&& other) noexcept
+    : type(other.type), dictionary(other.dictionary), inline_width(other.inline_width), count(other.count.load()), int32_values(std::move(other.int32_values)),
+      bool_values(std::move(other.bool_values)), offsets(std::move(other.offsets)), blob(std::move(other.blob)),
+      int32_view(other.int32_view.load()), bool_view(other.bool_view.load()), offsets_view(other.offsets_view.load()),
+      blob_view(other.blob_view.load()), blob_size(other.blob_size.load()), dictionary_count(other.dictionary_count.load()),
+      owner(std::move(other.owner)), slots(std::move(other.slots)) {
+    other.count = 0;
+    other.dictionary_count = 0;
+    other.slots.clear();
+    other.refresh_views();
+}
+
+ColumnStorage& ColumnStorage::operator=(const ColumnStorage& other) {
+    if (this != &other) {
+        *this = ColumnStorage(other);
+    }
+    return *this;
+}
+
+ColumnStorage& ColumnStorage::operator=(ColumnStorage&& other) noexcept {
+    if (this != &other) {
+        type = other.type;
+        dictionary = other.dictionary;
+        inline_width = other.inline_width;
+        count = other.count.load();
+        int32_values = std::move(other.int32_values);
+        bool_values = std::move(other.bool_values);
+        offsets = std::move(other.offsets);
+        blob = std::move(other.blob);
+        int32_view = other.int32_view.load();
+        bool_view = other.bool_view.load();
+        offsets_view = other.offsets_view.load();
+        blob_view = other.blob_view.load();
+        blob_size = other.blob_size.load();
+        dictionary_count = other.dictionary_count.load();
+        owner = std::move(other.owner);
+        slots = std::move(other.slots);
+        other.count = 0;
+        other.dictionary_count = 0;
+        other.slots.clear();
+        other.refresh_views();
+    }
+    return *this;
+}
+
+void ColumnStorage::own() {
+    if (!owner) {
+        return;
+    }
+    size_t rows = count;
+    switch (type) {
+        case DataType::INT32: int32_values.assign(int32_view.load(), int32_view.load() + rows); break;
+        case DataType::BOOL: bool_values.assign(bool_view.load(), bool_view.load() + rows); break;
+        case DataType::STRING:
+        case DataType::BYTES:
+            if (dictionary) {
+                int32_values.assign(int32_view.load(), int32_view.load() + rows);
+                rows = dictionary_count;
+            }
+            if (inline_width == 0) {
+                offsets.assign(offsets_view.load(), offsets_view.load() + rows + 1);
+            }
+            blob.assign(blob_view.load(), blob_view.load() + blob_size);
+            break;
+    }
+    refresh_views();
+    // Readers may still be in the borrowed arrays.
+    Epoch::retire(std::move(owner));
+    owner.reset();
+}
+
+// Appends within capacity leave the arrays where they are, so they only
+// publish the new sizes; make_room re-points the views when arrays move.
+void ColumnStorage::refresh_views() {
+    int32_view.store(int32_values.data(), memory_order_release);
+    bool_view.store(bool_values.data(), memory_order_release);
+    offsets_view.store(offsets.empty() ? nullptr : offsets.data(), memory_order_release);
+    blob_view.store(blob.data(), memory_order_release);
+    blob_size.store(blob.size(), memory_order_release);
+}
+
+template <typename T>
+void ColumnStorage::make_room(vector<T>& values, size_t additional) {
+    size_t needed = values.size() + additional;
+    if (needed <= values.capacity()) {
+        return;
+    }
+    vector<T> larger;
+    larger.reserve(max(needed, values.capacity() * 2));
+    larger.assign(values.begin(), values.end());
+    values.swap(larger);
+    refresh_views();
+    if (larger.capacity() != 0) {
+        Epoch::retire(make_shared<const vector<T>>(std::move(larger)));
+    }
+}
+
+void ColumnStorage::reserve(size_t rows) {
+    own();
+    switch (type) {
+        case DataType::INT32: make_room(int32_values, rows - min(rows, int32_values.size())); break;
+        case DataType::BOOL: make_room(bool_values, rows - min(rows, bool_values.size())); break;
+        case DataType::STRING:
+        case DataType::BYTES:
+            if (dictionary) {
+                make_room(int32_values, rows - min(rows, int32_values.size()));
+            } else if (inline_width != 0) {
+                make_room(blob, rows * slot_bytes() - min(rows * slot_bytes(), blob.size()));
+            } else {
+                make_room(offsets, rows + 1 - min(rows + 1, offsets.size()));
+            }
+            break;
+    }
+}
+
+void ColumnStorage::reserve_additional(size_t rows, size_t blob_bytes) {
+    own();
+    switch (type) {
+        case DataType::INT32: make_room(int32_values, rows); break;
+        case DataType::BOOL: make_room(bool_values, rows); break;
+        case DataType::STRING:
+        case DataType::BYTES:
+            // A dictionary column stores repeated values once, so their bytes are reserved as they arrive.
+            if (dictionary) {
+                make_room(int32_values, rows);
+                break;
+            }
+            if (inline_width != 0) {
+                make_room(blob, rows * slot_bytes());
+                break;
+            }
+            make_room(offsets, rows);
+            make_room(blob, blob_bytes);
+            break;
+    }
+}
+
+void ColumnStorage::clear() {
+    count = 0;
+    owner.reset();
+    int32_values.clear();
+    bool_values.clear();
+    blob.clear();
+    offsets.clear();
+    slots.clear();
+    dictionary_count = 0;
+    if ((type == DataType::STRING || type == DataType::BYTES) && inline_width == 0) {
+        offsets.push_back(0);
+    }
+    refresh_views();
+}
+
+void ColumnStorage::truncate(size_t rows) {
+    own();
+    if (rows >= count) {
+        return;
+    }
+    switch (type) {
+        case DataType::INT32: int32_values.resize(rows); break;
+        case DataType::BOOL: bool_values.resize(rows); break;
+        case DataType::STRING:
+        case DataType::BYTES:
+            // Values stay in the dictionary so codes already handed out keep their meaning.
+            if (dictionary) {
+                int32_values.resize(rows);
+                break;
+            }
+            if (inline_width != 0) {
+                blob.resize(rows * slot_bytes());
+                break;
+            }
+            offsets.resize(rows + 1);
+            blob.resize(offsets.back());
+            break;
+    }
+    count = rows;
+    refresh_views();
+}
+
+void ColumnStorage::append(const ValueType& value) {
+    if (!DataTypeHelper::validate(value, type)) {
+        throw runtime_error("Type mismatch: expected " + DataTypeHelper::type_to_string(type));
+    }
+    switch (type) {
+        case DataType::INT32: append_int32(get<int32_t>(value)); break;
+        case DataType::BOOL: append_bool(get<bool>(value)); break;
+        case DataType::STRING: append_string(get<string>(value)); break;
+        case DataType::BYTES: append_bytes(get<vector<uint8_t>>(value)); break;
+    }
+}
+
+void ColumnStorage::append_int32(int32_t value) {
+    own();
+    make_room(int32_values, 1);
+    int32_values.push_back(value);
+    count.store(count + 1, memory_order_release);
+}
+
+void ColumnStorage::append_bool(bool value) {
+    own();
+    make_room(bool_values, 1);
+    bool_values.push_back(value ? 1 : 0);
+    count.store(count + 1, memory_order_release);
+}
+
+void ColumnStorage::append_string(string_view value) {
+    if (dictionary) {
+        append_code(encode(value));
+        return;
+    }
+    if (inline_width != 0) {
+        append_inline(value);
+        return;
+    }
+    own();
+    make_room(blob, value.size());
+    make_room(offsets, 1);
+    blob.insert(blob.end(), value.begin(), value.end());
+    offsets.push_back(blob.size());
+    blob_size.store(blob.size(), memory_order_release);
+    count.store(count + 1, memory_order_release);
+}
+
+void ColumnStorage::append_bytes(span<const uint8_t> value) {
+    if (dictionary || inline_width != 0) {
+        append_string(string_view(reinterpret_cast<const char*>(value.data()), value.size()));
+        return;
+    }
+    own();
+    make_room(blob, value.size());
+    make_room(offsets, 1);
+    blob.insert(blob.end(), value.begin(), value.end());
+    offsets.push_back(blob.size());
+    blob_size.store(blob.size(), memory_order_release);
+    count.store(count + 1, memory_order_release);
+}
+
+void ColumnStorage::append_from(const ColumnStorage& other) {
+    append_range_from(other, 0, other.size());
+}
+
+void ColumnStorage::append_range_from(const ColumnStorage& other, size_t first, size_t rows) {
+    if (other.type != type) {
+        throw runtime_error("Type mismatch: expected " + DataTypeHelper::type_to_string(type));
+    }
+    switch (type) {
+        case DataType::INT32: append_int32_values(span<const int32_t>(other.int32_data() + first, rows)); break;
+        case DataType::BOOL: append_bool_values(span<const uint8_t>(other.bool_data() + first, rows)); break;
+        case DataType::STRING:
+        case DataType::BYTES: {
+            if (inline_width != 0 && other.inline_width == inline_width) {
+                own();
+                const uint8_t* other_slots = other.blob_view.load(memory_order_acquire);
+                make_room(blob, rows * slot_bytes());
+                blob.insert(blob.end(), other_slots + first * slot_bytes(), other_slots + (first + rows) * slot_bytes());
+                blob_size.store(blob.size(), memory_order_release);
+                count.store(count + rows, memory_order_release);
+                break;
+            }
+            if (dictionary && other.dictionary && rows >= other.dictionary_size()) {
+                // Each of other's values is looked up once, the rest are code translations.
+                vector<int32_t> codes(other.dictionary_size(), -1);
+                const int32_t* other_codes = other.codes_data();
+                reserve_additional(rows);
+                for (size_t row = first; row < first + rows; ++row) {
+                    int32_t& code = codes[other_codes[row]];
+                    if (code < 0) {
+                        code = encode(other.get_dictionary_value(other_codes[row]));
+                    }
+                    append_code(code);
+                }
+                break;
+            }
+            if (dictionary || other.dictionary || inline_width != 0 || other.inline_width != 0) {
+                reserve_additional(rows);
+                for (size_t row = first; row < first + rows; ++row) {
+                    append_string(other.get_string(row));
+                }
+                break;
+            }
+            own();
+            const uint64_t* other_offsets = other.offsets_view.load(memory_order_acquire);
+            const uint8_t* other_blob = other.blob_view.load(memory_order_acquire);
+            uint64_t begin = other_offsets[first];
+            uint64_t base = blob.size();
+            make_room(blob, other_offsets[first + rows] - begin);
+            make_room(offsets, rows);
+            blob.insert(blob.end(), other_blob + begin, other_blob + other_offsets[first + rows]);
+            for (size_t row = first + 1; row <= first + rows; ++row) {
+                offsets.push_back(base + other_offsets[row] - begin);
+            }
+            blob_size.store(blob.size(), memory_order_release);
+            count.store(count + rows, memory_order_release);
+            break;
+        }
+    }
+}
+
+void ColumnStorage::append_int32_values(span<const int32_t> values) {
+    own();
+    make_room(int32_values, values.size());
+    int32_values.insert(int32_values.end(), values.begin(), values.end());
+    count.store(count + values.size(), memory_order_release);
+}
+
+void ColumnStorage::append_bool_values(span<const uint8_t> values) {
+    own();
+    make_room(bool_values, values.size());
+    bool_values.insert(bool_values.end(), values.begin(), values.end());
+    count.store(count + values.size(), memory_order_release);
+}
+
+void ColumnStorage::append_blob_values(span<const uint64_t> value_offsets, span<const uint8_t> data) {
+    own();
+    if (value_offsets.empty()) {
+        return;
+    }
+    if (dictionary || inline_width != 0) {
+        reserve_additional(value_offsets.size() - 1);
+        for (size_t i = 1; i < value_offsets.size(); ++i) {
+            append_string(string_view(reinterpret_cast<const char*>(data.data()) + value_offsets[i - 1], value_offsets[i] - value_offsets[i - 1]));
+        }
+        return;
+    }
+    uint64_t base = blob.size();
+    make_room(blob, data.size());
+    make_room(offsets, value_offsets.size() - 1);
+    blob.insert(blob.end(), data.begin(), data.end());
+    for (size_t i = 1; i < value_offsets.size(); ++i) {
+        offsets.push_back(base + value_offsets[i]);
+    }
+    blob_size.store(blob.size(), memory_order_release);
+    count.store(count + value_offsets.size() - 1, memory_order_release);
+}
+
+void ColumnStorage::assign_int32_values(vector<int32_t> values) {
+    clear();
+    count = values.size();
+    int32_values = std::move(values);
+    refresh_views();
+}
+
+void ColumnStorage::assign_bool_values(vector<uint8_t> values) {
+    clear();
+    count = values.size();
+    bool_values = std::move(values);
+    refresh_views();
+}
+
+void ColumnStorage::assign_blob_values(vector<uint64_t> value_offsets, vector<uint8_t> data) {
+    if (value_offsets.empty() || value_offsets.front() != 0 || value_offsets.back() != data.size()) {
+        throw runtime_error("Invalid offsets for " + DataTypeHelper::type_to_string(type) + " column");
+    }
+    clear();
+    count = value_offsets.size() - 1;
+    offsets = std::move(value_offsets);
+    blob = std::move(data);
+    refresh_views();
+}
+
+void ColumnStorage::borrow_int32_values(const int32_t* values, size_t rows, shared_ptr<const void> memory) {
+    clear();
+    count = rows;
+    int32_view = values;
+    owner = std::move(memory);
+}
+
+void ColumnStorage::borrow_bool_values(const uint8_t* values, size_t rows, shared_ptr<const void> memory) {
+    clear();
+    count = rows;
+    bool_view = values;
+    owner = std::move(memory);
+}
+
+void ColumnStorage::borrow_blob_values(const uint64_t* value_offsets, size_t rows, const uint8_t* data, size_t size, shared_ptr<const void> memory) {
+    if (value_offsets[0] != 0 || value_offsets[rows] != size) {
+        throw runtime_error("Invalid offsets for " + DataTypeHelper::type_to_string(type) + " column");
+    }
+    clear();
+    count = rows;
+    offsets_view = value_offsets;
+    blob_view = data;
+    blob_size = size;
+    owner = std::move(memory);
+}
+
+void ColumnStorage::assign_dictionary(vector<uint64_t> value_offsets, vector<uint8_t> data, vector<int32_t> codes) {
+    if (!dictionary || value_offsets.empty() || value_offsets.front() != 0 || value_offsets.back() != data.size()) {
+        throw runtime_error("Invalid dictionary for " + DataTypeHelper::type_to_string(type) + " column");
+    }
+    size_t values = value_offsets.size() - 1;
+    for (int32_t code : codes) {
+        if (code < 0 || static_cast<size_t>(code) >= values) {
+            throw runtime_error("Dictionary code out of range: " + to_string(code));
+        }
+    }
+    clear();
+    count = codes.size();
+    dictionary_count = values;
+    int32_values = std::move(codes);
+    offsets = std::move(value_offsets);
+    blob = std::move(data);
+    refresh_views();
+    rebuild_slots();
+}
+
+void ColumnStorage::borrow_dictionary(const uint64_t* value_offsets, size_t values, const uint8_t* data, size_t size,
+                                      const int32_t* codes, size_t rows, shared_ptr<const void> memory) {
+    if (!dictionary || value_offsets[0] != 0 || value_offsets[values] != size) {
+        throw runtime_error("Invalid dictionary for " + DataTypeHelper::type_to_string(type) + " column");
+    }
+    clear();
+    count = rows;
+    dictionary_count = values;
+    int32_view = codes;
+    offsets_view = value_offsets;
+    blob_view = data;
+    blob_size = size;
+    owner = std::move(memory);
+    rebuild_slots();
+}
+
+void ColumnStorage::assign_inline_values(vector<uint8_t> slots) {
+    if (inline_width == 0 || slots.size() % slot_bytes() != 0) {
+        throw runtime_error("Invalid inline slots for " + DataTypeHelper::type_to_string(type) + " column");
+    }
+    for (size_t slot = 0; slot < slots.size(); slot += slot_bytes()) {
+        if (slots[slot] > inline_width) {
+            throw runtime_error("Inline value longer than its slot");
+        }
+    }
+    clear();
+    count = slots.size() / slot_bytes();
+    blob = std::move(slots);
+    refresh_views();
+}
+
+void ColumnStorage::borrow_inline_values(const uint8_t* slots, size_t rows, shared_ptr<const void> memory) {
+    if (inline_width == 0) {
+        throw runtime_error("Invalid inline slots for " + DataTypeHelper::type_to_string(type) + " column");
+    }
+    clear();
+    count = rows;
+    blob_view = slots;
+    blob_size = rows * slot_bytes();
+    owner = std::move(memory);
+}
+
+// Slot where `value` is, or the free slot where it would go.
+size_t ColumnStorage::find_slot(string_view value) const {
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash<string_view>{}(value) & mask;; slot = (slot + 1) & mask) {
+        if (slots[slot] == 0 || get_dictionary_value(static_cast<int32_t>(slots[slot] - 1)) == value) {
+            return slot;
+        }
+    }
+}
+
+// Sized to stay at most half full until the dictionary doubles.
+void ColumnStorage::rebuild_slots() {
+    size_t size = 16;
+    while (size < 4 * (dictionary_count + 1)) {
+        size *= 2;
+    }
+    slots.assign(size, 0);
+    for (size_t code = 0; code < dictionary_count; ++code) {
+        slots[find_slot(get_dictionary_value(static_cast<int32_t>(code)))] = static_cast<uint32_t>(code + 1);
+    }
+}
+
+int32_t ColumnStorage::encode(string_view value) {
+    own();
+    if (2 * (dictionary_count + 1) > slots.size()) {
+        rebuild_slots();
+    }
+    size_t slot = find_slot(value);
+    if (slots[slot] != 0) {
+        return static_cast<int32_t>(slots[slot] - 1);
+    }
+    if (dictionary_count >= static_cast<size_t>(INT32_MAX)) {
+        throw runtime_error("Too many distinct values for a dictionary column");
+    }
+    make_room(blob, value.size());
+    make_room(offsets, 1);
+    blob.insert(blob.end(), value.begin(), value.end());
+    offsets.push_back(blob.size());
+    blob_size.store(blob.size(), memory_order_release);
+    int32_t code = static_cast<int32_t>(dictionary_count);
+    dictionary_count.store(dictionary_count + 1, memory_order_release);
+    slots[slot] = static_cast<uint32_t>(code) + 1;
+    return code;
+}
+
+void ColumnStorage::append_inline(string_view value) {
+    if (value.size() > inline_width) {
+        throw runtime_error("Value of " + to_string(value.size()) + " bytes does not fit an inline slot of " + to_string(inline_width));
+    }
+    own();
+    make_room(blob, slot_bytes());
+    blob.push_back(static_cast<uint8_t>(value.size()));
+    blob.insert(blob.end(), value.begin(), value.end());
+    blob.resize(blob.size() + inline_width - value.size());
+    blob_size.store(blob.size(), memory_order_release);
+    count.store(count + 1, memory_order_release);
+}
+
+void ColumnStorage::append_code(int32_t code) {
+    make_room(int32_values, 1);
+    int32_values.push_back(code);
+    count.store(count + 1, memory_order_release);
+}
+
+ValueType ColumnStorage::get_value(size_t row) const {
+    switch (type) {
+        case DataType::INT32: return get_int32(row);
+        case DataType::BOOL: return get_bool(row);
+        case DataType::STRING: return string(get_string(row));
+        case DataType::BYTES: {
+            auto bytes = get_bytes(row);
+            return vector<uint8_t>(bytes.begin(), bytes.end());
+        }
+    }
+    throw runtime_error("Unsupported column type.");
+}
+
+void ColumnStorage::read_value(size_t row, ValueType& out) const {
+    switch (type) {
+        case DataType::INT32:
+            out = get_int32(row);
+            break;
+        case DataType::BOOL:
+            out = get_bool(row);
+            break;
+        case DataType::STRING:
+            if (auto* existing = get_if<string>(&out)) {
+                existing->assign(get_string(row));
+            } else {
+                out = string(get_string(row));
+            }
+            break;
+        case DataType::BYTES: {
+            auto bytes = get_bytes(row);
+            if (auto* existing = get_if<vector<uint8_t>>(&out)) {
+                existing->assign(bytes.begin(), bytes.end());
+            } else {
+                out = vector<uint8_t>(bytes.begin(), bytes.end());
+            }
+            break;
+        }
+    }
+}
+
+string_view ColumnStorage::get_string(size_t row) const {
+    if (dictionary) {
+        return get_dictionary_value(int32_view.load(memory_order_acquire)[row]);
+    }
+    if (inline_width != 0) {
+        const uint8_t* slot = blob_view.load(memory_order_acquire) + row * slot_bytes();
+        return string_view(reinterpret_cast<const char*>(slot) + 1, slot[0]);
+    }
+    const uint64_t* value_offsets = offsets_view.load(memory_order_acquire);
+    const char* data = reinterpret_cast<const char*>(blob_view.load(memory_order_acquire));
+    return string_view(data + value_offsets[row], value_offsets[row + 1] - value_offsets[row]);
+}
+
+span<const uint8_t> ColumnStorage::get_bytes(size_t row) const {
+    if (dictionary || inline_width != 0) {
+        string_view value = get_string(row);
+        return span<const uint8_t>(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+    }
+    const uint64_t* value_offsets = offsets_view.load(memory_order_acquire);
+    const uint8_t* data = blob_view.load(memory_order_acquire);
+    return span<const uint8_t>(data + value_offsets[row], value_offsets[row + 1] - value_offsets[row]);
+}
+
+string_view ColumnStorage::get_dictionary_value(int32_t code) const {
+    const uint64_t* value_offsets = offsets_view.load(memory_order_acquire);
+    const char* data = reinterpret_cast<const char*>(blob_view.load(memory_order_acquire));
+    return string_view(data + value_offsets[code], value_offsets[code + 1] - value_offsets[code]);
+}
+
+optional<int32_t> ColumnStorage::find_code(string_view value) const {
+    if (!dictionary || slots.empty()) {
+        return nullopt;
+    }
+    size_t slot = find_slot(value);
+    if (slots[slot] == 0) {
+        return nullopt;
+    }
+    return static_cast<int32_t>(slots[slot] - 1);
+}
+
+span<const uint64_t> ColumnStorage::get_offsets() const {
+    const uint64_t* value_offsets = offsets_view.load(memory_order_acquire);
+    return span<const uint64_t>(value_offsets, value_offsets ? (dictionary ? dictionary_size() : size()) + 1 : 0);
+}
+
+span<const uint8_t> ColumnStorage::get_blob() const {
+    return span<const uint8_t>(blob_view.load(memory_order_acquire), blob_size.load(memory_order_acquire));
+}
+
+size_t ColumnStorage::memory_usage() const {
+    return int32_values.capacity() * sizeof(int32_t)
+         + bool_values.capacity() * sizeof(uint8_t)
+         + offsets.capacity() * sizeof(uint64_t)
+         + blob.capacity()
+         + slots.capacity() * sizeof(uint32_t);
+}
+
+// The same arrays own() would copy.
+size_t ColumnStorage::borrowed_bytes() const {
+    if (!owner) {
+        return 0;
+    }
+    size_t rows = size();
+    switch (type) {
+        case DataType::INT32: return rows * sizeof(int32_t);
+        case DataType::BOOL: return rows;
+        case DataType::STRING:
+        case DataType::BYTES: {
+            size_t bytes = blob_size.load(memory_order_acquire);
+            if (dictionary) {
+                bytes += rows * sizeof(int32_t);
+                rows = dictionary_count.load(memory_order_acquire);
+            }
+            if (inline_width == 0) {
+                bytes += (rows + 1) * sizeof(uint64_t);
+            }
+            return bytes;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "cursor.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+ScanPlan plan_scan(const SelectStatement& select, const Table& table, span<const ValueType> parameters) {
+    ScanPlan plan;
+    auto lock = table.lock_shared();
+    if (select.where) {
+        plan.predicate = Expression::compile(select.where, table, parameters);
+    }
+    plan.path = QueryPlanner::choose_access_path(select, table, parameters);
+    return plan;
+}
+
+RowScanner::RowScanner(const Table& table, Expression predicate, AccessPath path, size_t rows, ThreadPool* pool)
+    : table(&table), predicate(std::move(predicate)), path(std::move(path)), rows(rows), pool(pool) {
+    // A LIMIT with no sort to do usually stops within the first batches, long
+    // before a window would.
+    bool stops_early = this->path.limit && !this->path.order_ordinal;
+    if (this->pool && (this->pool->size() == 1 || this->path.method != AccessMethod::FULL_SCAN || stops_early || rows <= MORSEL_ROWS)) {
+        this->pool = nullptr;
+    }
+}
+
+bool RowScanner::next(size_t& row) {
+    if (done) {
+        return false;
+    }
+    if (!started) {
+        started = true;
+        if (predicate.get_constant() == false) {
+            done = true;
+            return false;
+        }
+        if (path.method == AccessMethod::HASH_LOOKUP) {
+            done = true;
+            optional<size_t> found;
+            {
+                auto lock = table->lock_shared();
+                found = table->find_row(path.ordinal, path.key);
+            }
+            if (found && *found < rows && predicate.matches(*found)) {
+                row = *found;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    if (path.method == AccessMethod::INDEX_RANGE) {
+        while (chunk_position < chunk.size() || next_chunk()) {
+            row = chunk[chunk_position++];
+            if (predicate.matches(row)) {
+                return true;
+            }
+        }
+        done = true;
+        return false;
+    }
+
+    if (pool) {
+        while (morsel_index == morsels.size() || morsel_position == morsels[morsel_index].size()) {
+            if (morsel_index + 1 < morsels.size()) {
+                ++morsel_index;
+                morsel_position = 0;
+            } else if (!next_window()) {
+                done = true;
+                return false;
+            }
+        }
+        row = morsels[morsel_index][morsel_position++];
+        return true;
+    }
+
+    while (mask == 0) {
+        if (++word * 64 >= batch_count && !next_batch()) {
+            done = true;
+            return false;
+        }
+        mask = bits[word];
+    }
+    row = batch_begin + word * 64 + countr_zero(mask);
+    mask &= mask - 1;
+    return true;
+}
+
+bool RowScanner::next_batch() {
+    size_t begin = batch_begin + batch_count;
+    if (begin >= rows) {
+        return false;
+    }
+    batch_begin = begin;
+    batch_count = min(PredicateNode::BATCH_ROWS, rows - begin);
+    predicate.matches_batch(batch_begin, batch_count, bits);
+    word = 0;
+    return true;
+}
+
+bool RowScanner::next_window() {
+    size_t begin = window_end;
+    if (begin >= rows) {
+        return false;
+    }
+    size_t count = min(pool->size() * WINDOW_MORSELS_PER_THREAD, (rows - begin + MORSEL_ROWS - 1) / MORSEL_ROWS);
+    morsels.resize(count);
+    window_end = min(rows, begin + count * MORSEL_ROWS);
+    // Each morsel fills only its own vector, so the window keeps row order.
+    pool->run(count, [this, begin](size_t morsel) {
+        vector<size_t>& matches = morsels[morsel];
+        matches.clear();
+        uint64_t morsel_bits[PredicateNode::BATCH_ROWS / 64];
+        size_t end = min(rows, begin + (morsel + 1) * MORSEL_ROWS);
+        for (size_t first = begin + morsel * MORSEL_ROWS; first < end; first += PredicateNode::BATCH_ROWS) {
+            size_t batch = min(PredicateNode::BATCH_ROWS, end - first);
+            predicate.matches_batch(first, batch, morsel_bits);
+            for (size_t w = 0; w * 64 < batch; ++w) {
+                for (uint64_t bits = morsel_bits[w]; bits != 0; bits &= bits - 1) {
+                    matches.push_back(first + w * 64 + countr_zero(bits));
+                }
+            }
+        }
+    });
+    morsel_index = 0;
+    morsel_position = 0;
+    return true;
+}
+
+bool RowScanner::next_chunk() {
+    chunk.clear();
+    chunk_position = 0;
+    if (range_exhausted) {
+        return false;
+    }
+    auto lock = table->lock_shared();
+    // An index that provides the ORDER BY order is walked in the requested direction.
+    bool descending = path.presorted && path.descending;
+    if (!last_entry || table->get_version() != range_version) {
+        if (!table->has_ordered_index(path.ordinal)) {
+            throw runtime_error("No ordered index on column: " + table->get_schema()->get_column(path.ordinal).get_name());
+        }
+        // Writers changed the index since the last chunk: seek back to the
+        // last entry's key and skip what was already produced.
+        KeyRange remaining = path.range;
+        if (last_entry) {
+            if (descending) {
+                remaining.upper = last_entry->first;
+            } else {
+                remaining.lower = last_entry->first;
+            }
+        }
+        range = table->get_ordered_index(path.ordinal).range(remaining, descending);
+        range_version = table->get_version();
+    }
+
+    bool skipping = last_entry.has_value();
+    size_t row;
+    int32_t key;
+    while (chunk.size() < INDEX_CHUNK_ROWS) {
+        if (!range.next(row, key)) {
+            range_exhausted = true;
+            break;
+        }
+        // Rows committed after the snapshot are left out.
+        if (row >= rows) {
+            continue;
+        }
+        if (skipping) {
+            // Entries are ordered by (key, row), so the produced ones come first.
+            pair<int32_t, size_t> entry(key, row);
+            if (descending ? entry >= *last_entry : entry <= *last_entry) {
+                continue;
+            }
+            skipping = false;
+        }
+        chunk.push_back(row);
+        last_entry = pair<int32_t, size_t>(key, row);
+    }
+    return !chunk.empty();
+}
+
+Cursor::Cursor(shared_ptr<const Table> table, Expression predicate, AccessPath path, vector<size_t> projection, shared_ptr<ThreadPool> pool)
+    : table(std::move(table)), pool(std::move(pool)), projection(std::move(projection)), limit(path.limit),
+      scanner(*this->table, predicate, path, this->table->get_row_count(), this->pool.get()) {
+    sorted = path.order_ordinal && !path.presorted;
+    if (sorted) {
+        sorted_rows = this->table->select_row_ids(predicate, path, this->pool.get());
+    }
+}
+
+Cursor Cursor::open(const SelectStatement& select, shared_ptr<const Table> table, span<const ValueType> parameters, shared_ptr<ThreadPool> pool) {
+    if (!select.items.empty()) {
+        throw InvalidQueryException("A cursor reads table rows; aggregate queries return batches through query_batches");
+    }
+    if (select.join) {
+        throw InvalidQueryException("A cursor reads one table's rows; joins return batches through query_batches");
+    }
+    shared_ptr<const Schema> schema = table->get_schema();
+    vector<size_t> projection;
+    if (select.column_names.empty()) {
+        for (size_t i = 0; i < schema->size(); ++i) {
+            projection.push_back(i);
+        }
+    } else {
+        for (const auto& column_name : select.column_names) {
+            projection.push_back(schema->get_column_ordinal(column_name));
+        }
+    }
+
+    ScanPlan scan = plan_scan(select, *table, parameters);
+    return Cursor(std::move(table), std::move(scan.predicate), std::move(scan.path), std::move(projection), std::move(pool));
+}
+
+bool Cursor::next() {
+    if (limit && produced >= *limit) {
+        return false;
+    }
+    if (sorted) {
+        if (produced >= sorted_rows.size()) {
+            return false;
+        }
+        row = sorted_rows[produced];
+    } else if (!scanner.next(row)) {
+        return false;
+    }
+    ++produced;
+    return true;
+}
@@ -24,3 +24,30 @@ string DataTypeHelper::type_to_string(DataType type) {
         default: return "unknown";
     }
 }
+
+string DataTypeHelper::to_literal(const ValueType& value) {
+    switch (type_of(value)) {
+        case DataType::INT32: return to_string(get<int32_t>(value));
+        case DataType::BOOL: return get<bool>(value) ? "true" : "false";
+        case DataType::STRING: {
+            string literal = "'";
+            for (char c : get<string>(value)) {
+                literal += c;
+                if (c == '\'') {
+                    literal += c;
+                }
+            }
+            return literal + "'";
+        }
+        case DataType::BYTES: {
+            static const char DIGITS[] = "0123456789abcdef";
+            string literal = "0x";
+            for (uint8_t byte : get<vector<uint8_t>>(value)) {
+                literal += DIGITS[byte >> 4];
+                literal += DIGITS[byte & 15];
+            }
+            return literal;
+        }
+    }
+    return "";
+}
@@ -1,34 +1,253 @@
 #include "database.h"
 
+#include <filesystem>
+#include <sstream>
+#include <thread>
 #include <iostream>
 
+#include "exceptions.h"
 #include "serializer.h"
 
-void Database::load_from_file(const string& filepath) {
-    ifstream file(filepath, ios::binary);
-    if (!file.is_open()) {
-        throw runtime_error("Failed to open file: " + filepath);
-    }
+Database::Database() {
+    set_scan_threads(thread::hardware_concurrency());
+    executor.set_metrics(metrics);
+}
 
+void Database::load_from_file(const string& filepath, bool verify_checksums) {
     Serializer serializer;
-    tables = serializer.load(file);
-    file.close();
+    auto loaded = serializer.map(filepath, verify_checksums);
+    for (auto& [name, table] : loaded) {
+        table->set_log_lsn(serializer.get_log_sequence_number());
+    }
+    metrics->snapshots.reads.add();
+    metrics->snapshots.bytes_read.add(filesystem::file_size(filepath));
+    unique_lock<shared_mutex> lock(catalog_mutex);
+    tables = std::move(loaded);
+    checkpoint_directory.clear();
+    attach_log();
+}
+
+void Database::load_from_directory(const string& directory, bool verify_checksums) {
+    unordered_map<string, shared_ptr<Table>> loaded;
+    for (const auto& entry : filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() != ".snap") {
+            continue;
+        }
+        Serializer serializer;
+        for (auto& [name, table] : serializer.map(entry.path().string(), verify_checksums)) {
+            table->set_log_lsn(serializer.get_log_sequence_number());
+            loaded[name] = table;
+        }
+        metrics->snapshots.reads.add();
+        metrics->snapshots.bytes_read.add(entry.file_size());
+    }
+    unique_lock<shared_mutex> lock(catalog_mutex);
+    tables = std::move(loaded);
+    checkpoint_directory = directory;
+    attach_log();
 }
 
 void Database::save_to_file(const string& filepath) {
-    ofstream file(filepath, ios::binary);
+    // Tables loaded from `filepath` may still be reading from its mapping, so the
+    // snapshot is written beside it and renamed over it instead of truncating it.
+    auto start = chrono::steady_clock::now();
+    string temporary = filepath + ".tmp";
+    ofstream file(temporary, ios::binary);
     if (!file.is_open()) {
-        throw runtime_error("Failed to open file: " + filepath);
+        throw runtime_error("Failed to open file: " + temporary);
     }
 
     Serializer serializer;
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    vector<shared_lock<shared_mutex>> table_locks;
+    for (const auto& [name, table] : tables) {
+        table_locks.push_back(table->lock_published());
+    }
+    // With every table held, no record can be logged that the snapshot lacks.
+    uint64_t lsn = log ? log->get_last_lsn() : 0;
+    for (const auto& [name, table] : tables) {
+        lsn = max(lsn, table->get_log_lsn());
+    }
+    serializer.set_log_sequence_number(lsn);
     serializer.save(tables, file);
+    size_t table_count = tables.size();
+    table_locks.clear();
+    lock.unlock();
+    auto bytes = static_cast<uint64_t>(file.tellp());
     file.close();
+    if (!file) {
+        throw runtime_error("Failed to write file: " + temporary);
+    }
+    filesystem::rename(temporary, filepath);
+    metrics->snapshots.records.add(table_count);
+    metrics->snapshots.writes.add();
+    metrics->snapshots.bytes_written.add(bytes);
+    metrics->snapshots.latency.record(chrono::steady_clock::now() - start);
+}
+
+void Database::open_log(const string& filepath, SyncPolicy policy, chrono::microseconds group_window) {
+    unique_lock<shared_mutex> lock(catalog_mutex);
+    log = make_shared<WriteAheadLog>(filepath, policy, group_window, [this](const LogRecord& record) {
+        WriteAheadLog::apply(record, tables);
+    });
+    attach_log();
+    executor.set_log(log);
+}
+
+void Database::attach_log() {
+    if (!log) {
+        return;
+    }
+    for (auto& [name, table] : tables) {
+        log->advance_lsn(table->get_log_lsn());
+        table->set_log(log);
+    }
+}
+
+void Database::checkpoint(const string& filepath) {
+    // Records logged before the rotation are retired and the snapshot taken
+    // after it covers them; records logged meanwhile stay in the new log.
+    shared_ptr<WriteAheadLog> rotated;
+    bool retired = false;
+    {
+        shared_lock<shared_mutex> lock(catalog_mutex);
+        rotated = log;
+        retired = log && log->rotate();
+    }
+    save_to_file(filepath);
+    if (retired) {
+        rotated->discard_retired();
+    }
+}
+
+void Database::start_checkpointer(const string& directory, CheckpointOptions options) {
+    stop_checkpointer();
+    checkpointer = make_unique<Checkpointer>(*this, directory, options);
+    checkpointer->start();
+}
+
+void Database::stop_checkpointer() {
+    if (checkpointer) {
+        checkpointer->stop();
+    }
+}
+
+void Database::set_scan_threads(size_t threads) {
+    executor.set_scan_pool(threads > 1 ? make_shared<ThreadPool>(threads) : nullptr);
+}
+
+size_t Database::get_scan_threads() const {
+    shared_ptr<ThreadPool> pool = executor.get_scan_pool();
+    return pool ? pool->size() : 1;
+}
+
+vector<pair<string, shared_ptr<Table>>> Database::list_tables() const {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    return vector<pair<string, shared_ptr<Table>>>(tables.begin(), tables.end());
+}
+
+vector<pair<string, shared_ptr<Table>>> Database::begin_checkpoint(shared_ptr<WriteAheadLog>& rotated) {
+    // CREATE TABLE logs and publishes the table under the exclusive catalog
+    // lock, so it cannot fall between the rotation and the listing.
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    rotated = log && log->rotate() ? log : nullptr;
+    return vector<pair<string, shared_ptr<Table>>>(tables.begin(), tables.end());
+}
+
+string Database::get_checkpoint_directory() const {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    return checkpoint_directory;
 }
 
-void Database::execute(const string& query) {
-    QueryExecutor executor;
-    return executor.execute(query, tables);
+shared_ptr<WriteAheadLog> Database::get_log() const {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    return log;
+}
+
+static StatementKind statement_kind(const Statement& statement) {
+    if (holds_alternative<CreateTableStatement>(statement)) {
+        return StatementKind::CREATE_TABLE;
+    }
+    if (holds_alternative<CreateIndexStatement>(statement)) {
+        return StatementKind::CREATE_INDEX;
+    }
+    if (holds_alternative<InsertStatement>(statement)) {
+        return StatementKind::INSERT;
+    }
+    return holds_alternative<SelectStatement>(statement) ? StatementKind::SELECT : StatementKind::EXPLAIN;
+}
+
+QueryResult Database::execute(const string& query) {
+    shared_ptr<const Statement> statement;
+    try {
+        statement = executor.parse(query);
+    } catch (...) {
+        metrics->parse_failures.add();
+        throw;
+    }
+    return metrics->time_statement(statement_kind(*statement), [this, &statement] { return execute_statement(*statement); });
+}
+
+QueryResult Database::execute_statement(const Statement& statement) {
+    if (holds_alternative<CreateTableStatement>(statement)) {
+        unique_lock<shared_mutex> lock(catalog_mutex);
+        QueryResult result = executor.execute(statement, tables);
+        if (!result.is_ok()) {
+            throw InvalidQueryException(result.get_error());
+        }
+        return result;
+    }
+
+    // Other statements only need their own tables. Running them outside the
+    // catalog lock keeps one that waits for a table lock from holding up
+    // CREATE TABLE and, behind it, every other statement.
+    const auto* select = get_if<SelectStatement>(&statement);
+    if (const auto* explain = get_if<ExplainStatement>(&statement)) {
+        select = &explain->select;
+    }
+    vector<string> table_names;
+    if (select) {
+        table_names.push_back(select->table_name);
+        if (select->join) {
+            table_names.push_back(select->join->table_name);
+        }
+    } else if (const auto* insert = get_if<InsertStatement>(&statement)) {
+        table_names.push_back(insert->table_name);
+    } else {
+        table_names.push_back(get<CreateIndexStatement>(statement).table_name);
+    }
+    unordered_map<string, shared_ptr<Table>> scope;
+    for (const string& table_name : table_names) {
+        if (shared_ptr<Table> table = get_table(table_name)) {
+            scope.emplace(table_name, std::move(table));
+        }
+    }
+    QueryResult result = executor.execute(statement, scope);
+    if (!result.is_ok()) {
+        throw InvalidQueryException(result.get_error());
+    }
+    return result;
+}
+
+PreparedStatement Database::prepare(const string& query) {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    return executor.prepare(query, tables);
+}
+
+Cursor Database::query(const string& query) {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    return executor.query(query, tables);
+}
+
+ExecutionPlan Database::query_batches(const string& query) {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    return executor.query_batches(query, tables);
+}
+
+shared_ptr<Table> Database::get_table(const string& name) const {
+    shared_lock<shared_mutex> lock(catalog_mutex);
+    auto it = tables.find(name);
+    return it == tables.end() ? nullptr : it->second;
 }
 
 unordered_map<string, shared_ptr<Table>>& Database::get_tables() {
@@ -37,7 +256,9 @@ unordered_map<string, shared_ptr<Table>>& Database::get_tables() {
 
 
 void Database::set_tables(unordered_map<string, shared_ptr<Table>> new_tables) {
+    unique_lock<shared_mutex> lock(catalog_mutex);
     tables = std::move(new_tables);
+    attach_log();
     cout << "Tables set in database: ";
     for (const auto& [name, _] : tables) {
         cout << name << " ";
@@ -45,4 +266,31 @@ void Database::set_tables(unordered_map<string, shared_ptr<Table>> new_tables) {
     cout << endl;
 }
 
-
+string Database::export_metrics() const {
+    ostringstream out;
+    metrics->write_text(out);
+    vector<pair<string, shared_ptr<Table>>> listed;
+    shared_ptr<WriteAheadLog> current_log;
+    {
+        shared_lock<shared_mutex> lock(catalog_mutex);
+        listed.assign(tables.begin(), tables.end());
+        current_log = log;
+    }
+    out << "# TYPE imdb_table_rows gauge\n";
+    for (const auto& [name, table] : listed) {
+        out << "imdb_table_rows{table=\"" << name << "\"} " << table->get_row_count() << "\n";
+    }
+    out << "# TYPE imdb_table_bytes gauge\n";
+    for (const auto& [name, table] : listed) {
+        TableMemory memory = table->memory_breakdown();
+        string labels = "{table=\"" + name;
+        out << "imdb_table_bytes" << labels << "\",part=\"columns\"} " << memory.column_bytes << "\n";
+        out << "imdb_table_bytes" << labels << "\",part=\"strings\"} " << memory.string_bytes << "\n";
+        out << "imdb_table_bytes" << labels << "\",part=\"indexes\"} " << memory.index_bytes << "\n";
+        out << "imdb_table_bytes" << labels << "\",part=\"mapped\"} " << memory.mapped_bytes << "\n";
+    }
+    if (current_log) {
+        MetricsRegistry::write_io(out, "imdb_log", "imdb_log_sync_latency_us", current_log->get_io_metrics());
+    }
+    return out.str();
+}
@@ -0,0 +1,174 @@
+#include "epoch.h"
+
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// One cache line per guard so readers pinning at once do not contend.
+struct alignas(64) Epoch::Slot {
+    atomic<uint64_t> epoch{numeric_limits<uint64_t>::max()};
+};
+
+namespace {
+
+constexpr uint64_t FREE_SLOT = numeric_limits<uint64_t>::max();
+
+// Slots are never freed, so guards and collectors can walk the blocks without locks.
+struct SlotBlock {
+    Epoch::Slot slots[Epoch::SLOTS_PER_BLOCK];
+    atomic<SlotBlock*> next{nullptr};
+};
+
+SlotBlock first_block;
+atomic<size_t> block_count{1};
+atomic<uint64_t> global_epoch{1};
+// Guards held right now; while there are none, retired memory is freed at once.
+atomic<size_t> active_guards{0};
+
+mutex retired_mutex;
+vector<pair<uint64_t, shared_ptr<const void>>> retired;
+atomic<size_t> retired_count{0};
+// Set by every collect call; whoever holds retired_mutex passes over the
+// slots again until it finds the flag clear after unlocking.
+atomic<bool> rescan{false};
+
+// The slot this thread released last; usually free again when it pins next.
+thread_local Epoch::Slot* slot_hint = nullptr;
+
+bool try_pin(Epoch::Slot& slot, uint64_t epoch) {
+    uint64_t expected = FREE_SLOT;
+    return slot.epoch.compare_exchange_strong(expected, epoch);
+}
+
+} // namespace
+
+// Pinning stores the epoch and counts the guard, then fences; retire and
+// collect fence and then read the count and the slots. So either they see the
+// guard, or the reader's later loads see every pointer published before the
+// retirement and never reach the old memory. A new block is linked before any
+// of its slots is pinned, so collect walks every slot that can be.
+Epoch::Guard::Guard() : slot(nullptr) {
+    uint64_t epoch = global_epoch.load();
+    if (slot_hint && try_pin(*slot_hint, epoch)) {
+        slot = slot_hint;
+    }
+    for (SlotBlock* block = &first_block; !slot; block = block->next.load(memory_order_acquire)) {
+        for (Slot& candidate : block->slots) {
+            if (try_pin(candidate, epoch)) {
+                slot = &candidate;
+                break;
+            }
+        }
+        if (!slot && !block->next.load(memory_order_acquire)) {
+            // Every slot is taken: link another block, or use the one a racing guard linked.
+            auto added = make_unique<SlotBlock>();
+            SlotBlock* expected = nullptr;
+            if (block->next.compare_exchange_strong(expected, added.get())) {
+                added.release();
+                block_count.fetch_add(1, memory_order_relaxed);
+            }
+        }
+    }
+    slot_hint = slot;
+    active_guards.fetch_add(1);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+Epoch::Guard::~Guard() {
+    release();
+}
+
+Epoch::Guard::Guard(Guard&& other) noexcept : slot(other.slot) {
+    other.slot = nullptr;
+}
+
+Epoch::Guard& Epoch::Guard::operator=(Guard&& other) noexcept {
+    if (this != &other) {
+        release();
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+void Epoch::Guard::release() {
+    if (!slot) {
+        return;
+    }
+    slot->epoch.store(FREE_SLOT, memory_order_release);
+    active_guards.fetch_sub(1, memory_order_release);
+    slot = nullptr;
+    // Pairs with the fence in collect: either this sees the memory retired,
+    // or the collector sees the slot free.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (retired_count.load(memory_order_relaxed) != 0) {
+        collect();
+    }
+}
+
+void Epoch::retire(shared_ptr<const void> memory) {
+    if (!memory) {
+        return;
+    }
+    uint64_t epoch = global_epoch.fetch_add(1);
+    // Same pairing as with the slots: a guard this does not see cannot reach `memory`.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (active_guards.load(memory_order_acquire) == 0) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(retired_mutex);
+        retired.emplace_back(epoch, std::move(memory));
+        retired_count.store(retired.size(), memory_order_relaxed);
+    }
+    collect();
+}
+
+void Epoch::collect() {
+    rescan.store(true);
+    while (rescan.load()) {
+        vector<shared_ptr<const void>> reclaimed;
+        {
+            unique_lock<mutex> lock(retired_mutex, try_to_lock);
+            if (!lock.owns_lock()) {
+                // The collector holding the lock finds `rescan` set once it
+                // unlocks, and passes over the slots again for this call.
+                return;
+            }
+            rescan.store(false);
+            if (retired.empty()) {
+                continue;
+            }
+            atomic_thread_fence(memory_order_seq_cst);
+            uint64_t oldest = FREE_SLOT;
+            for (const SlotBlock* block = &first_block; block; block = block->next.load(memory_order_acquire)) {
+                for (const Slot& entry : block->slots) {
+                    oldest = min(oldest, entry.epoch.load(memory_order_acquire));
+                }
+            }
+            // Memory retired at epoch e stays while a guard pinned e or earlier.
+            size_t kept = 0;
+            for (auto& [epoch, memory] : retired) {
+                if (epoch < oldest) {
+                    reclaimed.push_back(std::move(memory));
+                } else {
+                    retired[kept++] = {epoch, std::move(memory)};
+                }
+            }
+            retired.resize(kept);
+            retired_count.store(kept, memory_order_relaxed);
+        }
+        // `reclaimed` is freed here, outside the lock.
+    }
+}
+
+size_t Epoch::pending() {
+    lock_guard<mutex> lock(retired_mutex);
+    return retired.size();
+}
+
+size_t Epoch::capacity() {
+    return block_count.load(memory_order_relaxed) * SLOTS_PER_BLOCK;
+}
@@ -1,24 +1,558 @@
 #include "expression.h"
-#include <sstream>
-#include <stdexcept>
+#include "exceptions.h"
+#include "scan_kernels.h"
+#include "table.h"
 
-bool Expression::evaluate(const string& condition, const Row& row) {
-    istringstream iss(condition);
-    string column, op, value;
+#include <algorithm>
+#include <cstring>
 
-    iss >> column >> op >> value;
+namespace {
 
-    if (row.get_value(column).index() == 0) {
-        int32_t column_value = get<int32_t>(row.get_value(column));
-        int32_t compare_value = stoi(value);
+struct Compiled {
+    shared_ptr<const PredicateNode> node;
+    optional<bool> constant;
+};
 
-        if (op == "=") return column_value == compare_value;
-        if (op == "<") return column_value < compare_value;
-        if (op == ">") return column_value > compare_value;
-        if (op == "<=") return column_value <= compare_value;
-        if (op == ">=") return column_value >= compare_value;
-        if (op == "!=") return column_value != compare_value;
+struct Operand {
+    optional<size_t> ordinal;
+    DataType type = DataType::INT32;
+    ValueType value;
+};
+
+struct Int32Reader {
+    using Stored = int32_t;
+    static int32_t read(const ColumnStorage& storage, size_t row) { return storage.get_int32(row); }
+    static Stored store(const ValueType& value) { return get<int32_t>(value); }
+};
+
+struct BoolReader {
+    using Stored = bool;
+    static bool read(const ColumnStorage& storage, size_t row) { return storage.get_bool(row); }
+    static Stored store(const ValueType& value) { return get<bool>(value); }
+};
+
+// Strings and bytes share the offset+blob layout; string_view comparison
+// orders bytes as unsigned chars, matching vector<uint8_t> ordering.
+struct BlobReader {
+    using Stored = string;
+    static string_view read(const ColumnStorage& storage, size_t row) { return storage.get_string(row); }
+    static Stored store(const ValueType& value) {
+        if (const auto* text = get_if<string>(&value)) {
+            return *text;
+        }
+        const auto& bytes = get<vector<uint8_t>>(value);
+        return string(bytes.begin(), bytes.end());
+    }
+};
+
+template <ComparisonOp Op, typename L, typename R>
+inline bool apply(const L& lhs, const R& rhs) {
+    if constexpr (Op == ComparisonOp::EQ) return lhs == rhs;
+    else if constexpr (Op == ComparisonOp::NE) return lhs != rhs;
+    else if constexpr (Op == ComparisonOp::LT) return lhs < rhs;
+    else if constexpr (Op == ComparisonOp::LE) return lhs <= rhs;
+    else if constexpr (Op == ComparisonOp::GT) return lhs > rhs;
+    else return lhs >= rhs;
+}
+
+class BoolColumnNode : public PredicateNode {
+public:
+    explicit BoolColumnNode(const ColumnStorage& storage) : storage(storage) {}
+    bool evaluate(size_t row) const override { return storage.get_bool(row); }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        ScanKernels::equal_bool(storage.bool_data() + begin, count, true, bits);
+    }
+
+private:
+    const ColumnStorage& storage;
+};
+
+template <typename Reader, ComparisonOp Op>
+class ColumnConstantNode : public PredicateNode {
+public:
+    ColumnConstantNode(const ColumnStorage& storage, typename Reader::Stored constant)
+        : storage(storage), constant(std::move(constant)) {}
+    bool evaluate(size_t row) const override { return apply<Op>(Reader::read(storage, row), constant); }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        if constexpr (is_same_v<Reader, Int32Reader>) {
+            ScanKernels::compare_int32(storage.int32_data() + begin, count, Op, constant, bits);
+        } else if constexpr (is_same_v<Reader, BoolReader> && (Op == ComparisonOp::EQ || Op == ComparisonOp::NE)) {
+            ScanKernels::equal_bool(storage.bool_data() + begin, count, Op == ComparisonOp::EQ ? constant : !constant, bits);
+        } else {
+            PredicateNode::evaluate_batch(begin, count, bits);
+        }
+    }
+
+private:
+    const ColumnStorage& storage;
+    typename Reader::Stored constant;
+};
+
+// (In)equality with a value of a dictionary column compares codes and never reads the values.
+template <ComparisonOp Op>
+class DictionaryCodeNode : public PredicateNode {
+public:
+    DictionaryCodeNode(const ColumnStorage& storage, int32_t code) : storage(storage), code(code) {}
+    bool evaluate(size_t row) const override { return apply<Op>(storage.codes_data()[row], code); }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        ScanKernels::compare_int32(storage.codes_data() + begin, count, Op, code, bits);
+    }
+
+private:
+    const ColumnStorage& storage;
+    int32_t code;
+};
+
+// (In)equality with a value of an inline column checks each slot's length
+// byte before comparing its bytes in place.
+template <ComparisonOp Op>
+class InlineSlotNode : public PredicateNode {
+public:
+    InlineSlotNode(const ColumnStorage& storage, string constant) : storage(storage), constant(std::move(constant)) {}
+    bool evaluate(size_t row) const override {
+        return matches(storage.get_blob().data() + row * (storage.get_inline_width() + 1)) == (Op == ComparisonOp::EQ);
+    }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        size_t stride = storage.get_inline_width() + 1;
+        const uint8_t* slot = storage.get_blob().data() + begin * stride;
+        fill(bits, bits + ScanKernels::word_count(count), 0);
+        for (size_t i = 0; i < count; ++i, slot += stride) {
+            bits[i / 64] |= uint64_t(matches(slot) == (Op == ComparisonOp::EQ)) << (i % 64);
+        }
+    }
+
+private:
+    const ColumnStorage& storage;
+    string constant;
+
+    bool matches(const uint8_t* slot) const {
+        return slot[0] == constant.size() && memcmp(slot + 1, constant.data(), constant.size()) == 0;
+    }
+};
+
+template <typename Reader, ComparisonOp Op>
+class ColumnColumnNode : public PredicateNode {
+public:
+    ColumnColumnNode(const ColumnStorage& left, const ColumnStorage& right) : left(left), right(right) {}
+    bool evaluate(size_t row) const override { return apply<Op>(Reader::read(left, row), Reader::read(right, row)); }
+
+private:
+    const ColumnStorage& left;
+    const ColumnStorage& right;
+};
+
+class AndNode : public PredicateNode {
+public:
+    explicit AndNode(vector<shared_ptr<const PredicateNode>> children) : children(std::move(children)) {}
+    bool evaluate(size_t row) const override {
+        for (const auto& child : children) {
+            if (!child->evaluate(row)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        size_t words = ScanKernels::word_count(count);
+        uint64_t scratch[BATCH_ROWS / 64];
+        children.front()->evaluate_batch(begin, count, bits);
+        for (size_t i = 1; i < children.size(); ++i) {
+            if (all_of(bits, bits + words, [](uint64_t word) { return word == 0; })) {
+                return;
+            }
+            children[i]->evaluate_batch(begin, count, scratch);
+            for (size_t word = 0; word < words; ++word) {
+                bits[word] &= scratch[word];
+            }
+        }
+    }
+
+private:
+    vector<shared_ptr<const PredicateNode>> children;
+};
+
+class OrNode : public PredicateNode {
+public:
+    explicit OrNode(vector<shared_ptr<const PredicateNode>> children) : children(std::move(children)) {}
+    bool evaluate(size_t row) const override {
+        for (const auto& child : children) {
+            if (child->evaluate(row)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        size_t words = ScanKernels::word_count(count);
+        uint64_t scratch[BATCH_ROWS / 64];
+        children.front()->evaluate_batch(begin, count, bits);
+        for (size_t i = 1; i < children.size(); ++i) {
+            children[i]->evaluate_batch(begin, count, scratch);
+            for (size_t word = 0; word < words; ++word) {
+                bits[word] |= scratch[word];
+            }
+        }
+    }
+
+private:
+    vector<shared_ptr<const PredicateNode>> children;
+};
+
+class NotNode : public PredicateNode {
+public:
+    explicit NotNode(shared_ptr<const PredicateNode> child) : child(std::move(child)) {}
+    bool evaluate(size_t row) const override { return !child->evaluate(row); }
+    void evaluate_batch(size_t begin, size_t count, uint64_t* bits) const override {
+        size_t words = ScanKernels::word_count(count);
+        child->evaluate_batch(begin, count, bits);
+        for (size_t word = 0; word < words; ++word) {
+            bits[word] = ~bits[word];
+        }
+        if (words > 0) {
+            bits[words - 1] &= ScanKernels::tail_mask(count);
+        }
+    }
+
+private:
+    shared_ptr<const PredicateNode> child;
+};
+
+template <typename Reader, template <typename, ComparisonOp> class Node, typename... Args>
+shared_ptr<const PredicateNode> instantiate(ComparisonOp op, Args&&... args) {
+    switch (op) {
+        case ComparisonOp::EQ: return make_shared<Node<Reader, ComparisonOp::EQ>>(std::forward<Args>(args)...);
+        case ComparisonOp::NE: return make_shared<Node<Reader, ComparisonOp::NE>>(std::forward<Args>(args)...);
+        case ComparisonOp::LT: return make_shared<Node<Reader, ComparisonOp::LT>>(std::forward<Args>(args)...);
+        case ComparisonOp::LE: return make_shared<Node<Reader, ComparisonOp::LE>>(std::forward<Args>(args)...);
+        case ComparisonOp::GT: return make_shared<Node<Reader, ComparisonOp::GT>>(std::forward<Args>(args)...);
+        case ComparisonOp::GE: return make_shared<Node<Reader, ComparisonOp::GE>>(std::forward<Args>(args)...);
     }
+    throw runtime_error("Unsupported comparison operator");
+}
+
+ComparisonOp flip(ComparisonOp op) {
+    switch (op) {
+        case ComparisonOp::LT: return ComparisonOp::GT;
+        case ComparisonOp::LE: return ComparisonOp::GE;
+        case ComparisonOp::GT: return ComparisonOp::LT;
+        case ComparisonOp::GE: return ComparisonOp::LE;
+        default: return op;
+    }
+}
+
+ComparisonOp negate(ComparisonOp op) {
+    switch (op) {
+        case ComparisonOp::EQ: return ComparisonOp::NE;
+        case ComparisonOp::NE: return ComparisonOp::EQ;
+        case ComparisonOp::LT: return ComparisonOp::GE;
+        case ComparisonOp::LE: return ComparisonOp::GT;
+        case ComparisonOp::GT: return ComparisonOp::LE;
+        case ComparisonOp::GE: return ComparisonOp::LT;
+    }
+    return op;
+}
+
+class Compiler {
+public:
+    Compiler(const Table& table, span<const ValueType> parameters) : table(table), parameters(parameters) {}
+
+    Compiled compile(const Expr& expr) {
+        switch (expr.type) {
+            case ExprType::AND:
+            case ExprType::OR:
+                return compile_junction(expr);
+            case ExprType::NOT: {
+                const Expr& child = *expr.children[0];
+                if (child.type == ExprType::COMPARISON) {
+                    return compile_comparison(child, negate(child.op));
+                }
+                Compiled inner = compile(child);
+                if (inner.constant) {
+                    return {nullptr, !*inner.constant};
+                }
+                return {make_shared<NotNode>(inner.node), nullopt};
+            }
+            case ExprType::COMPARISON:
+                return compile_comparison(expr, expr.op);
+            default: {
+                Operand operand = resolve(expr);
+                if (operand.type != DataType::BOOL) {
+                    throw InvalidQueryException("Expected a boolean expression, found " + DataTypeHelper::type_to_string(operand.type));
+                }
+                if (operand.ordinal) {
+                    return {make_shared<BoolColumnNode>(table.get_column_storage(*operand.ordinal)), nullopt};
+                }
+                return {nullptr, get<bool>(operand.value)};
+            }
+        }
+    }
+
+private:
+    const Table& table;
+    span<const ValueType> parameters;
 
-    throw runtime_error("Unsupported operation or data type in condition: " + condition);
+    Compiled compile_junction(const Expr& expr) {
+        bool is_and = expr.type == ExprType::AND;
+        vector<shared_ptr<const PredicateNode>> children;
+        for (const auto& child : expr.children) {
+            Compiled compiled = compile(*child);
+            if (compiled.constant) {
+                // false short-circuits AND, true short-circuits OR; the other value is a no-op.
+                if (*compiled.constant != is_and) {
+                    return {nullptr, !is_and};
+                }
+                continue;
+            }
+            children.push_back(compiled.node);
+        }
+        if (children.empty()) {
+            return {nullptr, is_and};
+        }
+        if (children.size() == 1) {
+            return {children.front(), nullopt};
+        }
+        if (is_and) {
+            return {make_shared<AndNode>(std::move(children)), nullopt};
+        }
+        return {make_shared<OrNode>(std::move(children)), nullopt};
+    }
+
+    Compiled compile_comparison(const Expr& expr, ComparisonOp op) {
+        Operand left = resolve(*expr.children[0]);
+        Operand right = resolve(*expr.children[1]);
+        if (left.type != right.type) {
+            throw InvalidQueryException("Type mismatch in comparison: " + DataTypeHelper::type_to_string(left.type) + " vs " + DataTypeHelper::type_to_string(right.type));
+        }
+
+        if (!left.ordinal && !right.ordinal) {
+            return {nullptr, Expression::compare(left.value, op, right.value)};
+        }
+        if (!left.ordinal) {
+            swap(left, right);
+            op = flip(op);
+        }
+
+        const ColumnStorage& left_storage = table.get_column_storage(*left.ordinal);
+        if (right.ordinal) {
+            const ColumnStorage& right_storage = table.get_column_storage(*right.ordinal);
+            switch (left.type) {
+                case DataType::INT32: return {instantiate<Int32Reader, ColumnColumnNode>(op, left_storage, right_storage), nullopt};
+                case DataType::BOOL: return {instantiate<BoolReader, ColumnColumnNode>(op, left_storage, right_storage), nullopt};
+                case DataType::STRING:
+                case DataType::BYTES: return {instantiate<BlobReader, ColumnColumnNode>(op, left_storage, right_storage), nullopt};
+            }
+        }
+
+        switch (left.type) {
+            case DataType::INT32: return {instantiate<Int32Reader, ColumnConstantNode>(op, left_storage, Int32Reader::store(right.value)), nullopt};
+            case DataType::BOOL: return {instantiate<BoolReader, ColumnConstantNode>(op, left_storage, BoolReader::store(right.value)), nullopt};
+            case DataType::STRING:
+            case DataType::BYTES: {
+                string constant = BlobReader::store(right.value);
+                // A value missing from the dictionary may still arrive before the scan
+                // ends, so only values it already holds are compared by code.
+                if (left_storage.is_dictionary() && (op == ComparisonOp::EQ || op == ComparisonOp::NE)) {
+                    if (optional<int32_t> code = left_storage.find_code(constant)) {
+                        if (op == ComparisonOp::EQ) {
+                            return {make_shared<DictionaryCodeNode<ComparisonOp::EQ>>(left_storage, *code), nullopt};
+                        }
+                        return {make_shared<DictionaryCodeNode<ComparisonOp::NE>>(left_storage, *code), nullopt};
+                    }
+                }
+                if (left_storage.is_inline() && (op == ComparisonOp::EQ || op == ComparisonOp::NE)) {
+                    // No slot can hold a value longer than the column's width.
+                    if (constant.size() > left_storage.get_inline_width()) {
+                        return {nullptr, op == ComparisonOp::NE};
+                    }
+                    if (op == ComparisonOp::EQ) {
+                        return {make_shared<InlineSlotNode<ComparisonOp::EQ>>(left_storage, std::move(constant)), nullopt};
+                    }
+                    return {make_shared<InlineSlotNode<ComparisonOp::NE>>(left_storage, std::move(constant)), nullopt};
+                }
+                return {instantiate<BlobReader, ColumnConstantNode>(op, left_storage, std::move(constant)), nullopt};
+            }
+        }
+        throw runtime_error("Unsupported column type.");
+    }
+
+    Operand resolve(const Expr& expr) {
+        Operand operand;
+        switch (expr.type) {
+            case ExprType::COLUMN:
+                operand.ordinal = table.get_column_ordinal(expr.column_name);
+                operand.type = table.get_column_storage(*operand.ordinal).get_type();
+                return operand;
+            case ExprType::LITERAL:
+                operand.value = expr.value;
+                break;
+            case ExprType::PARAMETER:
+                if (expr.parameter_index >= parameters.size()) {
+                    throw InvalidQueryException("Parameter " + to_string(expr.parameter_index + 1) + " is not bound");
+                }
+                operand.value = parameters[expr.parameter_index];
+                break;
+            default:
+                throw InvalidQueryException("Unsupported operand in comparison");
+        }
+        operand.type = DataTypeHelper::type_of(operand.value);
+        return operand;
+    }
+};
+
+void infer_types(const Expr& expr, const Schema& schema, vector<optional<DataType>>& types) {
+    auto operand_type = [&schema](const Expr& operand) -> optional<DataType> {
+        if (operand.type == ExprType::COLUMN) {
+            return schema.get_column(schema.get_column_ordinal(operand.column_name)).get_type();
+        }
+        if (operand.type == ExprType::LITERAL) {
+            return DataTypeHelper::type_of(operand.value);
+        }
+        return nullopt;
+    };
+
+    switch (expr.type) {
+        case ExprType::PARAMETER:
+            types[expr.parameter_index] = DataType::BOOL;
+            break;
+        case ExprType::COMPARISON: {
+            const Expr& left = *expr.children[0];
+            const Expr& right = *expr.children[1];
+            if (left.type == ExprType::PARAMETER) {
+                types[left.parameter_index] = operand_type(right);
+            }
+            if (right.type == ExprType::PARAMETER) {
+                types[right.parameter_index] = operand_type(left);
+            }
+            break;
+        }
+        case ExprType::AND:
+        case ExprType::OR:
+        case ExprType::NOT:
+            for (const auto& child : expr.children) {
+                infer_types(*child, schema, types);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+}
+
+void PredicateNode::evaluate_batch(size_t begin, size_t count, uint64_t* bits) const {
+    fill(bits, bits + ScanKernels::word_count(count), 0);
+    for (size_t i = 0; i < count; ++i) {
+        bits[i / 64] |= uint64_t(evaluate(begin + i)) << (i % 64);
+    }
+}
+
+void Expression::matches_batch(size_t begin, size_t count, uint64_t* bits) const {
+    if (!constant) {
+        root->evaluate_batch(begin, count, bits);
+        return;
+    }
+    size_t words = ScanKernels::word_count(count);
+    fill(bits, bits + words, *constant ? ~uint64_t(0) : 0);
+    if (words > 0) {
+        bits[words - 1] &= ScanKernels::tail_mask(count);
+    }
+}
+
+Expression Expression::compile(const Expr& expr, const Table& table, span<const ValueType> parameters) {
+    Compiler compiler(table, parameters);
+    Compiled compiled = compiler.compile(expr);
+
+    Expression expression;
+    expression.constant = compiled.constant;
+    expression.root = compiled.node;
+    return expression;
+}
+
+Expression Expression::compile(shared_ptr<const Expr> expr, const Table& table, span<const ValueType> parameters) {
+    Expression expression = compile(*expr, table, parameters);
+    expression.source = std::move(expr);
+    return expression;
+}
+
+static const char* op_text(ComparisonOp op) {
+    switch (op) {
+        case ComparisonOp::EQ: return "=";
+        case ComparisonOp::NE: return "<>";
+        case ComparisonOp::LT: return "<";
+        case ComparisonOp::LE: return "<=";
+        case ComparisonOp::GT: return ">";
+        case ComparisonOp::GE: return ">=";
+    }
+    return "?";
+}
+
+// Operands that are themselves AND/OR keep their parentheses.
+static void append_operand(string& text, const Expr& operand) {
+    bool nested = operand.type == ExprType::AND || operand.type == ExprType::OR;
+    if (nested) {
+        text += '(';
+    }
+    text += Expression::describe(operand);
+    if (nested) {
+        text += ')';
+    }
+}
+
+string Expression::describe() const {
+    if (source) {
+        return describe(*source);
+    }
+    return constant ? (*constant ? "true" : "false") : "?";
+}
+
+string Expression::describe(const Expr& expr) {
+    switch (expr.type) {
+        case ExprType::COLUMN: return expr.column_name;
+        case ExprType::LITERAL: return DataTypeHelper::to_literal(expr.value);
+        case ExprType::PARAMETER: return "?";
+        case ExprType::COMPARISON: return describe(*expr.children[0]) + " " + op_text(expr.op) + " " + describe(*expr.children[1]);
+        case ExprType::NOT: {
+            string text = "NOT ";
+            append_operand(text, *expr.children[0]);
+            return text;
+        }
+        case ExprType::AND:
+        case ExprType::OR: {
+            string text;
+            for (const auto& child : expr.children) {
+                if (!text.empty()) {
+                    text += expr.type == ExprType::AND ? " AND " : " OR ";
+                }
+                append_operand(text, *child);
+            }
+            return text;
+        }
+    }
+    return "?";
+}
+
+vector<DataType> Expression::infer_parameter_types(const Expr& expr, const Schema& schema, size_t parameter_count) {
+    vector<optional<DataType>> inferred(parameter_count);
+    infer_types(expr, schema, inferred);
+
+    vector<DataType> types;
+    for (size_t i = 0; i < inferred.size(); ++i) {
+        if (!inferred[i]) {
+            throw InvalidQueryException("Cannot infer the type of parameter " + to_string(i + 1));
+        }
+        types.push_back(*inferred[i]);
+    }
+    return types;
+}
+
+bool Expression::compare(const ValueType& lhs, ComparisonOp op, const ValueType& rhs) {
+    switch (op) {
+        case ComparisonOp::EQ: return lhs == rhs;
+        case ComparisonOp::NE: return lhs != rhs;
+        case ComparisonOp::LT: return lhs < rhs;
+        case ComparisonOp::LE: return lhs <= rhs;
+        case ComparisonOp::GT: return lhs > rhs;
+        case ComparisonOp::GE: return lhs >= rhs;
+    }
+    return false;
 }
@@ -0,0 +1,102 @@
+#include "group_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t GroupTable::hash(string_view key) {
+    return mix(std::hash<string_view>{}(key));
+}
+
+uint64_t GroupTable::hash(int32_t key) {
+    return mix(static_cast<uint32_t>(key));
+}
+
+size_t GroupTable::find_or_insert(string_view key, uint64_t hash_value) {
+    grow_if_needed();
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash_value & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.group == 0) {
+            keys.push_back(copy_to_arena(key));
+            slot.hash = hash_value;
+            slot.group = static_cast<uint32_t>(++group_count);
+            return group_count - 1;
+        }
+        if (slot.hash == hash_value && keys[slot.group - 1] == key) {
+            return slot.group - 1;
+        }
+    }
+}
+
+size_t GroupTable::find_or_insert(int32_t key, uint64_t hash_value) {
+    grow_if_needed();
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash_value & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.group == 0) {
+            int32_keys.push_back(key);
+            slot.hash = hash_value;
+            slot.int32_key = key;
+            slot.group = static_cast<uint32_t>(++group_count);
+            return group_count - 1;
+        }
+        if (slot.int32_key == key && slot.hash == hash_value) {
+            return slot.group - 1;
+        }
+    }
+}
+
+size_t GroupTable::memory_usage() const {
+    return slots.capacity() * sizeof(Slot) + keys.capacity() * sizeof(string_view)
+        + int32_keys.capacity() * sizeof(int32_t) + arena_bytes;
+}
+
+void GroupTable::grow_if_needed() {
+    if ((group_count + 1) * 2 <= slots.size()) {
+        return;
+    }
+    if (group_count >= UINT32_MAX - 1) {
+        throw runtime_error("Too many groups");
+    }
+    vector<Slot> old = std::move(slots);
+    slots.assign(max<size_t>(old.size() * 2, 64), Slot());
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.group == 0) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].group != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
+
+string_view GroupTable::copy_to_arena(string_view key) {
+    if (key.empty()) {
+        return string_view();
+    }
+    if (key.size() > block_capacity - block_used) {
+        // Keys larger than a block get a block of their own.
+        block_capacity = max(BLOCK_BYTES, key.size());
+        blocks.push_back(make_unique<char[]>(block_capacity));
+        arena_bytes += block_capacity;
+        block_used = 0;
+    }
+    char* destination = blocks.back().get() + block_used;
+    memcpy(destination, key.data(), key.size());
+    block_used += key.size();
+    return string_view(destination, key.size());
+}
@@ -0,0 +1,159 @@
+#include "hash_index.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash_bytes(string_view bytes) {
+    return mix(std::hash<string_view>{}(bytes));
+}
+
+static uint64_t tag_of(uint64_t hash_value) {
+    return hash_value >> 40;
+}
+
+static bool same_value(const ColumnStorage& storage, size_t a, size_t b) {
+    switch (storage.get_type()) {
+        case DataType::INT32: return storage.get_int32(a) == storage.get_int32(b);
+        case DataType::BOOL: return storage.get_bool(a) == storage.get_bool(b);
+        case DataType::STRING:
+        case DataType::BYTES: return storage.get_string(a) == storage.get_string(b);
+    }
+    return false;
+}
+
+uint64_t HashIndex::hash(const ValueType& key) {
+    switch (DataTypeHelper::type_of(key)) {
+        case DataType::INT32: return mix(static_cast<uint32_t>(get<int32_t>(key)));
+        case DataType::BOOL: return mix(get<bool>(key) ? 1 : 0);
+        case DataType::STRING: return hash_bytes(get<string>(key));
+        case DataType::BYTES: {
+            const auto& bytes = get<vector<uint8_t>>(key);
+            return hash_bytes(string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+        }
+    }
+    throw runtime_error("Unsupported column type.");
+}
+
+uint64_t HashIndex::hash(const ColumnStorage& storage, size_t row) {
+    switch (storage.get_type()) {
+        case DataType::INT32: return mix(static_cast<uint32_t>(storage.get_int32(row)));
+        case DataType::BOOL: return mix(storage.get_bool(row) ? 1 : 0);
+        case DataType::STRING:
+        case DataType::BYTES: return hash_bytes(storage.get_string(row));
+    }
+    throw runtime_error("Unsupported column type.");
+}
+
+bool HashIndex::equals(const ColumnStorage& storage, size_t row, const ValueType& key) {
+    switch (storage.get_type()) {
+        case DataType::INT32: return storage.get_int32(row) == get<int32_t>(key);
+        case DataType::BOOL: return storage.get_bool(row) == get<bool>(key);
+        case DataType::STRING: return storage.get_string(row) == get<string>(key);
+        case DataType::BYTES: {
+            auto stored = storage.get_bytes(row);
+            const auto& bytes = get<vector<uint8_t>>(key);
+            return stored.size() == bytes.size() && equal(stored.begin(), stored.end(), bytes.begin());
+        }
+    }
+    return false;
+}
+
+optional<size_t> HashIndex::find(const ColumnStorage& storage, const ValueType& key) const {
+    if (slots.empty() || DataTypeHelper::type_of(key) != storage.get_type()) {
+        return nullopt;
+    }
+    uint64_t hash_value = hash(key);
+    uint64_t tag = tag_of(hash_value);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash_value & mask;; i = (i + 1) & mask) {
+        uint64_t slot = slots[i];
+        if (slot == 0) {
+            return nullopt;
+        }
+        size_t row = (slot & ROW_MASK) - 1;
+        if ((slot >> ROW_BITS) == tag && equals(storage, row, key)) {
+            return row;
+        }
+    }
+}
+
+bool HashIndex::insert(const ColumnStorage& storage, size_t row) {
+    if (row >= ROW_MASK) {
+        throw runtime_error("Row id exceeds hash index capacity");
+    }
+    reserve(storage, count + 1);
+
+    uint64_t hash_value = hash(storage, row);
+    uint64_t tag = tag_of(hash_value);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash_value & mask;; i = (i + 1) & mask) {
+        uint64_t slot = slots[i];
+        if (slot == 0) {
+            slots[i] = (tag << ROW_BITS) | (row + 1);
+            ++count;
+            return true;
+        }
+        size_t existing = (slot & ROW_MASK) - 1;
+        if ((slot >> ROW_BITS) == tag && same_value(storage, existing, row)) {
+            return false;
+        }
+    }
+}
+
+void HashIndex::reserve(const ColumnStorage& storage, size_t rows) {
+    // Keep the load factor at or below 0.7.
+    if (rows * 10 <= slots.size() * 7) {
+        return;
+    }
+    size_t capacity = 16;
+    while (rows * 10 > capacity * 7) {
+        capacity *= 2;
+    }
+    rehash(storage, capacity);
+}
+
+void HashIndex::rebuild(const ColumnStorage& storage) {
+    clear();
+    reserve(storage, storage.size());
+    for (size_t row = 0; row < storage.size(); ++row) {
+        if (!insert(storage, row)) {
+            throw runtime_error("Duplicate value in indexed column at row " + to_string(row));
+        }
+    }
+}
+
+void HashIndex::clear() {
+    slots.clear();
+    count = 0;
+}
+
+void HashIndex::rehash(const ColumnStorage& storage, size_t capacity) {
+    vector<uint64_t> old_slots = std::move(slots);
+    slots.assign(capacity, 0);
+    for (uint64_t slot : old_slots) {
+        if (slot != 0) {
+            size_t row = (slot & ROW_MASK) - 1;
+            place(hash(storage, row), row);
+        }
+    }
+}
+
+void HashIndex::place(uint64_t hash_value, size_t row) {
+    size_t mask = slots.size() - 1;
+    size_t i = hash_value & mask;
+    while (slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = (tag_of(hash_value) << ROW_BITS) | (row + 1);
+}
@@ -0,0 +1,59 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+shared_ptr<const MappedFile> MappedFile::open(const string& path) {
+    shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open()) {
+        throw runtime_error("Failed to open file: " + path);
+    }
+    file->length = static_cast<size_t>(in.tellg());
+    file->fallback = make_unique<uint8_t[]>(file->length);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(file->fallback.get()), file->length)) {
+        throw runtime_error("Failed to read file: " + path);
+    }
+    file->bytes = file->fallback.get();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Failed to open file: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw runtime_error("Failed to stat file: " + path);
+    }
+    file->length = static_cast<size_t>(info.st_size);
+    if (file->length > 0) {
+        void* mapping = mmap(nullptr, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw runtime_error("Failed to map file: " + path);
+        }
+        file->bytes = static_cast<const uint8_t*>(mapping);
+    }
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (bytes) {
+        munmap(const_cast<uint8_t*>(bytes), length);
+    }
+#endif
+}
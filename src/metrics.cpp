@@ -0,0 +1,119 @@
+#include "metrics.h"
+
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+size_t LatencyHistogram::bucket_of(uint64_t value) {
+    value = min(value, HIGHEST_VALUE);
+    if (value < 2 * SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    // The top SUB_BUCKET_BITS + 1 bits pick the bucket within the power of two.
+    size_t shift = static_cast<size_t>(bit_width(value)) - (SUB_BUCKET_BITS + 1);
+    return shift * SUB_BUCKETS + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_limit(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    size_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t top = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucket_of(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    count.fetch_add(1, memory_order_relaxed);
+    sum.fetch_add(nanoseconds, memory_order_relaxed);
+    uint64_t previous = highest.load(memory_order_relaxed);
+    while (nanoseconds > previous && !highest.compare_exchange_weak(previous, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const {
+    // Counted from the buckets, so values recorded meanwhile cannot push the rank past them.
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(ceil(clamp(quantile, 0.0, 1.0) * static_cast<double>(total)));
+    rank = max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return min(bucket_limit(i), get_max());
+        }
+    }
+    return get_max();
+}
+
+const char* MetricsRegistry::kind_name(StatementKind kind) {
+    switch (kind) {
+        case StatementKind::CREATE_TABLE: return "create_table";
+        case StatementKind::CREATE_INDEX: return "create_index";
+        case StatementKind::INSERT: return "insert";
+        case StatementKind::SELECT: return "select";
+        case StatementKind::EXPLAIN: return "explain";
+        case StatementKind::PREPARED_INSERT: return "prepared_insert";
+        case StatementKind::PREPARED_SELECT: return "prepared_select";
+    }
+    return "unknown";
+}
+
+static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+static string microseconds(uint64_t nanoseconds) {
+    ostringstream text;
+    text << fixed << setprecision(3) << static_cast<double>(nanoseconds) / 1000.0;
+    return text.str();
+}
+
+void MetricsRegistry::write_summary(ostream& out, const string& name, const string& labels, const LatencyHistogram& histogram) {
+    string prefix = labels.empty() ? "" : labels + ",";
+    for (double quantile : QUANTILES) {
+        out << name << "{" << prefix << "quantile=\"" << quantile << "\"} " << microseconds(histogram.percentile(quantile)) << "\n";
+    }
+    out << name << "{" << prefix << "quantile=\"1\"} " << microseconds(histogram.get_max()) << "\n";
+    string suffix;
+    if (!labels.empty()) {
+        suffix += "{";
+        suffix += labels;
+        suffix += "}";
+    }
+    out << name << "_sum" << suffix << " " << microseconds(histogram.get_sum()) << "\n";
+    out << name << "_count" << suffix << " " << histogram.get_count() << "\n";
+}
+
+void MetricsRegistry::write_io(ostream& out, const string& prefix, const string& latency_name, const IoMetrics& io) {
+    out << prefix << "_records_total " << io.records.get() << "\n";
+    out << prefix << "_writes_total " << io.writes.get() << "\n";
+    out << prefix << "_bytes_written_total " << io.bytes_written.get() << "\n";
+    out << prefix << "_reads_total " << io.reads.get() << "\n";
+    out << prefix << "_bytes_read_total " << io.bytes_read.get() << "\n";
+    out << prefix << "_syncs_total " << io.syncs.get() << "\n";
+    out << "# TYPE " << latency_name << " summary\n";
+    write_summary(out, latency_name, "", io.latency);
+}
+
+void MetricsRegistry::write_text(ostream& out) const {
+    out << "# TYPE imdb_statement_latency_us summary\n";
+    for (size_t i = 0; i < STATEMENT_KINDS; ++i) {
+        string labels = "type=\"";
+        labels += kind_name(static_cast<StatementKind>(i));
+        labels += "\"";
+        write_summary(out, "imdb_statement_latency_us", labels, statements[i].latency);
+    }
+    out << "# TYPE imdb_statement_failures_total counter\n";
+    for (size_t i = 0; i < STATEMENT_KINDS; ++i) {
+        out << "imdb_statement_failures_total{type=\"" << kind_name(static_cast<StatementKind>(i)) << "\"} " << statements[i].failures.get() << "\n";
+    }
+    out << "imdb_parse_failures_total " << parse_failures.get() << "\n";
+    write_io(out, "imdb_snapshot", "imdb_snapshot_write_latency_us", snapshots);
+}
@@ -0,0 +1,1560 @@
+#include "operators.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+// Calls visit(row) for the row id of every live position, in selection order.
+template <typename Visit>
+static void for_each_live(const Batch& batch, Visit visit) {
+    if (batch.contiguous) {
+        for (uint32_t position : batch.selection) {
+            visit(batch.first + position);
+        }
+    } else {
+        for (uint32_t position : batch.selection) {
+            visit(batch.row_ids[position]);
+        }
+    }
+}
+
+// Fills `values` with value_of(row) for every live row, in selection order;
+// with `joined`, for the paired row of the joined table.
+template <typename T, typename ValueOf>
+static void gather(const Batch& batch, vector<T>& values, ValueOf value_of, bool joined = false) {
+    values.resize(batch.size());
+    T* out = values.data();
+    if (joined) {
+        for (uint32_t position : batch.selection) {
+            *out++ = value_of(batch.joined_row_ids[position]);
+        }
+        return;
+    }
+    for_each_live(batch, [&out, &value_of](size_t row) { *out++ = value_of(row); });
+}
+
+void ColumnVector::clear() {
+    int32_values.clear();
+    int64_values.clear();
+    double_values.clear();
+    bool_values.clear();
+    string_values.clear();
+    bytes_values.clear();
+}
+
+size_t ColumnVector::size() const {
+    switch (kind) {
+        case Kind::INT32: return int32_values.size();
+        case Kind::INT64: return int64_values.size();
+        case Kind::DOUBLE: return double_values.size();
+        case Kind::BOOL: return bool_values.size();
+        case Kind::STRING: return string_values.size();
+        case Kind::BYTES: return bytes_values.size();
+    }
+    return 0;
+}
+
+void ColumnVector::append_from(const ColumnVector& from, span<const uint32_t> indexes) {
+    auto append = [indexes](auto& to, const auto& values) {
+        for (uint32_t index : indexes) {
+            to.push_back(values[index]);
+        }
+    };
+    switch (kind) {
+        case Kind::INT32: append(int32_values, from.int32_values); break;
+        case Kind::INT64: append(int64_values, from.int64_values); break;
+        case Kind::DOUBLE: append(double_values, from.double_values); break;
+        case Kind::BOOL: append(bool_values, from.bool_values); break;
+        case Kind::STRING: append(string_values, from.string_values); break;
+        case Kind::BYTES: append(bytes_values, from.bytes_values); break;
+    }
+}
+
+bool ColumnVector::less(size_t a, size_t b) const {
+    switch (kind) {
+        case Kind::INT32: return int32_values[a] < int32_values[b];
+        case Kind::INT64: return int64_values[a] < int64_values[b];
+        case Kind::DOUBLE: return double_values[a] < double_values[b];
+        case Kind::BOOL: return bool_values[a] < bool_values[b];
+        case Kind::STRING: return string_values[a] < string_values[b];
+        case Kind::BYTES:
+            return lexicographical_compare(bytes_values[a].begin(), bytes_values[a].end(), bytes_values[b].begin(), bytes_values[b].end());
+    }
+    return false;
+}
+
+void Batch::select_all() {
+    selection.resize(count);
+    iota(selection.begin(), selection.end(), 0u);
+}
+
+size_t Operator::rows_skipped(size_t, size_t) const {
+    return 0;
+}
+
+bool ProfiledOperator::next(Batch& batch) {
+    auto start = chrono::steady_clock::now();
+    bool produced = inner->next(batch);
+    time += chrono::steady_clock::now() - start;
+    if (produced) {
+        ++batches;
+        rows += batch.size();
+    }
+    peak_bytes = max(peak_bytes, inner->memory_usage());
+    return produced;
+}
+
+ScanOperator::ScanOperator(shared_ptr<const Table> table, AccessPath path)
+    : table(std::move(table)), path(std::move(path)), rows(this->table->get_row_count()) {
+    if (this->path.method != AccessMethod::FULL_SCAN) {
+        scanner.emplace(*this->table, Expression(), this->path, rows);
+    }
+}
+
+bool ScanOperator::next(Batch& batch) {
+    if (!scanner) {
+        if (next_row >= rows) {
+            return false;
+        }
+        batch.contiguous = true;
+        batch.first = next_row;
+        batch.count = min(Batch::CAPACITY, rows - next_row);
+        batch.row_ids.clear();
+        batch.select_all();
+        next_row += batch.count;
+        return true;
+    }
+
+    batch.contiguous = false;
+    batch.first = 0;
+    batch.row_ids.clear();
+    size_t row;
+    while (batch.row_ids.size() < Batch::CAPACITY && scanner->next(row)) {
+        batch.row_ids.push_back(row);
+    }
+    batch.count = batch.row_ids.size();
+    batch.select_all();
+    return batch.count != 0;
+}
+
+FilterOperator::FilterOperator(unique_ptr<Operator> child, Expression predicate, shared_ptr<ThreadPool> pool)
+    : child(std::move(child)), predicate(std::move(predicate)), pool(std::move(pool)) {
+    if (this->pool && this->pool->size() == 1) {
+        this->pool = nullptr;
+    }
+}
+
+bool FilterOperator::next(Batch& batch) {
+    if (predicate.get_constant() == false) {
+        return false;
+    }
+    if (!pool) {
+        while (child->next(batch)) {
+            filter(batch);
+            if (batch.size() != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    while (true) {
+        while (window_position < window_size) {
+            Batch& filtered = window[window_position++];
+            if (filtered.size() != 0) {
+                swap(batch, filtered);
+                return true;
+            }
+        }
+        if (child_done) {
+            return false;
+        }
+        window.resize(pool->size() * WINDOW_BATCHES_PER_THREAD);
+        window_size = 0;
+        window_position = 0;
+        while (window_size < window.size() && child->next(window[window_size])) {
+            ++window_size;
+        }
+        child_done = window_size < window.size();
+        pool->run(window_size, [this](size_t index) { filter(window[index]); });
+    }
+}
+
+void FilterOperator::filter(Batch& batch) const {
+    if (predicate.get_constant() == true) {
+        return;
+    }
+    if (batch.contiguous && batch.size() == batch.count) {
+        uint64_t bits[Batch::CAPACITY / 64];
+        predicate.matches_batch(batch.first, batch.count, bits);
+        uint32_t* out = batch.selection.data();
+        for (size_t word = 0; word * 64 < batch.count; ++word) {
+            for (uint64_t mask = bits[word]; mask != 0; mask &= mask - 1) {
+                *out++ = static_cast<uint32_t>(word * 64 + countr_zero(mask));
+            }
+        }
+        batch.selection.resize(out - batch.selection.data());
+        return;
+    }
+    size_t kept = 0;
+    for (uint32_t position : batch.selection) {
+        if (predicate.matches(batch.row(position))) {
+            batch.selection[kept++] = position;
+        }
+    }
+    batch.selection.resize(kept);
+}
+
+ProjectOperator::ProjectOperator(unique_ptr<Operator> child, shared_ptr<const Table> table, vector<size_t> projection, shared_ptr<const Table> joined)
+    : child(std::move(child)), table(std::move(table)), projection(std::move(projection)), joined(std::move(joined)) {}
+
+bool ProjectOperator::next(Batch& batch) {
+    if (!child->next(batch)) {
+        return false;
+    }
+    size_t table_columns = table->get_schema()->size();
+    batch.columns.resize(projection.size());
+    for (size_t i = 0; i < projection.size(); ++i) {
+        bool from_joined = projection[i] >= table_columns;
+        const ColumnStorage& storage = from_joined ? joined->get_column_storage(projection[i] - table_columns) : table->get_column_storage(projection[i]);
+        ColumnVector& column = batch.columns[i];
+        column.clear();
+        switch (storage.get_type()) {
+            case DataType::INT32: {
+                column.kind = ColumnVector::Kind::INT32;
+                const int32_t* values = storage.int32_data();
+                gather(batch, column.int32_values, [values](size_t row) { return values[row]; }, from_joined);
+                break;
+            }
+            case DataType::BOOL: {
+                column.kind = ColumnVector::Kind::BOOL;
+                const uint8_t* values = storage.bool_data();
+                gather(batch, column.bool_values, [values](size_t row) { return values[row]; }, from_joined);
+                break;
+            }
+            case DataType::STRING:
+            case DataType::BYTES: {
+                span<const uint8_t> blob = storage.get_blob();
+                if (storage.is_inline()) {
+                    // Each slot is a length byte followed by the value.
+                    size_t slot_bytes = storage.get_inline_width() + 1;
+                    if (storage.get_type() == DataType::STRING) {
+                        column.kind = ColumnVector::Kind::STRING;
+                        const char* data = reinterpret_cast<const char*>(blob.data());
+                        gather(batch, column.string_values, [data, slot_bytes](size_t row) {
+                            const char* slot = data + row * slot_bytes;
+                            return string_view(slot + 1, static_cast<uint8_t>(slot[0]));
+                        }, from_joined);
+                    } else {
+                        column.kind = ColumnVector::Kind::BYTES;
+                        gather(batch, column.bytes_values, [blob, slot_bytes](size_t row) {
+                            return blob.subspan(row * slot_bytes + 1, blob[row * slot_bytes]);
+                        }, from_joined);
+                    }
+                    break;
+                }
+                span<const uint64_t> offsets = storage.get_offsets();
+                // A dictionary column's offsets index its values, reached through the row's code.
+                const int32_t* codes = storage.is_dictionary() ? storage.codes_data() : nullptr;
+                if (storage.get_type() == DataType::STRING) {
+                    column.kind = ColumnVector::Kind::STRING;
+                    const char* data = reinterpret_cast<const char*>(blob.data());
+                    gather(batch, column.string_values, [data, offsets, codes](size_t row) {
+                        size_t value = codes ? static_cast<size_t>(codes[row]) : row;
+                        return string_view(data + offsets[value], offsets[value + 1] - offsets[value]);
+                    }, from_joined);
+                } else {
+                    column.kind = ColumnVector::Kind::BYTES;
+                    gather(batch, column.bytes_values, [blob, offsets, codes](size_t row) {
+                        size_t value = codes ? static_cast<size_t>(codes[row]) : row;
+                        return blob.subspan(offsets[value], offsets[value + 1] - offsets[value]);
+                    }, from_joined);
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+LimitOperator::LimitOperator(unique_ptr<Operator> child, size_t limit) : child(std::move(child)), limit(limit) {}
+
+bool LimitOperator::next(Batch& batch) {
+    if (produced >= limit || !child->next(batch)) {
+        return false;
+    }
+    // Sits below Project, so only the selection needs trimming.
+    if (batch.size() > limit - produced) {
+        batch.selection.resize(limit - produced);
+    }
+    produced += batch.size();
+    return true;
+}
+
+SortOperator::SortOperator(unique_ptr<Operator> child, shared_ptr<const Table> table, size_t ordinal, bool descending, optional<size_t> limit,
+                           shared_ptr<const Table> joined)
+    : child(std::move(child)), table(std::move(table)), ordinal(ordinal), descending(descending), limit(limit), joined(std::move(joined)) {}
+
+bool SortOperator::next(Batch& batch) {
+    if (!sorted) {
+        sort_rows();
+        sorted = true;
+    }
+    if (position >= sorted_rows.size()) {
+        return false;
+    }
+    batch.contiguous = false;
+    batch.first = 0;
+    batch.count = min(Batch::CAPACITY, sorted_rows.size() - position);
+    batch.row_ids.assign(sorted_rows.begin() + position, sorted_rows.begin() + position + batch.count);
+    if (joined) {
+        batch.joined_row_ids.assign(sorted_joined_rows.begin() + position, sorted_joined_rows.begin() + position + batch.count);
+    }
+    batch.select_all();
+    position += batch.count;
+    return true;
+}
+
+// Sorts (key, row) pairs, which orders ties by row, and keeps the first `limit`.
+template <typename Key>
+static void sort_keyed(vector<pair<Key, size_t>>& keyed, bool descending, optional<size_t> limit) {
+    size_t kept = limit ? min(*limit, keyed.size()) : keyed.size();
+    auto sort_by = [&](auto compare) {
+        if (kept < keyed.size()) {
+            partial_sort(keyed.begin(), keyed.begin() + kept, keyed.end(), compare);
+            keyed.resize(kept);
+        } else {
+            sort(keyed.begin(), keyed.end(), compare);
+        }
+    };
+    if (descending) {
+        sort_by(greater<>());
+    } else {
+        sort_by(less<>());
+    }
+}
+
+void SortOperator::sort_rows() {
+    size_t table_columns = table->get_schema()->size();
+    bool from_joined = joined && ordinal >= table_columns;
+    const ColumnStorage& storage = from_joined ? joined->get_column_storage(ordinal - table_columns) : table->get_column_storage(ordinal);
+    // Keys are read once into the pairs, so comparisons touch no storage.
+    // Joined pairs are keyed by their position in `rows` and `joined_rows`.
+    auto collect = [&](auto key_of, auto& keyed) {
+        Batch input;
+        vector<size_t> rows;
+        vector<size_t> joined_rows;
+        while (child->next(input)) {
+            if (!joined) {
+                for_each_live(input, [&](size_t row) { keyed.emplace_back(key_of(row), row); });
+                continue;
+            }
+            for (uint32_t position : input.selection) {
+                rows.push_back(input.row_ids[position]);
+                joined_rows.push_back(input.joined_row_ids[position]);
+                keyed.emplace_back(key_of(from_joined ? joined_rows.back() : rows.back()), keyed.size());
+            }
+        }
+        sort_keyed(keyed, descending, limit);
+        sorted_rows.reserve(keyed.size());
+        for (const auto& entry : keyed) {
+            sorted_rows.push_back(joined ? rows[entry.second] : entry.second);
+            if (joined) {
+                sorted_joined_rows.push_back(joined_rows[entry.second]);
+            }
+        }
+    };
+    switch (storage.get_type()) {
+        case DataType::INT32: {
+            vector<pair<int32_t, size_t>> keyed;
+            const int32_t* values = storage.int32_data();
+            collect([values](size_t row) { return values[row]; }, keyed);
+            break;
+        }
+        case DataType::BOOL: {
+            vector<pair<int32_t, size_t>> keyed;
+            const uint8_t* values = storage.bool_data();
+            collect([values](size_t row) { return static_cast<int32_t>(values[row] != 0); }, keyed);
+            break;
+        }
+        case DataType::STRING:
+        case DataType::BYTES: {
+            vector<pair<string_view, size_t>> keyed;
+            collect([&storage](size_t row) { return storage.get_string(row); }, keyed);
+            break;
+        }
+    }
+}
+
+HashJoinOperator::HashJoinOperator(unique_ptr<Operator> probe, shared_ptr<const Table> probe_table, size_t probe_ordinal,
+                                   unique_ptr<Operator> build, shared_ptr<const Table> build_table, size_t build_ordinal, shared_ptr<ThreadPool> pool)
+    : probe(std::move(probe)), probe_table(std::move(probe_table)), probe_ordinal(probe_ordinal),
+      build(std::move(build)), build_table(std::move(build_table)), build_ordinal(build_ordinal), pool(std::move(pool)),
+      probe_keys(&this->probe_table->get_column_storage(probe_ordinal)), build_keys(&this->build_table->get_column_storage(build_ordinal)) {
+    if (this->pool && this->pool->size() == 1) {
+        this->pool = nullptr;
+    }
+}
+
+bool HashJoinOperator::next(Batch& batch) {
+    if (!built) {
+        built = true;
+        build_partitions();
+        if (partitions.size() == 1 && partitions.front().build_rows.empty()) {
+            // Nothing can match, so the probe side is never read.
+            partitions.clear();
+        } else if (partitions.size() > 1) {
+            partition_probe();
+        }
+    }
+    batch.contiguous = false;
+    batch.first = 0;
+    batch.row_ids.clear();
+    batch.joined_row_ids.clear();
+    bool produced = partitions.size() == 1 ? next_streamed(batch) : !partitions.empty() && next_partitioned(batch);
+    batch.count = batch.row_ids.size();
+    batch.select_all();
+    return produced;
+}
+
+void HashJoinOperator::build_partitions() {
+    partitions.resize(1);
+    Partition& all = partitions.front();
+    Batch batch;
+    while (build->next(batch)) {
+        for_each_live(batch, [&](size_t row) {
+            all.build_rows.push_back(row);
+            all.build_hashes.push_back(HashIndex::hash(*build_keys, row));
+        });
+    }
+
+    if (all.build_rows.size() > PARTITION_ROWS) {
+        size_t count = bit_ceil((all.build_rows.size() + PARTITION_ROWS - 1) / PARTITION_ROWS);
+        size_t mask = count - 1;
+        partition_bits = countr_zero(count);
+        vector<Partition> split(count);
+        vector<size_t> sizes(count);
+        for (uint64_t hash_value : all.build_hashes) {
+            ++sizes[hash_value & mask];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            split[i].build_rows.reserve(sizes[i]);
+            split[i].build_hashes.reserve(sizes[i]);
+        }
+        for (size_t entry = 0; entry < all.build_rows.size(); ++entry) {
+            Partition& partition = split[all.build_hashes[entry] & mask];
+            partition.build_rows.push_back(all.build_rows[entry]);
+            partition.build_hashes.push_back(all.build_hashes[entry]);
+        }
+        partitions = std::move(split);
+    }
+
+    if (pool && partitions.size() > 1) {
+        pool->run(partitions.size(), [this](size_t index) { chain_partition(partitions[index]); });
+    } else {
+        for (Partition& partition : partitions) {
+            chain_partition(partition);
+        }
+    }
+}
+
+void HashJoinOperator::partition_probe() {
+    size_t mask = partitions.size() - 1;
+    Batch batch;
+    while (probe->next(batch)) {
+        for_each_live(batch, [&](size_t row) {
+            uint64_t hash_value = HashIndex::hash(*probe_keys, row);
+            Partition& partition = partitions[hash_value & mask];
+            partition.probe_rows.push_back(row);
+            partition.probe_hashes.push_back(hash_value);
+        });
+    }
+}
+
+void HashJoinOperator::chain_partition(Partition& partition) const {
+    size_t entries = partition.build_rows.size();
+    if (entries >= numeric_limits<uint32_t>::max()) {
+        throw runtime_error("Too many rows in one join partition");
+    }
+    partition.heads.assign(bit_ceil(max<size_t>(entries, 1)), 0);
+    partition.next.resize(entries);
+    // Chained back to front, so that every chain lists its entries in build order.
+    for (size_t entry = entries; entry-- > 0;) {
+        uint32_t& head = partition.heads[bucket_of(partition, partition.build_hashes[entry])];
+        partition.next[entry] = head;
+        head = static_cast<uint32_t>(entry + 1);
+    }
+}
+
+void HashJoinOperator::join_partition(Partition& partition) const {
+    for (size_t i = 0; i < partition.probe_rows.size(); ++i) {
+        size_t row = partition.probe_rows[i];
+        uint64_t hash_value = partition.probe_hashes[i];
+        for (uint32_t link = partition.heads[bucket_of(partition, hash_value)]; link != 0; link = partition.next[link - 1]) {
+            size_t entry = link - 1;
+            if (partition.build_hashes[entry] == hash_value && keys_equal(row, partition.build_rows[entry])) {
+                partition.matched_probe_rows.push_back(row);
+                partition.matched_build_rows.push_back(partition.build_rows[entry]);
+            }
+        }
+    }
+    // Only the pairs are needed from here on.
+    partition.build_rows = {};
+    partition.build_hashes = {};
+    partition.heads = {};
+    partition.next = {};
+    partition.probe_rows = {};
+    partition.probe_hashes = {};
+}
+
+bool HashJoinOperator::keys_equal(size_t probe_row, size_t build_row) const {
+    switch (build_keys->get_type()) {
+        case DataType::INT32: return probe_keys->get_int32(probe_row) == build_keys->get_int32(build_row);
+        case DataType::BOOL: return probe_keys->get_bool(probe_row) == build_keys->get_bool(build_row);
+        case DataType::STRING:
+        case DataType::BYTES: return probe_keys->get_string(probe_row) == build_keys->get_string(build_row);
+    }
+    return false;
+}
+
+bool HashJoinOperator::next_streamed(Batch& batch) {
+    const Partition& partition = partitions.front();
+    while (batch.row_ids.size() < Batch::CAPACITY) {
+        if (chain == 0) {
+            if (probe_done) {
+                break;
+            }
+            if (input_position == input.size()) {
+                if (!probe->next(input)) {
+                    probe_done = true;
+                    break;
+                }
+                input_position = 0;
+            }
+            probe_row = input.row(input.selection[input_position++]);
+            probe_hash = HashIndex::hash(*probe_keys, probe_row);
+            chain = partition.heads[bucket_of(partition, probe_hash)];
+            continue;
+        }
+        size_t entry = chain - 1;
+        chain = partition.next[entry];
+        if (partition.build_hashes[entry] == probe_hash && keys_equal(probe_row, partition.build_rows[entry])) {
+            batch.row_ids.push_back(probe_row);
+            batch.joined_row_ids.push_back(partition.build_rows[entry]);
+        }
+    }
+    return !batch.row_ids.empty();
+}
+
+bool HashJoinOperator::next_partitioned(Batch& batch) {
+    while (batch.row_ids.size() < Batch::CAPACITY) {
+        if (output_partition == next_partition) {
+            if (next_partition == partitions.size()) {
+                break;
+            }
+            // Joins the next window of partitions, one per thread.
+            size_t first = next_partition;
+            size_t end = min(partitions.size(), first + (pool ? pool->size() : 1));
+            if (pool && end - first > 1) {
+                pool->run(end - first, [this, first](size_t index) { join_partition(partitions[first + index]); });
+            } else {
+                for (size_t index = first; index < end; ++index) {
+                    join_partition(partitions[index]);
+                }
+            }
+            next_partition = end;
+            continue;
+        }
+        Partition& partition = partitions[output_partition];
+        size_t taken = min(Batch::CAPACITY - batch.row_ids.size(), partition.matched_probe_rows.size() - output_position);
+        auto probe_rows = partition.matched_probe_rows.begin() + output_position;
+        auto build_rows = partition.matched_build_rows.begin() + output_position;
+        batch.row_ids.insert(batch.row_ids.end(), probe_rows, probe_rows + taken);
+        batch.joined_row_ids.insert(batch.joined_row_ids.end(), build_rows, build_rows + taken);
+        output_position += taken;
+        if (output_position == partition.matched_probe_rows.size()) {
+            partition.matched_probe_rows = {};
+            partition.matched_build_rows = {};
+            ++output_partition;
+            output_position = 0;
+        }
+    }
+    return !batch.row_ids.empty();
+}
+
+IndexJoinOperator::IndexJoinOperator(unique_ptr<Operator> outer, shared_ptr<const Table> outer_table, size_t outer_ordinal,
+                                     shared_ptr<const Table> inner_table, size_t inner_ordinal, Expression inner_predicate)
+    : outer(std::move(outer)), outer_table(std::move(outer_table)), outer_ordinal(outer_ordinal),
+      inner_table(std::move(inner_table)), inner_ordinal(inner_ordinal), inner_predicate(std::move(inner_predicate)),
+      inner_rows(this->inner_table->get_row_count()) {}
+
+bool IndexJoinOperator::next(Batch& batch) {
+    while (position == outer_rows.size()) {
+        if (inner_predicate.get_constant() == false || !outer->next(input)) {
+            return false;
+        }
+        look_up(input);
+    }
+    batch.contiguous = false;
+    batch.first = 0;
+    batch.count = min(Batch::CAPACITY, outer_rows.size() - position);
+    batch.row_ids.assign(outer_rows.begin() + position, outer_rows.begin() + position + batch.count);
+    batch.joined_row_ids.assign(matched_rows.begin() + position, matched_rows.begin() + position + batch.count);
+    batch.select_all();
+    position += batch.count;
+    return true;
+}
+
+void IndexJoinOperator::look_up(const Batch& batch) {
+    outer_rows.clear();
+    matched_rows.clear();
+    position = 0;
+    const ColumnStorage& keys = outer_table->get_column_storage(outer_ordinal);
+    auto add = [this](size_t outer_row, size_t inner_row) {
+        if (inner_row < inner_rows && inner_predicate.matches(inner_row)) {
+            outer_rows.push_back(outer_row);
+            matched_rows.push_back(inner_row);
+        }
+    };
+    auto lock = inner_table->lock_shared();
+    if (inner_table->has_hash_index(inner_ordinal)) {
+        for_each_live(batch, [&](size_t row) {
+            if (optional<size_t> found = inner_table->find_row(inner_ordinal, keys.get_value(row))) {
+                add(row, *found);
+            }
+        });
+        return;
+    }
+    const OrderedIndex& index = inner_table->get_ordered_index(inner_ordinal);
+    for_each_live(batch, [&](size_t row) {
+        int32_t key = OrderedIndex::key_of(keys, row);
+        scratch.clear();
+        index.scan(KeyRange{key, key}, scratch);
+        for (size_t inner_row : scratch) {
+            add(row, inner_row);
+        }
+    });
+}
+
+static bool reads_column(const AggregateSpec& spec) {
+    return spec.function && *spec.function != AggregateFunction::COUNT;
+}
+
+static bool sums(const AggregateSpec& spec) {
+    return spec.function == AggregateFunction::SUM || spec.function == AggregateFunction::AVG;
+}
+
+// Calls visit(row) for every live position, with the paired row of the joined
+// table when `joined`.
+template <typename Visit>
+static void for_each_live(const Batch& batch, bool joined, Visit visit) {
+    if (!joined) {
+        for_each_live(batch, visit);
+        return;
+    }
+    for (uint32_t position : batch.selection) {
+        visit(batch.joined_row_ids[position]);
+    }
+}
+
+// Folds values[row] of every live row into accumulator[groups[i] * stride],
+// the i-th live row's group, or into accumulator[0] without `groups`.
+template <typename T, typename Combine>
+static void fold_column(const Batch& batch, bool joined, const T* values, int64_t* accumulator, const uint32_t* groups, size_t stride,
+                        Combine combine) {
+    if (!groups) {
+        int64_t result = *accumulator;
+        for_each_live(batch, joined, [&result, values, &combine](size_t row) { result = combine(result, values[row]); });
+        *accumulator = result;
+        return;
+    }
+    for_each_live(batch, joined, [&](size_t row) {
+        int64_t& result = accumulator[*groups++ * stride];
+        result = combine(result, values[row]);
+    });
+}
+
+template <typename T>
+static void fold_numbers(const Batch& batch, bool joined, const T* values, AggregateFunction function, int64_t* accumulator,
+                         const uint32_t* groups, size_t stride) {
+    switch (function) {
+        case AggregateFunction::SUM:
+        case AggregateFunction::AVG:
+            fold_column(batch, joined, values, accumulator, groups, stride, [](int64_t result, int64_t value) { return result + value; });
+            break;
+        case AggregateFunction::MIN:
+            fold_column(batch, joined, values, accumulator, groups, stride, [](int64_t result, int64_t value) { return min(result, value); });
+            break;
+        case AggregateFunction::MAX:
+            fold_column(batch, joined, values, accumulator, groups, stride, [](int64_t result, int64_t value) { return max(result, value); });
+            break;
+        case AggregateFunction::COUNT:
+            break;
+    }
+}
+
+// Whether row `candidate` of a string or bytes column beats row `best`, -1
+// standing for no row.
+static bool replaces(const ColumnStorage& storage, bool maximum, int64_t best, int64_t candidate) {
+    if (candidate < 0) {
+        return false;
+    }
+    if (best < 0) {
+        return true;
+    }
+    string_view current = storage.get_string(static_cast<size_t>(best));
+    string_view value = storage.get_string(static_cast<size_t>(candidate));
+    return maximum ? current < value : value < current;
+}
+
+AggregateOperator::AggregateOperator(unique_ptr<Operator> child, shared_ptr<const Table> table, vector<size_t> group_ordinals, vector<AggregateSpec> specs,
+                                     optional<pair<size_t, bool>> order, optional<size_t> limit, shared_ptr<ThreadPool> pool, shared_ptr<const Table> joined)
+    : child(std::move(child)), table(std::move(table)), group_ordinals(std::move(group_ordinals)), specs(std::move(specs)),
+      order(order), limit(limit), pool(std::move(pool)), joined(std::move(joined)) {
+    if (this->pool && this->pool->size() == 1) {
+        this->pool = nullptr;
+    }
+    for (size_t ordinal : this->group_ordinals) {
+        group_sources.push_back(source_of(ordinal));
+    }
+    int32_key = group_sources.size() == 1 && group_sources[0].storage->get_type() == DataType::INT32;
+    for (const AggregateSpec& spec : this->specs) {
+        size_t key_position = 0;
+        if (!spec.function) {
+            auto found = spec.ordinal ? find(this->group_ordinals.begin(), this->group_ordinals.end(), *spec.ordinal) : this->group_ordinals.end();
+            if (found == this->group_ordinals.end()) {
+                throw runtime_error("Output column is neither aggregated nor grouped");
+            }
+            key_position = found - this->group_ordinals.begin();
+        } else if (reads_column(spec) && !spec.ordinal) {
+            throw runtime_error("Aggregates other than COUNT read a column");
+        }
+        Source source = spec.ordinal ? source_of(*spec.ordinal) : Source();
+        if (sums(spec) && source.storage->get_type() != DataType::INT32 && source.storage->get_type() != DataType::BOOL) {
+            throw runtime_error("SUM and AVG read int32 or bool columns");
+        }
+        sources.push_back(source);
+        key_positions.push_back(key_position);
+    }
+    if (order && order->first >= this->specs.size()) {
+        throw runtime_error("No output column to order by");
+    }
+}
+
+AggregateOperator::Source AggregateOperator::source_of(size_t ordinal) const {
+    size_t columns = table->get_schema()->size();
+    if (ordinal < columns) {
+        return Source{&table->get_column_storage(ordinal), false};
+    }
+    if (!joined) {
+        throw runtime_error("Column ordinal out of range");
+    }
+    return Source{&joined->get_column_storage(ordinal - columns), true};
+}
+
+bool AggregateOperator::by_row(size_t s) const {
+    if (!reads_column(specs[s])) {
+        return false;
+    }
+    DataType type = sources[s].storage->get_type();
+    return type == DataType::STRING || type == DataType::BYTES;
+}
+
+bool AggregateOperator::next(Batch& batch) {
+    if (!aggregated) {
+        aggregate();
+        aggregated = true;
+    }
+    if (position >= output_order.size()) {
+        return false;
+    }
+    batch.contiguous = false;
+    batch.first = 0;
+    batch.count = min(Batch::CAPACITY, output_order.size() - position);
+    batch.row_ids.clear();
+    batch.select_all();
+    batch.columns.resize(specs.size());
+    span<const uint32_t> groups = span<const uint32_t>(output_order).subspan(position, batch.count);
+    for (size_t s = 0; s < specs.size(); ++s) {
+        batch.columns[s].clear();
+        batch.columns[s].kind = results[s].kind;
+        batch.columns[s].append_from(results[s], groups);
+    }
+    position += batch.count;
+    return true;
+}
+
+void AggregateOperator::aggregate() {
+    vector<Partial> partials(pool ? pool->size() : 1);
+    size_t received = 0;
+    if (!pool) {
+        Batch batch;
+        while (child->next(batch)) {
+            fold(partials[0], batch, received);
+            received += batch.size();
+        }
+    } else {
+        size_t threads = pool->size();
+        vector<Batch> window(threads * WINDOW_BATCHES_PER_THREAD);
+        vector<size_t> firsts(window.size());
+        bool child_done = false;
+        while (!child_done) {
+            size_t window_size = 0;
+            while (window_size < window.size() && child->next(window[window_size])) {
+                firsts[window_size] = received;
+                received += window[window_size].size();
+                ++window_size;
+            }
+            child_done = window_size < window.size();
+            // Thread t folds batches t, t + threads, ... into partial t alone.
+            pool->run(threads, [&](size_t t) {
+                for (size_t b = t; b < window_size; b += threads) {
+                    fold(partials[t], window[b], firsts[b]);
+                }
+            });
+        }
+        for (size_t t = 1; t < threads; ++t) {
+            merge(partials[0], partials[t]);
+        }
+    }
+    if (group_ordinals.empty()) {
+        add_group(partials[0], 0);
+    }
+    decode_results(partials[0]);
+}
+
+size_t AggregateOperator::add_group(Partial& partial, size_t group) const {
+    if (group == partial.counts.size()) {
+        partial.counts.push_back(0);
+        partial.first_rows.push_back(numeric_limits<size_t>::max());
+        for (size_t s = 0; s < specs.size(); ++s) {
+            int64_t initial = 0;
+            if (by_row(s)) {
+                initial = -1;
+            } else if (specs[s].function == AggregateFunction::MIN) {
+                initial = numeric_limits<int64_t>::max();
+            } else if (specs[s].function == AggregateFunction::MAX) {
+                initial = numeric_limits<int64_t>::min();
+            }
+            partial.values.push_back(initial);
+        }
+    }
+    return group;
+}
+
+void AggregateOperator::fold(Partial& partial, const Batch& batch, size_t first) const {
+    size_t stride = specs.size();
+    const uint32_t* groups = nullptr;
+    if (group_ordinals.empty()) {
+        add_group(partial, 0);
+        partial.counts[0] += static_cast<int64_t>(batch.size());
+        if (joined) {
+            partial.first_rows[0] = min(partial.first_rows[0], first);
+        } else {
+            for_each_live(batch, [&partial](size_t row) { partial.first_rows[0] = min(partial.first_rows[0], row); });
+        }
+    } else {
+        // Number the group of every live row, then fold each column over those numbers.
+        partial.row_groups.resize(batch.size());
+        uint32_t* out = partial.row_groups.data();
+        bool above_join = joined != nullptr;
+        auto assign = [&partial, &out, &first, above_join](size_t group, size_t row) {
+            size_t order_key = above_join ? first++ : row;
+            partial.first_rows[group] = min(partial.first_rows[group], order_key);
+            ++partial.counts[group];
+            *out++ = static_cast<uint32_t>(group);
+        };
+        if (int32_key) {
+            const int32_t* keys = group_sources[0].storage->int32_data();
+            for_each_live(batch, group_sources[0].joined, [&](size_t row) {
+                int32_t key = keys[row];
+                assign(add_group(partial, partial.groups.find_or_insert(key, GroupTable::hash(key))), row);
+            });
+        } else if (!joined) {
+            for_each_live(batch, [&](size_t row) {
+                encode_key(partial.key, row, 0);
+                assign(add_group(partial, partial.groups.find_or_insert(partial.key, GroupTable::hash(partial.key))), row);
+            });
+        } else {
+            for (uint32_t live : batch.selection) {
+                size_t row = batch.row(live);
+                encode_key(partial.key, row, batch.joined_row_ids[live]);
+                assign(add_group(partial, partial.groups.find_or_insert(partial.key, GroupTable::hash(partial.key))), row);
+            }
+        }
+        groups = partial.row_groups.data();
+    }
+
+    for (size_t s = 0; s < stride; ++s) {
+        if (!reads_column(specs[s])) {
+            continue;
+        }
+        const Source& source = sources[s];
+        int64_t* accumulator = partial.values.data() + s;
+        if (by_row(s)) {
+            bool maximum = specs[s].function == AggregateFunction::MAX;
+            const uint32_t* group = groups;
+            for_each_live(batch, source.joined, [&](size_t row) {
+                int64_t& best = accumulator[group ? *group++ * stride : 0];
+                if (replaces(*source.storage, maximum, best, static_cast<int64_t>(row))) {
+                    best = static_cast<int64_t>(row);
+                }
+            });
+        } else if (source.storage->get_type() == DataType::INT32) {
+            fold_numbers(batch, source.joined, source.storage->int32_data(), *specs[s].function, accumulator, groups, stride);
+        } else {
+            fold_numbers(batch, source.joined, source.storage->bool_data(), *specs[s].function, accumulator, groups, stride);
+        }
+    }
+}
+
+void AggregateOperator::merge(Partial& into, Partial& from) const {
+    size_t stride = specs.size();
+    for (size_t g = 0; g < from.counts.size(); ++g) {
+        size_t target = 0;
+        if (int32_key) {
+            int32_t key = from.groups.get_int32_key(g);
+            target = into.groups.find_or_insert(key, GroupTable::hash(key));
+        } else if (!group_ordinals.empty()) {
+            string_view key = from.groups.get_key(g);
+            target = into.groups.find_or_insert(key, GroupTable::hash(key));
+        }
+        add_group(into, target);
+        into.counts[target] += from.counts[g];
+        into.first_rows[target] = min(into.first_rows[target], from.first_rows[g]);
+        for (size_t s = 0; s < stride; ++s) {
+            int64_t& result = into.values[target * stride + s];
+            int64_t value = from.values[g * stride + s];
+            if (by_row(s)) {
+                if (replaces(*sources[s].storage, specs[s].function == AggregateFunction::MAX, result, value)) {
+                    result = value;
+                }
+            } else if (specs[s].function == AggregateFunction::MIN) {
+                result = min(result, value);
+            } else if (specs[s].function == AggregateFunction::MAX) {
+                result = max(result, value);
+            } else {
+                result += value;
+            }
+        }
+    }
+}
+
+// Group columns are encoded one after the other: an int32 as its four bytes,
+// a bool as one byte, strings and bytes as a four-byte length and the bytes.
+void AggregateOperator::encode_key(string& key, size_t row, size_t joined_row) const {
+    key.clear();
+    for (const Source& source : group_sources) {
+        const ColumnStorage& storage = *source.storage;
+        size_t at = source.joined ? joined_row : row;
+        switch (storage.get_type()) {
+            case DataType::INT32: {
+                int32_t value = storage.get_int32(at);
+                key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+                break;
+            }
+            case DataType::BOOL:
+                key.push_back(storage.get_bool(at) ? 1 : 0);
+                break;
+            case DataType::STRING:
+            case DataType::BYTES: {
+                string_view value = storage.get_string(at);
+                uint32_t length = static_cast<uint32_t>(value.size());
+                key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                key.append(value);
+                break;
+            }
+        }
+    }
+}
+
+void AggregateOperator::decode_results(Partial& merged) {
+    size_t group_count = merged.counts.size();
+    size_t stride = specs.size();
+    // Encoded fields of every group, in group column order.
+    vector<vector<string_view>> fields(int32_key ? 0 : group_count);
+    if (!int32_key && !group_ordinals.empty()) {
+        for (size_t g = 0; g < group_count; ++g) {
+            string_view key = merged.groups.get_key(g);
+            for (const Source& source : group_sources) {
+                size_t length = 0;
+                switch (source.storage->get_type()) {
+                    case DataType::INT32: length = sizeof(int32_t); break;
+                    case DataType::BOOL: length = 1; break;
+                    case DataType::STRING:
+                    case DataType::BYTES: {
+                        uint32_t stored;
+                        memcpy(&stored, key.data(), sizeof(stored));
+                        key.remove_prefix(sizeof(stored));
+                        length = stored;
+                        break;
+                    }
+                }
+                fields[g].push_back(key.substr(0, length));
+                key.remove_prefix(length);
+            }
+        }
+    }
+
+    results.assign(stride, ColumnVector());
+    for (size_t s = 0; s < stride; ++s) {
+        ColumnVector& column = results[s];
+        const AggregateSpec& spec = specs[s];
+        if (!spec.function) {
+            DataType type = sources[s].storage->get_type();
+            for (size_t g = 0; g < group_count; ++g) {
+                if (int32_key) {
+                    column.kind = ColumnVector::Kind::INT32;
+                    column.int32_values.push_back(merged.groups.get_int32_key(g));
+                    continue;
+                }
+                string_view field = fields[g][key_positions[s]];
+                switch (type) {
+                    case DataType::INT32: {
+                        column.kind = ColumnVector::Kind::INT32;
+                        int32_t value;
+                        memcpy(&value, field.data(), sizeof(value));
+                        column.int32_values.push_back(value);
+                        break;
+                    }
+                    case DataType::BOOL:
+                        column.kind = ColumnVector::Kind::BOOL;
+                        column.bool_values.push_back(static_cast<uint8_t>(field[0]));
+                        break;
+                    case DataType::STRING:
+                        column.kind = ColumnVector::Kind::STRING;
+                        column.string_values.push_back(field);
+                        break;
+                    case DataType::BYTES:
+                        column.kind = ColumnVector::Kind::BYTES;
+                        column.bytes_values.emplace_back(reinterpret_cast<const uint8_t*>(field.data()), field.size());
+                        break;
+                }
+            }
+            continue;
+        }
+        DataType type = reads_column(spec) ? sources[s].storage->get_type() : DataType::INT32;
+        bool extreme = spec.function == AggregateFunction::MIN || spec.function == AggregateFunction::MAX;
+        for (size_t g = 0; g < group_count; ++g) {
+            int64_t count = merged.counts[g];
+            int64_t value = merged.values[g * stride + s];
+            if (*spec.function == AggregateFunction::AVG) {
+                column.kind = ColumnVector::Kind::DOUBLE;
+                column.double_values.push_back(count == 0 ? 0.0 : static_cast<double>(value) / static_cast<double>(count));
+            } else if (extreme && type == DataType::BOOL) {
+                column.kind = ColumnVector::Kind::BOOL;
+                column.bool_values.push_back(count != 0 && value != 0);
+            } else if (extreme && type == DataType::STRING) {
+                column.kind = ColumnVector::Kind::STRING;
+                column.string_values.push_back(value < 0 ? string_view() : sources[s].storage->get_string(static_cast<size_t>(value)));
+            } else if (extreme && type == DataType::BYTES) {
+                column.kind = ColumnVector::Kind::BYTES;
+                column.bytes_values.push_back(value < 0 ? span<const uint8_t>() : sources[s].storage->get_bytes(static_cast<size_t>(value)));
+            } else {
+                column.kind = ColumnVector::Kind::INT64;
+                column.int64_values.push_back(*spec.function == AggregateFunction::COUNT ? count : (count == 0 ? 0 : value));
+            }
+        }
+    }
+
+    output_order.resize(group_count);
+    iota(output_order.begin(), output_order.end(), 0u);
+    sort(output_order.begin(), output_order.end(), [&merged](uint32_t a, uint32_t b) { return merged.first_rows[a] < merged.first_rows[b]; });
+    if (order) {
+        const ColumnVector& key = results[order->first];
+        if (order->second) {
+            stable_sort(output_order.begin(), output_order.end(), [&key](uint32_t a, uint32_t b) { return key.less(b, a); });
+        } else {
+            stable_sort(output_order.begin(), output_order.end(), [&key](uint32_t a, uint32_t b) { return key.less(a, b); });
+        }
+    }
+    if (limit && *limit < output_order.size()) {
+        output_order.resize(*limit);
+    }
+    // The keys stay in the group table's arena, which the results point into.
+    arena = std::move(merged.groups);
+}
+
+static string column_name(const Table& table, size_t ordinal) {
+    return table.get_schema()->get_column(ordinal).get_name();
+}
+
+// A column as ProjectOperator and SortOperator number them above a join.
+static string output_column_name(const Table& table, const Table* joined, size_t ordinal) {
+    size_t columns = table.get_schema()->size();
+    if (ordinal < columns) {
+        return joined ? table.get_name() + "." + column_name(table, ordinal) : column_name(table, ordinal);
+    }
+    return joined->get_name() + "." + column_name(*joined, ordinal - columns);
+}
+
+template <typename T>
+static size_t vector_bytes(const vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+static size_t batch_bytes(const Batch& batch) {
+    size_t bytes = vector_bytes(batch.row_ids) + vector_bytes(batch.joined_row_ids) + vector_bytes(batch.selection);
+    for (const ColumnVector& column : batch.columns) {
+        bytes += vector_bytes(column.int32_values) + vector_bytes(column.int64_values) + vector_bytes(column.double_values)
+               + vector_bytes(column.bool_values) + vector_bytes(column.string_values) + vector_bytes(column.bytes_values);
+    }
+    return bytes;
+}
+
+string ScanOperator::describe() const {
+    string text = "Scan " + table->get_name();
+    switch (path.method) {
+        case AccessMethod::FULL_SCAN:
+            text += " (full scan";
+            break;
+        case AccessMethod::HASH_LOOKUP:
+            text += " (hash index lookup " + column_name(*table, path.ordinal) + " = " + DataTypeHelper::to_literal(path.key);
+            break;
+        case AccessMethod::INDEX_RANGE: {
+            text += " (ordered index on " + column_name(*table, path.ordinal);
+            if (path.range.lower != numeric_limits<int32_t>::min() || path.range.upper != numeric_limits<int32_t>::max()) {
+                text += ", " + to_string(path.range.lower) + " <= key <= " + to_string(path.range.upper);
+            }
+            if (path.presorted) {
+                text += path.descending ? ", in descending order" : ", in order";
+            }
+            break;
+        }
+    }
+    return text + ")";
+}
+
+size_t ScanOperator::rows_skipped(size_t, size_t rows_out) const {
+    return rows - min(rows, rows_out);
+}
+
+size_t FilterOperator::memory_usage() const {
+    size_t bytes = 0;
+    for (const Batch& batch : window) {
+        bytes += batch_bytes(batch);
+    }
+    return bytes;
+}
+
+string ProjectOperator::describe() const {
+    string text = "Project (";
+    for (size_t i = 0; i < projection.size(); ++i) {
+        text += (i == 0 ? "" : ", ") + output_column_name(*table, joined.get(), projection[i]);
+    }
+    return text + ")";
+}
+
+string SortOperator::describe() const {
+    string text = "Sort (" + output_column_name(*table, joined.get(), ordinal) + (descending ? " DESC" : "");
+    if (limit) {
+        text += ", top " + to_string(*limit);
+    }
+    return text + ")";
+}
+
+size_t SortOperator::memory_usage() const {
+    return vector_bytes(sorted_rows) + vector_bytes(sorted_joined_rows);
+}
+
+string HashJoinOperator::describe() const {
+    string text = "Hash join (" + probe_table->get_name() + "." + column_name(*probe_table, probe_ordinal) + " = "
+                + build_table->get_name() + "." + column_name(*build_table, build_ordinal) + ", building on " + build_table->get_name();
+    if (partition_bits > 0) {
+        text += ", " + to_string(partitions.size()) + " partitions";
+    }
+    return text + ")";
+}
+
+size_t HashJoinOperator::memory_usage() const {
+    size_t bytes = batch_bytes(input);
+    for (const Partition& partition : partitions) {
+        bytes += vector_bytes(partition.build_rows) + vector_bytes(partition.build_hashes) + vector_bytes(partition.heads)
+               + vector_bytes(partition.next) + vector_bytes(partition.probe_rows) + vector_bytes(partition.probe_hashes)
+               + vector_bytes(partition.matched_probe_rows) + vector_bytes(partition.matched_build_rows);
+    }
+    return bytes;
+}
+
+string IndexJoinOperator::describe() const {
+    string text = "Index join (" + outer_table->get_name() + "." + column_name(*outer_table, outer_ordinal) + " = "
+                + inner_table->get_name() + "." + column_name(*inner_table, inner_ordinal) + " via "
+                + (inner_table->has_hash_index(inner_ordinal) ? "hash" : "ordered") + " index";
+    if (inner_predicate.get_constant() != true) {
+        text += ", where " + inner_predicate.describe();
+    }
+    return text + ")";
+}
+
+size_t IndexJoinOperator::memory_usage() const {
+    return batch_bytes(input) + vector_bytes(outer_rows) + vector_bytes(matched_rows) + vector_bytes(scratch);
+}
+
+static const char* const AGGREGATE_NAMES[] = {"COUNT", "SUM", "MIN", "MAX", "AVG"};
+
+string AggregateOperator::describe() const {
+    string text = "Aggregate (";
+    for (size_t i = 0; i < specs.size(); ++i) {
+        const AggregateSpec& spec = specs[i];
+        string argument = spec.ordinal ? output_column_name(*table, joined.get(), *spec.ordinal) : "*";
+        text += (i == 0 ? "" : ", ") + (spec.function ? string(AGGREGATE_NAMES[static_cast<size_t>(*spec.function)]) + "(" + argument + ")" : argument);
+    }
+    if (!group_ordinals.empty()) {
+        text += "; group by ";
+        for (size_t i = 0; i < group_ordinals.size(); ++i) {
+            text += (i == 0 ? "" : ", ") + output_column_name(*table, joined.get(), group_ordinals[i]);
+        }
+    }
+    if (order) {
+        text += "; order by item " + to_string(order->first + 1) + (order->second ? " DESC" : "");
+    }
+    if (limit) {
+        text += "; limit " + to_string(*limit);
+    }
+    return text + ")";
+}
+
+size_t AggregateOperator::memory_usage() const {
+    size_t bytes = arena.memory_usage() + vector_bytes(output_order);
+    for (const ColumnVector& column : results) {
+        bytes += vector_bytes(column.int32_values) + vector_bytes(column.int64_values) + vector_bytes(column.double_values)
+               + vector_bytes(column.bool_values) + vector_bytes(column.string_values) + vector_bytes(column.bytes_values);
+    }
+    return bytes;
+}
+
+static void explain_operator(const Operator& op, size_t depth, vector<PlanStage>& stages) {
+    size_t index = stages.size();
+    stages.push_back(PlanStage{op.describe(), depth});
+    size_t rows_in = 0;
+    double inputs_ms = 0;
+    vector<const Operator*> inputs = op.inputs();
+    for (const Operator* input : inputs) {
+        size_t child = stages.size();
+        explain_operator(*input, depth + 1, stages);
+        rows_in += stages[child].rows_out;
+        inputs_ms += stages[child].time_ms;
+    }
+    const ProfiledOperator* profile = op.profile();
+    if (!profile) {
+        return;
+    }
+    PlanStage& stage = stages[index];
+    stage.batches = profile->get_batches();
+    stage.rows_out = profile->get_rows();
+    stage.rows_in = inputs.empty() ? stage.rows_out : rows_in;
+    stage.rows_skipped = op.rows_skipped(stage.rows_in, stage.rows_out);
+    stage.peak_bytes = profile->get_peak_bytes();
+    stage.time_ms = chrono::duration<double, milli>(profile->get_time()).count();
+    stage.self_time_ms = max(0.0, stage.time_ms - inputs_ms);
+}
+
+vector<PlanStage> ExecutionPlan::explain() const {
+    vector<PlanStage> stages;
+    explain_operator(*root, 0, stages);
+    return stages;
+}
+
+static string item_name(const SelectItem& item) {
+    if (!item.aggregate) {
+        return item.column_name;
+    }
+    string argument = item.column_name.empty() ? "*" : item.column_name;
+    return string(AGGREGATE_NAMES[static_cast<size_t>(*item.aggregate)]) + "(" + argument + ")";
+}
+
+// `op`, wrapped in a ProfiledOperator when the plan is profiled.
+static unique_ptr<Operator> stage(unique_ptr<Operator> op, bool profile) {
+    if (profile) {
+        return make_unique<ProfiledOperator>(std::move(op));
+    }
+    return op;
+}
+
+// The group columns, output columns and order of an aggregate query, with
+// `resolve` numbering the columns it names and giving their types.
+struct AggregatePlan {
+    vector<size_t> group_ordinals;
+    vector<AggregateSpec> specs;
+    optional<pair<size_t, bool>> order;
+};
+
+static AggregatePlan plan_aggregate(const SelectStatement& select, const function<pair<size_t, DataType>(const string&)>& resolve,
+                                    vector<string>& column_names) {
+    AggregatePlan plan;
+    for (const auto& column_name : select.group_by) {
+        plan.group_ordinals.push_back(resolve(column_name).first);
+    }
+    for (const SelectItem& item : select.items) {
+        AggregateSpec spec;
+        spec.function = item.aggregate;
+        DataType type = DataType::INT32;
+        if (!item.column_name.empty()) {
+            tie(spec.ordinal, type) = resolve(item.column_name);
+        }
+        if (!item.aggregate && find(plan.group_ordinals.begin(), plan.group_ordinals.end(), *spec.ordinal) == plan.group_ordinals.end()) {
+            throw InvalidQueryException("Column '" + item.column_name + "' must appear in GROUP BY or in an aggregate");
+        }
+        if (sums(spec) && type != DataType::INT32 && type != DataType::BOOL) {
+            throw InvalidQueryException(item_name(item) + " needs an int32 or bool column");
+        }
+        plan.specs.push_back(spec);
+        column_names.push_back(item_name(item));
+    }
+
+    if (select.order_by) {
+        for (size_t i = 0; i < select.items.size() && !plan.order; ++i) {
+            if (select.items[i].aggregate == select.order_by->aggregate && select.items[i].column_name == select.order_by->column_name) {
+                plan.order = make_pair(i, select.order_by->descending);
+            }
+        }
+        if (!plan.order) {
+            throw InvalidQueryException("ORDER BY of an aggregate query must name one of its SELECT items");
+        }
+    }
+    return plan;
+}
+
+// Scan -> Filter -> Aggregate. The access path is planned without the ORDER
+// BY and LIMIT, which apply to the groups.
+static ExecutionPlan build_aggregate(const SelectStatement& select, shared_ptr<const Table> table, span<const ValueType> parameters, shared_ptr<ThreadPool> pool,
+                                     bool profile) {
+    shared_ptr<const Schema> schema = table->get_schema();
+    ExecutionPlan plan;
+    auto [group_ordinals, specs, order] = plan_aggregate(select, [&schema](const string& name) {
+        size_t ordinal = schema->get_column_ordinal(name);
+        return make_pair(ordinal, schema->get_column(ordinal).get_type());
+    }, plan.column_names);
+
+    SelectStatement scan = select;
+    scan.items.clear();
+    scan.group_by.clear();
+    scan.order_by.reset();
+    scan.limit.reset();
+    ScanPlan scan_plan = plan_scan(scan, *table, parameters);
+    unique_ptr<Operator> root = stage(make_unique<ScanOperator>(table, scan_plan.path), profile);
+    root = stage(make_unique<FilterOperator>(std::move(root), std::move(scan_plan.predicate), pool), profile);
+    plan.root = stage(make_unique<AggregateOperator>(std::move(root), table, std::move(group_ordinals), std::move(specs), order, select.limit, std::move(pool)), profile);
+    return plan;
+}
+
+ExecutionPlan ExecutionPlan::build_select(const SelectStatement& select, shared_ptr<const Table> table, span<const ValueType> parameters, shared_ptr<ThreadPool> pool,
+                                          bool profile) {
+    if (!select.items.empty()) {
+        return build_aggregate(select, std::move(table), parameters, std::move(pool), profile);
+    }
+    shared_ptr<const Schema> schema = table->get_schema();
+    ExecutionPlan plan;
+    vector<size_t> projection;
+    if (select.column_names.empty()) {
+        for (size_t i = 0; i < schema->size(); ++i) {
+            projection.push_back(i);
+        }
+    } else {
+        for (const auto& column_name : select.column_names) {
+            projection.push_back(schema->get_column_ordinal(column_name));
+        }
+    }
+    for (size_t ordinal : projection) {
+        plan.column_names.push_back(schema->get_column(ordinal).get_name());
+    }
+
+    auto [predicate, path] = plan_scan(select, *table, parameters);
+    bool needs_sort = path.order_ordinal && !path.presorted;
+    // Filtered serially for the same reason RowScanner drops its pool.
+    if (path.limit && !needs_sort) {
+        pool = nullptr;
+    }
+    unique_ptr<Operator> root = stage(make_unique<ScanOperator>(table, path), profile);
+    root = stage(make_unique<FilterOperator>(std::move(root), std::move(predicate), std::move(pool)), profile);
+    if (needs_sort) {
+        root = stage(make_unique<SortOperator>(std::move(root), table, *path.order_ordinal, path.descending, path.limit), profile);
+    }
+    if (path.limit) {
+        root = stage(make_unique<LimitOperator>(std::move(root), *path.limit), profile);
+    }
+    plan.root = stage(make_unique<ProjectOperator>(std::move(root), table, std::move(projection)), profile);
+    return plan;
+}
+
+// Side (0 for the FROM table, 1 for the JOIN table) and ordinal of a column named in a join query.
+static pair<size_t, size_t> resolve_join_column(const string& name, const shared_ptr<const Table> (&tables)[2]) {
+    size_t dot = name.find('.');
+    if (dot != string::npos) {
+        string table_name = name.substr(0, dot);
+        string column_name = name.substr(dot + 1);
+        for (size_t side = 0; side < 2; ++side) {
+            if (tables[side]->get_name() != table_name) {
+                continue;
+            }
+            if (!tables[side]->has_column(column_name)) {
+                throw InvalidQueryException("Column not found: " + name);
+            }
+            return {side, tables[side]->get_column_ordinal(column_name)};
+        }
+        throw InvalidQueryException("Table '" + table_name + "' is not part of the query");
+    }
+    bool in_left = tables[0]->has_column(name);
+    bool in_right = tables[1]->has_column(name);
+    if (in_left && in_right) {
+        throw InvalidQueryException("Column '" + name + "' is ambiguous; qualify it with its table");
+    }
+    if (!in_left && !in_right) {
+        throw InvalidQueryException("Column not found: " + name);
+    }
+    size_t side = in_left ? 0 : 1;
+    return {side, tables[side]->get_column_ordinal(name)};
+}
+
+// Copy of `expr` naming its columns without their tables; sets bit `side` of
+// `sides` for every table whose columns it reads.
+static shared_ptr<const Expr> unqualify(const Expr& expr, const shared_ptr<const Table> (&tables)[2], unsigned& sides) {
+    auto copy = make_shared<Expr>(expr);
+    if (expr.type == ExprType::COLUMN) {
+        auto [side, ordinal] = resolve_join_column(expr.column_name, tables);
+        sides |= 1u << side;
+        copy->column_name = tables[side]->get_schema()->get_column(ordinal).get_name();
+    }
+    for (auto& child : copy->children) {
+        child = unqualify(*child, tables, sides);
+    }
+    return copy;
+}
+
+ExecutionPlan ExecutionPlan::build_join(const SelectStatement& select, shared_ptr<const Table> table, shared_ptr<const Table> joined,
+                                        span<const ValueType> parameters, shared_ptr<ThreadPool> pool, bool profile) {
+    if (table == joined) {
+        throw InvalidQueryException("A table cannot be joined with itself");
+    }
+    const shared_ptr<const Table> tables[2] = {std::move(table), std::move(joined)};
+
+    auto [left_side, left_ordinal] = resolve_join_column(select.join->left_column, tables);
+    auto [right_side, right_ordinal] = resolve_join_column(select.join->right_column, tables);
+    if (left_side == right_side) {
+        throw InvalidQueryException("JOIN ... ON must compare a column of each table");
+    }
+    size_t keys[2];
+    keys[left_side] = left_ordinal;
+    keys[right_side] = right_ordinal;
+    if (tables[0]->get_column_storage(keys[0]).get_type() != tables[1]->get_column_storage(keys[1]).get_type()) {
+        throw InvalidQueryException("Join columns must have the same type");
+    }
+
+    // Each condition of the top-level AND goes below the join, to the table it reads.
+    vector<shared_ptr<const Expr>> conditions[2];
+    if (select.where) {
+        vector<shared_ptr<const Expr>> conjuncts;
+        if (select.where->type == ExprType::AND) {
+            conjuncts = select.where->children;
+        } else {
+            conjuncts.push_back(select.where);
+        }
+        for (const auto& conjunct : conjuncts) {
+            unsigned sides = 0;
+            auto condition = unqualify(*conjunct, tables, sides);
+            if (sides == 3) {
+                throw InvalidQueryException("Each WHERE condition of a join must read one table");
+            }
+            conditions[sides == 2 ? 1 : 0].push_back(std::move(condition));
+        }
+    }
+
+    Expression predicates[2];
+    AccessPath paths[2];
+    JoinSide sides[2];
+    for (size_t side = 0; side < 2; ++side) {
+        // One table is locked at a time while it is planned, so that joins
+        // naming the tables in either order cannot deadlock.
+        auto lock = tables[side]->lock_shared();
+        SelectStatement scan;
+        scan.table_name = tables[side]->get_name();
+        if (conditions[side].size() == 1) {
+            scan.where = conditions[side].front();
+        } else if (!conditions[side].empty()) {
+            auto both = make_shared<Expr>();
+            both->type = ExprType::AND;
+            both->children = std::move(conditions[side]);
+            scan.where = std::move(both);
+        }
+        if (scan.where) {
+            predicates[side] = Expression::compile(scan.where, *tables[side], parameters);
+        }
+        paths[side] = QueryPlanner::choose_access_path(scan, *tables[side], parameters);
+        sides[side].rows = QueryPlanner::estimate_rows(*tables[side], paths[side]);
+        sides[side].indexed = tables[side]->has_hash_index(keys[side]) || tables[side]->has_ordered_index(keys[side]);
+    }
+    JoinPath join = QueryPlanner::choose_join_method(sides[0], sides[1]);
+    size_t outer = join.left_outer ? 0 : 1;
+    size_t inner = 1 - outer;
+
+    // Output ordinals count the outer table's columns first, as ProjectOperator reads them.
+    size_t outer_columns = tables[outer]->get_schema()->size();
+    auto output_ordinal = [&](size_t side, size_t ordinal) { return side == outer ? ordinal : outer_columns + ordinal; };
+    auto input = [&](size_t side) -> unique_ptr<Operator> {
+        unique_ptr<Operator> root = stage(make_unique<ScanOperator>(tables[side], paths[side]), profile);
+        return stage(make_unique<FilterOperator>(std::move(root), std::move(predicates[side]), pool), profile);
+    };
+    auto join_inputs = [&]() -> unique_ptr<Operator> {
+        if (join.method == JoinMethod::INDEX_NESTED_LOOP) {
+            return stage(make_unique<IndexJoinOperator>(input(outer), tables[outer], keys[outer], tables[inner], keys[inner], std::move(predicates[inner])), profile);
+        }
+        return stage(make_unique<HashJoinOperator>(input(outer), tables[outer], keys[outer], input(inner), tables[inner], keys[inner], pool), profile);
+    };
+    ExecutionPlan plan;
+
+    // Only the groups leave the engine: Join -> Aggregate, which takes the ORDER BY and LIMIT.
+    if (!select.items.empty()) {
+        auto [group_ordinals, specs, order] = plan_aggregate(select, [&](const string& name) {
+            auto [side, ordinal] = resolve_join_column(name, tables);
+            return make_pair(output_ordinal(side, ordinal), tables[side]->get_column_storage(ordinal).get_type());
+        }, plan.column_names);
+        unique_ptr<Operator> root = join_inputs();
+        plan.root = stage(make_unique<AggregateOperator>(std::move(root), tables[outer], std::move(group_ordinals), std::move(specs), order, select.limit,
+                                                         std::move(pool), tables[inner]), profile);
+        return plan;
+    }
+
+    vector<size_t> projection;
+    if (select.column_names.empty()) {
+        for (size_t side = 0; side < 2; ++side) {
+            const Schema& schema = *tables[side]->get_schema();
+            for (size_t i = 0; i < schema.size(); ++i) {
+                const string& name = schema.get_column(i).get_name();
+                projection.push_back(output_ordinal(side, i));
+                plan.column_names.push_back(tables[1 - side]->has_column(name) ? tables[side]->get_name() + "." + name : name);
+            }
+        }
+    } else {
+        for (const auto& column_name : select.column_names) {
+            auto [side, ordinal] = resolve_join_column(column_name, tables);
+            projection.push_back(output_ordinal(side, ordinal));
+            plan.column_names.push_back(column_name);
+        }
+    }
+    optional<size_t> order_ordinal;
+    if (select.order_by) {
+        if (select.order_by->aggregate) {
+            throw InvalidQueryException("ORDER BY an aggregate needs an aggregate query");
+        }
+        auto [side, ordinal] = resolve_join_column(select.order_by->column_name, tables);
+        order_ordinal = output_ordinal(side, ordinal);
+    }
+
+    if (select.limit && !order_ordinal) {
+        pool = nullptr;
+    }
+    unique_ptr<Operator> root = join_inputs();
+    if (order_ordinal) {
+        root = stage(make_unique<SortOperator>(std::move(root), tables[outer], *order_ordinal, select.order_by->descending, select.limit, tables[inner]), profile);
+    }
+    if (select.limit) {
+        root = stage(make_unique<LimitOperator>(std::move(root), *select.limit), profile);
+    }
+    plan.root = stage(make_unique<ProjectOperator>(std::move(root), tables[outer], std::move(projection), tables[inner]), profile);
+    return plan;
+}
@@ -0,0 +1,279 @@
+#include "ordered_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+OrderedIndex::OrderedIndex() {
+    clear();
+}
+
+int32_t OrderedIndex::key_of(const ColumnStorage& storage, size_t row) {
+    switch (storage.get_type()) {
+        case DataType::INT32: return storage.get_int32(row);
+        case DataType::BOOL: return storage.get_bool(row) ? 1 : 0;
+        default: break;
+    }
+    throw runtime_error("Ordered indexes support int32 and bool columns only.");
+}
+
+void OrderedIndex::clear() {
+    leaves.assign(1, Leaf());
+    inners.clear();
+    root = 0;
+    height = 0;
+    last_leaf = 0;
+    count = 0;
+}
+
+void OrderedIndex::insert(int32_t key, size_t row) {
+    auto split = insert_into(root, height, key, row);
+    if (split) {
+        Inner new_root;
+        new_root.size = 1;
+        new_root.keys[0] = split->separator;
+        new_root.children[0] = root;
+        new_root.children[1] = split->node;
+        inners.push_back(new_root);
+        root = static_cast<uint32_t>(inners.size() - 1);
+        ++height;
+    }
+    ++count;
+}
+
+optional<OrderedIndex::Split> OrderedIndex::insert_into(uint32_t node, size_t level, int32_t key, size_t row) {
+    if (level == 0) {
+        return insert_into_leaf(node, key, row);
+    }
+
+    // Equal keys descend to the rightmost candidate child so they stay in insertion order.
+    const Inner& parent = inners[node];
+    size_t child = upper_bound(parent.keys, parent.keys + parent.size, key) - parent.keys;
+    auto split = insert_into(parent.children[child], level - 1, key, row);
+    if (!split) {
+        return nullopt;
+    }
+
+    Inner* inner = &inners[node];
+    if (inner->size < NODE_CAPACITY) {
+        copy_backward(inner->keys + child, inner->keys + inner->size, inner->keys + inner->size + 1);
+        copy_backward(inner->children + child + 1, inner->children + inner->size + 1, inner->children + inner->size + 2);
+        inner->keys[child] = split->separator;
+        inner->children[child + 1] = split->node;
+        ++inner->size;
+        return nullopt;
+    }
+
+    // Full: lay out the NODE_CAPACITY + 1 separators in order, keep the lower
+    // half, and push the middle separator up.
+    int32_t keys[NODE_CAPACITY + 1];
+    uint32_t children[NODE_CAPACITY + 2];
+    copy(inner->keys, inner->keys + child, keys);
+    keys[child] = split->separator;
+    copy(inner->keys + child, inner->keys + NODE_CAPACITY, keys + child + 1);
+    copy(inner->children, inner->children + child + 1, children);
+    children[child + 1] = split->node;
+    copy(inner->children + child + 1, inner->children + NODE_CAPACITY + 1, children + child + 2);
+
+    size_t middle = (NODE_CAPACITY + 1) / 2;
+    Inner right;
+    right.size = static_cast<uint32_t>(NODE_CAPACITY - middle);
+    copy(keys + middle + 1, keys + NODE_CAPACITY + 1, right.keys);
+    copy(children + middle + 1, children + NODE_CAPACITY + 2, right.children);
+
+    inner->size = static_cast<uint32_t>(middle);
+    copy(keys, keys + middle, inner->keys);
+    copy(children, children + middle + 1, inner->children);
+
+    inners.push_back(right);
+    return Split{keys[middle], static_cast<uint32_t>(inners.size() - 1)};
+}
+
+optional<OrderedIndex::Split> OrderedIndex::insert_into_leaf(uint32_t node, int32_t key, size_t row) {
+    Leaf* leaf = &leaves[node];
+    size_t position = upper_bound(leaf->keys, leaf->keys + leaf->size, key) - leaf->keys;
+    if (leaf->size < NODE_CAPACITY) {
+        copy_backward(leaf->keys + position, leaf->keys + leaf->size, leaf->keys + leaf->size + 1);
+        copy_backward(leaf->rows + position, leaf->rows + leaf->size, leaf->rows + leaf->size + 1);
+        leaf->keys[position] = key;
+        leaf->rows[position] = row;
+        ++leaf->size;
+        return nullopt;
+    }
+
+    uint32_t right_node = static_cast<uint32_t>(leaves.size());
+    leaves.emplace_back();
+    leaf = &leaves[node];
+    Leaf& right = leaves.back();
+    right.next = leaf->next;
+    right.prev = node;
+    leaf->next = right_node;
+    if (right.next != NO_NODE) {
+        leaves[right.next].prev = right_node;
+    }
+    if (node == last_leaf) {
+        last_leaf = right_node;
+    }
+
+    if (position == NODE_CAPACITY && right.next == NO_NODE) {
+        // Appending past the largest key (e.g. an autoincrement column): start
+        // a new leaf and leave this one full instead of splitting it in half.
+        right.keys[0] = key;
+        right.rows[0] = row;
+        right.size = 1;
+        return Split{key, right_node};
+    }
+
+    size_t middle = NODE_CAPACITY / 2;
+    right.size = static_cast<uint32_t>(NODE_CAPACITY - middle);
+    copy(leaf->keys + middle, leaf->keys + NODE_CAPACITY, right.keys);
+    copy(leaf->rows + middle, leaf->rows + NODE_CAPACITY, right.rows);
+    leaf->size = static_cast<uint32_t>(middle);
+
+    Leaf& target = position <= middle ? *leaf : right;
+    size_t offset = position <= middle ? position : position - middle;
+    copy_backward(target.keys + offset, target.keys + target.size, target.keys + target.size + 1);
+    copy_backward(target.rows + offset, target.rows + target.size, target.rows + target.size + 1);
+    target.keys[offset] = key;
+    target.rows[offset] = row;
+    ++target.size;
+    return Split{right.keys[0], right_node};
+}
+
+void OrderedIndex::rebuild(const ColumnStorage& storage) {
+    clear();
+    size_t rows = storage.size();
+    if (rows == 0) {
+        return;
+    }
+
+    vector<pair<int32_t, uint64_t>> entries(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        entries[row] = {key_of(storage, row), row};
+    }
+    sort(entries.begin(), entries.end());
+
+    leaves.assign((rows + NODE_CAPACITY - 1) / NODE_CAPACITY, Leaf());
+    vector<pair<int32_t, uint32_t>> level;
+    level.reserve(leaves.size());
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        Leaf& leaf = leaves[i];
+        size_t begin = i * NODE_CAPACITY;
+        leaf.size = static_cast<uint32_t>(min(NODE_CAPACITY, rows - begin));
+        for (size_t j = 0; j < leaf.size; ++j) {
+            leaf.keys[j] = entries[begin + j].first;
+            leaf.rows[j] = entries[begin + j].second;
+        }
+        leaf.next = i + 1 < leaves.size() ? static_cast<uint32_t>(i + 1) : NO_NODE;
+        leaf.prev = i > 0 ? static_cast<uint32_t>(i - 1) : NO_NODE;
+        level.emplace_back(leaf.keys[0], static_cast<uint32_t>(i));
+    }
+    last_leaf = static_cast<uint32_t>(leaves.size() - 1);
+    count = rows;
+
+    // Group each level's nodes under parents of NODE_CAPACITY + 1 children until one remains.
+    while (level.size() > 1) {
+        vector<pair<int32_t, uint32_t>> parents;
+        for (size_t begin = 0; begin < level.size(); begin += NODE_CAPACITY + 1) {
+            size_t end = min(level.size(), begin + NODE_CAPACITY + 1);
+            Inner inner;
+            inner.size = static_cast<uint32_t>(end - begin - 1);
+            for (size_t j = begin; j < end; ++j) {
+                inner.children[j - begin] = level[j].second;
+                if (j > begin) {
+                    inner.keys[j - begin - 1] = level[j].first;
+                }
+            }
+            inners.push_back(inner);
+            parents.emplace_back(level[begin].first, static_cast<uint32_t>(inners.size() - 1));
+        }
+        level = std::move(parents);
+        ++height;
+    }
+    root = level.front().second;
+}
+
+OrderedIndex::RangeIterator OrderedIndex::range(const KeyRange& range, bool descending) const {
+    RangeIterator it;
+    it.index = this;
+    it.descending = descending;
+    if (range.is_empty() || count == 0) {
+        return it;
+    }
+    it.lower = static_cast<int32_t>(max<int64_t>(range.lower, numeric_limits<int32_t>::min()));
+    it.upper = static_cast<int32_t>(min<int64_t>(range.upper, numeric_limits<int32_t>::max()));
+
+    // Going forward, start at the leftmost leaf that can hold `lower`: equal
+    // keys may straddle a split, so the search goes left of an equal
+    // separator. Going backward, start right of every key <= `upper`.
+    uint32_t node = root;
+    for (size_t level = height; level > 0; --level) {
+        const Inner& inner = inners[node];
+        const int32_t* separator = descending ? upper_bound(inner.keys, inner.keys + inner.size, it.upper)
+                                              : lower_bound(inner.keys, inner.keys + inner.size, it.lower);
+        node = inner.children[separator - inner.keys];
+    }
+
+    const Leaf& leaf = leaves[node];
+    it.leaf = node;
+    it.position = static_cast<uint32_t>(descending ? upper_bound(leaf.keys, leaf.keys + leaf.size, it.upper) - leaf.keys
+                                                   : lower_bound(leaf.keys, leaf.keys + leaf.size, it.lower) - leaf.keys);
+    return it;
+}
+
+bool OrderedIndex::RangeIterator::next(size_t& row) {
+    int32_t key;
+    return next(row, key);
+}
+
+bool OrderedIndex::RangeIterator::next(size_t& row, int32_t& key) {
+    while (leaf != NO_NODE) {
+        const Leaf& current = index->leaves[leaf];
+        if (!descending && position < current.size) {
+            if (current.keys[position] > upper) {
+                break;
+            }
+            key = current.keys[position];
+            row = current.rows[position++];
+            return true;
+        }
+        if (descending && position > 0) {
+            if (current.keys[position - 1] < lower) {
+                break;
+            }
+            key = current.keys[position - 1];
+            row = current.rows[--position];
+            return true;
+        }
+        leaf = descending ? current.prev : current.next;
+        position = descending && leaf != NO_NODE ? index->leaves[leaf].size : 0;
+    }
+    leaf = NO_NODE;
+    return false;
+}
+
+void OrderedIndex::scan(const KeyRange& range, vector<size_t>& rows) const {
+    RangeIterator it = this->range(range);
+    size_t row;
+    while (it.next(row)) {
+        rows.push_back(row);
+    }
+}
+
+double OrderedIndex::estimate_selectivity(const KeyRange& range) const {
+    if (count == 0 || range.is_empty()) {
+        return 0.0;
+    }
+    int64_t smallest = leaves.front().keys[0];
+    int64_t largest = leaves[last_leaf].keys[leaves[last_leaf].size - 1];
+    int64_t lower = max(range.lower, smallest);
+    int64_t upper = min(range.upper, largest);
+    if (lower > upper) {
+        return 0.0;
+    }
+    return static_cast<double>(upper - lower + 1) / static_cast<double>(largest - smallest + 1);
+}
+
+size_t OrderedIndex::memory_usage() const {
+    return leaves.capacity() * sizeof(Leaf) + inners.capacity() * sizeof(Inner);
+}
@@ -0,0 +1,517 @@
+#include "parser.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+
+static bool equals_ignore_case(string_view a, string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static vector<uint8_t> decode_hex(string_view text) {
+    string_view digits = text.substr(2);
+    if (digits.empty() || digits.size() % 2 != 0) {
+        throw InvalidQueryException("Hex literal must have an even number of digits: " + string(text));
+    }
+    vector<uint8_t> bytes;
+    bytes.reserve(digits.size() / 2);
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        uint8_t byte = 0;
+        from_chars(digits.data() + i, digits.data() + i + 2, byte, 16);
+        bytes.push_back(byte);
+    }
+    return bytes;
+}
+
+static string unescape_string(string_view text) {
+    string value;
+    value.reserve(text.size() - 2);
+    for (size_t i = 1; i + 1 < text.size(); ++i) {
+        value.push_back(text[i]);
+        if (text[i] == '\'') {
+            ++i;
+        }
+    }
+    return value;
+}
+
+Statement Parser::parse(string_view query) {
+    Parser parser(query);
+    return parser.parse_statement();
+}
+
+Statement Parser::parse_statement() {
+    Token token = tokenizer.peek();
+    Statement statement;
+
+    if (accept_keyword("CREATE")) {
+        if (accept_keyword("INDEX")) {
+            statement = parse_create_index();
+        } else {
+            statement = parse_create();
+        }
+    } else if (token.type == TokenType::IDENTIFIER && equals_ignore_case(token.text, "INSERT")) {
+        statement = parse_insert();
+    } else if (token.type == TokenType::IDENTIFIER && equals_ignore_case(token.text, "SELECT")) {
+        statement = parse_select();
+    } else if (accept_keyword("EXPLAIN")) {
+        ExplainStatement explain;
+        explain.analyze = accept_keyword("ANALYZE");
+        Token next = tokenizer.peek();
+        if (next.type != TokenType::IDENTIFIER || !equals_ignore_case(next.text, "SELECT")) {
+            fail("Only SELECT statements can be explained", next);
+        }
+        explain.select = parse_select();
+        statement = std::move(explain);
+    } else {
+        fail("Unsupported query", token);
+    }
+
+    accept_symbol(";");
+    Token end = tokenizer.next();
+    if (end.type != TokenType::END) {
+        fail("Unexpected trailing input", end);
+    }
+    return statement;
+}
+
+CreateTableStatement Parser::parse_create() {
+    CreateTableStatement statement;
+    expect_keyword("TABLE");
+    statement.table_name = parse_identifier();
+
+    expect_symbol("(");
+    do {
+        statement.columns.push_back(parse_column_definition());
+    } while (accept_symbol(","));
+    expect_symbol(")");
+
+    return statement;
+}
+
+CreateIndexStatement Parser::parse_create_index() {
+    CreateIndexStatement statement;
+    if (!accept_keyword("ON")) {
+        statement.index_name = parse_identifier();
+        expect_keyword("ON");
+    }
+    statement.table_name = parse_identifier();
+    expect_symbol("(");
+    statement.column_name = parse_identifier();
+    expect_symbol(")");
+    return statement;
+}
+
+ColumnDefinition Parser::parse_column_definition() {
+    ColumnDefinition column;
+
+    if (accept_symbol("{")) {
+        while (!accept_symbol("}")) {
+            Token attribute = tokenizer.next();
+            if (attribute.type == TokenType::IDENTIFIER && equals_ignore_case(attribute.text, "autoincrement")) {
+                column.autoincrement = true;
+            } else if (attribute.type == TokenType::IDENTIFIER && equals_ignore_case(attribute.text, "unique")) {
+                column.unique = true;
+            } else if (attribute.type == TokenType::IDENTIFIER && equals_ignore_case(attribute.text, "key")) {
+                column.key = true;
+            } else if (attribute.type == TokenType::IDENTIFIER && equals_ignore_case(attribute.text, "index")) {
+                column.indexed = true;
+            } else if (attribute.type == TokenType::IDENTIFIER && equals_ignore_case(attribute.text, "dictionary")) {
+                column.dictionary = true;
+            } else {
+                fail("Unknown column attribute", attribute);
+            }
+            accept_symbol(",");
+        }
+    }
+
+    column.name = parse_identifier();
+    expect_symbol(":");
+
+    Token type = tokenizer.next();
+    if (type.type == TokenType::IDENTIFIER && equals_ignore_case(type.text, "int32")) {
+        column.type = DataType::INT32;
+    } else if (type.type == TokenType::IDENTIFIER && equals_ignore_case(type.text, "bool")) {
+        column.type = DataType::BOOL;
+    } else if (type.type == TokenType::IDENTIFIER && equals_ignore_case(type.text, "string")) {
+        column.type = DataType::STRING;
+    } else if (type.type == TokenType::IDENTIFIER && equals_ignore_case(type.text, "bytes")) {
+        column.type = DataType::BYTES;
+    } else {
+        fail("Unsupported column type", type);
+    }
+    if (column.dictionary && column.type != DataType::STRING && column.type != DataType::BYTES) {
+        fail("Only string and bytes columns can be dictionary encoded", type);
+    }
+
+    if ((column.type == DataType::STRING || column.type == DataType::BYTES) && accept_symbol("[")) {
+        column.length = parse_count("column length");
+        expect_symbol("]");
+    }
+
+    if (accept_symbol("=")) {
+        Token token = tokenizer.peek();
+        ValueType value = parse_literal();
+        if (!DataTypeHelper::validate(value, column.type)) {
+            fail("Invalid default value for " + DataTypeHelper::type_to_string(column.type) + " column '" + column.name + "'", token);
+        }
+        size_t size = 0;
+        if (const auto* text = get_if<string>(&value)) {
+            size = text->size();
+        } else if (const auto* bytes = get_if<vector<uint8_t>>(&value)) {
+            size = bytes->size();
+        }
+        if (column.length != 0 && size > column.length) {
+            fail("Default value is longer than column '" + column.name + "' allows", token);
+        }
+        column.default_value = std::move(value);
+    }
+
+    return column;
+}
+
+InsertStatement Parser::parse_insert() {
+    InsertStatement statement;
+    expect_keyword("INSERT");
+
+    if (accept_symbol("(")) {
+        statement.rows.emplace_back();
+        do {
+            parse_insert_column(statement);
+            expect_symbol("=");
+            parse_insert_value(statement);
+        } while (accept_symbol(","));
+        expect_symbol(")");
+        expect_keyword("TO");
+        statement.table_name = parse_identifier();
+        return statement;
+    }
+
+    expect_keyword("INTO");
+    statement.table_name = parse_identifier();
+
+    if (accept_symbol("(")) {
+        do {
+            parse_insert_column(statement);
+        } while (accept_symbol(","));
+        expect_symbol(")");
+    }
+
+    expect_keyword("VALUES");
+    do {
+        expect_symbol("(");
+        statement.rows.emplace_back();
+        while (!accept_symbol(")")) {
+            parse_insert_value(statement);
+            accept_symbol(",");
+        }
+
+        size_t expected = statement.column_names.empty() ? statement.rows.front().size() : statement.column_names.size();
+        if (statement.rows.back().size() != expected) {
+            throw InvalidQueryException("Row " + to_string(statement.rows.size()) + " has " + to_string(statement.rows.back().size()) + " values, expected " + to_string(expected));
+        }
+    } while (accept_symbol(","));
+
+    return statement;
+}
+
+void Parser::parse_insert_column(InsertStatement& statement) {
+    Token token = tokenizer.peek();
+    string name = parse_identifier();
+    if (find(statement.column_names.begin(), statement.column_names.end(), name) != statement.column_names.end()) {
+        fail("Duplicate column '" + name + "' in INSERT", token);
+    }
+    statement.column_names.push_back(std::move(name));
+}
+
+void Parser::parse_insert_value(InsertStatement& statement) {
+    vector<ValueType>& row = statement.rows.back();
+    if (accept_symbol("?")) {
+        statement.parameters.emplace_back(statement.rows.size() - 1, row.size());
+        row.emplace_back();
+    } else {
+        row.push_back(parse_literal());
+    }
+}
+
+SelectStatement Parser::parse_select() {
+    SelectStatement statement;
+    expect_keyword("SELECT");
+
+    bool has_aggregate = false;
+    if (!accept_symbol("*")) {
+        do {
+            statement.items.push_back(parse_select_item());
+            has_aggregate = has_aggregate || statement.items.back().aggregate;
+        } while (accept_symbol(","));
+    }
+
+    expect_keyword("FROM");
+    statement.table_name = parse_identifier();
+    if (accept_keyword("INNER")) {
+        expect_keyword("JOIN");
+        statement.join.emplace();
+    } else if (accept_keyword("JOIN")) {
+        statement.join.emplace();
+    }
+    if (statement.join) {
+        statement.join->table_name = parse_identifier();
+        expect_keyword("ON");
+        statement.join->left_column = parse_column_name();
+        expect_symbol("=");
+        statement.join->right_column = parse_column_name();
+    }
+
+    if (accept_keyword("WHERE")) {
+        statement.where = parse_or();
+    }
+    if (accept_keyword("GROUP")) {
+        expect_keyword("BY");
+        do {
+            statement.group_by.push_back(parse_column_name());
+        } while (accept_symbol(","));
+    }
+    if (!has_aggregate && statement.group_by.empty()) {
+        for (auto& item : statement.items) {
+            statement.column_names.push_back(std::move(item.column_name));
+        }
+        statement.items.clear();
+    } else if (statement.items.empty()) {
+        fail("Aggregate queries list their columns", tokenizer.peek());
+    }
+    if (accept_keyword("ORDER")) {
+        expect_keyword("BY");
+        OrderByClause order_by;
+        SelectItem item = parse_select_item();
+        order_by.column_name = std::move(item.column_name);
+        order_by.aggregate = item.aggregate;
+        if (accept_keyword("DESC")) {
+            order_by.descending = true;
+        } else {
+            accept_keyword("ASC");
+        }
+        statement.order_by = std::move(order_by);
+    }
+    if (accept_keyword("LIMIT")) {
+        statement.limit = parse_count("row count");
+    }
+    statement.parameter_count = parameter_count;
+    return statement;
+}
+
+SelectItem Parser::parse_select_item() {
+    static const pair<string_view, AggregateFunction> functions[] = {
+        {"COUNT", AggregateFunction::COUNT}, {"SUM", AggregateFunction::SUM}, {"MIN", AggregateFunction::MIN},
+        {"MAX", AggregateFunction::MAX}, {"AVG", AggregateFunction::AVG},
+    };
+    SelectItem item;
+    Token name = tokenizer.peek();
+    item.column_name = parse_column_name();
+    if (!accept_symbol("(")) {
+        return item;
+    }
+    for (const auto& [function_name, function] : functions) {
+        if (equals_ignore_case(item.column_name, function_name)) {
+            item.aggregate = function;
+        }
+    }
+    if (!item.aggregate) {
+        fail("Unknown aggregate function", name);
+    }
+    item.column_name.clear();
+    if (*item.aggregate == AggregateFunction::COUNT && accept_symbol("*")) {
+        expect_symbol(")");
+        return item;
+    }
+    item.column_name = parse_column_name();
+    expect_symbol(")");
+    return item;
+}
+
+shared_ptr<const Expr> Parser::parse_or() {
+    auto left = parse_and();
+    if (!accept_keyword("OR")) {
+        return left;
+    }
+    auto node = make_shared<Expr>();
+    node->type = ExprType::OR;
+    node->children.push_back(left);
+    do {
+        node->children.push_back(parse_and());
+    } while (accept_keyword("OR"));
+    return node;
+}
+
+shared_ptr<const Expr> Parser::parse_and() {
+    auto left = parse_not();
+    if (!accept_keyword("AND")) {
+        return left;
+    }
+    auto node = make_shared<Expr>();
+    node->type = ExprType::AND;
+    node->children.push_back(left);
+    do {
+        node->children.push_back(parse_not());
+    } while (accept_keyword("AND"));
+    return node;
+}
+
+shared_ptr<const Expr> Parser::parse_not() {
+    if (accept_keyword("NOT")) {
+        auto node = make_shared<Expr>();
+        node->type = ExprType::NOT;
+        node->children.push_back(parse_not());
+        return node;
+    }
+    return parse_comparison();
+}
+
+shared_ptr<const Expr> Parser::parse_comparison() {
+    if (accept_symbol("(")) {
+        auto inner = parse_or();
+        expect_symbol(")");
+        return inner;
+    }
+
+    auto left = parse_operand();
+
+    Token op = tokenizer.peek();
+    if (op.type != TokenType::SYMBOL) {
+        return left;
+    }
+    ComparisonOp comparison;
+    if (op.text == "=") comparison = ComparisonOp::EQ;
+    else if (op.text == "!=" || op.text == "<>") comparison = ComparisonOp::NE;
+    else if (op.text == "<") comparison = ComparisonOp::LT;
+    else if (op.text == "<=") comparison = ComparisonOp::LE;
+    else if (op.text == ">") comparison = ComparisonOp::GT;
+    else if (op.text == ">=") comparison = ComparisonOp::GE;
+    else return left;
+    tokenizer.next();
+
+    auto node = make_shared<Expr>();
+    node->type = ExprType::COMPARISON;
+    node->op = comparison;
+    node->children.push_back(left);
+    node->children.push_back(parse_operand());
+    return node;
+}
+
+shared_ptr<const Expr> Parser::parse_operand() {
+    auto node = make_shared<Expr>();
+    Token token = tokenizer.peek();
+
+    if (accept_symbol("?")) {
+        node->type = ExprType::PARAMETER;
+        node->parameter_index = parameter_count++;
+    } else if (token.type == TokenType::IDENTIFIER && !equals_ignore_case(token.text, "true") && !equals_ignore_case(token.text, "false")) {
+        node->type = ExprType::COLUMN;
+        node->column_name = parse_column_name();
+    } else {
+        node->type = ExprType::LITERAL;
+        node->value = parse_literal();
+    }
+    return node;
+}
+
+ValueType Parser::parse_literal() {
+    Token token = tokenizer.next();
+    switch (token.type) {
+        case TokenType::INTEGER: {
+            int64_t value = 0;
+            auto [ptr, ec] = from_chars(token.text.data(), token.text.data() + token.text.size(), value);
+            if (ec != errc() || value < numeric_limits<int32_t>::min() || value > numeric_limits<int32_t>::max()) {
+                fail("Integer literal out of range", token);
+            }
+            return static_cast<int32_t>(value);
+        }
+        case TokenType::STRING:
+            return unescape_string(token.text);
+        case TokenType::HEX:
+            return decode_hex(token.text);
+        case TokenType::IDENTIFIER:
+            if (equals_ignore_case(token.text, "true")) return true;
+            if (equals_ignore_case(token.text, "false")) return false;
+            break;
+        default:
+            break;
+    }
+    fail("Expected literal value", token);
+}
+
+string Parser::parse_identifier() {
+    Token token = tokenizer.next();
+    if (token.type != TokenType::IDENTIFIER) {
+        fail("Expected identifier", token);
+    }
+    return string(token.text);
+}
+
+size_t Parser::parse_count(const string& what) {
+    Token token = tokenizer.next();
+    if (token.type != TokenType::INTEGER || token.text.front() == '-') {
+        fail("Expected " + what, token);
+    }
+    size_t value = 0;
+    auto [ptr, ec] = from_chars(token.text.data(), token.text.data() + token.text.size(), value);
+    if (ec != errc() || ptr != token.text.data() + token.text.size()) {
+        string message = what + " out of range";
+        message[0] = static_cast<char>(toupper(static_cast<unsigned char>(message[0])));
+        fail(message, token);
+    }
+    return value;
+}
+
+string Parser::parse_column_name() {
+    string name = parse_identifier();
+    if (accept_symbol(".")) {
+        name.push_back('.');
+        name += parse_identifier();
+    }
+    return name;
+}
+
+void Parser::expect_keyword(string_view keyword) {
+    if (!accept_keyword(keyword)) {
+        fail("Expected " + string(keyword), tokenizer.peek());
+    }
+}
+
+void Parser::expect_symbol(string_view symbol) {
+    if (!accept_symbol(symbol)) {
+        fail("Expected '" + string(symbol) + "'", tokenizer.peek());
+    }
+}
+
+bool Parser::accept_keyword(string_view keyword) {
+    Token token = tokenizer.peek();
+    if (token.type == TokenType::IDENTIFIER && equals_ignore_case(token.text, keyword)) {
+        tokenizer.next();
+        return true;
+    }
+    return false;
+}
+
+bool Parser::accept_symbol(string_view symbol) {
+    Token token = tokenizer.peek();
+    if (token.type == TokenType::SYMBOL && token.text == symbol) {
+        tokenizer.next();
+        return true;
+    }
+    return false;
+}
+
+void Parser::fail(const string& message, const Token& token) {
+    string found = token.type == TokenType::END ? "end of query" : "'" + string(token.text) + "'";
+    throw InvalidQueryException(message + " at position " + to_string(token.position) + ", found " + found);
+}
@@ -0,0 +1,190 @@
+#include "prepared_statement.h"
+#include "exceptions.h"
+#include "expression.h"
+#include "query_executor.h"
+
+static ValueType default_value_of(DataType type) {
+    switch (type) {
+        case DataType::INT32: return int32_t(0);
+        case DataType::BOOL: return false;
+        case DataType::STRING: return string();
+        case DataType::BYTES: return vector<uint8_t>();
+    }
+    throw runtime_error("Unsupported column type.");
+}
+
+PreparedStatement::PreparedStatement(shared_ptr<const Statement> statement, shared_ptr<Table> table, shared_ptr<ThreadPool> pool,
+                                     shared_ptr<MetricsRegistry> metrics)
+    : statement(std::move(statement)), table(std::move(table)), pool(std::move(pool)), metrics(std::move(metrics)) {
+    schema = this->table->get_schema();
+
+    if (const auto* insert = get_if<InsertStatement>(this->statement.get())) {
+        is_insert = true;
+        size_t value_count = insert->rows.empty() ? 0 : insert->rows.front().size();
+        if (value_count > schema->size()) {
+            throw InvalidQueryException("Too many values for table: " + insert->table_name);
+        }
+
+        provided.assign(schema->size(), false);
+        vector<size_t> ordinals;
+        for (size_t i = 0; i < value_count; ++i) {
+            ordinals.push_back(insert->column_names.empty() ? i : schema->get_column_ordinal(insert->column_names[i]));
+            provided[ordinals.back()] = true;
+        }
+
+        size_t next_parameter = 0;
+        for (size_t r = 0; r < insert->rows.size(); ++r) {
+            Row& row = pending_rows.emplace_back(schema);
+            for (size_t i = 0; i < value_count; ++i) {
+                const Column& column = schema->get_column(ordinals[i]);
+                if (next_parameter < insert->parameters.size() && insert->parameters[next_parameter] == make_pair(r, i)) {
+                    parameter_types.push_back(column.get_type());
+                    parameter_slots.emplace_back(r, ordinals[i]);
+                    ++next_parameter;
+                    continue;
+                }
+                if (!DataTypeHelper::validate(insert->rows[r][i], column.get_type())) {
+                    throw InvalidQueryException("Type mismatch for column '" + column.get_name() + "'. Expected: " + DataTypeHelper::type_to_string(column.get_type()));
+                }
+                row.set(ordinals[i], insert->rows[r][i]);
+            }
+        }
+    } else {
+        const auto& select = get<SelectStatement>(*this->statement);
+        is_insert = false;
+        if (select.join) {
+            throw InvalidQueryException("Joins cannot be prepared");
+        }
+
+        for (const auto& column_name : select.column_names) {
+            schema->get_column_ordinal(column_name);
+        }
+
+        if (select.where) {
+            where = select.where;
+            parameter_types = Expression::infer_parameter_types(*where, *schema, select.parameter_count);
+            for (DataType type : parameter_types) {
+                parameter_values.push_back(default_value_of(type));
+            }
+            // Surfaces type errors at prepare time rather than on first execution.
+            auto lock = this->table->lock_shared();
+            Expression::compile(*where, *this->table, parameter_values);
+        }
+        if (select.order_by) {
+            schema->get_column_ordinal(select.order_by->column_name);
+        }
+    }
+
+    bound.assign(parameter_types.size(), false);
+}
+
+ValueType& PreparedStatement::parameter_slot(size_t index, DataType type) {
+    if (index == 0 || index > parameter_types.size()) {
+        throw InvalidQueryException("Parameter index out of range: " + to_string(index));
+    }
+    if (parameter_types[index - 1] != type) {
+        throw InvalidQueryException("Type mismatch for parameter " + to_string(index) + ". Expected: " + DataTypeHelper::type_to_string(parameter_types[index - 1]));
+    }
+    bound[index - 1] = true;
+    if (is_insert) {
+        auto [row, ordinal] = parameter_slots[index - 1];
+        return pending_rows[row].slot(ordinal);
+    }
+    return parameter_values[index - 1];
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, int32_t value) {
+    parameter_slot(index, DataType::INT32) = value;
+    return *this;
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, bool value) {
+    parameter_slot(index, DataType::BOOL) = value;
+    return *this;
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, string_view value) {
+    ValueType& slot = parameter_slot(index, DataType::STRING);
+    if (auto* existing = get_if<string>(&slot)) {
+        existing->assign(value);
+    } else {
+        slot = string(value);
+    }
+    return *this;
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, span<const uint8_t> value) {
+    ValueType& slot = parameter_slot(index, DataType::BYTES);
+    if (auto* existing = get_if<vector<uint8_t>>(&slot)) {
+        existing->assign(value.begin(), value.end());
+    } else {
+        slot = vector<uint8_t>(value.begin(), value.end());
+    }
+    return *this;
+}
+
+void PreparedStatement::clear_bindings() {
+    bound.assign(bound.size(), false);
+}
+
+void PreparedStatement::check_ready() const {
+    if (table->get_schema() != schema) {
+        throw InvalidQueryException("Table schema changed since the statement was prepared: " + table->get_name());
+    }
+    for (size_t i = 0; i < bound.size(); ++i) {
+        if (!bound[i]) {
+            throw InvalidQueryException("Parameter " + to_string(i + 1) + " is not bound");
+        }
+    }
+}
+
+QueryResult PreparedStatement::execute() {
+    if (!metrics) {
+        return run();
+    }
+    return metrics->time_statement(is_insert ? StatementKind::PREPARED_INSERT : StatementKind::PREPARED_SELECT, [this] { return run(); });
+}
+
+QueryResult PreparedStatement::run() {
+    if (!is_insert) {
+        check_ready();
+        ExecutionPlan plan = ExecutionPlan::build_select(get<SelectStatement>(*statement), table, parameter_values, pool);
+        QueryExecutor::print_rows(plan);
+        return QueryResult(true);
+    }
+
+    check_ready();
+    // insert_rows fills autoincrement columns into the rows; clear them so the
+    // next execution draws fresh values.
+    for (Row& row : pending_rows) {
+        for (size_t i = 0; i < provided.size(); ++i) {
+            if (!provided[i]) {
+                row.unset(i);
+            }
+        }
+    }
+    table->insert_rows(pending_rows);
+    return QueryResult(true);
+}
+
+vector<Row> PreparedStatement::fetch() {
+    auto fetch_rows = [this] {
+        vector<Row> rows;
+        for (RowView view : query()) {
+            rows.push_back(table->get_row(view.get_row_id()));
+        }
+        return rows;
+    };
+    if (!metrics) {
+        return fetch_rows();
+    }
+    return metrics->time_statement(StatementKind::PREPARED_SELECT, fetch_rows);
+}
+
+Cursor PreparedStatement::query() {
+    if (is_insert) {
+        throw InvalidQueryException("Only a prepared SELECT returns rows");
+    }
+    check_ready();
+    return Cursor::open(get<SelectStatement>(*statement), table, parameter_values, pool);
+}
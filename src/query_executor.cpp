@@ -1,349 +1,302 @@
 #include "query_executor.h"
 #include "data_types.h"
 #include "exceptions.h"
+#include "expression.h"
+#include "prepared_statement.h"
 
+#include <charconv>
+#include <iomanip>
 #include <iostream>
-#include <regex>
+#include <sstream>
 
-#include "database.h"
-
-template <typename ValueType>
-void print_variant(const ValueType& value) {
-    std::visit([](const auto& arg) {
-        using T = std::decay_t<decltype(arg)>;
-        if constexpr (std::is_same_v<T, std::vector<unsigned char>>) {
-            std::cout << "[";
-            for (size_t i = 0; i < arg.size(); ++i) {
-                std::cout << static_cast<int>(arg[i]);
-                if (i + 1 < arg.size()) {
-                    std::cout << ", ";
-                }
-            }
-            std::cout << "]";
-        } else {
-            std::cout << arg;
-        }
-    }, value);
+static shared_ptr<Table> find_table(const string& table_name, unordered_map<string, shared_ptr<Table>>& tables) {
+    auto table_it = tables.find(table_name);
+    if (table_it == tables.end()) {
+        throw InvalidQueryException("Table not found: " + table_name);
+    }
+    return table_it->second;
 }
 
-ValueType parse_value(const string& value) {
-    if (value.front() == '\'' && value.back() == '\'') {
-        return value.substr(1, value.size() - 2);
-    }
-    try {
-        return stoi(value);
-    } catch (...) {
-        throw runtime_error("Invalid value: " + value);
+static void check_type(const Column& column, const ValueType& value) {
+    if (!DataTypeHelper::validate(value, column.get_type())) {
+        throw InvalidQueryException("Type mismatch for column '" + column.get_name() + "'. Expected: " + DataTypeHelper::type_to_string(column.get_type()));
     }
 }
 
-string trim(const string& str) {
-    size_t start = str.find_first_not_of(" \t");
-    size_t end = str.find_last_not_of(" \t");
-    return (start == string::npos) ? "" : str.substr(start, end - start + 1);
+QueryResult QueryExecutor::execute(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
+    shared_ptr<const Statement> statement = statement_cache.get_or_parse(query);
+    QueryResult result = execute(*statement, tables);
+    if (!result.is_ok()) {
+        throw InvalidQueryException(result.get_error());
+    }
+    return result;
 }
 
-void QueryExecutor::execute(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
-    regex create_table_regex(R"(CREATE\s+TABLE\s+(\w+)\s*\((.*)\))", regex::icase);
-    smatch match;
-
-    if (regex_match(query, match, create_table_regex)) {
-        string table_name = match[1];
-        string columns_str = match[2];
-
-        shared_ptr<Table> table = make_shared<Table>(table_name);
-        tables[table_name] = table;
-
-        regex column_regex(R"(\s*(\{[^}]*\})?\s*(\w+)\s*:\s*(int32|bool|string|bytes)(\[(\d+)\])?(?:\s*=\s*(\S+))?)");
-        auto begin = sregex_iterator(columns_str.begin(), columns_str.end(), column_regex);
-        auto end = sregex_iterator();
-
-        for (auto it = begin; it != end; ++it) {
-            string column_attr = (*it)[1];
-            string column_name = (*it)[2];
-            string column_type_str = (*it)[3];
-            string column_size_str = (*it)[4];
-            string default_value_str = (*it)[6];
-
-            DataType type;
-            size_t size = 0;
-
-            if (column_type_str == "int32") {
-                type = DataType::INT32;
-            } else if (column_type_str == "bool") {
-                type = DataType::BOOL;
-            } else if (column_type_str == "string") {
-                type = DataType::STRING;
-                if (!column_size_str.empty()) {
-                    string size_str = column_size_str.substr(1, column_size_str.size() - 2);
-                    size = stoi(size_str);
-                }
-            } else if (column_type_str == "bytes") {
-                type = DataType::BYTES;
-                if (!column_size_str.empty()) {
-                    string size_str = column_size_str.substr(1, column_size_str.size() - 2);
-                    size = stoi(size_str);
-                }
-            } else {
-                throw runtime_error("Unsupported column type: " + column_type_str);
-            }
-
-            bool is_autoincrement = column_attr.find("autoincrement") != string::npos;
-            bool is_unique = column_attr.find("unique") != string::npos;
-
-            ValueType default_value;
-            if (!default_value_str.empty()) {
-                if (column_type_str == "bool") {
-                    if (default_value_str == "true") {
-                        default_value = true;
-                    } else if (default_value_str == "false") {
-                        default_value = false;
-                    } else {
-                        throw runtime_error("Invalid default value for BOOL column: " + default_value_str);
-                    }
-                } else if (column_type_str == "int32") {
-                    default_value = stoi(default_value_str);
-                } else if (column_type_str == "string") {
-                    default_value = default_value_str;
-                } else if (column_type_str == "bytes") {
-                    if (default_value_str.substr(0, 2) == "0x") {
-                        vector<uint8_t> bytes;
-                        for (size_t i = 2; i < default_value_str.length(); i += 2) {
-                            string byte_str = default_value_str.substr(i, 2);
-                            unsigned char byte = (unsigned char)stoul(byte_str, nullptr, 16);
-                            bytes.push_back(byte);
-                        }
-                        default_value = bytes;
-                    } else {
-                        throw runtime_error("Invalid default value for BYTES column: " + default_value_str);
-                    }
-                } else {
-                    throw runtime_error("Unsupported default value format for column: " + column_name);
-                }
-            }
-
-            table->add_column(Column(column_name, type, is_autoincrement, is_unique, size, default_value));
+QueryResult QueryExecutor::execute(const Statement& statement, unordered_map<string, shared_ptr<Table>>& tables) {
+    return std::visit([this, &tables](const auto& parsed) {
+        using T = std::decay_t<decltype(parsed)>;
+        if constexpr (std::is_same_v<T, CreateTableStatement>) {
+            return handle_create(parsed, tables);
+        } else if constexpr (std::is_same_v<T, CreateIndexStatement>) {
+            return handle_create_index(parsed, tables);
+        } else if constexpr (std::is_same_v<T, InsertStatement>) {
+            return handle_insert(parsed, tables);
+        } else if constexpr (std::is_same_v<T, ExplainStatement>) {
+            return handle_explain(parsed, tables);
+        } else {
+            return handle_select(parsed, tables);
         }
+    }, statement);
+}
 
-        cout << "Table '" << table_name << "' created successfully." << endl;
-        return;
+QueryResult QueryExecutor::handle_create(const CreateTableStatement& statement, unordered_map<string, shared_ptr<Table>>& tables) {
+    if (tables.find(statement.table_name) != tables.end()) {
+        throw InvalidQueryException("Table already exists: " + statement.table_name);
     }
 
-    regex insert_regex(R"(INSERT\s+INTO\s+(\w+)\s+VALUES\s*\((.*)\))", regex::icase);
-    if (regex_match(query, match, insert_regex)) {
-        string table_name = match[1];
-        string values_str = match[2];
-
-        auto table = tables[table_name];
-        auto columns = table->get_columns();
-
-        regex value_regex(R"(\s*(\S+)\s*)");
-        auto value_begin = sregex_iterator(values_str.begin(), values_str.end(), value_regex);
-        auto value_end = sregex_iterator();
-
-        Row row;
-        int idx = 0;
-        for (auto it = value_begin; it != value_end; ++it) {
-            const string& value_str = (*it)[1];
-            const Column& column = columns[idx];
-
-            ValueType value;
-
-            switch (column.get_type()) {
-                case DataType::INT32:
-                    try {
-                        value = stoi(value_str);
-                    } catch (...) {
-                        throw runtime_error("Invalid value for INT32 column: " + value_str);
-                    }
-                    break;
-                case DataType::BOOL:
-                    if (value_str == "true") {
-                        value = true;
-                    } else if (value_str == "false") {
-                        value = false;
-                    } else {
-                        throw runtime_error("Invalid value for BOOL column: " + value_str);
-                    }
-                    break;
-                case DataType::STRING:
-                    value = value_str;
-                    break;
-                case DataType::BYTES:
-                    if (value_str.substr(0, 2) == "0x") {
-                        vector<uint8_t> bytes;
-                        for (size_t i = 2; i < value_str.length(); i += 2) {
-                            string byte_str = value_str.substr(i, 2);
-                            unsigned char byte = (unsigned char)stoul(byte_str, nullptr, 16);
-                            bytes.push_back(byte);
-                        }
-                        value = bytes;
-                    } else {
-                        throw runtime_error("Invalid value for BYTES column: " + value_str);
-                    }
-                    break;
-                default:
-                    throw runtime_error("Unsupported column type.");
-            }
-
-            if (!DataTypeHelper::validate(value, column.get_type())) {
-                throw runtime_error("Type mismatch for column '" + column.get_name() + "'. Expected: " + DataTypeHelper::type_to_string(column.get_type()));
-            }
-
-            row.set_value(column.get_name(), value);
-            ++idx;
-        }
-
-        table->insert_row(row);
-        cout << "Row inserted into table '" << table_name << "'." << endl;
-        return;
+    auto table = make_shared<Table>(statement.table_name);
+    for (const auto& definition : statement.columns) {
+        table->add_column(Column(definition.name, definition.type, definition.length, definition.autoincrement, definition.unique, definition.default_value, definition.key, definition.indexed, definition.dictionary));
     }
 
-    throw runtime_error("Invalid query: Unsupported query: " + query);
+    if (log) {
+        uint64_t lsn = log->append_create_table(*table);
+        table->set_log_lsn(lsn);
+        table->set_log(log);
+        log->commit(lsn);
+    }
+    tables[statement.table_name] = table;
+    cout << "Table '" << statement.table_name << "' created successfully." << endl;
+    return QueryResult(true);
 }
 
+QueryResult QueryExecutor::handle_create_index(const CreateIndexStatement& statement, unordered_map<string, shared_ptr<Table>>& tables) {
+    shared_ptr<Table> table = find_table(statement.table_name, tables);
+    table->create_ordered_index(table->get_column_ordinal(statement.column_name));
 
+    cout << "Index " << (statement.index_name.empty() ? "" : "'" + statement.index_name + "' ") << "on '" << statement.table_name << "(" << statement.column_name << ")' created successfully." << endl;
+    return QueryResult(true);
+}
 
-QueryResult QueryExecutor::handle_create(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
-    regex create_regex(R"(create table (\w+)\s*\((.*)\))", regex::icase);
-    smatch match;
+QueryResult QueryExecutor::handle_insert(const InsertStatement& statement, unordered_map<string, shared_ptr<Table>>& tables) {
+    shared_ptr<Table> table = find_table(statement.table_name, tables);
+    shared_ptr<const Schema> schema = table->get_schema();
 
-    if (!regex_match(query, match, create_regex)) {
-        throw InvalidQueryException("Malformed CREATE TABLE query: " + query);
+    if (!statement.parameters.empty()) {
+        throw InvalidQueryException("Unbound parameter in INSERT; use Database::prepare");
     }
 
-    string table_name = match[1];
-    string columns_definition = match[2];
-
-    if (tables.find(table_name) != tables.end()) {
-        throw InvalidQueryException("Table already exists: " + table_name);
+    vector<size_t> ordinals;
+    size_t value_count = statement.rows.empty() ? 0 : statement.rows.front().size();
+    if (value_count > schema->size()) {
+        throw InvalidQueryException("Too many values for table: " + statement.table_name);
     }
-
-    unordered_map<string, Column> columns;
-    regex column_regex(R"(\{([^}]*)\}\s*(\w+)\s*:\s*(\w+)(?:\s*=\s*(.*))?)");
-    auto col_begin = sregex_iterator(columns_definition.begin(), columns_definition.end(), column_regex);
-    auto col_end = sregex_iterator();
-
-    for (auto it = col_begin; it != col_end; ++it) {
-        string attributes = (*it)[1];
-        string column_name = (*it)[2];
-        string type = (*it)[3];
-
-        DataType data_type;
-
-        if (type == "int32") data_type = DataType::INT32;
-        else if (type == "bool") data_type = DataType::BOOL;
-        else if (type.find("string") == 0) data_type = DataType::STRING;
-        else if (type.find("bytes") == 0) data_type = DataType::BYTES;
-        else throw InvalidQueryException("Unknown column type: " + type);
-
-        columns[column_name] = Column(column_name, data_type);
+    for (size_t i = 0; i < value_count; ++i) {
+        ordinals.push_back(statement.column_names.empty() ? i : schema->get_column_ordinal(statement.column_names[i]));
     }
 
-    auto table = make_shared<Table>(table_name);
-    for (const auto& [name, column] : columns) {
-        table->add_column(column);
+    vector<Row> rows;
+    rows.reserve(statement.rows.size());
+    for (const auto& values : statement.rows) {
+        Row& row = rows.emplace_back(schema);
+        for (size_t i = 0; i < values.size(); ++i) {
+            check_type(schema->get_column(ordinals[i]), values[i]);
+            row.set(ordinals[i], values[i]);
+        }
     }
 
-    tables[table_name] = table;
-    cout << "Table '" << table_name << "' created successfully." << endl;
+    table->insert_rows(rows);
+    if (rows.size() == 1) {
+        cout << "Row inserted into table '" << statement.table_name << "'." << endl;
+    } else {
+        cout << rows.size() << " rows inserted into table '" << statement.table_name << "'." << endl;
+    }
     return QueryResult(true);
 }
 
-QueryResult QueryExecutor::handle_insert(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
-    regex insert_regex(R"(insert\s*\((.*)\)\s*to\s*(\w+))", regex::icase);
-    smatch match;
-
-    if (!regex_match(query, match, insert_regex)) {
-        throw InvalidQueryException("Malformed INSERT query: " + query);
+static ExecutionPlan build_plan(const SelectStatement& select, unordered_map<string, shared_ptr<Table>>& tables, shared_ptr<ThreadPool> pool,
+                                bool profile = false) {
+    shared_ptr<Table> table = find_table(select.table_name, tables);
+    if (select.join) {
+        return ExecutionPlan::build_join(select, table, find_table(select.join->table_name, tables), {}, std::move(pool), profile);
     }
+    return ExecutionPlan::build_select(select, table, {}, std::move(pool), profile);
+}
 
-    string values = match[1];
-    string table_name = match[2];
-
-    auto table_it = tables.find(table_name);
-    if (table_it == tables.end()) {
-        throw InvalidQueryException("Table not found: " + table_name);
+QueryResult QueryExecutor::handle_select(const SelectStatement& statement, unordered_map<string, shared_ptr<Table>>& tables) {
+    if (statement.parameter_count > 0) {
+        throw InvalidQueryException("Unbound parameter in SELECT; use Database::prepare");
     }
 
-    shared_ptr<Table> table = table_it->second;
-    Row row;
-
-    regex value_regex(R"((\w+)\s*=\s*([^,]+))");
-    auto value_begin = sregex_iterator(values.begin(), values.end(), value_regex);
-    auto value_end = sregex_iterator();
+    ExecutionPlan plan = build_plan(statement, tables, get_scan_pool());
+    print_rows(plan);
+    return QueryResult(true);
+}
 
-    for (auto it = value_begin; it != value_end; ++it) {
-        string column_name = (*it)[1];
-        string value = (*it)[2];
+QueryResult QueryExecutor::handle_explain(const ExplainStatement& statement, unordered_map<string, shared_ptr<Table>>& tables) {
+    if (statement.select.parameter_count > 0) {
+        throw InvalidQueryException("Unbound parameter in SELECT; use Database::prepare");
+    }
 
-        if (!table->has_column(column_name)) {
-            throw InvalidQueryException("Column not found: " + column_name);
+    ExecutionPlan plan = build_plan(statement.select, tables, get_scan_pool(), statement.analyze);
+    if (statement.analyze) {
+        Batch batch;
+        while (plan.root->next(batch)) {
         }
-
-        DataType column_type = table->get_column(column_name).get_type();
-        ValueType parsed_value;
-
-        if (column_type == DataType::INT32) parsed_value = stoi(value);
-        else if (column_type == DataType::BOOL) parsed_value = (value == "true");
-        else if (column_type == DataType::STRING) parsed_value = value.substr(1, value.size() - 2);
-        else if (column_type == DataType::BYTES) parsed_value = vector<uint8_t>(value.begin(), value.end());
-        else throw InvalidQueryException("Unsupported data type for column: " + column_name);
-
-        row.set_value(column_name, parsed_value);
     }
-
-    table->insert_row(row);
-    return QueryResult(true);
+    QueryResult result(true);
+    result.set_plan(plan.explain(), statement.analyze);
+    print_plan(result);
+    return result;
 }
 
-QueryResult QueryExecutor::handle_select(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
-    regex select_regex(R"(select\s+(.*)\s+from\s+(\w+)\s+where\s+(.*))", regex::icase);
-    smatch match;
-
-    if (!regex_match(query, match, select_regex)) {
-        throw InvalidQueryException("Malformed SELECT query: " + query);
+Cursor QueryExecutor::query(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
+    shared_ptr<const Statement> statement = statement_cache.get_or_parse(query);
+    const auto* select = get_if<SelectStatement>(statement.get());
+    if (!select) {
+        throw InvalidQueryException("Only SELECT statements return a cursor");
     }
-
-    string columns = match[1];
-    string table_name = match[2];
-    string condition = match[3];
-
-    auto table_it = tables.find(table_name);
-    if (table_it == tables.end()) {
-        throw InvalidQueryException("Table not found: " + table_name);
+    if (select->parameter_count > 0) {
+        throw InvalidQueryException("Unbound parameter in SELECT; use Database::prepare");
     }
+    return Cursor::open(*select, find_table(select->table_name, tables), {}, get_scan_pool());
+}
 
-    shared_ptr<Table> table = table_it->second;
+ExecutionPlan QueryExecutor::query_batches(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
+    shared_ptr<const Statement> statement = statement_cache.get_or_parse(query);
+    const auto* select = get_if<SelectStatement>(statement.get());
+    if (!select) {
+        throw InvalidQueryException("Only SELECT statements return batches");
+    }
+    if (select->parameter_count > 0) {
+        throw InvalidQueryException("Unbound parameter in SELECT; use Database::prepare");
+    }
+    return build_plan(*select, tables, get_scan_pool());
+}
 
-    auto condition_func = [condition](const Row& row) -> bool {
-        regex condition_regex(R"((\w+)\s*=\s*(\w+))", regex::icase);
-        smatch cond_match;
+PreparedStatement QueryExecutor::prepare(const string& query, unordered_map<string, shared_ptr<Table>>& tables) {
+    shared_ptr<const Statement> statement = statement_cache.get_or_parse(query);
+    if (const auto* insert = get_if<InsertStatement>(statement.get())) {
+        return PreparedStatement(statement, find_table(insert->table_name, tables), nullptr, metrics);
+    }
+    if (const auto* select = get_if<SelectStatement>(statement.get())) {
+        return PreparedStatement(statement, find_table(select->table_name, tables), get_scan_pool(), metrics);
+    }
+    throw InvalidQueryException("Only INSERT and SELECT statements can be prepared");
+}
 
-        if (!regex_match(condition, cond_match, condition_regex)) {
-            throw InvalidQueryException("Invalid condition: " + condition);
+void QueryExecutor::print_rows(Cursor& cursor) {
+    const Schema& schema = *cursor.get_table().get_schema();
+    const vector<size_t>& projection = cursor.get_projection();
+    for (RowView row : cursor) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            cout << schema.get_column(projection[i]).get_name() << ": ";
+            switch (row.get_type(i)) {
+                case DataType::INT32:
+                    cout << row.get_int32(i);
+                    break;
+                case DataType::BOOL:
+                    cout << row.get_bool(i);
+                    break;
+                case DataType::STRING:
+                    cout << row.get_string(i);
+                    break;
+                case DataType::BYTES: {
+                    span<const uint8_t> bytes = row.get_bytes(i);
+                    cout << "[";
+                    for (size_t b = 0; b < bytes.size(); ++b) {
+                        cout << static_cast<int>(bytes[b]);
+                        if (b + 1 < bytes.size()) {
+                            cout << ", ";
+                        }
+                    }
+                    cout << "]";
+                    break;
+                }
+            }
+            cout << "\t";
         }
+        cout << endl;
+    }
+}
 
-        string column_name = cond_match[1];
-        string value = cond_match[2];
-
-        try {
-            return std::get<string>(row.get_value(column_name)) == value;
-        } catch (const std::exception& e) {
-            throw runtime_error("Condition evaluation failed: " + string(e.what()));
-        }
+void QueryExecutor::print_rows(ExecutionPlan& plan) {
+    Batch batch;
+    vector<string> lines;
+    char digits[24];
+    auto append_number = [&digits](string& line, auto value) {
+        line.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
     };
-
-    vector<Row> selected_rows = table->select(condition_func);
-
-    for (const auto& row : selected_rows) {
-        for (const auto& column : table->get_columns()) {
-            cout << column.get_name() << ": ";
-            print_variant(row.get_value(column.get_name()));
-            cout << "\t";
+    while (plan.root->next(batch)) {
+        lines.assign(batch.size(), string());
+        for (size_t c = 0; c < batch.columns.size(); ++c) {
+            const ColumnVector& column = batch.columns[c];
+            string label = plan.column_names[c] + ": ";
+            for (string& line : lines) {
+                line += label;
+            }
+            switch (column.kind) {
+                case ColumnVector::Kind::INT32:
+                    for (size_t r = 0; r < lines.size(); ++r) {
+                        append_number(lines[r], column.int32_values[r]);
+                    }
+                    break;
+                case ColumnVector::Kind::INT64:
+                    for (size_t r = 0; r < lines.size(); ++r) {
+                        append_number(lines[r], column.int64_values[r]);
+                    }
+                    break;
+                case ColumnVector::Kind::DOUBLE:
+                    for (size_t r = 0; r < lines.size(); ++r) {
+                        append_number(lines[r], column.double_values[r]);
+                    }
+                    break;
+                case ColumnVector::Kind::BOOL:
+                    for (size_t r = 0; r < lines.size(); ++r) {
+                        lines[r] += column.bool_values[r] ? '1' : '0';
+                    }
+                    break;
+                case ColumnVector::Kind::STRING:
+                    for (size_t r = 0; r < lines.size(); ++r) {
+                        lines[r] += column.string_values[r];
+                    }
+                    break;
+                case ColumnVector::Kind::BYTES:
+                    for (size_t r = 0; r < lines.size(); ++r) {
+                        span<const uint8_t> bytes = column.bytes_values[r];
+                        lines[r] += '[';
+                        for (size_t b = 0; b < bytes.size(); ++b) {
+                            append_number(lines[r], static_cast<int>(bytes[b]));
+                            if (b + 1 < bytes.size()) {
+                                lines[r] += ", ";
+                            }
+                        }
+                        lines[r] += ']';
+                    }
+                    break;
+            }
+            for (string& line : lines) {
+                line += '\t';
+            }
+        }
+        for (const string& line : lines) {
+            cout << line << '\n';
         }
-        cout << endl;
     }
+    cout << flush;
+}
 
-    return QueryResult(true);
+void QueryExecutor::print_plan(const QueryResult& result) {
+    ostringstream out;
+    out << fixed << setprecision(3);
+    for (const PlanStage& stage : result.get_plan()) {
+        out << string(stage.depth * 2, ' ') << stage.description;
+        if (result.is_analyzed()) {
+            out << "  [rows in " << stage.rows_in << ", out " << stage.rows_out << ", skipped " << stage.rows_skipped
+                << "; " << stage.batches << (stage.batches == 1 ? " batch; " : " batches; ")
+                << stage.time_ms << " ms, self " << stage.self_time_ms << " ms; peak " << stage.peak_bytes << " bytes]";
+        }
+        out << '\n';
+    }
+    cout << out.str() << flush;
 }
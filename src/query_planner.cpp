@@ -0,0 +1,159 @@
+#include "query_planner.h"
+#include "exceptions.h"
+#include "table.h"
+
+#include <map>
+
+static optional<ValueType> constant_of(const Expr& expr, span<const ValueType> parameters) {
+    if (expr.type == ExprType::LITERAL) {
+        return expr.value;
+    }
+    if (expr.type == ExprType::PARAMETER && expr.parameter_index < parameters.size()) {
+        return parameters[expr.parameter_index];
+    }
+    return nullopt;
+}
+
+static ComparisonOp flip(ComparisonOp op) {
+    switch (op) {
+        case ComparisonOp::LT: return ComparisonOp::GT;
+        case ComparisonOp::LE: return ComparisonOp::GE;
+        case ComparisonOp::GT: return ComparisonOp::LT;
+        case ComparisonOp::GE: return ComparisonOp::LE;
+        default: return op;
+    }
+}
+
+// A comparison between a column of `table` and a constant of the column's type.
+struct ColumnBound {
+    size_t ordinal;
+    ComparisonOp op;
+    ValueType value;
+};
+
+static optional<ColumnBound> match_column_bound(const Expr& expr, const Table& table, span<const ValueType> parameters) {
+    if (expr.type != ExprType::COMPARISON) {
+        return nullopt;
+    }
+    for (size_t side = 0; side < 2; ++side) {
+        const Expr& column = *expr.children[side];
+        const Expr& other = *expr.children[1 - side];
+        if (column.type != ExprType::COLUMN || !table.has_column(column.column_name)) {
+            continue;
+        }
+        size_t ordinal = table.get_column_ordinal(column.column_name);
+        auto value = constant_of(other, parameters);
+        if (!value || DataTypeHelper::type_of(*value) != table.get_column_storage(ordinal).get_type()) {
+            continue;
+        }
+        return ColumnBound{ordinal, side == 0 ? expr.op : flip(expr.op), std::move(*value)};
+    }
+    return nullopt;
+}
+
+static void tighten(KeyRange& range, ComparisonOp op, int64_t key) {
+    switch (op) {
+        case ComparisonOp::EQ:
+            range.lower = max(range.lower, key);
+            range.upper = min(range.upper, key);
+            break;
+        case ComparisonOp::LT: range.upper = min(range.upper, key - 1); break;
+        case ComparisonOp::LE: range.upper = min(range.upper, key); break;
+        case ComparisonOp::GT: range.lower = max(range.lower, key + 1); break;
+        case ComparisonOp::GE: range.lower = max(range.lower, key); break;
+        case ComparisonOp::NE: break;
+    }
+}
+
+AccessPath QueryPlanner::choose_access_path(const SelectStatement& select, const Table& table, span<const ValueType> parameters) {
+    AccessPath path;
+    path.limit = select.limit;
+    if (select.order_by) {
+        if (select.order_by->aggregate) {
+            throw InvalidQueryException("ORDER BY an aggregate needs an aggregate query");
+        }
+        path.order_ordinal = table.get_column_ordinal(select.order_by->column_name);
+        path.descending = select.order_by->descending;
+    }
+
+    vector<const Expr*> conjuncts;
+    if (select.where && select.where->type == ExprType::AND) {
+        for (const auto& child : select.where->children) {
+            conjuncts.push_back(child.get());
+        }
+    } else if (select.where) {
+        conjuncts.push_back(select.where.get());
+    }
+
+    map<size_t, KeyRange> ranges;
+    for (const Expr* conjunct : conjuncts) {
+        auto bound = match_column_bound(*conjunct, table, parameters);
+        if (!bound) {
+            continue;
+        }
+        if (bound->op == ComparisonOp::EQ && table.has_hash_index(bound->ordinal)) {
+            // At most one row matches, so it is trivially in order.
+            path.method = AccessMethod::HASH_LOOKUP;
+            path.ordinal = bound->ordinal;
+            path.key = std::move(bound->value);
+            path.presorted = true;
+            return path;
+        }
+        if (table.has_ordered_index(bound->ordinal)) {
+            const ValueType& value = bound->value;
+            int64_t key = holds_alternative<bool>(value) ? (get<bool>(value) ? 1 : 0) : get<int32_t>(value);
+            tighten(ranges[bound->ordinal], bound->op, key);
+        }
+    }
+
+    // A range on the ORDER BY column serves both purposes; otherwise take the most selective range.
+    auto chosen = ranges.end();
+    double chosen_selectivity = 1.0;
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        double selectivity = table.get_ordered_index(it->first).estimate_selectivity(it->second);
+        if (path.order_ordinal == it->first) {
+            chosen = it;
+            break;
+        }
+        if (selectivity <= MAX_RANGE_SELECTIVITY && selectivity < chosen_selectivity) {
+            chosen = it;
+            chosen_selectivity = selectivity;
+        }
+    }
+
+    if (chosen != ranges.end()) {
+        path.method = AccessMethod::INDEX_RANGE;
+        path.ordinal = chosen->first;
+        path.range = chosen->second;
+    } else if (path.order_ordinal && table.has_ordered_index(*path.order_ordinal)) {
+        path.method = AccessMethod::INDEX_RANGE;
+        path.ordinal = *path.order_ordinal;
+    }
+    path.presorted = path.method == AccessMethod::INDEX_RANGE && path.order_ordinal == path.ordinal;
+    return path;
+}
+
+double QueryPlanner::estimate_rows(const Table& table, const AccessPath& path) {
+    double rows = static_cast<double>(table.get_row_count());
+    switch (path.method) {
+        case AccessMethod::HASH_LOOKUP: return min(rows, 1.0);
+        case AccessMethod::INDEX_RANGE: return rows * table.get_ordered_index(path.ordinal).estimate_selectivity(path.range);
+        case AccessMethod::FULL_SCAN: break;
+    }
+    return rows;
+}
+
+JoinPath QueryPlanner::choose_join_method(const JoinSide& left, const JoinSide& right) {
+    bool right_inner = right.indexed && left.rows <= MAX_INDEX_JOIN_RATIO * right.rows;
+    bool left_inner = left.indexed && right.rows <= MAX_INDEX_JOIN_RATIO * left.rows;
+
+    JoinPath path;
+    if (right_inner || left_inner) {
+        path.method = JoinMethod::INDEX_NESTED_LOOP;
+        path.left_outer = right_inner && (!left_inner || left.rows <= right.rows);
+    } else {
+        // The larger side probes, so the hash table is built over the smaller.
+        path.left_outer = left.rows >= right.rows;
+    }
+    return path;
+}
@@ -2,18 +2,88 @@
 
 #include <stdexcept>
 
+Row::Row(shared_ptr<const Schema> schema)
+    : schema(std::move(schema)), values(this->schema->size()), present(this->schema->size(), false) {}
+
+void Row::bind(shared_ptr<const Schema> new_schema) {
+    vector<ValueType> bound_values(new_schema->size());
+    vector<bool> bound_present(new_schema->size(), false);
+
+    if (schema) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (present[i]) {
+                size_t ordinal = new_schema->get_column_ordinal(schema->get_column(i).get_name());
+                bound_values[ordinal] = std::move(values[i]);
+                bound_present[ordinal] = true;
+            }
+        }
+    }
+    for (auto& [column_name, value] : unbound_values) {
+        size_t ordinal = new_schema->get_column_ordinal(column_name);
+        bound_values[ordinal] = std::move(value);
+        bound_present[ordinal] = true;
+    }
+
+    schema = std::move(new_schema);
+    values = std::move(bound_values);
+    present = std::move(bound_present);
+    unbound_values.clear();
+}
+
+void Row::set(size_t ordinal, ValueType value) {
+    values[ordinal] = std::move(value);
+    present[ordinal] = true;
+}
+
+const ValueType& Row::get(size_t ordinal) const {
+    if (!has(ordinal)) {
+        throw runtime_error("Column value not found at ordinal: " + to_string(ordinal));
+    }
+    return values[ordinal];
+}
+
+ValueType& Row::slot(size_t ordinal) {
+    present[ordinal] = true;
+    return values[ordinal];
+}
+
 void Row::set_value(const string& column_name, const ValueType& value) {
-    values[column_name] = value;
+    if (schema) {
+        set(schema->get_column_ordinal(column_name), value);
+        return;
+    }
+    for (auto& [name, existing] : unbound_values) {
+        if (name == column_name) {
+            existing = value;
+            return;
+        }
+    }
+    unbound_values.emplace_back(column_name, value);
 }
 
-ValueType Row::get_value(const string& column_name) const {
-    auto it = values.find(column_name);
-    if (it == values.end()) {
-        throw runtime_error("Column value not found: " + column_name);
+const ValueType& Row::get_value(const string& column_name) const {
+    if (schema) {
+        if (!schema->has_column(column_name)) {
+            throw runtime_error("Column value not found: " + column_name);
+        }
+        return get(schema->get_column_ordinal(column_name));
+    }
+    for (const auto& [name, value] : unbound_values) {
+        if (name == column_name) {
+            return value;
+        }
     }
-    return it->second;
+    throw runtime_error("Column value not found: " + column_name);
 }
 
 bool Row::has_value(const string& column_name) const {
-    return values.find(column_name) != values.end();
+    if (schema) {
+        return schema->has_column(column_name) && has(schema->get_column_ordinal(column_name));
+    }
+    for (const auto& entry : unbound_values) {
+        if (entry.first == column_name) {
+            return true;
+        }
+    }
+    return false;
 }
@@ -0,0 +1,232 @@
+#include "scan_kernels.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_KERNELS_X86 1
+#endif
+
+namespace {
+
+template <ComparisonOp Op>
+inline bool matches(int32_t value, int32_t constant) {
+    if constexpr (Op == ComparisonOp::EQ) return value == constant;
+    else if constexpr (Op == ComparisonOp::NE) return value != constant;
+    else if constexpr (Op == ComparisonOp::LT) return value < constant;
+    else if constexpr (Op == ComparisonOp::LE) return value <= constant;
+    else if constexpr (Op == ComparisonOp::GT) return value > constant;
+    else return value >= constant;
+}
+
+template <ComparisonOp Op>
+void compare_int32_scalar(const int32_t* values, size_t count, int32_t constant, uint64_t* bits) {
+    for (size_t word = 0; word * 64 < count; ++word) {
+        size_t begin = word * 64;
+        size_t end = count - begin < 64 ? count : begin + 64;
+        uint64_t mask = 0;
+        for (size_t i = begin; i < end; ++i) {
+            mask |= uint64_t(matches<Op>(values[i], constant)) << (i - begin);
+        }
+        bits[word] = mask;
+    }
+}
+
+void compare_int32_scalar(const int32_t* values, size_t count, ComparisonOp op, int32_t constant, uint64_t* bits) {
+    switch (op) {
+        case ComparisonOp::EQ: return compare_int32_scalar<ComparisonOp::EQ>(values, count, constant, bits);
+        case ComparisonOp::NE: return compare_int32_scalar<ComparisonOp::NE>(values, count, constant, bits);
+        case ComparisonOp::LT: return compare_int32_scalar<ComparisonOp::LT>(values, count, constant, bits);
+        case ComparisonOp::LE: return compare_int32_scalar<ComparisonOp::LE>(values, count, constant, bits);
+        case ComparisonOp::GT: return compare_int32_scalar<ComparisonOp::GT>(values, count, constant, bits);
+        case ComparisonOp::GE: return compare_int32_scalar<ComparisonOp::GE>(values, count, constant, bits);
+    }
+}
+
+void equal_bool_scalar(const uint8_t* values, size_t count, bool expected, uint64_t* bits) {
+    for (size_t word = 0; word * 64 < count; ++word) {
+        size_t begin = word * 64;
+        size_t end = count - begin < 64 ? count : begin + 64;
+        uint64_t mask = 0;
+        for (size_t i = begin; i < end; ++i) {
+            mask |= uint64_t((values[i] != 0) == expected) << (i - begin);
+        }
+        bits[word] = mask;
+    }
+}
+
+#ifdef SCAN_KERNELS_X86
+
+// Only EQ and GT have SIMD compares: LT swaps the operands, and NE, LE and
+// GE invert EQ, GT and LT. `invert` is applied to whole words, then the
+// caller's tail handling clears bits past the end.
+struct Int32Plan {
+    bool swap;
+    bool greater;
+    bool invert;
+};
+
+Int32Plan plan_for(ComparisonOp op) {
+    switch (op) {
+        case ComparisonOp::EQ: return {false, false, false};
+        case ComparisonOp::NE: return {false, false, true};
+        case ComparisonOp::GT: return {false, true, false};
+        case ComparisonOp::LE: return {false, true, true};
+        case ComparisonOp::LT: return {true, true, false};
+        case ComparisonOp::GE: return {true, true, true};
+    }
+    return {false, false, false};
+}
+
+__attribute__((target("sse4.2")))
+void compare_int32_sse42(const int32_t* values, size_t count, ComparisonOp op, int32_t constant, uint64_t* bits) {
+    Int32Plan plan = plan_for(op);
+    __m128i broadcast = _mm_set1_epi32(constant);
+    size_t full_words = count / 64;
+    for (size_t word = 0; word < full_words; ++word) {
+        const int32_t* base = values + word * 64;
+        uint64_t mask = 0;
+        for (size_t lane = 0; lane < 64; lane += 4) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + lane));
+            __m128i result = !plan.greater ? _mm_cmpeq_epi32(chunk, broadcast)
+                : plan.swap ? _mm_cmpgt_epi32(broadcast, chunk) : _mm_cmpgt_epi32(chunk, broadcast);
+            mask |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(result))) << lane;
+        }
+        bits[word] = plan.invert ? ~mask : mask;
+    }
+    if (count % 64 != 0) {
+        compare_int32_scalar(values + full_words * 64, count % 64, op, constant, bits + full_words);
+    }
+}
+
+__attribute__((target("avx2")))
+void compare_int32_avx2(const int32_t* values, size_t count, ComparisonOp op, int32_t constant, uint64_t* bits) {
+    Int32Plan plan = plan_for(op);
+    __m256i broadcast = _mm256_set1_epi32(constant);
+    size_t full_words = count / 64;
+    for (size_t word = 0; word < full_words; ++word) {
+        const int32_t* base = values + word * 64;
+        uint64_t mask = 0;
+        for (size_t lane = 0; lane < 64; lane += 8) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + lane));
+            __m256i result = !plan.greater ? _mm256_cmpeq_epi32(chunk, broadcast)
+                : plan.swap ? _mm256_cmpgt_epi32(broadcast, chunk) : _mm256_cmpgt_epi32(chunk, broadcast);
+            mask |= uint64_t(uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(result)))) << lane;
+        }
+        bits[word] = plan.invert ? ~mask : mask;
+    }
+    if (count % 64 != 0) {
+        compare_int32_scalar(values + full_words * 64, count % 64, op, constant, bits + full_words);
+    }
+}
+
+__attribute__((target("sse4.2")))
+void equal_bool_sse42(const uint8_t* values, size_t count, bool expected, uint64_t* bits) {
+    __m128i zero = _mm_setzero_si128();
+    size_t full_words = count / 64;
+    for (size_t word = 0; word < full_words; ++word) {
+        const uint8_t* base = values + word * 64;
+        uint64_t mask = 0;
+        for (size_t lane = 0; lane < 64; lane += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + lane));
+            mask |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero)))) << lane;
+        }
+        bits[word] = expected ? ~mask : mask;
+    }
+    if (count % 64 != 0) {
+        equal_bool_scalar(values + full_words * 64, count % 64, expected, bits + full_words);
+    }
+}
+
+__attribute__((target("avx2")))
+void equal_bool_avx2(const uint8_t* values, size_t count, bool expected, uint64_t* bits) {
+    __m256i zero = _mm256_setzero_si256();
+    size_t full_words = count / 64;
+    for (size_t word = 0; word < full_words; ++word) {
+        const uint8_t* base = values + word * 64;
+        uint64_t low = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base)), zero)));
+        uint64_t high = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + 32)), zero)));
+        uint64_t mask = low | (high << 32);
+        bits[word] = expected ? ~mask : mask;
+    }
+    if (count % 64 != 0) {
+        equal_bool_scalar(values + full_words * 64, count % 64, expected, bits + full_words);
+    }
+}
+
+#endif
+
+SimdLevel detect() {
+#ifdef SCAN_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return SimdLevel::SSE42;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+using CompareInt32 = void (*)(const int32_t*, size_t, ComparisonOp, int32_t, uint64_t*);
+using EqualBool = void (*)(const uint8_t*, size_t, bool, uint64_t*);
+
+struct Kernels {
+    SimdLevel level;
+    CompareInt32 compare_int32;
+    EqualBool equal_bool;
+};
+
+const Kernels scalar_kernels{SimdLevel::SCALAR, compare_int32_scalar, equal_bool_scalar};
+#ifdef SCAN_KERNELS_X86
+const Kernels sse42_kernels{SimdLevel::SSE42, compare_int32_sse42, equal_bool_sse42};
+const Kernels avx2_kernels{SimdLevel::AVX2, compare_int32_avx2, equal_bool_avx2};
+#endif
+
+const Kernels* kernels_for(SimdLevel level) {
+#ifdef SCAN_KERNELS_X86
+    switch (level) {
+        case SimdLevel::AVX2: return &avx2_kernels;
+        case SimdLevel::SSE42: return &sse42_kernels;
+        case SimdLevel::SCALAR: break;
+    }
+#endif
+    return &scalar_kernels;
+}
+
+const SimdLevel detected = detect();
+// Scans read it while set_level may swap it, so it points at one of the
+// constant tables above rather than being a table itself.
+atomic<const Kernels*> active{kernels_for(detected)};
+
+}
+
+SimdLevel ScanKernels::detected_level() {
+    return detected;
+}
+
+SimdLevel ScanKernels::active_level() {
+    return active.load(memory_order_acquire)->level;
+}
+
+void ScanKernels::set_level(SimdLevel level) {
+    active.store(kernels_for(static_cast<int>(level) < static_cast<int>(detected) ? level : detected), memory_order_release);
+}
+
+const char* ScanKernels::level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR: return "scalar";
+        case SimdLevel::SSE42: return "sse4.2";
+        case SimdLevel::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+void ScanKernels::compare_int32(const int32_t* values, size_t count, ComparisonOp op, int32_t constant, uint64_t* bits) {
+    active.load(memory_order_acquire)->compare_int32(values, count, op, constant, bits);
+}
+
+void ScanKernels::equal_bool(const uint8_t* values, size_t count, bool expected, uint64_t* bits) {
+    active.load(memory_order_acquire)->equal_bool(values, count, expected, bits);
+}
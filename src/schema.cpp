@@ -0,0 +1,23 @@
+#include "schema.h"
+
+#include <stdexcept>
+
+void Schema::add_column(const Column& column) {
+    if (has_column(column.get_name())) {
+        throw runtime_error("Column already exists: " + column.get_name());
+    }
+    column_ordinals[column.get_name()] = columns.size();
+    columns.push_back(column);
+}
+
+bool Schema::has_column(const string& column_name) const {
+    return column_ordinals.find(column_name) != column_ordinals.end();
+}
+
+size_t Schema::get_column_ordinal(const string& column_name) const {
+    auto it = column_ordinals.find(column_name);
+    if (it == column_ordinals.end()) {
+        throw runtime_error("Column not found: " + column_name);
+    }
+    return it->second;
+}
@@ -1,96 +1,703 @@
 #include "serializer.h"
-#include <sstream>
+#include "checksum.h"
+#include "column_encoding.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
 #include <vector>
 
-void Serializer::save(const unordered_map<string, shared_ptr<Table>>& tables, ostream& out) {
-    size_t table_count = tables.size();
-    out.write(reinterpret_cast<const char*>(&table_count), sizeof(table_count));
+static constexpr char MAGIC[8] = {'I', 'M', 'D', 'B', 'S', 'N', 'A', 'P'};
 
-    for (const auto& [table_name, table] : tables) {
-        size_t name_length = table_name.size();
-        out.write(reinterpret_cast<const char*>(&name_length), sizeof(name_length));
-        out.write(table_name.c_str(), name_length);
+enum ColumnFlags : uint8_t {
+    FLAG_AUTOINCREMENT = 1,
+    FLAG_UNIQUE = 2,
+    FLAG_KEY = 4,
+    FLAG_INDEXED = 8,
+    FLAG_DEFAULT = 16,
+    FLAG_DICTIONARY = 32,
+};
 
-        auto columns = table->get_columns();
-        size_t column_count = columns.size();
-        out.write(reinterpret_cast<const char*>(&column_count), sizeof(column_count));
-
-        for (const auto& column : columns) {
-            size_t column_name_length = column.get_name().size();
-            out.write(reinterpret_cast<const char*>(&column_name_length), sizeof(column_name_length));
-            out.write(column.get_name().c_str(), column_name_length);
-        }
-
-        const auto& rows = table->get_rows();
-        size_t row_count = rows.size();
-        out.write(reinterpret_cast<const char*>(&row_count), sizeof(row_count));
-
-        for (const auto& row : rows) {
-            for (const auto& column : columns) {
-                const auto& value = row.get_value(column.get_name());
-                std::visit([&out](const auto& val) {
-                    if constexpr (std::is_same_v<decltype(val), int32_t>) {
-                        out.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    } else if constexpr (std::is_same_v<decltype(val), bool>) {
-                        out.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    } else if constexpr (std::is_same_v<decltype(val), string>) {
-                        size_t len = val.size();
-                        out.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                        out.write(val.c_str(), len);
-                    } else if constexpr (std::is_same_v<decltype(val), vector<uint8_t>>) {
-                        size_t len = val.size();
-                        out.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                        out.write(reinterpret_cast<const char*>(val.data()), len);
-                    }
-                }, value);
+static void check_host() {
+    if constexpr (endian::native != endian::little) {
+        throw SerializationException("Snapshots require a little-endian host");
+    }
+}
+
+// Buffers small writes so the stream sees few, large writes; payloads
+// larger than the buffer go straight through.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(ostream& out) : out(out) { buffer.reserve(BUFFER_BYTES); }
+
+    template <typename T>
+    void write_pod(const T& value) {
+        write(&value, sizeof(value));
+    }
+
+    void write(const void* data, size_t size) {
+        if (buffer.size() + size > BUFFER_BYTES) {
+            flush();
+        }
+        if (size >= BUFFER_BYTES) {
+            out.write(static_cast<const char*>(data), size);
+        } else {
+            const char* bytes = static_cast<const char*>(data);
+            buffer.insert(buffer.end(), bytes, bytes + size);
+        }
+        position += size;
+    }
+
+    void pad() {
+        static const char zeros[8] = {};
+        write(zeros, (8 - position % 8) % 8);
+    }
+
+    void write_block(const void* data, size_t size) {
+        uint32_t chunk_count = static_cast<uint32_t>((size + Serializer::CHUNK_BYTES - 1) / Serializer::CHUNK_BYTES);
+        write_pod<uint64_t>(size);
+        write_pod<uint32_t>(Serializer::CHUNK_BYTES);
+        write_pod<uint32_t>(chunk_count);
+        const char* bytes = static_cast<const char*>(data);
+        for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+            size_t offset = size_t(chunk) * Serializer::CHUNK_BYTES;
+            write_pod<uint32_t>(Checksum::crc32c(bytes + offset, min<size_t>(Serializer::CHUNK_BYTES, size - offset)));
+        }
+        pad();
+        write(data, size);
+        pad();
+    }
+
+    void flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+        if (!out) {
+            throw SerializationException("Write failed");
+        }
+    }
+
+private:
+    static constexpr size_t BUFFER_BYTES = 1 << 20;
+
+    ostream& out;
+    vector<char> buffer;
+    size_t position = 0;
+};
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(istream& in) : in(in) {
+        // Blocks are checked against the bytes left in the stream before
+        // anything is allocated for them, where the stream can tell.
+        istream::pos_type start = in.tellg();
+        if (start == istream::pos_type(-1)) {
+            return;
+        }
+        if (in.seekg(0, ios::end)) {
+            stream_bytes = static_cast<uint64_t>(in.tellg() - start);
+        }
+        in.clear();
+        in.seekg(start);
+    }
+
+    template <typename T>
+    T read_pod() {
+        T value;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    void read(void* data, size_t size) {
+        if (!in.read(static_cast<char*>(data), size)) {
+            throw SerializationException("Unexpected end of file");
+        }
+        position += size;
+    }
+
+    void skip_padding() {
+        char padding[8];
+        read(padding, (8 - position % 8) % 8);
+    }
+
+    // Reads a block payload, checking each chunk against its checksum as it arrives.
+    template <typename T>
+    vector<T> read_block(const string& what) {
+        uint64_t size = read_pod<uint64_t>();
+        uint32_t chunk_bytes = read_pod<uint32_t>();
+        uint32_t chunk_count = read_pod<uint32_t>();
+        if (size % sizeof(T) != 0 || chunk_bytes == 0 || chunk_count != (size + chunk_bytes - 1) / chunk_bytes) {
+            throw SerializationException("Corrupt block header for " + what);
+        }
+        if (size > remaining() || chunk_count > remaining() / sizeof(uint32_t)) {
+            throw SerializationException("Block for " + what + " runs past the end of the file");
+        }
+        // A stream that cannot tell its length gets the checksums and the payload
+        // chunk by chunk, so a corrupt size runs into its end before it exhausts memory.
+        vector<uint32_t> checksums;
+        for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+            checksums.push_back(read_pod<uint32_t>());
+        }
+        skip_padding();
+
+        vector<T> values(stream_bytes != UNKNOWN_SIZE ? size / sizeof(T) : 0);
+        for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+            size_t offset = size_t(chunk) * chunk_bytes;
+            size_t length = min<size_t>(chunk_bytes, size - offset);
+            if (values.size() * sizeof(T) < offset + length) {
+                values.resize((offset + length + sizeof(T) - 1) / sizeof(T));
+            }
+            char* bytes = reinterpret_cast<char*>(values.data());
+            read(bytes + offset, length);
+            if (Checksum::crc32c(bytes + offset, length) != checksums[chunk]) {
+                throw SerializationException("Checksum mismatch in " + what);
             }
         }
+        skip_padding();
+        return values;
+    }
+
+private:
+    static constexpr uint64_t UNKNOWN_SIZE = numeric_limits<uint64_t>::max();
+
+    istream& in;
+    size_t position = 0;
+    uint64_t stream_bytes = UNKNOWN_SIZE;
+
+    uint64_t remaining() const {
+        return stream_bytes == UNKNOWN_SIZE ? UNKNOWN_SIZE : stream_bytes - min<uint64_t>(position, stream_bytes);
+    }
+};
+
+// Reads a snapshot in place from a mapping. Block payloads are handed out as
+// pointers into the mapped region; their checksums are only computed on request,
+// since doing so touches every page.
+class MappedReader {
+public:
+    MappedReader(const MappedFile& file, bool verify_checksums) : file(file), verify_checksums(verify_checksums) {}
+
+    template <typename T>
+    T read_pod() {
+        T value;
+        memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    const uint8_t* take(size_t size) {
+        if (size > file.size() - position) {
+            throw SerializationException("Unexpected end of file");
+        }
+        const uint8_t* bytes = file.data() + position;
+        position += size;
+        return bytes;
+    }
+
+    void skip_padding() {
+        take((8 - position % 8) % 8);
+    }
+
+    template <typename T>
+    span<const T> read_block(const string& what, bool verify) {
+        static_assert(alignof(T) <= 8, "Block payloads are 8-byte aligned");
+        uint64_t size = read_pod<uint64_t>();
+        uint32_t chunk_bytes = read_pod<uint32_t>();
+        uint32_t chunk_count = read_pod<uint32_t>();
+        if (size % sizeof(T) != 0 || chunk_bytes == 0 || chunk_count != (size + chunk_bytes - 1) / chunk_bytes) {
+            throw SerializationException("Corrupt block header for " + what);
+        }
+        const uint8_t* checksums = take(size_t(chunk_count) * sizeof(uint32_t));
+        skip_padding();
+        const uint8_t* bytes = take(size);
+        skip_padding();
+
+        if (verify || verify_checksums) {
+            for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+                size_t offset = size_t(chunk) * chunk_bytes;
+                uint32_t expected;
+                memcpy(&expected, checksums + chunk * sizeof(uint32_t), sizeof(expected));
+                if (Checksum::crc32c(bytes + offset, min<size_t>(chunk_bytes, size - offset)) != expected) {
+                    throw SerializationException("Checksum mismatch in " + what);
+                }
+            }
+        }
+        return span<const T>(reinterpret_cast<const T*>(bytes), size / sizeof(T));
+    }
+
+private:
+    const MappedFile& file;
+    bool verify_checksums;
+    size_t position = 0;
+};
+
+// Little-endian encoding of the schema block.
+class SchemaEncoder {
+public:
+    template <typename T>
+    void put(const T& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(value));
+    }
+
+    void put_bytes(const void* bytes, size_t size) {
+        put<uint32_t>(static_cast<uint32_t>(size));
+        const auto* begin = static_cast<const uint8_t*>(bytes);
+        data.insert(data.end(), begin, begin + size);
+    }
+
+    void put_value(const ValueType& value) {
+        put<uint8_t>(static_cast<uint8_t>(DataTypeHelper::type_of(value)));
+        switch (DataTypeHelper::type_of(value)) {
+            case DataType::INT32: put(get<int32_t>(value)); break;
+            case DataType::BOOL: put<uint8_t>(get<bool>(value) ? 1 : 0); break;
+            case DataType::STRING: put_bytes(get<string>(value).data(), get<string>(value).size()); break;
+            case DataType::BYTES: put_bytes(get<vector<uint8_t>>(value).data(), get<vector<uint8_t>>(value).size()); break;
+        }
+    }
+
+    vector<uint8_t> data;
+};
+
+class SchemaDecoder {
+public:
+    explicit SchemaDecoder(span<const uint8_t> data) : data(data) {}
+
+    template <typename T>
+    T get() {
+        T value;
+        memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    string get_string() {
+        uint32_t size = get<uint32_t>();
+        const uint8_t* bytes = take(size);
+        return string(reinterpret_cast<const char*>(bytes), size);
+    }
+
+    DataType get_type() {
+        uint8_t type = get<uint8_t>();
+        if (type > static_cast<uint8_t>(DataType::BYTES)) {
+            throw SerializationException("Unknown column type " + to_string(type));
+        }
+        return static_cast<DataType>(type);
+    }
+
+    ValueType get_value() {
+        switch (get_type()) {
+            case DataType::INT32: return get<int32_t>();
+            case DataType::BOOL: return get<uint8_t>() != 0;
+            case DataType::STRING: return get_string();
+            case DataType::BYTES: {
+                string bytes = get_string();
+                return vector<uint8_t>(bytes.begin(), bytes.end());
+            }
+        }
+        throw SerializationException("Unknown value type");
+    }
+
+private:
+    span<const uint8_t> data;
+    size_t position = 0;
+
+    const uint8_t* take(size_t size) {
+        if (size > data.size() - position) {
+            throw SerializationException("Truncated schema block");
+        }
+        const uint8_t* bytes = data.data() + position;
+        position += size;
+        return bytes;
+    }
+};
+
+static void check_header(const char* magic, uint32_t version) {
+    if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw SerializationException("Not a snapshot file");
+    }
+    if (version != Serializer::FORMAT_VERSION) {
+        throw SerializationException("Unsupported snapshot version " + to_string(version));
     }
 }
 
+template <typename T>
+static void write_encoded(SnapshotWriter& writer, span<const T> values, bool compress) {
+    vector<uint8_t> payload;
+    EncodingHeader header = compress ? ColumnEncoding::encode(values, payload) : EncodingHeader();
+    writer.write_block(&header, sizeof(header));
+    if (header.encoding == Encoding::PLAIN) {
+        writer.write_block(values.data(), values.size_bytes());
+    } else {
+        writer.write_block(payload.data(), payload.size());
+    }
+}
 
-unordered_map<string, shared_ptr<Table>> Serializer::load(istream& in) {
-    unordered_map<string, shared_ptr<Table>> tables;
+static EncodingHeader to_encoding_header(span<const uint8_t> block, const string& what) {
+    EncodingHeader header;
+    if (block.size() != sizeof(header)) {
+        throw SerializationException("Corrupt encoding header for " + what);
+    }
+    memcpy(&header, block.data(), sizeof(header));
+    return header;
+}
+
+template <typename T>
+static vector<T> decode(const EncodingHeader& header, span<const uint8_t> payload, size_t rows) {
+    if constexpr (is_same_v<T, int32_t>) {
+        return ColumnEncoding::decode_int32(header, payload, rows);
+    } else {
+        return ColumnEncoding::decode_bool(header, payload, rows);
+    }
+}
+
+template <typename T>
+static vector<T> read_encoded(SnapshotReader& reader, size_t rows, const string& what) {
+    EncodingHeader header = to_encoding_header(reader.read_block<uint8_t>(what), what);
+    if (header.encoding == Encoding::PLAIN) {
+        return reader.read_block<T>(what);
+    }
+    return decode<T>(header, reader.read_block<uint8_t>(what), rows);
+}
+
+// Layout of a string or bytes column's values.
+enum class BlobLayout : uint32_t { OFFSETS = 0, DICTIONARY = 1, INLINE = 2 };
+
+struct LayoutHeader {
+    BlobLayout layout = BlobLayout::OFFSETS;
+    uint32_t inline_width = 0;
+};
+
+static LayoutHeader layout_of(const ColumnStorage& storage) {
+    if (storage.is_dictionary()) {
+        return {BlobLayout::DICTIONARY, 0};
+    }
+    if (storage.is_inline()) {
+        return {BlobLayout::INLINE, static_cast<uint32_t>(storage.get_inline_width())};
+    }
+    return {BlobLayout::OFFSETS, 0};
+}
+
+static LayoutHeader read_layout(span<const uint8_t> block, const string& what) {
+    LayoutHeader header;
+    if (block.size() != sizeof(header)) {
+        throw SerializationException("Corrupt layout header for " + what);
+    }
+    memcpy(&header, block.data(), sizeof(header));
+    bool valid = header.layout == BlobLayout::INLINE
+        ? header.inline_width != 0 && header.inline_width <= ColumnStorage::MAX_INLINE_WIDTH
+        : header.inline_width == 0 && (header.layout == BlobLayout::OFFSETS || header.layout == BlobLayout::DICTIONARY);
+    if (!valid) {
+        throw SerializationException("Corrupt layout header for " + what);
+    }
+    return header;
+}
+
+static ColumnStorage storage_for(const Column& column, const LayoutHeader& layout) {
+    return ColumnStorage(column.get_type(), layout.layout == BlobLayout::DICTIONARY, layout.layout == BlobLayout::INLINE ? layout.inline_width : 0);
+}
+
+static bool valid_slots(span<const uint8_t> slots, size_t inline_width) {
+    for (size_t slot = 0; slot < slots.size(); slot += inline_width + 1) {
+        if (slots[slot] > inline_width) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The ends are checked always; the order, which reads every offset, only with `check_order`.
+static bool valid_offsets(span<const uint64_t> offsets, size_t values, size_t blob_size, bool check_order = true) {
+    return offsets.size() == values + 1 && offsets.front() == 0 && offsets.back() == blob_size
+        && (!check_order || is_sorted(offsets.begin(), offsets.end()));
+}
+
+static bool valid_codes(span<const int32_t> codes, size_t values) {
+    return all_of(codes.begin(), codes.end(), [values](int32_t code) { return code >= 0 && static_cast<size_t>(code) < values; });
+}
+
+vector<uint8_t> Serializer::encode_schema(const string& table_name, const Table& table) {
+    auto columns = table.get_columns();
+    SchemaEncoder schema;
+    schema.put_bytes(table_name.data(), table_name.size());
+    schema.put<uint64_t>(table.get_row_count());
+    schema.put<uint32_t>(static_cast<uint32_t>(columns.size()));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const Column& column = columns[i];
+        uint8_t flags = (column.is_autoincrement() ? FLAG_AUTOINCREMENT : 0)
+                      | (column.is_unique() && !column.is_key() ? FLAG_UNIQUE : 0)
+                      | (column.is_key() ? FLAG_KEY : 0)
+                      | (table.has_ordered_index(i) ? FLAG_INDEXED : 0)
+                      | (column.has_default() ? FLAG_DEFAULT : 0)
+                      | (column.is_dictionary() ? FLAG_DICTIONARY : 0);
+        schema.put_bytes(column.get_name().data(), column.get_name().size());
+        schema.put<uint8_t>(static_cast<uint8_t>(column.get_type()));
+        schema.put<uint64_t>(column.get_length());
+        schema.put<uint8_t>(flags);
+        schema.put<int32_t>(column.get_autoincrement_value());
+        if (column.has_default()) {
+            schema.put_value(column.get_default_value());
+        }
+    }
+    return std::move(schema.data);
+}
+
+shared_ptr<Table> Serializer::decode_schema(span<const uint8_t> schema_block, uint64_t& row_count) {
+    SchemaDecoder schema(schema_block);
+    string table_name = schema.get_string();
+    auto table = make_shared<Table>(table_name);
+    row_count = schema.get<uint64_t>();
+    uint32_t column_count = schema.get<uint32_t>();
+    for (uint32_t i = 0; i < column_count; ++i) {
+        string column_name = schema.get_string();
+        DataType type = schema.get_type();
+        uint64_t length = schema.get<uint64_t>();
+        uint8_t flags = schema.get<uint8_t>();
+        int32_t next_autoincrement = schema.get<int32_t>();
+        optional<ValueType> default_value;
+        if (flags & FLAG_DEFAULT) {
+            default_value = schema.get_value();
+        }
+        Column column(column_name, type, length, flags & FLAG_AUTOINCREMENT, flags & FLAG_UNIQUE, default_value, flags & FLAG_KEY, flags & FLAG_INDEXED, flags & FLAG_DICTIONARY);
+        column.set_autoincrement_value(next_autoincrement);
+        table->add_column(column);
+    }
+    return table;
+}
 
-    size_t table_count;
-    in.read(reinterpret_cast<char*>(&table_count), sizeof(table_count));
+void Serializer::save(const unordered_map<string, shared_ptr<Table>>& tables, ostream& out) {
+    check_host();
+    SnapshotWriter writer(out);
+    writer.write(MAGIC, sizeof(MAGIC));
+    writer.write_pod<uint32_t>(FORMAT_VERSION);
+    writer.write_pod<uint32_t>(static_cast<uint32_t>(tables.size()));
+    writer.write_pod<uint64_t>(log_sequence_number);
 
-    for (size_t i = 0; i < table_count; ++i) {
-        size_t name_length;
-        in.read(reinterpret_cast<char*>(&name_length), sizeof(name_length));
+    for (const auto& [table_name, table] : tables) {
+        auto columns = table->get_columns();
+        size_t row_count = table->get_row_count();
 
-        string table_name(name_length, '\0');
-        in.read(&table_name[0], name_length);
+        vector<uint8_t> schema = encode_schema(table_name, *table);
+        writer.write_block(schema.data(), schema.size());
 
-        shared_ptr<Table> table = make_shared<Table>(table_name);
+        for (size_t i = 0; i < columns.size(); ++i) {
+            const ColumnStorage& storage = table->get_column_storage(i);
+            switch (storage.get_type()) {
+                case DataType::INT32:
+                    write_encoded(writer, span<const int32_t>(storage.int32_data(), row_count), compress_payloads);
+                    break;
+                case DataType::BOOL:
+                    write_encoded(writer, span<const uint8_t>(storage.bool_data(), row_count), compress_payloads);
+                    break;
+                case DataType::STRING:
+                case DataType::BYTES: {
+                    LayoutHeader layout = layout_of(storage);
+                    writer.write_block(&layout, sizeof(layout));
+                    if (storage.is_inline()) {
+                        writer.write_block(storage.get_blob().data(), row_count * (storage.get_inline_width() + 1));
+                        break;
+                    }
+                    if (storage.is_dictionary()) {
+                        writer.write_block(storage.get_offsets().data(), storage.get_offsets().size_bytes());
+                        writer.write_block(storage.get_blob().data(), storage.get_blob().size());
+                        write_encoded(writer, span<const int32_t>(storage.codes_data(), row_count), compress_payloads);
+                        break;
+                    }
+                    writer.write_block(storage.get_offsets().data(), (row_count + 1) * sizeof(uint64_t));
+                    writer.write_block(storage.get_blob().data(), storage.get_blob().size());
+                    break;
+                }
+            }
+        }
+    }
+    writer.flush();
+}
 
-        size_t column_count;
-        in.read(reinterpret_cast<char*>(&column_count), sizeof(column_count));
-        for (size_t j = 0; j < column_count; ++j) {
-            size_t column_name_length;
-            in.read(reinterpret_cast<char*>(&column_name_length), sizeof(column_name_length));
+unordered_map<string, shared_ptr<Table>> Serializer::load(istream& in) {
+    check_host();
+    SnapshotReader reader(in);
+    char magic[sizeof(MAGIC)];
+    reader.read(magic, sizeof(magic));
+    uint32_t version = reader.read_pod<uint32_t>();
+    check_header(magic, version);
 
-            string column_name(column_name_length, '\0');
-            in.read(&column_name[0], column_name_length);
+    unordered_map<string, shared_ptr<Table>> tables;
+    uint32_t table_count = reader.read_pod<uint32_t>();
+    log_sequence_number = reader.read_pod<uint64_t>();
+    for (uint32_t t = 0; t < table_count; ++t) {
+        vector<uint8_t> schema_block = reader.read_block<uint8_t>("table schema");
+        uint64_t row_count = 0;
+        auto table = decode_schema(schema_block, row_count);
+        const string& table_name = table->get_name();
 
-            table->add_column(Column(column_name, DataType::INT32));
+        vector<ColumnStorage> storage;
+        storage.reserve(table->get_schema()->size());
+        for (const auto& column : table->get_columns()) {
+            string what = "column '" + column.get_name() + "' of table '" + table_name + "'";
+            LayoutHeader layout;
+            if (column.get_type() == DataType::STRING || column.get_type() == DataType::BYTES) {
+                layout = read_layout(reader.read_block<uint8_t>(what), what);
+            }
+            ColumnStorage& column_storage = storage.emplace_back(storage_for(column, layout));
+            switch (column.get_type()) {
+                case DataType::INT32:
+                    column_storage.assign_int32_values(read_encoded<int32_t>(reader, row_count, what));
+                    break;
+                case DataType::BOOL:
+                    column_storage.assign_bool_values(read_encoded<uint8_t>(reader, row_count, what));
+                    break;
+                case DataType::STRING:
+                case DataType::BYTES: {
+                    if (layout.layout == BlobLayout::INLINE) {
+                        auto slots = reader.read_block<uint8_t>(what);
+                        if (slots.size() != row_count * (layout.inline_width + 1) || !valid_slots(slots, layout.inline_width)) {
+                            throw SerializationException("Corrupt inline slots for " + what);
+                        }
+                        column_storage.assign_inline_values(std::move(slots));
+                        break;
+                    }
+                    auto offsets = reader.read_block<uint64_t>(what);
+                    auto blob = reader.read_block<uint8_t>(what);
+                    if (layout.layout == BlobLayout::DICTIONARY) {
+                        auto codes = read_encoded<int32_t>(reader, row_count, what);
+                        if (offsets.empty() || !valid_offsets(offsets, offsets.size() - 1, blob.size())) {
+                            throw SerializationException("Corrupt dictionary for " + what);
+                        }
+                        try {
+                            column_storage.assign_dictionary(std::move(offsets), std::move(blob), std::move(codes));
+                        } catch (const runtime_error& e) {
+                            throw SerializationException(string(e.what()) + " in " + what);
+                        }
+                        break;
+                    }
+                    if (!valid_offsets(offsets, row_count, blob.size())) {
+                        throw SerializationException("Corrupt offsets for " + what);
+                    }
+                    column_storage.assign_blob_values(std::move(offsets), std::move(blob));
+                    break;
+                }
+            }
+            if (column_storage.size() != row_count) {
+                throw SerializationException("Row count mismatch for " + what);
+            }
         }
+        table->load_column_storage(std::move(storage), row_count);
+
+        tables[table_name] = table;
+    }
+
+    return tables;
+}
+
+unordered_map<string, shared_ptr<Table>> Serializer::map(const string& path, bool verify_checksums) {
+    check_host();
+    shared_ptr<const MappedFile> file = MappedFile::open(path);
+    MappedReader reader(*file, verify_checksums);
+    const uint8_t* magic = reader.take(sizeof(MAGIC));
+    uint32_t version = reader.read_pod<uint32_t>();
+    check_header(reinterpret_cast<const char*>(magic), version);
 
-        size_t row_count;
-        in.read(reinterpret_cast<char*>(&row_count), sizeof(row_count));
+    unordered_map<string, shared_ptr<Table>> tables;
+    uint32_t table_count = reader.read_pod<uint32_t>();
+    log_sequence_number = reader.read_pod<uint64_t>();
+    for (uint32_t t = 0; t < table_count; ++t) {
+        // Schema blocks are tiny, so they are always verified.
+        uint64_t row_count = 0;
+        auto table = decode_schema(reader.read_block<uint8_t>("table schema", true), row_count);
+        const string& table_name = table->get_name();
 
-        for (size_t k = 0; k < row_count; ++k) {
-            Row row;
-            for (size_t col = 0; col < column_count; ++col) {
-                ValueType value;
-                in.read(reinterpret_cast<char*>(&value), sizeof(value));
-                row.set_value(table->get_columns()[col].get_name(), value);
+        vector<ColumnStorage> storage;
+        storage.reserve(table->get_schema()->size());
+        for (const auto& column : table->get_columns()) {
+            string what = "column '" + column.get_name() + "' of table '" + table_name + "'";
+            LayoutHeader layout;
+            if (column.get_type() == DataType::STRING || column.get_type() == DataType::BYTES) {
+                layout = read_layout(reader.read_block<uint8_t>(what, true), what);
+            }
+            ColumnStorage& column_storage = storage.emplace_back(storage_for(column, layout));
+            // Encoded payloads are expanded into owned memory; plain ones are read in place.
+            EncodingHeader header;
+            auto read_header = [&]() { header = to_encoding_header(reader.read_block<uint8_t>(what, true), what); };
+            switch (column.get_type()) {
+                case DataType::INT32: {
+                    read_header();
+                    if (header.encoding != Encoding::PLAIN) {
+                        column_storage.assign_int32_values(decode<int32_t>(header, reader.read_block<uint8_t>(what, false), row_count));
+                        break;
+                    }
+                    auto values = reader.read_block<int32_t>(what, false);
+                    if (values.size() != row_count) {
+                        throw SerializationException("Row count mismatch for " + what);
+                    }
+                    column_storage.borrow_int32_values(values.data(), row_count, file);
+                    break;
+                }
+                case DataType::BOOL: {
+                    read_header();
+                    if (header.encoding != Encoding::PLAIN) {
+                        column_storage.assign_bool_values(decode<uint8_t>(header, reader.read_block<uint8_t>(what, false), row_count));
+                        break;
+                    }
+                    auto values = reader.read_block<uint8_t>(what, false);
+                    if (values.size() != row_count) {
+                        throw SerializationException("Row count mismatch for " + what);
+                    }
+                    column_storage.borrow_bool_values(values.data(), row_count, file);
+                    break;
+                }
+                case DataType::STRING:
+                case DataType::BYTES: {
+                    if (layout.layout == BlobLayout::INLINE) {
+                        // Checking every slot's length would fault in the whole column, so
+                        // like the checksums it is only done when asked.
+                        auto slots = reader.read_block<uint8_t>(what, false);
+                        if (slots.size() != row_count * (layout.inline_width + 1) || (verify_checksums && !valid_slots(slots, layout.inline_width))) {
+                            throw SerializationException("Corrupt inline slots for " + what);
+                        }
+                        column_storage.borrow_inline_values(slots.data(), row_count, file);
+                        break;
+                    }
+                    auto offsets = reader.read_block<uint64_t>(what, false);
+                    auto blob = reader.read_block<uint8_t>(what, false);
+                    if (layout.layout == BlobLayout::DICTIONARY) {
+                        // Building the lookup table reads every value anyway, so the order is always checked.
+                        if (offsets.empty() || !valid_offsets(offsets, offsets.size() - 1, blob.size())) {
+                            throw SerializationException("Corrupt dictionary for " + what);
+                        }
+                        read_header();
+                        try {
+                            if (header.encoding != Encoding::PLAIN) {
+                                column_storage.assign_dictionary(vector<uint64_t>(offsets.begin(), offsets.end()), vector<uint8_t>(blob.begin(), blob.end()),
+                                                                 decode<int32_t>(header, reader.read_block<uint8_t>(what, false), row_count));
+                                break;
+                            }
+                            auto codes = reader.read_block<int32_t>(what, false);
+                            if (codes.size() != row_count) {
+                                throw SerializationException("Row count mismatch for " + what);
+                            }
+                            if (verify_checksums && !valid_codes(codes, offsets.size() - 1)) {
+                                throw SerializationException("Dictionary code out of range in " + what);
+                            }
+                            column_storage.borrow_dictionary(offsets.data(), offsets.size() - 1, blob.data(), blob.size(), codes.data(), row_count, file);
+                        } catch (const SerializationException&) {
+                            throw;
+                        } catch (const runtime_error& e) {
+                            throw SerializationException(string(e.what()) + " in " + what);
+                        }
+                        break;
+                    }
+                    // Checking every offset would fault in the whole table; the ends
+                    // are checked always, the order only along with the checksums.
+                    if (!valid_offsets(offsets, row_count, blob.size(), verify_checksums)) {
+                        throw SerializationException("Corrupt offsets for " + what);
+                    }
+                    column_storage.borrow_blob_values(offsets.data(), row_count, blob.data(), blob.size(), file);
+                    break;
+                }
             }
-            table->insert_row(row);
         }
+        table->load_column_storage(std::move(storage), row_count);
 
         tables[table_name] = table;
     }
 
     return tables;
-}
\ No newline at end of file
+}
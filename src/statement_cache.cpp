@@ -0,0 +1,82 @@
+#include "statement_cache.h"
+#include "parser.h"
+
+#include <cctype>
+
+string StatementCache::normalize(string_view query) {
+    string normalized;
+    normalized.reserve(query.size());
+    bool in_string = false;
+    bool pending_space = false;
+
+    for (char c : query) {
+        if (!in_string && isspace(static_cast<unsigned char>(c))) {
+            pending_space = !normalized.empty();
+            continue;
+        }
+        if (pending_space) {
+            normalized.push_back(' ');
+            pending_space = false;
+        }
+        if (c == '\'') {
+            in_string = !in_string;
+        }
+        normalized.push_back(c);
+    }
+    return normalized;
+}
+
+shared_ptr<const Statement> StatementCache::get_or_parse(string_view query) {
+    string key = normalize(query);
+    {
+        lock_guard<mutex> lock(cache_mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            ++hits;
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->second;
+        }
+        ++misses;
+    }
+
+    auto statement = make_shared<const Statement>(Parser::parse(key));
+    if (capacity == 0) {
+        return statement;
+    }
+
+    lock_guard<mutex> lock(cache_mutex);
+    // Another thread may have parsed the same query meanwhile.
+    auto it = index.find(key);
+    if (it != index.end()) {
+        return it->second->second;
+    }
+    entries.emplace_front(std::move(key), statement);
+    index[entries.front().first] = entries.begin();
+
+    if (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    return statement;
+}
+
+size_t StatementCache::size() const {
+    lock_guard<mutex> lock(cache_mutex);
+    return entries.size();
+}
+
+size_t StatementCache::get_hits() const {
+    lock_guard<mutex> lock(cache_mutex);
+    return hits;
+}
+
+size_t StatementCache::get_misses() const {
+    lock_guard<mutex> lock(cache_mutex);
+    return misses;
+}
+
+void StatementCache::clear() {
+    lock_guard<mutex> lock(cache_mutex);
+    index.clear();
+    entries.clear();
+}
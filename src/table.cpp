@@ -1,56 +1,441 @@
 #include "table.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
+#include <unordered_set>
 
-Table::Table(const string& name) : name(name) {}
+#include "cursor.h"
+#include "epoch.h"
+#include "exceptions.h"
+
+Table::Table(const string& name) : name(name), schema(make_shared<Schema>()) {}
 
 void Table::add_column(const Column& column) {
-    if (columns.find(column.get_name()) != columns.end()) {
-        throw runtime_error("Column already exists: " + column.get_name());
+    if (row_count > 0) {
+        throw runtime_error("Cannot add column to a non-empty table: " + column.get_name());
+    }
+    // Rows already bound to the old schema keep it; new rows see the extended copy.
+    auto extended = make_shared<Schema>(*schema);
+    extended->add_column(column);
+    schema = std::move(extended);
+    // Bounded values are stored inline; unbounded and long ones go to the blob.
+    bool inline_values = !column.is_dictionary() && column.get_length() <= ColumnStorage::MAX_INLINE_WIDTH;
+    storage.emplace_back(column.get_type(), column.is_dictionary(), inline_values ? column.get_length() : 0);
+    if (column.is_unique()) {
+        hash_indexes[storage.size() - 1] = HashIndex();
+    }
+    if (column.is_indexed()) {
+        create_ordered_index(storage.size() - 1);
     }
-    columns[column.get_name()] = column;
 }
 
 vector<Column> Table::get_columns() const {
-    vector<Column> columns_list;
-    for (const auto& [name, column] : columns) {
-        columns_list.push_back(column);
-    }
-    return columns_list;
+    return schema->get_columns();
 }
 
 bool Table::has_column(const string& column_name) const {
-    return columns.find(column_name) != columns.end();
+    return schema->has_column(column_name);
 }
 
 const Column& Table::get_column(const string& column_name) const {
-    auto it = columns.find(column_name);
-    if (it == columns.end()) {
-        throw runtime_error("Column not found: " + column_name);
-    }
-    return it->second;
+    return schema->get_column(get_column_ordinal(column_name));
+}
+
+size_t Table::get_column_ordinal(const string& column_name) const {
+    return schema->get_column_ordinal(column_name);
+}
+
+const ColumnStorage& Table::get_column_storage(size_t ordinal) const {
+    return storage[ordinal];
 }
 
 void Table::insert_row(Row& row) {
-    for (auto& [name, column] : columns) {
-        if (!row.has_value(name)) {
-            if (column.is_autoincrement()) {
-                row.set_value(name, column.get_next_autoincrement_value());
-            } else if (column.has_default()) {
-                row.set_value(name, column.get_default_value());
-            } else {
-                throw runtime_error("Missing value for column: " + name);
+    insert_rows(span<Row>(&row, 1));
+}
+
+void Table::insert_rows(span<Row> batch) {
+    if (batch.empty()) {
+        return;
+    }
+    unique_lock<shared_mutex> lock(table_mutex);
+    check_writable();
+    size_t first_row = append_rows(batch);
+    uint64_t lsn = log_appended_rows(first_row);
+    ++version;
+    publish_rows(lock, row_count, lsn);
+}
+
+void Table::check_writable() const {
+    if (commit_failed) {
+        throw runtime_error("Table '" + name + "' no longer accepts writes: a log commit failed");
+    }
+}
+
+void Table::publish_rows(unique_lock<shared_mutex>& lock, size_t end_row, uint64_t lsn) {
+    if (lsn == 0) {
+        committed_rows.store(end_row, memory_order_release);
+        published.notify_all();
+        return;
+    }
+    shared_ptr<WriteAheadLog> committing = log;
+    // Committing outside the lock lets other writers join the same log flush.
+    lock.unlock();
+    try {
+        committing->commit(lsn);
+    } catch (...) {
+        // The rows stay unpublished, and since rows are only ever appended,
+        // no later write may publish past them.
+        lock.lock();
+        commit_failed = true;
+        published.notify_all();
+        throw;
+    }
+    lock.lock();
+    // A later writer's commit makes these records durable too, so it may
+    // have published the rows already.
+    if (committed_rows.load(memory_order_relaxed) < end_row) {
+        committed_rows.store(end_row, memory_order_release);
+    }
+    published.notify_all();
+}
+
+shared_lock<shared_mutex> Table::lock_published() const {
+    shared_lock<shared_mutex> lock(table_mutex);
+    published.wait(lock, [this] { return commit_failed || committed_rows.load(memory_order_acquire) == row_count; });
+    if (commit_failed) {
+        throw runtime_error("Table '" + name + "' has rows a failed log commit left unpublished");
+    }
+    return lock;
+}
+
+size_t Table::append_rows(span<Row> batch) {
+    size_t column_count = schema->size();
+    vector<size_t> autoincrement_needed(column_count, 0);
+    vector<size_t> blob_bytes(column_count, 0);
+
+    for (Row& row : batch) {
+        if (row.get_schema() != schema) {
+            row.bind(schema);
+        }
+        for (size_t i = 0; i < column_count; ++i) {
+            const Column& column = schema->get_column(i);
+            if (!row.has(i)) {
+                if (column.is_autoincrement()) {
+                    ++autoincrement_needed[i];
+                } else if (!column.has_default()) {
+                    throw runtime_error("Missing value for column: " + column.get_name());
+                }
+                continue;
+            }
+            const ValueType& value = row.get(i);
+            if (!DataTypeHelper::validate(value, column.get_type())) {
+                throw runtime_error("Type mismatch for column '" + column.get_name() + "'. Expected: " + DataTypeHelper::type_to_string(column.get_type()));
+            }
+            size_t size = 0;
+            if (const auto* text = get_if<string>(&value)) {
+                size = text->size();
+            } else if (const auto* bytes = get_if<vector<uint8_t>>(&value)) {
+                size = bytes->size();
+            }
+            check_length(column, size);
+            blob_bytes[i] += size;
+        }
+    }
+
+    // Only a batch that passes every check gets autoincrement values, so a
+    // rejected one leaves the rows and the counters as they were.
+    ensure_indexes();
+    ensure_autoincrement();
+    for (const auto& [ordinal, index] : hash_indexes) {
+        check_unique(batch, ordinal);
+    }
+
+    for (size_t i = 0; i < column_count; ++i) {
+        if (autoincrement_needed[i] == 0) {
+            continue;
+        }
+        int32_t next = schema->get_column(i).reserve_autoincrement_range(autoincrement_needed[i]);
+        for (Row& row : batch) {
+            if (!row.has(i)) {
+                row.set(i, next++);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < column_count; ++i) {
+        const Column& column = schema->get_column(i);
+        ColumnStorage& column_storage = storage[i];
+        column_storage.reserve_additional(batch.size(), blob_bytes[i]);
+        for (const Row& row : batch) {
+            column_storage.append(row.has(i) ? row.get(i) : column.get_default_value());
+        }
+    }
+    size_t first_row = row_count;
+    row_count += batch.size();
+    index_rows(first_row);
+    advance_autoincrement(first_row);
+    return first_row;
+}
+
+uint64_t Table::log_appended_rows(size_t first_row) {
+    if (!log) {
+        return 0;
+    }
+    try {
+        uint64_t lsn = log->append_insert(*this, first_row, row_count - first_row);
+        log_lsn = lsn;
+        return lsn;
+    } catch (...) {
+        // Rows the log does not hold must never become visible.
+        truncate_rows(first_row);
+        throw;
+    }
+}
+
+void Table::truncate_rows(size_t first_row) {
+    for (auto& column_storage : storage) {
+        column_storage.truncate(first_row);
+    }
+    row_count = first_row;
+    rebuild_indexes();
+}
+
+void Table::advance_autoincrement(size_t first_row) {
+    for (size_t i = 0; i < storage.size(); ++i) {
+        Column& column = schema->get_column(i);
+        if (!column.is_autoincrement() || column.get_type() != DataType::INT32 || first_row == row_count) {
+            continue;
+        }
+        const int32_t* values = storage[i].int32_data();
+        int32_t largest = *max_element(values + first_row, values + row_count);
+        if (largest >= column.get_autoincrement_value() && largest < numeric_limits<int32_t>::max()) {
+            column.set_autoincrement_value(largest + 1);
+        }
+    }
+}
+
+void Table::ensure_autoincrement() {
+    if (autoincrement_stale) {
+        advance_autoincrement(0);
+        autoincrement_stale = false;
+    }
+}
+
+void Table::check_length(const Column& column, size_t size) {
+    if (column.get_length() != 0 && size > column.get_length()) {
+        throw ConstraintViolationException("Value of " + to_string(size) + " bytes is too long for column '" + column.get_name()
+                                           + "' of length " + to_string(column.get_length()));
+    }
+}
+
+void Table::check_unique(span<Row> batch, size_t ordinal) const {
+    const Column& column = schema->get_column(ordinal);
+    const HashIndex& index = hash_indexes.at(ordinal);
+    // Rows without a value of an autoincrement column are checked with the ones they will be assigned.
+    vector<ValueType> generated;
+    if (column.is_autoincrement()) {
+        generated.resize(batch.size());
+        int32_t next = column.get_autoincrement_value();
+        for (size_t r = 0; r < batch.size(); ++r) {
+            if (!batch[r].has(ordinal)) {
+                generated[r] = next++;
             }
         }
     }
-    rows.push_back(row);
+    auto value_of = [&](size_t r) -> const ValueType& {
+        if (batch[r].has(ordinal)) {
+            return batch[r].get(ordinal);
+        }
+        return generated.empty() ? column.get_default_value() : generated[r];
+    };
+
+    for (size_t r = 0; r < batch.size(); ++r) {
+        if (index.find(storage[ordinal], value_of(r))) {
+            throw ConstraintViolationException("Duplicate value for unique column '" + column.get_name() + "'");
+        }
+    }
+    if (batch.size() < 2) {
+        return;
+    }
+
+    auto hash = [&](size_t r) { return static_cast<size_t>(HashIndex::hash(value_of(r))); };
+    auto equal = [&](size_t a, size_t b) { return value_of(a) == value_of(b); };
+    unordered_set<size_t, decltype(hash), decltype(equal)> seen(batch.size(), hash, equal);
+    for (size_t r = 0; r < batch.size(); ++r) {
+        if (!seen.insert(r).second) {
+            throw ConstraintViolationException("Duplicate value for unique column '" + column.get_name() + "'");
+        }
+    }
+}
+
+void Table::index_rows(size_t first_row) {
+    for (auto& [ordinal, index] : hash_indexes) {
+        index.reserve(storage[ordinal], row_count);
+        for (size_t row = first_row; row < row_count; ++row) {
+            if (!index.insert(storage[ordinal], row)) {
+                throw ConstraintViolationException("Duplicate value for unique column '" + schema->get_column(ordinal).get_name() + "'");
+            }
+        }
+    }
+    for (auto& [ordinal, index] : ordered_indexes) {
+        if (first_row == 0) {
+            index.rebuild(storage[ordinal]);
+            continue;
+        }
+        for (size_t row = first_row; row < row_count; ++row) {
+            index.insert(OrderedIndex::key_of(storage[ordinal], row), row);
+        }
+    }
+}
+
+void Table::rebuild_indexes() const {
+    for (auto& [ordinal, index] : hash_indexes) {
+        index.rebuild(storage[ordinal]);
+    }
+    for (auto& [ordinal, index] : ordered_indexes) {
+        index.rebuild(storage[ordinal]);
+    }
+    indexes_stale = false;
+}
+
+void Table::ensure_indexes() const {
+    if (!indexes_stale.load(memory_order_acquire)) {
+        return;
+    }
+    lock_guard<mutex> lock(index_mutex);
+    if (indexes_stale.load(memory_order_relaxed)) {
+        rebuild_indexes();
+    }
+}
+
+void Table::create_ordered_index(size_t ordinal) {
+    const Column& column = schema->get_column(ordinal);
+    if (!OrderedIndex::supports(column.get_type())) {
+        throw InvalidQueryException("Ordered indexes support int32 and bool columns only: " + column.get_name());
+    }
+    unique_lock<shared_mutex> lock(table_mutex);
+    check_writable();
+    if (has_ordered_index(ordinal)) {
+        throw InvalidQueryException("Index already exists on column: " + column.get_name());
+    }
+    ensure_indexes();
+    ordered_indexes[ordinal].rebuild(storage[ordinal]);
+    ++version;
+    if (!log) {
+        return;
+    }
+    uint64_t lsn = log->append_create_index(*this, ordinal);
+    log_lsn = lsn;
+    shared_ptr<WriteAheadLog> committing = log;
+    lock.unlock();
+    try {
+        committing->commit(lsn);
+    } catch (...) {
+        // The index is already in use but would not survive a restart; like a
+        // failed insert, this stops the table from taking further writes.
+        lock.lock();
+        commit_failed = true;
+        published.notify_all();
+        throw;
+    }
+}
+
+optional<size_t> Table::find_row(size_t ordinal, const ValueType& key) const {
+    ensure_indexes();
+    auto it = hash_indexes.find(ordinal);
+    if (it == hash_indexes.end()) {
+        throw runtime_error("No hash index on column: " + schema->get_column(ordinal).get_name());
+    }
+    return it->second.find(storage[ordinal], key);
+}
+
+const OrderedIndex& Table::get_ordered_index(size_t ordinal) const {
+    ensure_indexes();
+    return ordered_indexes.at(ordinal);
+}
+
+void Table::append_columns(const vector<ColumnStorage>& batch) {
+    if (batch.size() != storage.size()) {
+        throw runtime_error("Column count mismatch for table: " + name);
+    }
+    size_t batch_rows = batch.empty() ? 0 : batch.front().size();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i].get_type() != storage[i].get_type() || batch[i].size() != batch_rows) {
+            throw runtime_error("Column batch mismatch for column: " + schema->get_column(i).get_name());
+        }
+        const Column& column = schema->get_column(i);
+        bool fits = batch[i].is_inline() && batch[i].get_inline_width() <= column.get_length();
+        if (column.get_length() != 0 && !fits && (column.get_type() == DataType::STRING || column.get_type() == DataType::BYTES)) {
+            for (size_t row = 0; row < batch_rows; ++row) {
+                check_length(column, batch[i].get_string(row).size());
+            }
+        }
+    }
+    unique_lock<shared_mutex> lock(table_mutex);
+    check_writable();
+    ensure_indexes();
+    ensure_autoincrement();
+    size_t first_row = row_count;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        storage[i].append_from(batch[i]);
+    }
+    row_count += batch_rows;
+
+    try {
+        index_rows(first_row);
+    } catch (const ConstraintViolationException&) {
+        // Roll the append back so the table and its indexes stay consistent.
+        truncate_rows(first_row);
+        throw;
+    }
+    advance_autoincrement(first_row);
+    uint64_t lsn = log_appended_rows(first_row);
+    ++version;
+    publish_rows(lock, row_count, lsn);
+}
+
+shared_ptr<Table> Table::consistent_copy() const {
+    auto copy = make_shared<Table>(name);
+    size_t rows = 0;
+    {
+        // The counters have to match the rows, so writers wait while both are read.
+        shared_lock<shared_mutex> lock = lock_published();
+        copy->schema = make_shared<Schema>(*schema);
+        for (const auto& column_storage : storage) {
+            ColumnStorage& copied = copy->storage.emplace_back(column_storage.get_type(), column_storage.is_dictionary(), column_storage.get_inline_width());
+            copied.reserve(row_count);
+        }
+        for (const auto& [ordinal, index] : hash_indexes) {
+            copy->hash_indexes[ordinal];
+        }
+        for (const auto& [ordinal, index] : ordered_indexes) {
+            copy->ordered_indexes[ordinal];
+        }
+        rows = row_count;
+        copy->version = version.load();
+        copy->log_lsn = log_lsn.load();
+        copy->autoincrement_stale = autoincrement_stale;
+    }
+    Epoch::Guard guard;
+    for (size_t i = 0; i < storage.size(); ++i) {
+        copy->storage[i].append_range_from(storage[i], 0, rows);
+    }
+    copy->row_count = rows;
+    copy->committed_rows = rows;
+    copy->indexes_stale = true;
+    return copy;
 }
 
 std::vector<Row> Table::select(std::function<bool(const Row&)> condition) {
+    Epoch::Guard guard;
     std::vector<Row> result;
-    for (const auto& row : rows) {
+    Row row(schema);
+    size_t rows = get_row_count();
+    for (size_t i = 0; i < rows; ++i) {
+        read_row(i, row);
         if (condition(row)) {
             result.push_back(row);
         }
@@ -58,42 +443,163 @@ std::vector<Row> Table::select(std::function<bool(const Row&)> condition) {
     return result;
 }
 
+std::vector<Row> Table::select(const Expression& predicate, const AccessPath& path, ThreadPool* pool) const {
+    Epoch::Guard guard;
+    std::vector<Row> result;
+    std::vector<size_t> rows = select_row_ids(predicate, path, pool);
+    result.reserve(rows.size());
+    for (size_t row : rows) {
+        result.push_back(get_row(row));
+    }
+    return result;
+}
+
+static bool value_less(const ColumnStorage& column_storage, size_t a, size_t b) {
+    switch (column_storage.get_type()) {
+        case DataType::INT32: return column_storage.get_int32(a) < column_storage.get_int32(b);
+        case DataType::BOOL: return column_storage.get_bool(a) < column_storage.get_bool(b);
+        case DataType::STRING:
+        case DataType::BYTES: return column_storage.get_string(a) < column_storage.get_string(b);
+    }
+    return false;
+}
+
+std::vector<size_t> Table::select_row_ids(const Expression& predicate, const AccessPath& path, ThreadPool* pool) const {
+    std::vector<size_t> rows;
+    RowScanner scanner(*this, predicate, path, get_row_count(), pool);
+    bool needs_sort = path.order_ordinal && !path.presorted;
+    size_t row;
+    while ((needs_sort || !path.limit || rows.size() < *path.limit) && scanner.next(row)) {
+        rows.push_back(row);
+    }
+    if (!needs_sort) {
+        return rows;
+    }
+
+    // Ties fall back to row order, and descending order is exactly the
+    // reverse of ascending, so every access path sorts the same way.
+    const ColumnStorage& column_storage = storage[*path.order_ordinal];
+    auto ascending = [&column_storage](size_t a, size_t b) {
+        if (value_less(column_storage, a, b)) return true;
+        if (value_less(column_storage, b, a)) return false;
+        return a < b;
+    };
+    auto descending = [&ascending](size_t a, size_t b) { return ascending(b, a); };
+    auto sort_rows = [&](auto compare) {
+        if (path.limit && *path.limit < rows.size()) {
+            partial_sort(rows.begin(), rows.begin() + *path.limit, rows.end(), compare);
+            rows.resize(*path.limit);
+        } else {
+            sort(rows.begin(), rows.end(), compare);
+        }
+    };
+    if (path.descending) {
+        sort_rows(descending);
+    } else {
+        sort_rows(ascending);
+    }
+    return rows;
+}
+
 void Table::print_table() const {
-    if (columns.empty()) {
+    Epoch::Guard guard;
+    if (schema->size() == 0) {
         std::cout << "The table is empty." << std::endl;
         return;
     }
 
-    for (const auto& [name, _] : columns) {
-        std::cout << std::setw(15) << std::left << name;
+    for (const auto& column : schema->get_columns()) {
+        std::cout << std::setw(15) << std::left << column.get_name();
     }
     std::cout << std::endl;
 
-    std::cout << std::string(columns.size() * 15, '-') << std::endl;
+    std::cout << std::string(schema->size() * 15, '-') << std::endl;
 
-    for (const auto& row : rows) {
-        for (const auto& [name, _] : columns) {
-            const auto& value = row.get_value(name);
-            std::visit([](const auto& val) {
-                if constexpr (std::is_same_v<std::decay_t<decltype(val)>, std::vector<unsigned char>>) {
+    size_t rows = get_row_count();
+    for (size_t i = 0; i < rows; ++i) {
+        for (const auto& column_storage : storage) {
+            switch (column_storage.get_type()) {
+                case DataType::INT32:
+                    std::cout << std::setw(15) << std::left << column_storage.get_int32(i);
+                    break;
+                case DataType::BOOL:
+                    std::cout << std::setw(15) << std::left << column_storage.get_bool(i);
+                    break;
+                case DataType::STRING:
+                    std::cout << std::setw(15) << std::left << column_storage.get_string(i);
+                    break;
+                case DataType::BYTES:
                     std::cout << std::setw(15) << std::left << "[BLOB]";
-                } else {
-                    std::cout << std::setw(15) << std::left << val;
-                }
-            }, value);
+                    break;
+            }
         }
         std::cout << std::endl;
     }
 }
 
-const std::vector<Row>& Table::get_rows() const {
-    return rows;
+Row Table::get_row(size_t index) const {
+    Row row(schema);
+    read_row(index, row);
+    return row;
+}
+
+void Table::read_row(size_t index, Row& row) const {
+    for (size_t i = 0; i < storage.size(); ++i) {
+        storage[i].read_value(index, row.slot(i));
+    }
+}
+
+std::vector<Row> Table::get_rows() const {
+    Epoch::Guard guard;
+    std::vector<Row> result;
+    size_t rows = get_row_count();
+    result.reserve(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        result.push_back(get_row(i));
+    }
+    return result;
 }
 
 vector<Column> Table::get_column_definitions() const {
-    vector<Column> column_definitions;
-    for (const auto& [name, column] : columns) {
-        column_definitions.push_back(column);
+    return schema->get_columns();
+}
+
+void Table::load_column_storage(vector<ColumnStorage> loaded, size_t loaded_row_count) {
+    if (loaded.size() != schema->size()) {
+        throw runtime_error("Column count mismatch while loading table: " + name);
     }
-    return column_definitions;
-}
\ No newline at end of file
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        if (loaded[i].get_type() != schema->get_column(i).get_type() || loaded[i].size() != loaded_row_count) {
+            throw runtime_error("Column storage mismatch while loading table: " + name);
+        }
+    }
+    storage = std::move(loaded);
+    row_count = loaded_row_count;
+    committed_rows = loaded_row_count;
+    indexes_stale = true;
+    autoincrement_stale = true;
+}
+
+size_t Table::memory_usage() const {
+    TableMemory memory = memory_breakdown();
+    return memory.column_bytes + memory.string_bytes + memory.index_bytes;
+}
+
+TableMemory Table::memory_breakdown() const {
+    shared_lock<shared_mutex> lock(table_mutex);
+    TableMemory memory;
+    for (const auto& column_storage : storage) {
+        memory.string_bytes += column_storage.string_memory_usage();
+        memory.column_bytes += column_storage.memory_usage() - column_storage.string_memory_usage();
+        memory.mapped_bytes += column_storage.borrowed_bytes();
+    }
+    // Readers rebuild stale indexes under index_mutex, not the table lock.
+    lock_guard<mutex> index_lock(index_mutex);
+    for (const auto& [ordinal, index] : hash_indexes) {
+        memory.index_bytes += index.memory_usage();
+    }
+    for (const auto& [ordinal, index] : ordered_indexes) {
+        memory.index_bytes += index.memory_usage();
+    }
+    return memory;
+}
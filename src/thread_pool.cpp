@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+    size_t worker_count = max<size_t>(threads, 1) - 1;
+    for (size_t i = 0; i < worker_count; ++i) {
+        queues.push_back(make_unique<Queue>());
+    }
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t count, const function<void(size_t)>& task) {
+    if (workers.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    auto job = make_shared<Job>();
+    job->task = &task;
+    job->remaining = count;
+    for (size_t i = 0; i < count; ++i) {
+        Queue& queue = *queues[i % queues.size()];
+        lock_guard<mutex> lock(queue.queue_mutex);
+        queued.fetch_add(1);
+        queue.tasks.emplace_back(job, i);
+    }
+    {
+        // Taken so a worker between checking `queued` and sleeping cannot miss the wakeup.
+        lock_guard<mutex> lock(sleep_mutex);
+    }
+    wake.notify_all();
+
+    // The caller steals like a worker until nothing is left, then waits for the stragglers.
+    Task stolen;
+    while (job->remaining.load(memory_order_acquire) != 0) {
+        if (take(0, stolen)) {
+            execute(stolen);
+            continue;
+        }
+        unique_lock<mutex> lock(job->done_mutex);
+        job->done.wait(lock, [&job] { return job->remaining.load(memory_order_acquire) == 0; });
+    }
+    if (job->error) {
+        rethrow_exception(job->error);
+    }
+}
+
+void ThreadPool::work(size_t index) {
+    Task task;
+    while (true) {
+        if (take(index, task)) {
+            execute(task);
+            continue;
+        }
+        unique_lock<mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || queued.load() != 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::take(size_t first, Task& task) {
+    for (size_t i = 0; i < queues.size(); ++i) {
+        Queue& queue = *queues[(first + i) % queues.size()];
+        lock_guard<mutex> lock(queue.queue_mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task& task) {
+    Job& job = *task.first;
+    try {
+        (*job.task)(task.second);
+    } catch (...) {
+        lock_guard<mutex> lock(job.done_mutex);
+        if (!job.error) {
+            job.error = current_exception();
+        }
+    }
+    if (job.remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+        lock_guard<mutex> lock(job.done_mutex);
+        job.done.notify_all();
+    }
+    task.first.reset();
+}
@@ -0,0 +1,109 @@
+#include "tokenizer.h"
+#include "exceptions.h"
+
+#include <cctype>
+
+static bool is_identifier_char(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool is_digit(char c) {
+    return isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+void Tokenizer::skip_whitespace() {
+    while (position < input.size() && isspace(static_cast<unsigned char>(input[position]))) {
+        ++position;
+    }
+}
+
+Token Tokenizer::peek() {
+    if (!lookahead) {
+        lookahead = scan();
+    }
+    return *lookahead;
+}
+
+Token Tokenizer::next() {
+    if (lookahead) {
+        Token token = *lookahead;
+        lookahead.reset();
+        return token;
+    }
+    return scan();
+}
+
+Token Tokenizer::scan() {
+    skip_whitespace();
+    size_t start = position;
+    if (position >= input.size()) {
+        return {TokenType::END, input.substr(start, 0), start};
+    }
+
+    char c = input[position];
+
+    if (c == '0' && position + 1 < input.size() && (input[position + 1] == 'x' || input[position + 1] == 'X')) {
+        position += 2;
+        while (position < input.size() && isxdigit(static_cast<unsigned char>(input[position]))) {
+            ++position;
+        }
+        if (position < input.size() && is_identifier_char(input[position])) {
+            throw InvalidQueryException("Malformed hex literal at position " + to_string(start));
+        }
+        return {TokenType::HEX, input.substr(start, position - start), start};
+    }
+
+    if (is_digit(c) || (c == '-' && position + 1 < input.size() && is_digit(input[position + 1]))) {
+        ++position;
+        while (position < input.size() && is_digit(input[position])) {
+            ++position;
+        }
+        if (position < input.size() && is_identifier_char(input[position])) {
+            throw InvalidQueryException("Malformed number at position " + to_string(start));
+        }
+        return {TokenType::INTEGER, input.substr(start, position - start), start};
+    }
+
+    if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
+        while (position < input.size() && is_identifier_char(input[position])) {
+            ++position;
+        }
+        return {TokenType::IDENTIFIER, input.substr(start, position - start), start};
+    }
+
+    if (c == '\'') {
+        ++position;
+        while (true) {
+            if (position >= input.size()) {
+                throw InvalidQueryException("Unterminated string literal at position " + to_string(start));
+            }
+            if (input[position] == '\'') {
+                if (position + 1 < input.size() && input[position + 1] == '\'') {
+                    position += 2;
+                    continue;
+                }
+                ++position;
+                break;
+            }
+            ++position;
+        }
+        return {TokenType::STRING, input.substr(start, position - start), start};
+    }
+
+    if (position + 1 < input.size()) {
+        string_view two = input.substr(position, 2);
+        if (two == "<=" || two == ">=" || two == "!=" || two == "<>") {
+            position += 2;
+            return {TokenType::SYMBOL, two, start};
+        }
+    }
+
+    switch (c) {
+        case '(': case ')': case '{': case '}': case '[': case ']':
+        case ',': case '.': case ':': case '=': case '<': case '>': case '*': case ';': case '?':
+            ++position;
+            return {TokenType::SYMBOL, input.substr(start, 1), start};
+        default:
+            throw InvalidQueryException("Unexpected character '" + string(1, c) + "' at position " + to_string(start));
+    }
+}
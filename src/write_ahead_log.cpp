@@ -0,0 +1,549 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "checksum.h"
+#include "exceptions.h"
+#include "mapped_file.h"
+#include "serializer.h"
+#include "table.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
+static int sync_descriptor(int fd) { return _commit(fd); }
+
+static int resize_descriptor(int fd, size_t size) { return _chsize_s(fd, static_cast<long long>(size)); }
+#else
+#include <fcntl.h>
+#include <unistd.h>
+
+static int sync_descriptor(int fd) {
+#ifdef __linux__
+    return fdatasync(fd);
+#else
+    return fsync(fd);
+#endif
+}
+
+static int resize_descriptor(int fd, size_t size) { return ftruncate(fd, static_cast<off_t>(size)); }
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// Writes all of `data`, retrying interrupted writes; false on an error.
+static bool write_descriptor(int fd, span<const uint8_t> data) {
+    while (!data.empty()) {
+        auto written = ::write(fd, data.data(), static_cast<unsigned>(min<size_t>(data.size(), 1 << 30)));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data = data.subspan(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+static constexpr char MAGIC[8] = {'I', 'M', 'D', 'B', 'W', 'A', 'L', '\0'};
+static constexpr size_t LOG_HEADER_BYTES = 16;
+static constexpr size_t RECORD_HEADER_BYTES = 17;
+// Record headers store the payload size in 32 bits.
+static constexpr size_t MAX_RECORD_BYTES = numeric_limits<uint32_t>::max();
+
+class RecordEncoder {
+public:
+    template <typename T>
+    void put(const T& value) {
+        put_raw(&value, sizeof(value));
+    }
+
+    void put_raw(const void* bytes, size_t size) {
+        const auto* begin = static_cast<const uint8_t*>(bytes);
+        data.insert(data.end(), begin, begin + size);
+    }
+
+    void put_string(const string& value) {
+        put<uint32_t>(static_cast<uint32_t>(value.size()));
+        put_raw(value.data(), value.size());
+    }
+
+    vector<uint8_t> data;
+};
+
+class RecordDecoder {
+public:
+    explicit RecordDecoder(span<const uint8_t> data) : data(data) {}
+
+    template <typename T>
+    T get() {
+        T value;
+        memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    string get_string() {
+        uint32_t size = get<uint32_t>();
+        return string(reinterpret_cast<const char*>(take(size)), size);
+    }
+
+    const uint8_t* take(size_t size) {
+        if (size > data.size() - position) {
+            throw SerializationException("Truncated log record");
+        }
+        const uint8_t* bytes = data.data() + position;
+        position += size;
+        return bytes;
+    }
+
+private:
+    span<const uint8_t> data;
+    size_t position = 0;
+};
+
+static uint32_t record_checksum(uint64_t lsn, LogRecordType type, span<const uint8_t> payload) {
+    uint32_t crc = Checksum::crc32c(&lsn, sizeof(lsn));
+    crc = Checksum::crc32c(&type, sizeof(type), crc);
+    return Checksum::crc32c(payload.data(), payload.size(), crc);
+}
+
+static shared_ptr<Table> find_logged_table(const string& name, unordered_map<string, shared_ptr<Table>>& tables) {
+    auto it = tables.find(name);
+    if (it == tables.end()) {
+        throw SerializationException("Log record for unknown table: " + name);
+    }
+    return it->second;
+}
+
+// Hands each intact record of a mapped log to `visit` and returns the bytes they
+// span, header included; 0 if the file is empty. Stops at the first record that
+// was torn by a crash or does not follow `last_lsn`, which tracks the last one.
+static size_t scan_records(const MappedFile& file, const string& path, const function<void(const LogRecord&)>& visit, uint64_t& last_lsn) {
+    if (file.size() < LOG_HEADER_BYTES) {
+        return 0;
+    }
+    uint32_t version;
+    memcpy(&version, file.data() + sizeof(MAGIC), sizeof(version));
+    if (memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0 || version != WriteAheadLog::FORMAT_VERSION) {
+        throw SerializationException("Not a write-ahead log: " + path);
+    }
+    size_t valid_bytes = LOG_HEADER_BYTES;
+    while (file.size() - valid_bytes >= RECORD_HEADER_BYTES) {
+        const uint8_t* header = file.data() + valid_bytes;
+        uint32_t size;
+        uint32_t crc;
+        LogRecord record;
+        memcpy(&size, header, sizeof(size));
+        memcpy(&crc, header + 4, sizeof(crc));
+        memcpy(&record.lsn, header + 8, sizeof(record.lsn));
+        record.type = static_cast<LogRecordType>(header[16]);
+        if (size > file.size() - valid_bytes - RECORD_HEADER_BYTES) {
+            break;
+        }
+        record.payload = span<const uint8_t>(header + RECORD_HEADER_BYTES, size);
+        if (record_checksum(record.lsn, record.type, record.payload) != crc || record.lsn <= last_lsn) {
+            break;
+        }
+        if (visit) {
+            visit(record);
+        }
+        last_lsn = record.lsn;
+        valid_bytes += RECORD_HEADER_BYTES + size;
+    }
+    return valid_bytes;
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, SyncPolicy policy, chrono::microseconds group_window,
+                             const function<void(const LogRecord&)>& replay)
+    : path(path), policy(policy), group_window(group_window) {
+    uint64_t last_lsn = 0;
+    // A checkpoint that did not finish leaves the segment it retired behind; it
+    // comes first. A torn tail is cut so that rotate can append to it.
+    if (filesystem::exists(retired_path())) {
+        auto retired = MappedFile::open(retired_path());
+        size_t valid_bytes = scan_records(*retired, retired_path(), replay, last_lsn);
+        size_t retired_bytes = retired->size();
+        io.reads.add();
+        io.bytes_read.add(retired_bytes);
+        retired.reset();
+        if (valid_bytes == 0) {
+            filesystem::remove(retired_path());
+        } else {
+            if (valid_bytes < retired_bytes) {
+                filesystem::resize_file(retired_path(), valid_bytes);
+            }
+            retired_on_open = true;
+        }
+    }
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0644);
+    if (fd < 0) {
+        throw runtime_error("Failed to open log: " + path);
+    }
+    try {
+        auto file = MappedFile::open(path);
+        size_t valid_bytes = scan_records(*file, path, replay, last_lsn);
+        io.reads.add();
+        io.bytes_read.add(file->size());
+        file.reset();
+        if (valid_bytes == 0) {
+            write_header();
+        } else if (resize_descriptor(fd, valid_bytes) != 0) {
+            throw runtime_error("Failed to cut torn records from log: " + path);
+        }
+        ::lseek(fd, 0, SEEK_END);
+        sync();
+        next_lsn = last_lsn + 1;
+        durable_lsn = last_lsn;
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    // Records appended but never committed are still written, just not synced.
+    if (failure.empty() && !pending.empty()) {
+        try {
+            write_all(pending);
+        } catch (const exception&) {
+        }
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+uint64_t WriteAheadLog::append_create_table(const Table& table) {
+    vector<uint8_t> schema = Serializer::encode_schema(table.get_name(), table);
+    return append(LogRecordType::CREATE_TABLE, schema);
+}
+
+uint64_t WriteAheadLog::append_create_index(const Table& table, size_t ordinal) {
+    RecordEncoder record;
+    record.put_string(table.get_name());
+    record.put<uint32_t>(static_cast<uint32_t>(ordinal));
+    return append(LogRecordType::CREATE_INDEX, record.data);
+}
+
+uint64_t WriteAheadLog::append_insert(const Table& table, size_t first_row, size_t rows) {
+    auto columns = table.get_columns();
+    RecordEncoder record;
+    record.put_string(table.get_name());
+    record.put<uint64_t>(rows);
+    record.put<uint32_t>(static_cast<uint32_t>(columns.size()));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const ColumnStorage& storage = table.get_column_storage(i);
+        record.put<int32_t>(columns[i].get_autoincrement_value());
+        switch (storage.get_type()) {
+            case DataType::INT32:
+                record.put_raw(storage.int32_data() + first_row, rows * sizeof(int32_t));
+                break;
+            case DataType::BOOL:
+                record.put_raw(storage.bool_data() + first_row, rows);
+                break;
+            case DataType::STRING:
+            case DataType::BYTES: {
+                // Records hold the values themselves, whatever the column's layout.
+                if (storage.is_dictionary() || storage.is_inline()) {
+                    for (size_t row = first_row; row < first_row + rows; ++row) {
+                        record.put<uint32_t>(static_cast<uint32_t>(storage.get_string(row).size()));
+                    }
+                    for (size_t row = first_row; row < first_row + rows; ++row) {
+                        record.put_raw(storage.get_string(row).data(), storage.get_string(row).size());
+                    }
+                    break;
+                }
+                span<const uint64_t> offsets = storage.get_offsets();
+                for (size_t row = first_row; row < first_row + rows; ++row) {
+                    record.put<uint32_t>(static_cast<uint32_t>(offsets[row + 1] - offsets[row]));
+                }
+                record.put_raw(storage.get_blob().data() + offsets[first_row], offsets[first_row + rows] - offsets[first_row]);
+                break;
+            }
+        }
+    }
+    return append(LogRecordType::INSERT, record.data);
+}
+
+uint64_t WriteAheadLog::append(LogRecordType type, span<const uint8_t> payload) {
+    if (payload.size() > MAX_RECORD_BYTES) {
+        throw runtime_error("Log record of " + to_string(payload.size()) + " bytes exceeds the limit of " + to_string(MAX_RECORD_BYTES) + " bytes");
+    }
+    lock_guard<mutex> lock(log_mutex);
+    if (!failure.empty()) {
+        throw runtime_error(failure);
+    }
+    uint64_t lsn = next_lsn++;
+    io.records.add();
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    uint32_t crc = record_checksum(lsn, type, payload);
+    uint8_t header[RECORD_HEADER_BYTES];
+    memcpy(header, &size, sizeof(size));
+    memcpy(header + 4, &crc, sizeof(crc));
+    memcpy(header + 8, &lsn, sizeof(lsn));
+    header[16] = static_cast<uint8_t>(type);
+    size_t offset = pending.size();
+    pending.resize(offset + RECORD_HEADER_BYTES + payload.size());
+    memcpy(pending.data() + offset, header, RECORD_HEADER_BYTES);
+    if (!payload.empty()) {
+        memcpy(pending.data() + offset + RECORD_HEADER_BYTES, payload.data(), payload.size());
+    }
+    pending_ends.emplace_back(lsn, pending.size());
+    return lsn;
+}
+
+void WriteAheadLog::commit(uint64_t lsn) {
+    unique_lock<mutex> lock(log_mutex);
+    while (durable_lsn < lsn) {
+        if (!failure.empty()) {
+            throw runtime_error(failure);
+        }
+        if (flushing) {
+            flushed.wait(lock);
+            continue;
+        }
+
+        // This commit leads: it writes whatever the others appended meanwhile.
+        flushing = true;
+        if (policy == SyncPolicy::GROUP && group_window.count() > 0) {
+            lock.unlock();
+            this_thread::sleep_for(group_window);
+            lock.lock();
+        }
+        vector<uint8_t> batch;
+        uint64_t batch_lsn = next_lsn - 1;
+        if (policy == SyncPolicy::EVERY_COMMIT) {
+            // Only this commit's records are flushed; later ones wait for their own.
+            auto last = upper_bound(pending_ends.begin(), pending_ends.end(), lsn,
+                                    [](uint64_t target, const pair<uint64_t, size_t>& end) { return target < end.first; });
+            size_t bytes = last == pending_ends.begin() ? 0 : prev(last)->second;
+            batch_lsn = last == pending_ends.begin() ? lsn : prev(last)->first;
+            batch.assign(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(bytes));
+            pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(bytes));
+            pending_ends.erase(pending_ends.begin(), last);
+            for (auto& end : pending_ends) {
+                end.second -= bytes;
+            }
+        } else {
+            batch.swap(pending);
+            pending_ends.clear();
+        }
+        lock.unlock();
+
+        string error;
+        try {
+            write_all(batch);
+            if (policy != SyncPolicy::NONE) {
+                sync();
+            }
+        } catch (const exception& e) {
+            error = e.what();
+        }
+
+        lock.lock();
+        flushing = false;
+        if (error.empty()) {
+            durable_lsn = max(durable_lsn, batch_lsn);
+        } else {
+            failure = error;
+        }
+        flushed.notify_all();
+    }
+}
+
+bool WriteAheadLog::rotate() {
+    unique_lock<mutex> lock(log_mutex);
+    flushed.wait(lock, [this] { return !flushing; });
+    if (!failure.empty()) {
+        throw runtime_error(failure);
+    }
+    bool take_over = filesystem::exists(retired_path());
+    if (take_over && !retired_on_open) {
+        return false;
+    }
+    try {
+        write_all(pending);
+        sync();
+        pending.clear();
+        pending_ends.clear();
+        durable_lsn = next_lsn - 1;
+        if (take_over) {
+            // Nothing but a checkpoint deletes a retired file left over from
+            // before the log was opened, so the records logged since follow it
+            // there. A crash before the log is reset leaves them in both files,
+            // and replay skips the second copy.
+            append_to_retired();
+            retired_on_open = false;
+            ::lseek(fd, 0, SEEK_SET);
+            write_header();
+            sync();
+            return true;
+        }
+        ::close(fd);
+        fd = -1;
+        filesystem::rename(path, retired_path());
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0644);
+        if (fd < 0) {
+            throw runtime_error("Failed to open log: " + path);
+        }
+        write_header();
+        sync();
+    } catch (const exception& e) {
+        failure = e.what();
+        throw;
+    }
+    return true;
+}
+
+void WriteAheadLog::discard_retired() {
+    filesystem::remove(retired_path());
+}
+
+void WriteAheadLog::append_to_retired() {
+    auto current = MappedFile::open(path);
+    span<const uint8_t> records(current->data() + LOG_HEADER_BYTES, current->size() - LOG_HEADER_BYTES);
+    int retired = ::open(retired_path().c_str(), O_WRONLY | O_APPEND | O_BINARY);
+    if (retired < 0) {
+        throw runtime_error("Failed to open retired log: " + retired_path());
+    }
+    bool written = write_descriptor(retired, records) && sync_descriptor(retired) == 0;
+    ::close(retired);
+    if (!written) {
+        throw runtime_error("Failed to write retired log: " + retired_path());
+    }
+    io.writes.add();
+    io.bytes_written.add(records.size());
+    io.syncs.add();
+}
+
+uint64_t WriteAheadLog::get_last_lsn() const {
+    lock_guard<mutex> lock(log_mutex);
+    return next_lsn - 1;
+}
+
+void WriteAheadLog::advance_lsn(uint64_t lsn) {
+    lock_guard<mutex> lock(log_mutex);
+    if (lsn >= next_lsn) {
+        next_lsn = lsn + 1;
+        durable_lsn = max(durable_lsn, lsn);
+    }
+}
+
+void WriteAheadLog::write_header() {
+    RecordEncoder header;
+    header.put_raw(MAGIC, sizeof(MAGIC));
+    header.put<uint32_t>(FORMAT_VERSION);
+    header.put<uint32_t>(0);
+    if (resize_descriptor(fd, 0) != 0) {
+        throw runtime_error("Failed to reset log: " + path);
+    }
+    write_all(header.data);
+}
+
+void WriteAheadLog::write_all(span<const uint8_t> data) {
+    io.writes.add();
+    io.bytes_written.add(data.size());
+    if (!write_descriptor(fd, data)) {
+        throw runtime_error("Failed to write log: " + path);
+    }
+}
+
+void WriteAheadLog::sync() {
+    auto start = chrono::steady_clock::now();
+    if (sync_descriptor(fd) != 0) {
+        throw runtime_error("Failed to sync log: " + path);
+    }
+    io.syncs.add();
+    io.latency.record(chrono::steady_clock::now() - start);
+}
+
+void WriteAheadLog::apply(const LogRecord& record, unordered_map<string, shared_ptr<Table>>& tables) {
+    switch (record.type) {
+        case LogRecordType::CREATE_TABLE: {
+            uint64_t row_count = 0;
+            shared_ptr<Table> table = Serializer::decode_schema(record.payload, row_count);
+            auto existing = tables.find(table->get_name());
+            if (existing != tables.end()) {
+                if (existing->second->get_log_lsn() >= record.lsn) {
+                    return;
+                }
+                throw SerializationException("Log creates an existing table: " + table->get_name());
+            }
+            table->set_log_lsn(record.lsn);
+            tables[table->get_name()] = table;
+            return;
+        }
+        case LogRecordType::CREATE_INDEX: {
+            RecordDecoder in(record.payload);
+            shared_ptr<Table> table = find_logged_table(in.get_string(), tables);
+            if (table->get_log_lsn() >= record.lsn) {
+                return;
+            }
+            table->create_ordered_index(in.get<uint32_t>());
+            table->set_log_lsn(record.lsn);
+            return;
+        }
+        case LogRecordType::INSERT: {
+            RecordDecoder in(record.payload);
+            shared_ptr<Table> table = find_logged_table(in.get_string(), tables);
+            if (table->get_log_lsn() >= record.lsn) {
+                return;
+            }
+            uint64_t rows = in.get<uint64_t>();
+            uint32_t column_count = in.get<uint32_t>();
+            auto columns = table->get_columns();
+            if (column_count != columns.size()) {
+                throw SerializationException("Column count mismatch in log record for table: " + table->get_name());
+            }
+
+            vector<ColumnStorage> batch;
+            vector<int32_t> autoincrement_values;
+            batch.reserve(column_count);
+            for (const Column& column : columns) {
+                autoincrement_values.push_back(in.get<int32_t>());
+                ColumnStorage& storage = batch.emplace_back(column.get_type());
+                switch (column.get_type()) {
+                    case DataType::INT32: {
+                        vector<int32_t> values(rows);
+                        memcpy(values.data(), in.take(rows * sizeof(int32_t)), rows * sizeof(int32_t));
+                        storage.append_int32_values(values);
+                        break;
+                    }
+                    case DataType::BOOL:
+                        storage.append_bool_values(span<const uint8_t>(in.take(rows), rows));
+                        break;
+                    case DataType::STRING:
+                    case DataType::BYTES: {
+                        vector<uint64_t> offsets(rows + 1, 0);
+                        for (size_t row = 0; row < rows; ++row) {
+                            offsets[row + 1] = offsets[row] + in.get<uint32_t>();
+                        }
+                        storage.append_blob_values(offsets, span<const uint8_t>(in.take(offsets.back()), offsets.back()));
+                        break;
+                    }
+                }
+            }
+            table->append_columns(batch);
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (columns[i].is_autoincrement()) {
+                    // append_columns already moved the counter past the replayed values.
+                    table->set_autoincrement_value(i, max(autoincrement_values[i], table->get_schema()->get_column(i).get_autoincrement_value()));
+                }
+            }
+            table->set_log_lsn(record.lsn);
+            return;
+        }
+    }
+    throw SerializationException("Unknown log record type " + to_string(static_cast<int>(record.type)));
+}